@@ -0,0 +1,33 @@
+#!/bin/bash
+
+# Host tests for the Ventoy EFI driver, built with gcc instead of the EDK2 tools.
+# Every <Uefi.h>, <Library/xxx.h>, <Protocol/xxx.h> and <Guid/xxx.h> included by the
+# driver is mapped to test/edk2_host.h. All the driver sources are compiled and linked.
+
+VT_EDK_DIR=$PWD
+VT_APP_DIR=$VT_EDK_DIR/edk2_mod/edk2-edk2-stable201911/MdeModulePkg/Application/Ventoy
+
+TMP_DIR=$(mktemp -d)
+
+for h in $(grep -ho '<[A-Za-z/]*[A-Za-z0-9]*\.h>' $VT_APP_DIR/*.c | sort -u | sed 's/[<>]//g'); do
+    [ "$h" = "Ventoy.h" ] && continue
+    mkdir -p $TMP_DIR/$(dirname $h)
+    echo '#include <edk2_host.h>' > $TMP_DIR/$h
+done
+
+XXFLAG="-O2 -fshort-wchar -Wall -Wno-unused-function -I$TMP_DIR -I$VT_EDK_DIR/test -I$VT_APP_DIR"
+
+# the driver is compiled once and linked with every test
+for f in Ventoy VentoyDebug VentoyProtocol; do
+    gcc $XXFLAG -c $VT_APP_DIR/$f.c -o $TMP_DIR/$f.o || { rm -rf $TMP_DIR; exit 1; }
+done
+gcc $XXFLAG -c $VT_EDK_DIR/test/edk2_host.c -o $TMP_DIR/edk2_host.o || { rm -rf $TMP_DIR; exit 1; }
+
+rc=0
+for t in ventoy_secover_test ventoy_memdisk_test; do
+    gcc $XXFLAG $VT_EDK_DIR/test/$t.c $TMP_DIR/*.o -o $TMP_DIR/$t || { rm -rf $TMP_DIR; exit 1; }
+    $TMP_DIR/$t || rc=1
+done
+
+rm -rf $TMP_DIR
+exit $rc
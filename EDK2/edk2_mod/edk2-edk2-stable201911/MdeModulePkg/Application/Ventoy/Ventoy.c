@@ -32,6 +32,7 @@
 #include <Guid/FileInfo.h>
 #include <Guid/FileSystemInfo.h>
 #include <Protocol/BlockIo.h>
+#include <Protocol/BlockIo2.h>
 #include <Protocol/RamDisk.h>
 #include <Protocol/SimpleFileSystem.h>
 #include <Protocol/DriverBinding.h>
@@ -263,9 +264,17 @@ static int ventoy_update_image_location(ventoy_os_param *param)
     void *buffer = NULL;
     ventoy_image_location *location = NULL;
     ventoy_image_disk_region *region = NULL;
+    UINT32 region_count = g_img_chunk_num;
     ventoy_img_chunk *chunk = g_chunk;
 
-    length = sizeof(ventoy_image_location) + (g_img_chunk_num - 1) * sizeof(ventoy_image_disk_region);
+    /* chunks placed after the image (linux cpio payload) are not part of the image */
+    while (region_count > 1 && 
+           g_chunk[region_count - 1].img_start_sector >= (g_chain->real_img_size_in_bytes + 2047) / 2048)
+    {
+        region_count--;
+    }
+
+    length = sizeof(ventoy_image_location) + (region_count - 1) * sizeof(ventoy_image_disk_region);
 
     Status = gBS->AllocatePool(EfiRuntimeServicesData, length + 4096 * 2, &buffer);
     if (EFI_ERROR(Status) || NULL == buffer)
@@ -302,13 +311,13 @@ static int ventoy_update_image_location(ventoy_os_param *param)
     CopyMem(&location->guid, &param->guid, sizeof(ventoy_guid));
     location->image_sector_size = gSector512Mode ? 512 : 2048;
     location->disk_sector_size  = g_chain->disk_sector_size;
-    location->region_count = g_img_chunk_num;
+    location->region_count = region_count;
 
     region = location->regions;
 
     if (gSector512Mode)
     {
-        for (i = 0; i < g_img_chunk_num; i++)
+        for (i = 0; i < region_count; i++)
         {
             region->image_sector_count = chunk->disk_end_sector - chunk->disk_start_sector + 1;
             region->image_start_sector = chunk->img_start_sector * 4;
@@ -319,7 +328,7 @@ static int ventoy_update_image_location(ventoy_os_param *param)
     }
     else
     {
-        for (i = 0; i < g_img_chunk_num; i++)
+        for (i = 0; i < region_count; i++)
         {
             region->image_sector_count = chunk->img_end_sector - chunk->img_start_sector + 1;
             region->image_start_sector = chunk->img_start_sector;
@@ -525,91 +534,268 @@ STATIC EFI_STATUS EFIAPI ventoy_load_image
 }
 
 
+STATIC EFI_HANDLE EFIAPI ventoy_get_boot_disk_handle(IN EFI_HANDLE ImageHandle)
+{
+    EFI_STATUS Status = EFI_SUCCESS;
+    EFI_BLOCK_IO_PROTOCOL *pBlockIo = NULL;
+    EFI_DEVICE_PATH_PROTOCOL *pDevPath = NULL;
+    EFI_LOADED_IMAGE_PROTOCOL *pImageInfo = NULL;
+
+    /* we are loaded from a partition of the ventoy disk in most cases */
+    Status = gBS->HandleProtocol(ImageHandle, &gEfiLoadedImageProtocolGuid, (VOID **)&pImageInfo);
+    if (EFI_ERROR(Status) || NULL == pImageInfo->DeviceHandle)
+    {
+        return NULL;
+    }
+
+    Status = gBS->HandleProtocol(pImageInfo->DeviceHandle, &gEfiBlockIoProtocolGuid, (VOID **)&pBlockIo);
+    if (!EFI_ERROR(Status) && !pBlockIo->Media->LogicalPartition)
+    {
+        return pImageInfo->DeviceHandle;
+    }
+
+    Status = gBS->HandleProtocol(pImageInfo->DeviceHandle, &gEfiDevicePathProtocolGuid, (VOID **)&pDevPath);
+    if (EFI_ERROR(Status))
+    {
+        return NULL;
+    }
+
+    return ventoy_get_parent_handle(pDevPath);
+}
+
+STATIC BOOLEAN ventoy_is_iso_disk_sector0(IN UINT8 *pBuffer)
+{
+    return (CompareMem(g_chain->os_param.vtoy_disk_guid, pBuffer + 0x180, 16) == 0) ? TRUE : FALSE;
+}
+
+/* 
+ * Read sector 0 of all the candidates, async with BlockIo2 if supported, 
+ * so that the slow disks are read at the same time.
+ */
+STATIC VOID EFIAPI ventoy_probe_iso_disk(IN ventoy_disk_probe *Probe, IN UINTN Num)
+{
+    UINTN i = 0;
+    UINTN Index = 0;
+    UINT32 BlockSize = 0;
+    EFI_STATUS Status = EFI_SUCCESS;
+    ventoy_disk_probe *Cur = NULL;
+
+    for (i = 0; i < Num; i++)
+    {
+        Cur = Probe + i;
+        BlockSize = Cur->pBlockIo->Media->BlockSize;
+
+        /* page aligned buffer meets the IoAlign of the disk */
+        Cur->Buffer = AllocatePages(EFI_SIZE_TO_PAGES(BlockSize));
+        if (!Cur->Buffer || !Cur->pBlockIo2)
+        {
+            continue;
+        }
+
+        Status = gBS->CreateEvent(0, 0, NULL, NULL, &(Cur->Token.Event));
+        if (EFI_ERROR(Status))
+        {
+            Cur->Token.Event = NULL;
+            continue;
+        }
+
+        Status = Cur->pBlockIo2->ReadBlocksEx(Cur->pBlockIo2, Cur->pBlockIo2->Media->MediaId, 0, 
+                                              &(Cur->Token), BlockSize, Cur->Buffer);
+        if (EFI_ERROR(Status))
+        {
+            debug("ReadBlocksEx failed %r, use BlockIo", Status);
+            gBS->CloseEvent(Cur->Token.Event);
+            Cur->Token.Event = NULL;
+            continue;
+        }
+
+        Cur->Pending = TRUE;
+    }
+
+    /* disks without BlockIo2 */
+    for (i = 0; i < Num; i++)
+    {
+        Cur = Probe + i;
+        if (Cur->Pending || !Cur->Buffer)
+        {
+            continue;
+        }
+
+        Status = Cur->pBlockIo->ReadBlocks(Cur->pBlockIo, Cur->pBlockIo->Media->MediaId, 0, 
+                                           Cur->pBlockIo->Media->BlockSize, Cur->Buffer);
+        if (EFI_ERROR(Status))
+        {
+            debug("ReadBlocks filed %r", Status);
+            continue;
+        }
+
+        Cur->Match = ventoy_is_iso_disk_sector0(Cur->Buffer);
+    }
+
+    /* the buffers can only be freed after all the requests are finished */
+    for (i = 0; i < Num; i++)
+    {
+        Cur = Probe + i;
+        if (Cur->Pending)
+        {
+            gBS->WaitForEvent(1, &(Cur->Token.Event), &Index);
+            if (!EFI_ERROR(Cur->Token.TransactionStatus))
+            {
+                Cur->Match = ventoy_is_iso_disk_sector0(Cur->Buffer);
+            }
+            else
+            {
+                debug("ReadBlocksEx filed %r", Cur->Token.TransactionStatus);
+            }
+        }
+
+        if (Cur->Token.Event)
+        {
+            gBS->CloseEvent(Cur->Token.Event);
+        }
+
+        if (Cur->Buffer)
+        {
+            FreePages(Cur->Buffer, EFI_SIZE_TO_PAGES(Cur->pBlockIo->Media->BlockSize));
+        }
+    }
+}
+
+STATIC EFI_STATUS EFIAPI ventoy_set_iso_disk(IN EFI_HANDLE ImageHandle, IN ventoy_disk_probe *Probe)
+{
+    EFI_STATUS Status = EFI_SUCCESS;
+    MBR_HEAD *pMBR = NULL;
+
+    pMBR = AllocatePool(Probe->pBlockIo->Media->BlockSize);
+    if (!pMBR)
+    {
+        return EFI_OUT_OF_RESOURCES;
+    }
+
+    Status = Probe->pBlockIo->ReadBlocks(Probe->pBlockIo, Probe->pBlockIo->Media->MediaId, 0, 
+                                         Probe->pBlockIo->Media->BlockSize, pMBR);
+    if (!EFI_ERROR(Status) && pMBR->PartTbl[0].FsFlag != 0xEE)
+    {
+        if (pMBR->PartTbl[0].StartSectorId != 2048 ||
+            pMBR->PartTbl[1].SectorCount != 65536 ||
+            pMBR->PartTbl[1].StartSectorId != pMBR->PartTbl[0].StartSectorId + pMBR->PartTbl[0].SectorCount)
+        {
+            debug("Failed to check disk part table");
+            ventoy_warn_invalid_device();
+        }
+    }
+    FreePool(pMBR);
+
+    gBlockData.RawBlockIoHandle = Probe->Handle;
+    gBlockData.pRawBlockIo = Probe->pBlockIo;
+    gBS->OpenProtocol(Probe->Handle, &gEfiDevicePathProtocolGuid, 
+                      (VOID **)&(gBlockData.pDiskDevPath),
+                      ImageHandle,
+                      Probe->Handle,
+                      EFI_OPEN_PROTOCOL_GET_PROTOCOL);
+    
+    debug("Find Ventoy Disk Handle:%p DP:%s", Probe->Handle, 
+        ConvertDevicePathToText(gBlockData.pDiskDevPath, FALSE, FALSE));
+
+    return EFI_SUCCESS;
+}
+
 STATIC EFI_STATUS EFIAPI ventoy_find_iso_disk(IN EFI_HANDLE ImageHandle)
 {
     UINTN i = 0;
     UINTN Count = 0;
+    UINTN Num = 0;
     UINT64 DiskSize = 0;
-    MBR_HEAD *pMBR = NULL;
-    UINT8 *pBuffer = NULL;
+    UINT64 StartMs = 0;
+    EFI_HANDLE Hint = NULL;
     EFI_HANDLE *Handles;
     EFI_STATUS Status = EFI_SUCCESS;
     EFI_BLOCK_IO_PROTOCOL *pBlockIo;
+    ventoy_disk_probe *Probe = NULL;
+    ventoy_disk_probe Tmp;
 
-    pBuffer = AllocatePool(2048);
-    if (!pBuffer)
-    {
-        return EFI_OUT_OF_RESOURCES;
-    }
+    StartMs = ventoy_get_time_ms();
 
     Status = gBS->LocateHandleBuffer(ByProtocol, &gEfiBlockIoProtocolGuid, 
                                      NULL, &Count, &Handles);
     if (EFI_ERROR(Status))
     {
-        FreePool(pBuffer);
         return Status;
     }
 
+    Probe = AllocateZeroPool(Count * sizeof(ventoy_disk_probe));
+    if (!Probe)
+    {
+        FreePool(Handles);
+        return EFI_OUT_OF_RESOURCES;
+    }
+
+    Hint = ventoy_get_boot_disk_handle(ImageHandle);
+    debug("boot disk hint handle:%p", Hint);
+
+    /* only whole disks with the same size, partitions share the sector 0 of its disk */
     for (i = 0; i < Count; i++)
     {
         Status = gBS->HandleProtocol(Handles[i], &gEfiBlockIoProtocolGuid, (VOID **)&pBlockIo);
-        if (EFI_ERROR(Status))
+        if (EFI_ERROR(Status) || pBlockIo->Media->LogicalPartition || !pBlockIo->Media->MediaPresent)
         {
             continue;
         }
 
         DiskSize = (pBlockIo->Media->LastBlock + 1) * pBlockIo->Media->BlockSize;
         debug("This Disk size: %llu", DiskSize);
-        if (g_chain->os_param.vtoy_disk_size != DiskSize)
+        if (g_chain->os_param.vtoy_disk_size != DiskSize || pBlockIo->Media->BlockSize < 512)
         {
             continue;
         }
 
-        Status = pBlockIo->ReadBlocks(pBlockIo, pBlockIo->Media->MediaId, 0, 512, pBuffer);
-        if (EFI_ERROR(Status))
-        {
-            debug("ReadBlocks filed %r", Status);
-            continue;
-        }
+        Probe[Num].Handle = Handles[i];
+        Probe[Num].pBlockIo = pBlockIo;
+        gBS->HandleProtocol(Handles[i], &gEfiBlockIo2ProtocolGuid, (VOID **)&(Probe[Num].pBlockIo2));
 
-        if (CompareMem(g_chain->os_param.vtoy_disk_guid, pBuffer + 0x180, 16) == 0)
+        /* the disk we are loaded from is the first choice */
+        if (Handles[i] == Hint && Num > 0)
         {
-            pMBR = (MBR_HEAD *)pBuffer;
-            if (pMBR->PartTbl[0].FsFlag != 0xEE)
-            {
-                if (pMBR->PartTbl[0].StartSectorId != 2048 ||
-                    pMBR->PartTbl[1].SectorCount != 65536 ||
-                    pMBR->PartTbl[1].StartSectorId != pMBR->PartTbl[0].StartSectorId + pMBR->PartTbl[0].SectorCount)
-                {
-                    debug("Failed to check disk part table");
-                    ventoy_warn_invalid_device();
-                }
-            }
-        
-            gBlockData.RawBlockIoHandle = Handles[i];
-            gBlockData.pRawBlockIo = pBlockIo;
-            gBS->OpenProtocol(Handles[i], &gEfiDevicePathProtocolGuid, 
-                              (VOID **)&(gBlockData.pDiskDevPath),
-                              ImageHandle,
-                              Handles[i],
-                              EFI_OPEN_PROTOCOL_GET_PROTOCOL);
-            
-            debug("Find Ventoy Disk Handle:%p DP:%s", Handles[i], 
-                ConvertDevicePathToText(gBlockData.pDiskDevPath, FALSE, FALSE));
-            break;
+            CopyMem(&Tmp, Probe, sizeof(Tmp));
+            CopyMem(Probe, Probe + Num, sizeof(Tmp));
+            CopyMem(Probe + Num, &Tmp, sizeof(Tmp));
         }
+        Num++;
     }
 
     FreePool(Handles);
 
-    if (i >= Count)
+    debug("ventoy disk candidates:%u", Num);
+
+    /* try the hint alone first, the other disks are only read when it is not the ventoy disk */
+    if (Num > 0 && Hint && Probe[0].Handle == Hint)
     {
-        return EFI_NOT_FOUND;
+        ventoy_probe_iso_disk(Probe, 1);
+        if (!Probe[0].Match)
+        {
+            ventoy_probe_iso_disk(Probe + 1, Num - 1);
+        }
     }
-    else
+    else if (Num > 0)
     {
-        return EFI_SUCCESS;
+        ventoy_probe_iso_disk(Probe, Num);
+    }
+
+    Status = EFI_NOT_FOUND;
+    for (i = 0; i < Num; i++)
+    {
+        if (Probe[i].Match)
+        {
+            Status = ventoy_set_iso_disk(ImageHandle, Probe + i);
+            break;
+        }
     }
+
+    FreePool(Probe);
+
+    ventoy_report_time("ventoy_find_iso_disk", StartMs);
+
+    return Status;
 }
 
 
@@ -875,6 +1061,18 @@ STATIC EFI_STATUS EFIAPI ventoy_parse_cmdline(IN EFI_HANDLE ImageHandle)
         gSector512Mode = TRUE;
     }
 
+    /* throwaway writable session, writes go to a bounded RAM overlay, cow_size in MB */
+    if (StrStr(pCmdLine, L"cowdisk"))
+    {
+        gCowMode = TRUE;
+
+        pPos = StrStr(pCmdLine, L"cow_size=");
+        if (pPos && StrDecimalToUintn(pPos + 9) > 0)
+        {
+            gCowMaxSecs = StrDecimalToUintn(pPos + 9) * 512;
+        }
+    }
+
     if (StrStr(pCmdLine, L"memdisk"))
     {
         g_iso_data_buf = (UINT8 *)chain + sizeof(ventoy_chain_head);
@@ -883,6 +1081,15 @@ STATIC EFI_STATUS EFIAPI ventoy_parse_cmdline(IN EFI_HANDLE ImageHandle)
 
         g_chain = chain;
         gMemdiskMode = TRUE;
+
+        /* the chunk list of the image file is appended by vt_load_img_memdisk */
+        if (StrStr(pCmdLine, L"writeback") && chain->img_chunk_num > 0)
+        {
+            g_chunk = (ventoy_img_chunk *)((char *)chain + chain->img_chunk_offset);
+            g_img_chunk_num = chain->img_chunk_num;
+            gMemdiskWriteback = TRUE;
+            debug("memdisk writeback chunk num:%u", g_img_chunk_num);
+        }
     }
     else
     {
@@ -903,6 +1110,7 @@ STATIC EFI_STATUS EFIAPI ventoy_parse_cmdline(IN EFI_HANDLE ImageHandle)
         if (g_os_param_reserved[2] == ventoy_chain_windows && g_os_param_reserved[3] == 0)
         {
             g_fixup_iso9660_secover_enable = TRUE;
+            ventoy_fixup_iso9660_init();
         }
 
         if (g_os_param_reserved[2] == ventoy_chain_windows && g_os_param_reserved[4] != 1)
@@ -924,6 +1132,12 @@ STATIC EFI_STATUS EFIAPI ventoy_parse_cmdline(IN EFI_HANDLE ImageHandle)
 
         ventoy_update_image_location(&(g_chain->os_param));
 
+        pEnv = grub_env_get("VTOY_READ_TRACE");
+        if (pEnv && pEnv[0] >= '1' && pEnv[0] <= '9')
+        {
+            ventoy_read_trace_start(AsciiStrDecimalToUintn(pEnv));
+        }
+
         if (gDebugPrint)
         {
             ventoy_dump_chain(g_chain);
@@ -966,6 +1180,12 @@ EFI_STATUS EFIAPI ventoy_clean_env(VOID)
 
     ventoy_delete_variable();
 
+    ventoy_read_trace_stop();
+
+    ventoy_cow_free();
+
+    ventoy_fixup_iso9660_fini();
+
     if (g_vtoy_img_location_buf)
     {
         FreePool(g_vtoy_img_location_buf);
@@ -1102,6 +1322,8 @@ EFI_STATUS EFIAPI ventoy_boot(IN EFI_HANDLE ImageHandle)
                 pFile->OpenVolume = ventoy_wrapper_open_volume;
             }
 
+            ventoy_read_trace_checkpoint();
+
             ventoy_hook_start();
             /* can't add debug print here */
             //ventoy_wrapper_system();
@@ -1180,17 +1402,36 @@ EFI_STATUS EFIAPI VentoyEfiMain
 
         ventoy_save_ramdisk_param();
 
+        if (gLoadIsoEfi || gMemdiskWriteback)
+        {
+            if (EFI_ERROR(ventoy_find_iso_disk(ImageHandle)) && gMemdiskWriteback)
+            {
+                debug("ventoy disk not found, memdisk writeback disabled");
+                gMemdiskWriteback = FALSE;
+            }
+        }
+
         if (gLoadIsoEfi)
         {
-            ventoy_find_iso_disk(ImageHandle);
             ventoy_find_iso_disk_fs(ImageHandle);
             ventoy_load_isoefi_driver(ImageHandle);
         }
+
+        if (gMemdiskWriteback && EFI_ERROR(ventoy_memdisk_writeback_init()))
+        {
+            gMemdiskWriteback = FALSE;
+        }
         
         ventoy_install_blockio(ImageHandle, g_iso_buf_size);
         ventoy_debug_pause();
 
         Status = ventoy_boot(ImageHandle);
+
+        if (gMemdiskWriteback)
+        {
+            ventoy_memdisk_writeback_fini();
+            gMemdiskWriteback = FALSE;
+        }
         
         ventoy_delete_ramdisk_param();
 
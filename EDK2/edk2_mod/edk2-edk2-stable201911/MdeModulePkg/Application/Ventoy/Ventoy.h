@@ -143,6 +143,13 @@ typedef struct ventoy_img_chunk
     UINT64 disk_end_sector;
 }ventoy_img_chunk;
 
+/*
+ * A chunk whose disk sectors start from VTOY_ZERO_CHUNK_SECTOR has no storage
+ * (unallocated block of a dynamic vdisk). It reads as zero and can't be written.
+ */
+#define VTOY_ZERO_CHUNK_SECTOR    0x8000000000000000ULL
+#define VTOY_IS_ZERO_CHUNK(chunk) ((chunk)->disk_start_sector >= VTOY_ZERO_CHUNK_SECTOR)
+
 
 typedef struct ventoy_override_chunk
 {
@@ -245,6 +252,8 @@ typedef int (*grub_env_printf_pf)(const char *fmt, ...);
 #define GRUB_FILE_REPLACE_MAGIC  0x1258BEEF
 #define GRUB_IMG_REPLACE_MAGIC   0x1259BEEF
 
+#define VTOY_FILE_CACHE_SECS     4
+
 typedef struct ventoy_efi_file_replace
 {
     UINT64 BlockIoSectorStart;
@@ -252,6 +261,11 @@ typedef struct ventoy_efi_file_replace
     UINT64 CurPos;
     UINT64 FileSizeBytes;
 
+    /* small sector cache for the unaligned head/tail of the reads */
+    UINT64 CacheSector;
+    UINT32 CacheSecs;
+    UINT8  CacheBuf[VTOY_FILE_CACHE_SECS * 2048];
+
     EFI_FILE_PROTOCOL  WrapperHandle;
 }ventoy_efi_file_replace;
 
@@ -272,12 +286,72 @@ typedef struct ventoy_grub_param
     grub_env_printf_pf grub_env_printf;    
 }ventoy_grub_param;
 
+/* max sectors of one write in memdisk writeback: 4MB */
+#define VTOY_WRITEBACK_MAX_SECS  2048
+
+/* default size of the cow overlay: 64MB */
+#define VTOY_COW_DEF_SECS  32768
+
+/* empty bucket of the cow index */
+#define VTOY_COW_SLOT_FREE  0xFFFFFFFF
+
+typedef struct ventoy_cow_sector
+{
+    UINT64 Lba;  /* 2048 sector */
+    UINT32 Slot; /* VTOY_COW_SLOT_FREE for an empty bucket */
+}ventoy_cow_sector;
+
+/* candidate of the ventoy disk, sector 0 is read with BlockIo2 when possible */
+typedef struct ventoy_disk_probe
+{
+    EFI_HANDLE Handle;
+    EFI_BLOCK_IO_PROTOCOL *pBlockIo;
+    EFI_BLOCK_IO2_PROTOCOL *pBlockIo2;
+    EFI_BLOCK_IO2_TOKEN Token;
+    UINT8 *Buffer;
+    BOOLEAN Pending;
+    BOOLEAN Match;
+}ventoy_disk_probe;
+
 typedef struct ventoy_ram_disk
 {
     UINT64 PhyAddr;
     UINT64 DiskSize;
 }ventoy_ram_disk;
 
+/*
+ * Optional read trace, enabled by grub env VTOY_READ_TRACE={entry count}.
+ * Every ventoy_block_io_read is recorded into a ring buffer in runtime memory.
+ * Just before the boot image is started (and again when the boot returns) the ring is
+ * saved into the volatile EFI variable "VentoyReadTrace" (VENTOY_GUID): this head
+ * followed by EntryNum entries (oldest first). Reads done by the OS loader after that
+ * only go to the ring, which stays at RingAddr. On Linux it can be read from
+ * /sys/firmware/efi/efivars/VentoyReadTrace-77772020-2e77-6576-6e74-6f792e6e6574
+ * (the first 4 bytes of that file are the variable attributes).
+ */
+#define VTOY_READ_TRACE_VERSION     2
+#define VTOY_READ_TRACE_MAX_ENTRY   (1024 * 1024)
+
+typedef struct ventoy_read_trace_entry
+{
+    UINT64 Lba;    /* in head BlockSize */
+    UINT32 Count;  /* in head BlockSize */
+    UINT32 Seq;    /* read sequence number (low 32 bits) */
+}ventoy_read_trace_entry;
+
+typedef struct ventoy_read_trace_head
+{
+    ventoy_guid guid;   /* VENTOY_GUID */
+    UINT32 Version;     /* VTOY_READ_TRACE_VERSION */
+    UINT32 EntrySize;   /* sizeof(ventoy_read_trace_entry) */
+    UINT32 MaxEntry;    /* ring capacity */
+    UINT32 EntryNum;    /* entries following this head */
+    UINT64 TotalRead;   /* total reads recorded, may exceed MaxEntry */
+    UINT64 RingAddr;    /* physical address of the whole ring, 0 if freed */
+    UINT32 BlockSize;   /* unit of Lba and Count in bytes */
+    UINT32 Reserved;
+}ventoy_read_trace_head;
+
 typedef struct ventoy_iso9660_override
 {
     UINT32 first_sector;
@@ -286,6 +360,16 @@ typedef struct ventoy_iso9660_override
     UINT32 size_be;
 }ventoy_iso9660_override;
 
+/* file whose first sector is beyond VENTOY_ISO9660_SECTOR_OVERFLOW (SSTR PE loader workaround) */
+typedef struct ventoy_secover_file
+{
+    UINT32 first_sector;
+    UINT32 tot_secs;
+    UINT32 cur_secs;
+    BOOLEAN armed;   /* its dirent has been read, waiting for the wrapped read */
+    BOOLEAN active;  /* wrapped read of the file is in progress */
+}ventoy_secover_file;
+
 typedef struct PART_TABLE
 {
     UINT8  Active; // 0x00  0x80
@@ -402,6 +486,9 @@ extern ventoy_efi_file_replace g_img_file_replace;
 extern ventoy_sector_flag *g_sector_flag;
 extern UINT32 g_sector_flag_num;
 extern BOOLEAN gMemdiskMode;
+extern BOOLEAN gCowMode;
+extern BOOLEAN gMemdiskWriteback;
+extern UINTN gCowMaxSecs;
 extern BOOLEAN gSector512Mode;
 extern UINTN g_iso_buf_size;
 extern UINT8 *g_iso_data_buf;
@@ -425,6 +512,19 @@ EFI_STATUS ventoy_hook_1st_cdrom_start(VOID);
 EFI_STATUS ventoy_hook_1st_cdrom_stop(VOID);
 EFI_STATUS ventoy_disable_ex_filesystem(VOID);
 EFI_STATUS ventoy_enable_ex_filesystem(VOID);
+EFI_STATUS ventoy_fixup_iso9660_init(VOID);
+VOID ventoy_fixup_iso9660_fini(VOID);
+VOID ventoy_cow_free(VOID);
+VOID ventoy_memdisk_mark_dirty(IN EFI_LBA Lba, IN UINTN Count);
+EFI_STATUS ventoy_memdisk_writeback(VOID);
+EFI_STATUS ventoy_memdisk_writeback_init(VOID);
+VOID ventoy_memdisk_writeback_fini(VOID);
+EFI_STATUS ventoy_read_trace_start(IN UINTN MaxEntry);
+EFI_STATUS ventoy_read_trace_stop(VOID);
+EFI_STATUS ventoy_read_trace_checkpoint(VOID);
+VOID ventoy_read_trace_record(IN EFI_LBA Lba, IN UINTN Count);
+UINT64 ventoy_get_time_ms(VOID);
+VOID ventoy_report_time(IN CONST CHAR8 *Name, IN UINT64 StartMs);
 
 #endif
 
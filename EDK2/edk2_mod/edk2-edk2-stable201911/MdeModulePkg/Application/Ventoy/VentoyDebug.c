@@ -32,6 +32,7 @@
 #include <Guid/FileInfo.h>
 #include <Guid/FileSystemInfo.h>
 #include <Protocol/BlockIo.h>
+#include <Protocol/BlockIo2.h>
 #include <Protocol/RamDisk.h>
 #include <Protocol/SimpleFileSystem.h>
 #include <Protocol/DriverBinding.h>
@@ -227,3 +228,197 @@ EFI_STATUS EFIAPI ventoy_wrapper_system(VOID)
     return EFI_SUCCESS;
 }
 
+
+/* 
+ * Wall clock in milliseconds, only for the elapsed time of the debug report.
+ * The resolution depends on the firmware RTC, many of them only have seconds.
+ */
+UINT64 ventoy_get_time_ms(VOID)
+{
+    EFI_TIME Time;
+
+    if (EFI_ERROR(gRT->GetTime(&Time, NULL)))
+    {
+        return 0;
+    }
+
+    return ((((UINT64)Time.Day * 24 + Time.Hour) * 60 + Time.Minute) * 60 + Time.Second) * 1000 + 
+           Time.Nanosecond / 1000000;
+}
+
+VOID ventoy_report_time(IN CONST CHAR8 *Name, IN UINT64 StartMs)
+{
+    UINT64 Now = ventoy_get_time_ms();
+
+    debug("%a took %lu ms", Name, (Now >= StartMs) ? (Now - StartMs) : 0);
+}
+
+/* read trace recorder, see ventoy_read_trace_head in Ventoy.h */
+STATIC ventoy_read_trace_head *g_read_trace = NULL;
+STATIC ventoy_read_trace_entry *g_read_trace_ring = NULL;
+STATIC ventoy_read_trace_head *g_read_trace_var = NULL;
+STATIC UINTN g_read_trace_pos = 0;
+
+VOID ventoy_read_trace_record(IN EFI_LBA Lba, IN UINTN Count)
+{
+    ventoy_read_trace_entry *Entry = NULL;
+
+    if (!g_read_trace)
+    {
+        return;
+    }
+
+    Entry = g_read_trace_ring + g_read_trace_pos;
+    Entry->Lba = Lba;
+    Entry->Count = (UINT32)Count;
+    Entry->Seq = (UINT32)g_read_trace->TotalRead;
+
+    g_read_trace->TotalRead++;
+    if (++g_read_trace_pos >= g_read_trace->MaxEntry)
+    {
+        g_read_trace_pos = 0;
+    }
+}
+
+STATIC EFI_STATUS ventoy_read_trace_save(VOID)
+{
+    UINTN i;
+    UINTN Num;
+    UINTN Start;
+    EFI_STATUS Status = EFI_SUCCESS;
+    EFI_GUID VarGuid = VENTOY_GUID;
+    ventoy_read_trace_entry *Entry = NULL;
+
+    if (!g_read_trace || !g_read_trace_var)
+    {
+        return EFI_NOT_READY;
+    }
+
+    if (g_read_trace->TotalRead < g_read_trace->MaxEntry)
+    {
+        Num = (UINTN)g_read_trace->TotalRead;
+    }
+    else
+    {
+        Num = g_read_trace->MaxEntry;
+    }
+
+    /* firmware limits the variable size, keep the latest entries that fit */
+    do
+    {
+        CopyMem(g_read_trace_var, g_read_trace, sizeof(ventoy_read_trace_head));
+        g_read_trace_var->EntryNum = (UINT32)Num;
+
+        Start = (g_read_trace_pos + g_read_trace->MaxEntry - Num) % g_read_trace->MaxEntry;
+        Entry = (ventoy_read_trace_entry *)(g_read_trace_var + 1);
+        for (i = 0; i < Num; i++)
+        {
+            CopyMem(Entry + i, g_read_trace_ring + Start, sizeof(ventoy_read_trace_entry));
+            if (++Start >= g_read_trace->MaxEntry)
+            {
+                Start = 0;
+            }
+        }
+
+        Status = gRT->SetVariable(L"VentoyReadTrace", &VarGuid, 
+                      EFI_VARIABLE_BOOTSERVICE_ACCESS | EFI_VARIABLE_RUNTIME_ACCESS,
+                      sizeof(ventoy_read_trace_head) + Num * sizeof(ventoy_read_trace_entry),
+                      g_read_trace_var);
+        if (!EFI_ERROR(Status) || Num == 0)
+        {
+            break;
+        }
+
+        Num /= 2;
+    } while (1);
+
+    return Status;
+}
+
+/*
+ * Called before StartImage, boot services (and SetVariable) are still usable.
+ * Later reads are only kept in the ring.
+ */
+EFI_STATUS ventoy_read_trace_checkpoint(VOID)
+{
+    if (!g_read_trace)
+    {
+        return EFI_SUCCESS;
+    }
+
+    return ventoy_read_trace_save();
+}
+
+EFI_STATUS ventoy_read_trace_start(IN UINTN MaxEntry)
+{
+    UINTN Size;
+    EFI_STATUS Status = EFI_SUCCESS;
+    EFI_GUID VarGuid = VENTOY_GUID;
+
+    if (MaxEntry == 0)
+    {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    if (MaxEntry > VTOY_READ_TRACE_MAX_ENTRY)
+    {
+        MaxEntry = VTOY_READ_TRACE_MAX_ENTRY;
+    }
+
+    Size = sizeof(ventoy_read_trace_head) + MaxEntry * sizeof(ventoy_read_trace_entry);
+
+    /* keep the ring in runtime memory so that it's still there after boot */
+    Status = gBS->AllocatePool(EfiRuntimeServicesData, Size, (VOID **)&g_read_trace);
+    if (EFI_ERROR(Status) || NULL == g_read_trace)
+    {
+        debug("Failed to allocate read trace ring %r", Status);
+        g_read_trace = NULL;
+        return EFI_OUT_OF_RESOURCES;
+    }
+
+    g_read_trace_var = AllocatePool(Size);
+    if (NULL == g_read_trace_var)
+    {
+        gBS->FreePool(g_read_trace);
+        g_read_trace = NULL;
+        return EFI_OUT_OF_RESOURCES;
+    }
+
+    ZeroMem(g_read_trace, sizeof(ventoy_read_trace_head));
+    CopyMem(&g_read_trace->guid, &VarGuid, sizeof(ventoy_guid));
+    g_read_trace->Version = VTOY_READ_TRACE_VERSION;
+    g_read_trace->EntrySize = sizeof(ventoy_read_trace_entry);
+    g_read_trace->MaxEntry = (UINT32)MaxEntry;
+    g_read_trace->RingAddr = (UINT64)(UINTN)g_read_trace;
+    g_read_trace->BlockSize = 2048; /* ventoy_block_io_read works in 2048, sector512 reads are converted before */
+
+    g_read_trace_ring = (ventoy_read_trace_entry *)(g_read_trace + 1);
+    g_read_trace_pos = 0;
+
+    debug("read trace start max:%lu addr:%p", MaxEntry, g_read_trace);
+
+    return EFI_SUCCESS;
+}
+
+EFI_STATUS ventoy_read_trace_stop(VOID)
+{
+    EFI_STATUS Status = EFI_SUCCESS;
+
+    if (!g_read_trace)
+    {
+        return EFI_SUCCESS;
+    }
+
+    /* boot returned, the ring is about to be freed */
+    g_read_trace->RingAddr = 0;
+    Status = ventoy_read_trace_save();
+    debug("read trace stop total:%lu save:%r", g_read_trace->TotalRead, Status);
+
+    FreePool(g_read_trace_var);
+    gBS->FreePool(g_read_trace);
+    g_read_trace_var = NULL;
+    g_read_trace_ring = NULL;
+    g_read_trace = NULL;
+
+    return Status;
+}
@@ -32,6 +32,7 @@
 #include <Guid/FileInfo.h>
 #include <Guid/FileSystemInfo.h>
 #include <Protocol/BlockIo.h>
+#include <Protocol/BlockIo2.h>
 #include <Protocol/RamDisk.h>
 #include <Protocol/SimpleFileSystem.h>
 #include <Protocol/DriverBinding.h>
@@ -44,6 +45,28 @@ UINT8 *g_iso_data_buf = NULL;
 UINTN g_iso_buf_size = 0;
 BOOLEAN gMemdiskMode = FALSE;
 BOOLEAN gSector512Mode = FALSE;
+BOOLEAN gCowMode = FALSE;
+BOOLEAN gMemdiskWriteback = FALSE;
+UINTN gCowMaxSecs = VTOY_COW_DEF_SECS;
+
+/* 
+ * copy-on-write overlay, g_cow_index is an open addressing hash table of at least
+ * twice gCowMaxSecs buckets, the data of the sector is in g_cow_data[Slot]
+ */
+STATIC ventoy_cow_sector *g_cow_index = NULL;
+STATIC UINTN g_cow_index_mask = 0;
+STATIC UINT8 *g_cow_data = NULL;
+STATIC UINTN g_cow_used = 0;
+
+/* 
+ * dirty 2048 sectors of the memdisk, written back to the image file in writeback mode
+ * on FlushBlocks, just before ExitBootServices and when the boot returns. No disk I/O
+ * is possible after ExitBootServices, so the writes that the OS makes after that are not saved.
+ */
+STATIC UINT8 *g_memdisk_dirty = NULL;
+STATIC UINTN g_memdisk_dirty_secs = 0;
+STATIC EFI_EXIT_BOOT_SERVICES g_org_exit_boot_services = NULL;
+STATIC BOOLEAN g_memdisk_exit_bs_flushed = FALSE;
 
 ventoy_sector_flag *g_sector_flag = NULL;
 UINT32 g_sector_flag_num = 0;
@@ -59,9 +82,13 @@ EFI_GUID gVtoyBlockDevicePathGuid = VTOY_BLOCK_DEVICE_PATH_GUID;
 
 BOOLEAN g_fixup_iso9660_secover_enable = FALSE;
 BOOLEAN g_fixup_iso9660_secover_start  = FALSE;
-UINT64  g_fixup_iso9660_secover_1st_secs = 0;
-UINT64  g_fixup_iso9660_secover_cur_secs = 0;
-UINT64  g_fixup_iso9660_secover_tot_secs = 0;
+
+/* sorted first sectors of all the dirent overrides, and the overflowed files among them */
+STATIC UINT32 *g_dirent_sector = NULL;
+STATIC UINT32 g_dirent_sector_num = 0;
+STATIC ventoy_secover_file *g_secover_file = NULL;
+STATIC UINT32 g_secover_file_num = 0;
+STATIC UINT32 g_secover_pending = 0;
 
 STATIC UINTN g_keyboard_hook_count = 0;
 STATIC BOOLEAN g_blockio_start_record_bcd = FALSE;
@@ -134,6 +161,144 @@ EFI_STATUS EFIAPI ventoy_block_io_reset
 	return EFI_SUCCESS;
 }
 
+/* 
+ * Binary search in a table sorted by the leading UINT32 of each entry. 
+ * Return TRUE with *Index of the last entry whose key <= Key.
+ */
+STATIC BOOLEAN ventoy_sector_search(IN VOID *Table, IN UINTN EntrySize, IN UINT32 Num, IN UINT32 Key, OUT UINT32 *Index)
+{
+    UINT32 Low = 0;
+    UINT32 High = Num;
+    UINT32 Mid = 0;
+
+    while (Low < High)
+    {
+        Mid = Low + (High - Low) / 2;
+        if (*(UINT32 *)((UINT8 *)Table + Mid * EntrySize) <= Key)
+        {
+            Low = Mid + 1;
+        }
+        else
+        {
+            High = Mid;
+        }
+    }
+
+    if (Low == 0)
+    {
+        return FALSE;
+    }
+
+    *Index = Low - 1;
+    return TRUE;
+}
+
+STATIC VOID ventoy_secover_arm(IN UINT32 FirstSector)
+{
+    UINT32 i = 0;
+    ventoy_secover_file *file;
+
+    if (ventoy_sector_search(g_secover_file, sizeof(ventoy_secover_file), g_secover_file_num, FirstSector, &i) &&
+        g_secover_file[i].first_sector == FirstSector)
+    {
+        file = g_secover_file + i;
+        if (!file->armed && !file->active)
+        {
+            file->armed = TRUE;
+            g_secover_pending++;
+            g_fixup_iso9660_secover_start = TRUE;
+        }
+    }
+}
+
+/* build the sorted dirent sector tables once, the override chunks never change after boot */
+EFI_STATUS ventoy_fixup_iso9660_init(VOID)
+{
+    UINT32 i, j;
+    UINT32 Sector;
+    UINT32 TotSecs;
+    ventoy_iso9660_override *dirent;
+    ventoy_secover_file File;
+
+    if (g_override_chunk_num == 0)
+    {
+        return EFI_SUCCESS;
+    }
+
+    g_dirent_sector = AllocatePool(g_override_chunk_num * sizeof(UINT32));
+    g_secover_file = AllocatePool(g_override_chunk_num * sizeof(ventoy_secover_file));
+    if (!g_dirent_sector || !g_secover_file)
+    {
+        debug("Failed to alloc secover table %u", g_override_chunk_num);
+        ventoy_fixup_iso9660_fini();
+        g_fixup_iso9660_secover_enable = FALSE;
+        return EFI_OUT_OF_RESOURCES;
+    }
+
+    for (i = 0; i < g_override_chunk_num; i++)
+    {
+        if (g_override_chunk[i].override_size != sizeof(ventoy_iso9660_override))
+        {
+            continue;
+        }
+
+        dirent = (ventoy_iso9660_override *)g_override_chunk[i].override_data;
+        Sector = dirent->first_sector;
+        TotSecs = (dirent->size + 2047) / 2048;
+
+        /* insertion sort, the table is small and built only once */
+        for (j = g_dirent_sector_num; j > 0 && g_dirent_sector[j - 1] > Sector; j--)
+        {
+            g_dirent_sector[j] = g_dirent_sector[j - 1];
+        }
+        g_dirent_sector[j] = Sector;
+        g_dirent_sector_num++;
+
+        if (Sector < VENTOY_ISO9660_SECTOR_OVERFLOW || TotSecs == 0)
+        {
+            continue;
+        }
+
+        if (ventoy_sector_search(g_secover_file, sizeof(ventoy_secover_file), g_secover_file_num, Sector, &j) &&
+            g_secover_file[j].first_sector == Sector)
+        {
+            continue;
+        }
+
+        ZeroMem(&File, sizeof(File));
+        File.first_sector = Sector;
+        File.tot_secs = TotSecs;
+
+        for (j = g_secover_file_num; j > 0 && g_secover_file[j - 1].first_sector > Sector; j--)
+        {
+            CopyMem(g_secover_file + j, g_secover_file + j - 1, sizeof(ventoy_secover_file));
+        }
+        CopyMem(g_secover_file + j, &File, sizeof(ventoy_secover_file));
+        g_secover_file_num++;
+    }
+
+    debug("secover init dirent:%u overflow file:%u", g_dirent_sector_num, g_secover_file_num);
+    return EFI_SUCCESS;
+}
+
+VOID ventoy_fixup_iso9660_fini(VOID)
+{
+    if (g_dirent_sector)
+    {
+        FreePool(g_dirent_sector);
+        g_dirent_sector = NULL;
+    }
+
+    if (g_secover_file)
+    {
+        FreePool(g_secover_file);
+        g_secover_file = NULL;
+    }
+
+    g_dirent_sector_num = 0;
+    g_secover_file_num = 0;
+}
+
 STATIC EFI_STATUS EFIAPI ventoy_read_iso_sector
 (
     IN UINT64                 Sector,
@@ -184,6 +349,16 @@ STATIC EFI_STATUS EFIAPI ventoy_read_iso_sector
             secLeft = pchunk->img_end_sector + 1 - Sector;
             secRead = (Count < secLeft) ? Count : secLeft;
 
+            if (VTOY_IS_ZERO_CHUNK(pchunk))
+            {
+                /* unallocated block of a dynamic vdisk */
+                ZeroMem(pCurBuf, secRead * 2048);
+                Count -= secRead;
+                Sector += secRead;
+                pCurBuf += secRead * 2048;
+                continue;
+            }
+
             Status = pRawBlockIo->ReadBlocks(pRawBlockIo, pRawBlockIo->Media->MediaId,
                                      MapLba, secRead * 2048, pCurBuf);
             if (EFI_ERROR(Status))
@@ -238,14 +413,12 @@ STATIC EFI_STATUS EFIAPI ventoy_read_iso_sector
             }
         }
 
-        if (g_fixup_iso9660_secover_enable && (!g_fixup_iso9660_secover_start) && 
-            pOverride->override_size == sizeof(ventoy_iso9660_override))
+        if (g_fixup_iso9660_secover_enable && pOverride->override_size == sizeof(ventoy_iso9660_override))
         {
             ventoy_iso9660_override *dirent = (ventoy_iso9660_override *)pOverride->override_data;
             if (dirent->first_sector >= VENTOY_ISO9660_SECTOR_OVERFLOW)
             {
-                g_fixup_iso9660_secover_start = TRUE;
-                g_fixup_iso9660_secover_cur_secs = 0;
+                ventoy_secover_arm(dirent->first_sector);
             }
         }
     }
@@ -309,6 +482,12 @@ STATIC EFI_STATUS EFIAPI ventoy_write_iso_sector
             secLeft = pchunk->img_end_sector + 1 - Sector;
             secRead = (Count < secLeft) ? Count : secLeft;
 
+            if (VTOY_IS_ZERO_CHUNK(pchunk))
+            {
+                debug("write to unallocated block sector %lu count %u", Sector, secRead);
+                return EFI_WRITE_PROTECTED;
+            }
+
             Status = pRawBlockIo->WriteBlocks(pRawBlockIo, pRawBlockIo->Media->MediaId,
                                      MapLba, secRead * 2048, pCurBuf);
             if (EFI_ERROR(Status))
@@ -348,9 +527,141 @@ EFI_STATUS EFIAPI ventoy_block_io_ramdisk_write
 
     CopyMem(g_iso_data_buf + (Lba * 2048), Buffer, BufferSize);
 
+    if (g_memdisk_dirty)
+    {
+        ventoy_memdisk_mark_dirty(Lba, BufferSize / 2048);
+    }
+
 	return EFI_SUCCESS;
 }
 
+VOID ventoy_memdisk_mark_dirty(IN EFI_LBA Lba, IN UINTN Count)
+{
+    UINTN i = 0;
+
+    for (i = 0; i < Count && Lba + i < g_memdisk_dirty_secs; i++)
+    {
+        g_memdisk_dirty[(Lba + i) >> 3] |= (UINT8)(1 << ((Lba + i) & 7));
+    }
+}
+
+STATIC BOOLEAN ventoy_memdisk_is_dirty(IN UINTN Sector)
+{
+    return (g_memdisk_dirty[Sector >> 3] & (1 << (Sector & 7))) ? TRUE : FALSE;
+}
+
+/* write the dirty sectors back to the image file, continuous sectors are merged into one write */
+EFI_STATUS ventoy_memdisk_writeback(VOID)
+{
+    UINTN Sector = 0;
+    UINTN Start = 0;
+    UINTN Total = 0;
+    UINTN Runs = 0;
+    EFI_STATUS Status = EFI_SUCCESS;
+
+    if (!g_memdisk_dirty)
+    {
+        return EFI_SUCCESS;
+    }
+
+    while (Sector < g_memdisk_dirty_secs)
+    {
+        /* skip 8 clean sectors at once */
+        if ((Sector & 7) == 0 && g_memdisk_dirty[Sector >> 3] == 0)
+        {
+            Sector += 8;
+            continue;
+        }
+
+        if (!ventoy_memdisk_is_dirty(Sector))
+        {
+            Sector++;
+            continue;
+        }
+
+        Start = Sector;
+        while (Sector < g_memdisk_dirty_secs && Sector - Start < VTOY_WRITEBACK_MAX_SECS && ventoy_memdisk_is_dirty(Sector))
+        {
+            Sector++;
+        }
+
+        Status = ventoy_write_iso_sector(Start, Sector - Start, g_iso_data_buf + Start * 2048);
+        if (EFI_ERROR(Status))
+        {
+            debug("memdisk writeback failed %r %lu %lu", Status, Start, Sector - Start);
+            return Status;
+        }
+
+        for (; Start < Sector; Start++)
+        {
+            g_memdisk_dirty[Start >> 3] &= (UINT8)(~(1 << (Start & 7)));
+            Total++;
+        }
+        Runs++;
+    }
+
+    if (Total > 0)
+    {
+        gBlockData.pRawBlockIo->FlushBlocks(gBlockData.pRawBlockIo);
+        debug("memdisk writeback %lu sectors in %lu writes", Total, Runs);
+    }
+
+    return EFI_SUCCESS;
+}
+
+/* 
+ * The OS loader calls ExitBootServices when the memory map is final. The writeback may
+ * change the memory map, so the first call can fail with a stale MapKey and the loader
+ * retries. Only the first call writes back, the retry goes straight to the firmware.
+ */
+STATIC EFI_STATUS EFIAPI ventoy_wrapper_exit_boot_services
+(
+    IN EFI_HANDLE ImageHandle,
+    IN UINTN      MapKey
+)
+{
+    if (!g_memdisk_exit_bs_flushed)
+    {
+        g_memdisk_exit_bs_flushed = TRUE;
+        ventoy_memdisk_writeback();
+    }
+
+    return g_org_exit_boot_services(ImageHandle, MapKey);
+}
+
+EFI_STATUS ventoy_memdisk_writeback_init(VOID)
+{
+    g_memdisk_dirty_secs = g_iso_buf_size / 2048;
+    g_memdisk_dirty = AllocateZeroPool((g_memdisk_dirty_secs + 7) / 8);
+    if (!g_memdisk_dirty)
+    {
+        return EFI_OUT_OF_RESOURCES;
+    }
+
+    g_memdisk_exit_bs_flushed = FALSE;
+    g_org_exit_boot_services = gBS->ExitBootServices;
+    gBS->ExitBootServices = ventoy_wrapper_exit_boot_services;
+
+    debug("memdisk writeback enabled, %lu sectors", g_memdisk_dirty_secs);
+    return EFI_SUCCESS;
+}
+
+VOID ventoy_memdisk_writeback_fini(VOID)
+{
+    if (g_org_exit_boot_services)
+    {
+        gBS->ExitBootServices = g_org_exit_boot_services;
+        g_org_exit_boot_services = NULL;
+    }
+
+    if (g_memdisk_dirty)
+    {
+        ventoy_memdisk_writeback();
+        FreePool(g_memdisk_dirty);
+        g_memdisk_dirty = NULL;
+    }
+}
+
 EFI_STATUS EFIAPI ventoy_block_io_ramdisk_read 
 (
     IN EFI_BLOCK_IO_PROTOCOL          *This,
@@ -380,54 +691,62 @@ EFI_STATUS EFIAPI ventoy_block_io_ramdisk_read
 
 EFI_LBA EFIAPI ventoy_fixup_iso9660_sector(IN EFI_LBA Lba, UINT32 secNum)
 {
-    UINT32 i = 0;
+    UINT32 i;
+    ventoy_secover_file *file;
 
-    if (g_fixup_iso9660_secover_cur_secs > 0)
+    /* a normal read of an overridden file, stop waiting for the wrapped read of this file */
+    if (Lba <= MAX_UINT32 && ventoy_sector_search(g_dirent_sector, sizeof(UINT32), g_dirent_sector_num, (UINT32)Lba, &i) &&
+        g_dirent_sector[i] == (UINT32)Lba)
     {
-        Lba += VENTOY_ISO9660_SECTOR_OVERFLOW;
-        g_fixup_iso9660_secover_cur_secs += secNum;
-        if (g_fixup_iso9660_secover_cur_secs >= g_fixup_iso9660_secover_tot_secs)
+        if (ventoy_sector_search(g_secover_file, sizeof(ventoy_secover_file), g_secover_file_num, (UINT32)Lba, &i) &&
+            g_secover_file[i].first_sector == (UINT32)Lba && g_secover_file[i].armed)
         {
-            g_fixup_iso9660_secover_start = FALSE;
-            goto end;
+            g_secover_file[i].armed = FALSE;
+            g_secover_pending--;
         }
+        goto end;
+    }
+
+    if (Lba + VENTOY_ISO9660_SECTOR_OVERFLOW > MAX_UINT32 || 
+        !ventoy_sector_search(g_secover_file, sizeof(ventoy_secover_file), g_secover_file_num, 
+                              (UINT32)(Lba + VENTOY_ISO9660_SECTOR_OVERFLOW), &i))
+    {
+        goto end;
+    }
+
+    file = g_secover_file + i;
+    if (Lba + VENTOY_ISO9660_SECTOR_OVERFLOW >= (UINT64)file->first_sector + file->tot_secs)
+    {
+        goto end;
+    }
+
+    if (file->active)
+    {
+        file->cur_secs += secNum;
+    }
+    else if (file->armed && Lba + VENTOY_ISO9660_SECTOR_OVERFLOW == file->first_sector)
+    {
+        file->armed = FALSE;
+        file->active = TRUE;
+        file->cur_secs = secNum;
     }
     else
     {
-        ventoy_iso9660_override *dirent;
-        ventoy_override_chunk *pOverride;
+        goto end;
+    }
 
-        for (i = 0, pOverride = g_override_chunk; i < g_override_chunk_num; i++, pOverride++)
-        {
-            dirent = (ventoy_iso9660_override *)pOverride->override_data;
-            if (Lba == dirent->first_sector)
-            {
-                g_fixup_iso9660_secover_start = FALSE;
-                goto end;
-            }
-        }
+    debug("secover fixup %lu -> %lu (%u/%u)", Lba, Lba + VENTOY_ISO9660_SECTOR_OVERFLOW, file->cur_secs, file->tot_secs);
 
-        if (g_fixup_iso9660_secover_start)
-        {
-            for (i = 0, pOverride = g_override_chunk; i < g_override_chunk_num; i++, pOverride++)
-            {
-                dirent = (ventoy_iso9660_override *)pOverride->override_data;
-                if (Lba + VENTOY_ISO9660_SECTOR_OVERFLOW == dirent->first_sector)
-                {
-                    g_fixup_iso9660_secover_tot_secs = (dirent->size + 2047) / 2048;
-                    g_fixup_iso9660_secover_cur_secs = secNum;
-                    if (g_fixup_iso9660_secover_cur_secs >= g_fixup_iso9660_secover_tot_secs)
-                    {
-                        g_fixup_iso9660_secover_start = FALSE;
-                    }
-                    Lba += VENTOY_ISO9660_SECTOR_OVERFLOW;
-                    goto end;
-                }
-            }
-        }
+    if (file->cur_secs >= file->tot_secs)
+    {
+        file->active = FALSE;
+        g_secover_pending--;
     }
 
+    Lba += VENTOY_ISO9660_SECTOR_OVERFLOW;
+
 end:
+    g_fixup_iso9660_secover_start = (g_secover_pending > 0) ? TRUE : FALSE;
     return Lba;
 }
 
@@ -572,6 +891,8 @@ EFI_STATUS EFIAPI ventoy_block_io_read
     VOID *NewBuf = NULL;
     EFI_STATUS Status = EFI_OUT_OF_RESOURCES;
 
+    ventoy_read_trace_record(Lba, BufferSize / 2048);
+
     if (gBlockData.pRawBlockIo && gBlockData.pRawBlockIo->Media)
     {
         IoAlign = gBlockData.pRawBlockIo->Media->IoAlign;
@@ -621,9 +942,178 @@ EFI_STATUS EFIAPI ventoy_block_io_write
     return ventoy_write_iso_sector(Lba, secNum, Buffer);
 }
 
+/* the bucket of Lba, or the empty bucket where it would be inserted */
+STATIC ventoy_cow_sector * ventoy_cow_search(IN EFI_LBA Lba)
+{
+    UINTN Pos;
+    ventoy_cow_sector *Entry = NULL;
+
+    Pos = (UINTN)((Lba * 0x9E3779B97F4A7C15ULL) >> 32) & g_cow_index_mask;
+    for (;;)
+    {
+        Entry = g_cow_index + Pos;
+        if (Entry->Slot == VTOY_COW_SLOT_FREE || Entry->Lba == Lba)
+        {
+            return Entry;
+        }
+        Pos = (Pos + 1) & g_cow_index_mask;
+    }
+}
+
+STATIC EFI_STATUS ventoy_cow_alloc(VOID)
+{
+    UINTN Buckets = 1;
+
+    if (g_cow_index)
+    {
+        return EFI_SUCCESS;
+    }
+
+    /* at most half full, so the probe is short and always ends at an empty bucket */
+    while (Buckets < gCowMaxSecs * 2)
+    {
+        Buckets <<= 1;
+    }
+
+    g_cow_index = AllocatePool(Buckets * sizeof(ventoy_cow_sector));
+    g_cow_data = AllocatePages(EFI_SIZE_TO_PAGES(gCowMaxSecs * 2048));
+    if (!g_cow_index || !g_cow_data)
+    {
+        debug("Failed to alloc cow overlay %lu sectors", gCowMaxSecs);
+        ventoy_cow_free();
+        return EFI_OUT_OF_RESOURCES;
+    }
+
+    SetMem(g_cow_index, Buckets * sizeof(ventoy_cow_sector), 0xFF);
+    g_cow_index_mask = Buckets - 1;
+    g_cow_used = 0;
+    debug("cow overlay allocated, max %lu sectors %lu buckets", gCowMaxSecs, Buckets);
+    return EFI_SUCCESS;
+}
+
+VOID ventoy_cow_free(VOID)
+{
+    if (g_cow_index)
+    {
+        FreePool(g_cow_index);
+        g_cow_index = NULL;
+    }
+
+    if (g_cow_data)
+    {
+        FreePages(g_cow_data, EFI_SIZE_TO_PAGES(gCowMaxSecs * 2048));
+        g_cow_data = NULL;
+    }
+
+    g_cow_index_mask = 0;
+    g_cow_used = 0;
+}
+
+EFI_STATUS EFIAPI ventoy_block_io_cow_read
+(
+    IN EFI_BLOCK_IO_PROTOCOL          *This,
+    IN UINT32                          MediaId,
+    IN EFI_LBA                         Lba,
+    IN UINTN                           BufferSize,
+    OUT VOID                          *Buffer
+) 
+{
+    UINTN i = 0;
+    UINTN secNum = 0;
+    ventoy_cow_sector *Entry = NULL;
+    EFI_STATUS Status = EFI_SUCCESS;
+
+    Status = ventoy_block_io_read(This, MediaId, Lba, BufferSize, Buffer);
+    if (g_cow_used == 0)
+    {
+        return Status;
+    }
+
+    /* patch the sectors that were written before */
+    secNum = BufferSize / 2048;
+    for (i = 0; i < secNum; i++)
+    {
+        Entry = ventoy_cow_search(Lba + i);
+        if (Entry->Slot != VTOY_COW_SLOT_FREE)
+        {
+            CopyMem((UINT8 *)Buffer + i * 2048, g_cow_data + (UINTN)Entry->Slot * 2048, 2048);
+        }
+    }
+
+    return Status;
+}
+
+EFI_STATUS EFIAPI ventoy_block_io_cow_write 
+(
+    IN EFI_BLOCK_IO_PROTOCOL          *This,
+    IN UINT32                          MediaId,
+    IN EFI_LBA                         Lba,
+    IN UINTN                           BufferSize,
+    IN VOID                           *Buffer
+) 
+{
+    UINTN i = 0;
+    UINTN NewSecs = 0;
+    UINTN secNum = 0;
+    ventoy_cow_sector *Entry = NULL;
+    EFI_STATUS Status = EFI_SUCCESS;
+    
+    (VOID)This;
+    (VOID)MediaId;
+
+    if (!gSector512Mode)
+    {
+        return EFI_WRITE_PROTECTED;
+    }
+
+    Status = ventoy_cow_alloc();
+    if (EFI_ERROR(Status))
+    {
+        return Status;
+    }
+
+    secNum = BufferSize / 2048;
+
+    /* the overlay is bounded, refuse the whole request instead of writing part of it */
+    for (i = 0; i < secNum; i++)
+    {
+        if (ventoy_cow_search(Lba + i)->Slot == VTOY_COW_SLOT_FREE)
+        {
+            NewSecs++;
+        }
+    }
+
+    if (g_cow_used + NewSecs > gCowMaxSecs)
+    {
+        debug("cow overlay full %lu + %lu > %lu", g_cow_used, NewSecs, gCowMaxSecs);
+        return EFI_VOLUME_FULL;
+    }
+
+    for (i = 0; i < secNum; i++)
+    {
+        Entry = ventoy_cow_search(Lba + i);
+        if (Entry->Slot == VTOY_COW_SLOT_FREE)
+        {
+            Entry->Lba = Lba + i;
+            Entry->Slot = (UINT32)g_cow_used;
+            g_cow_used++;
+        }
+
+        CopyMem(g_cow_data + (UINTN)Entry->Slot * 2048, (UINT8 *)Buffer + i * 2048, 2048);
+    }
+
+    return EFI_SUCCESS;
+}
+
 EFI_STATUS EFIAPI ventoy_block_io_flush(IN EFI_BLOCK_IO_PROTOCOL *This)
 {
 	(VOID)This;
+
+    if (gMemdiskWriteback)
+    {
+        return ventoy_memdisk_writeback();
+    }
+    
 	return EFI_SUCCESS;
 }
 
@@ -1159,8 +1649,22 @@ EFI_STATUS EFIAPI ventoy_install_blockio(IN EFI_HANDLE ImageHandle, IN UINT64 Im
 
     if (gSector512Mode)
     {
-        g_sector_2048_read = gMemdiskMode ? ventoy_block_io_ramdisk_read : ventoy_block_io_read;
-        g_sector_2048_write = gMemdiskMode ? ventoy_block_io_ramdisk_write : ventoy_block_io_write;
+        if (gMemdiskMode)
+        {
+            g_sector_2048_read = ventoy_block_io_ramdisk_read;
+            g_sector_2048_write = ventoy_block_io_ramdisk_write;
+        }
+        else if (gCowMode)
+        {
+            debug("cow overlay mode, max %lu sectors", gCowMaxSecs);
+            g_sector_2048_read = ventoy_block_io_cow_read;
+            g_sector_2048_write = ventoy_block_io_cow_write;
+        }
+        else
+        {
+            g_sector_2048_read = ventoy_block_io_read;
+            g_sector_2048_write = ventoy_block_io_write;
+        }
         pBlockIo->ReadBlocks = ventoy_block_io_read_512;
     	pBlockIo->WriteBlocks = ventoy_block_io_write_512;
     }
@@ -1348,37 +1852,115 @@ ventoy_wrapper_file_get_info(EFI_FILE_HANDLE This, EFI_GUID *Type, UINTN *Len, V
     return EFI_SUCCESS;
 }
 
+STATIC EFI_STATUS ventoy_wrapper_file_load_cache(ventoy_efi_file_replace *replace, UINT64 Sector)
+{
+    UINT32 Secs = VTOY_FILE_CACHE_SECS;
+    UINT64 TotSecs = replace->FileSizeBytes / 2048;
+    EFI_STATUS Status = EFI_SUCCESS;
+
+    if (replace->CacheSecs > 0 && Sector >= replace->CacheSector && Sector < replace->CacheSector + replace->CacheSecs)
+    {
+        return EFI_SUCCESS;
+    }
+
+    if (Sector + Secs > TotSecs)
+    {
+        Secs = (UINT32)(TotSecs - Sector);
+    }
+
+    replace->CacheSecs = 0;
+    Status = ventoy_block_io_read(NULL, 0, replace->BlockIoSectorStart + Sector, Secs * 2048, replace->CacheBuf);
+    if (EFI_ERROR(Status))
+    {
+        debug("Failed to read file cache sector %lu %r", Sector, Status);
+        return Status;
+    }
+
+    replace->CacheSector = Sector;
+    replace->CacheSecs = Secs;
+    return EFI_SUCCESS;
+}
+
 STATIC EFI_STATUS EFIAPI
 ventoy_wrapper_file_read(EFI_FILE_HANDLE This, UINTN *Len, VOID *Data)
 {
-    EFI_LBA Lba;
+    UINTN Size;
+    UINTN Done = 0;
     UINTN ReadLen = *Len;
+    UINT64 Sector;
+    UINT64 Offset;
+    UINT8 *Buf = (UINT8 *)Data;
+    EFI_STATUS Status = EFI_SUCCESS;
     ventoy_efi_file_replace *replace = NULL;
 
     ASSIGN_REPLACE(This, replace);
     
     debug("ventoy_wrapper_file_read ... %u", *Len);
 
+    if (replace->CurPos >= replace->FileSizeBytes)
+    {
+        *Len = 0;
+        return EFI_SUCCESS;
+    }
+
     if (replace->CurPos + ReadLen > replace->FileSizeBytes)
     {
         ReadLen = replace->FileSizeBytes - replace->CurPos;
     }
 
-    Lba = replace->CurPos / 2048 + replace->BlockIoSectorStart;
+    while (Done < ReadLen)
+    {
+        Sector = (replace->CurPos + Done) / 2048;
+        Offset = (replace->CurPos + Done) % 2048;
+
+        if (Offset == 0 && ReadLen - Done >= 2048)
+        {
+            /* whole sectors go directly to the caller's buffer */
+            Size = (ReadLen - Done) / 2048 * 2048;
+            Status = ventoy_block_io_read(NULL, 0, replace->BlockIoSectorStart + Sector, Size, Buf + Done);
+        }
+        else
+        {
+            Status = ventoy_wrapper_file_load_cache(replace, Sector);
+            if (!EFI_ERROR(Status))
+            {
+                Offset = replace->CurPos + Done - replace->CacheSector * 2048;
+                Size = MIN(ReadLen - Done, replace->CacheSecs * 2048 - (UINTN)Offset);
+                CopyMem(Buf + Done, replace->CacheBuf + Offset, Size);
+            }
+        }
+
+        if (EFI_ERROR(Status))
+        {
+            break;
+        }
 
-    ventoy_block_io_read(NULL, 0, Lba, ReadLen, Data);
+        Done += Size;
+    }
 
-    *Len = ReadLen;
+    *Len = Done;
 
-    replace->CurPos += ReadLen;
+    replace->CurPos += Done;
 
-    return EFI_SUCCESS;
+    return Status;
 }
 
 STATIC EFI_STATUS EFIAPI
 ventoy_wrapper_file_read_ex(IN EFI_FILE_PROTOCOL *This, IN OUT EFI_FILE_IO_TOKEN *Token)
 {
-	return ventoy_wrapper_file_read(This, &(Token->BufferSize), Token->Buffer);
+    EFI_STATUS Status;
+
+    Status = ventoy_wrapper_file_read(This, &(Token->BufferSize), Token->Buffer);
+    if (Token->Event == NULL)
+    {
+        return Status;
+    }
+
+    /* the data is in memory or on the raw disk, the request completes before return */
+    Token->Status = Status;
+    gBS->SignalEvent(Token->Event);
+
+    return EFI_SUCCESS;
 }
 
 STATIC EFI_STATUS EFIAPI ventoy_wrapper_file_procotol(EFI_FILE_PROTOCOL *File, BOOLEAN Img)
@@ -1456,6 +2038,8 @@ STATIC EFI_STATUS EFIAPI ventoy_wrapper_file_open
                 
                 g_efi_file_replace.BlockIoSectorStart = virt->mem_sector_start;
                 g_efi_file_replace.FileSizeBytes = Sectors * 2048;
+                g_efi_file_replace.CurPos = 0;
+                g_efi_file_replace.CacheSecs = 0;
 
                 if (gDebugPrint)
                 {
@@ -1499,6 +2083,8 @@ STATIC EFI_STATUS EFIAPI ventoy_wrapper_file_open
                 
                 g_img_file_replace.BlockIoSectorStart = virt->mem_sector_start;
                 g_img_file_replace.FileSizeBytes = Sectors * 2048;
+                g_img_file_replace.CurPos = 0;
+                g_img_file_replace.CacheSecs = 0;
 
                 if (gDebugPrint)
                 {
@@ -0,0 +1,409 @@
+/******************************************************************************
+ * edk2_host.c  ---- libc backed EDK2 library functions for host tests
+ *
+ * Copyright (c) 2021, longpanda <admin@ventoy.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <edk2_host.h>
+
+EFI_BOOT_SERVICES    *gBS = NULL;
+EFI_SYSTEM_TABLE     *gST = NULL;
+EFI_RUNTIME_SERVICES *gRT = NULL;
+EFI_HANDLE            gImageHandle = NULL;
+
+EFI_GUID gShellVariableGuid;
+EFI_GUID gEfiVirtualCdGuid;
+EFI_GUID gEfiFileInfoGuid;
+EFI_GUID gEfiFileSystemInfoGuid;
+EFI_GUID gEfiLoadedImageProtocolGuid;
+EFI_GUID gEfiBlockIoProtocolGuid;
+EFI_GUID gEfiBlockIo2ProtocolGuid;
+EFI_GUID gEfiDevicePathProtocolGuid;
+EFI_GUID gEfiSimpleFileSystemProtocolGuid;
+EFI_GUID gEfiRamDiskProtocolGuid;
+EFI_GUID gEfiAbsolutePointerProtocolGuid;
+EFI_GUID gEfiAcpiTableProtocolGuid;
+EFI_GUID gEfiBusSpecificDriverOverrideProtocolGuid;
+EFI_GUID gEfiComponentNameProtocolGuid;
+EFI_GUID gEfiComponentName2ProtocolGuid;
+EFI_GUID gEfiDriverBindingProtocolGuid;
+EFI_GUID gEfiDiskIoProtocolGuid;
+EFI_GUID gEfiDiskIo2ProtocolGuid;
+EFI_GUID gEfiGraphicsOutputProtocolGuid;
+EFI_GUID gEfiHiiConfigAccessProtocolGuid;
+EFI_GUID gEfiHiiFontProtocolGuid;
+EFI_GUID gEfiLoadFileProtocolGuid;
+EFI_GUID gEfiLoadFile2ProtocolGuid;
+EFI_GUID gEfiLoadedImageDevicePathProtocolGuid;
+EFI_GUID gEfiPciIoProtocolGuid;
+EFI_GUID gEfiSerialIoProtocolGuid;
+EFI_GUID gEfiSimpleTextInProtocolGuid;
+EFI_GUID gEfiSimpleTextInputExProtocolGuid;
+EFI_GUID gEfiSimpleTextOutProtocolGuid;
+
+UINTN StrLen(CONST CHAR16 *String)
+{
+    UINTN Len = 0;
+
+    while (String[Len])
+    {
+        Len++;
+    }
+    return Len;
+}
+
+UINTN StrSize(CONST CHAR16 *String)
+{
+    return (StrLen(String) + 1) * sizeof(CHAR16);
+}
+
+INTN StrnCmp(CONST CHAR16 *First, CONST CHAR16 *Second, UINTN Length)
+{
+    for (; Length > 0 && *First && *First == *Second; Length--)
+    {
+        First++;
+        Second++;
+    }
+    return Length ? (INTN)*First - (INTN)*Second : 0;
+}
+
+INTN StrCmp(CONST CHAR16 *First, CONST CHAR16 *Second)
+{
+    return StrnCmp(First, Second, MAX_UINTN);
+}
+
+CHAR16 *StrStr(CONST CHAR16 *String, CONST CHAR16 *SearchString)
+{
+    UINTN Len = StrLen(SearchString);
+
+    for (; *String; String++)
+    {
+        if (StrnCmp(String, SearchString, Len) == 0)
+        {
+            return (CHAR16 *)String;
+        }
+    }
+    return Len ? NULL : (CHAR16 *)String;
+}
+
+RETURN_STATUS StrCpyS(CHAR16 *Destination, UINTN DestMax, CONST CHAR16 *Source)
+{
+    if (StrLen(Source) >= DestMax)
+    {
+        return EFI_BUFFER_TOO_SMALL;
+    }
+    CopyMem(Destination, Source, StrSize(Source));
+    return EFI_SUCCESS;
+}
+
+UINTN StrDecimalToUintn(CONST CHAR16 *String)
+{
+    UINTN Value = 0;
+
+    for (; *String >= '0' && *String <= '9'; String++)
+    {
+        Value = Value * 10 + (*String - '0');
+    }
+    return Value;
+}
+
+UINTN StrHexToUintn(CONST CHAR16 *String)
+{
+    char Buf[32];
+    UINTN i;
+
+    for (i = 0; i < sizeof(Buf) - 1 && String[i]; i++)
+    {
+        Buf[i] = (char)String[i];
+    }
+    Buf[i] = 0;
+    return strtoull(Buf, NULL, 16);
+}
+
+UINTN AsciiStrLen(CONST CHAR8 *String)
+{
+    return strlen(String);
+}
+
+INTN AsciiStrCmp(CONST CHAR8 *First, CONST CHAR8 *Second)
+{
+    return strcmp(First, Second);
+}
+
+INTN AsciiStrnCmp(CONST CHAR8 *First, CONST CHAR8 *Second, UINTN Length)
+{
+    return strncmp(First, Second, Length);
+}
+
+CHAR8 *AsciiStrStr(CONST CHAR8 *String, CONST CHAR8 *SearchString)
+{
+    return strstr(String, SearchString);
+}
+
+RETURN_STATUS AsciiStrCpyS(CHAR8 *Destination, UINTN DestMax, CONST CHAR8 *Source)
+{
+    if (strlen(Source) >= DestMax)
+    {
+        return EFI_BUFFER_TOO_SMALL;
+    }
+    strcpy(Destination, Source);
+    return EFI_SUCCESS;
+}
+
+UINTN AsciiStrDecimalToUintn(CONST CHAR8 *String)
+{
+    return strtoull(String, NULL, 10);
+}
+
+UINTN AsciiStrHexToUintn(CONST CHAR8 *String)
+{
+    return strtoull(String, NULL, 16);
+}
+
+/*
+ * PrintLib format to a char buffer. Handles the specifiers used by the driver:
+ * %a %s(CHAR16) %r %g %c %p %d %u %x %X with l/ll and width, everything as 64 bit.
+ */
+static UINTN host_vsprint(CHAR8 *Buf, UINTN Size, CONST CHAR8 *Format, va_list Marker)
+{
+    UINTN Pos = 0;
+    UINTN Width;
+    UINTN Len;
+    CONST CHAR16 *Str16;
+    CHAR8 Num[64];
+    CHAR8 Fmt[16];
+    EFI_GUID *Guid;
+
+    if (Size == 0)
+    {
+        return 0;
+    }
+
+#define HOST_PUT(Src, SrcLen) \
+    do { \
+        Len = (SrcLen); \
+        if (Pos + Len >= Size) Len = Size - 1 - Pos; \
+        memcpy(Buf + Pos, (Src), Len); \
+        Pos += Len; \
+    } while (0)
+
+    for (; *Format && Pos + 1 < Size; Format++)
+    {
+        if (*Format != '%')
+        {
+            Buf[Pos++] = *Format;
+            continue;
+        }
+
+        Format++;
+        Width = 0;
+        Fmt[0] = '%';
+        Len = 1;
+        while (*Format == '0' || *Format == '-' || (*Format >= '1' && *Format <= '9'))
+        {
+            if (Len < 8)
+            {
+                Fmt[Len++] = *Format;
+            }
+            Width = 1;
+            Format++;
+        }
+        while (*Format == 'l' || *Format == 'L')
+        {
+            Format++;
+        }
+        (void)Width;
+
+        switch (*Format)
+        {
+            case 'a':
+            {
+                CONST CHAR8 *Str8 = va_arg(Marker, CONST CHAR8 *);
+                HOST_PUT(Str8 ? Str8 : "(null)", strlen(Str8 ? Str8 : "(null)"));
+                break;
+            }
+            case 's':
+            case 'S':
+            {
+                Str16 = va_arg(Marker, CONST CHAR16 *);
+                for (; Str16 && *Str16 && Pos + 1 < Size; Str16++)
+                {
+                    Buf[Pos++] = (CHAR8)*Str16;
+                }
+                break;
+            }
+            case 'c':
+            {
+                Buf[Pos++] = (CHAR8)va_arg(Marker, int);
+                break;
+            }
+            case 'r':
+            {
+                snprintf(Num, sizeof(Num), "Status:0x%llx", (unsigned long long)va_arg(Marker, EFI_STATUS));
+                HOST_PUT(Num, strlen(Num));
+                break;
+            }
+            case 'g':
+            {
+                Guid = va_arg(Marker, EFI_GUID *);
+                snprintf(Num, sizeof(Num), "%08x-%04x-%04x-...", Guid->Data1, Guid->Data2, Guid->Data3);
+                HOST_PUT(Num, strlen(Num));
+                break;
+            }
+            case 'p':
+            {
+                snprintf(Num, sizeof(Num), "%p", va_arg(Marker, VOID *));
+                HOST_PUT(Num, strlen(Num));
+                break;
+            }
+            case 'd':
+            case 'u':
+            case 'x':
+            case 'X':
+            {
+                Fmt[Len++] = 'l';
+                Fmt[Len++] = 'l';
+                Fmt[Len++] = *Format;
+                Fmt[Len] = 0;
+                snprintf(Num, sizeof(Num), Fmt, (unsigned long long)va_arg(Marker, UINT64));
+                HOST_PUT(Num, strlen(Num));
+                break;
+            }
+            case '%':
+            {
+                Buf[Pos++] = '%';
+                break;
+            }
+            default:
+            {
+                Format--;
+                break;
+            }
+        }
+    }
+
+#undef HOST_PUT
+
+    Buf[Pos] = 0;
+    return Pos;
+}
+
+UINTN AsciiVSPrint(CHAR8 *StartOfBuffer, UINTN BufferSize, CONST CHAR8 *FormatString, va_list Marker)
+{
+    return host_vsprint(StartOfBuffer, BufferSize, FormatString, Marker);
+}
+
+UINTN AsciiSPrint(CHAR8 *StartOfBuffer, UINTN BufferSize, CONST CHAR8 *FormatString, ...)
+{
+    UINTN Len;
+    va_list Marker;
+
+    va_start(Marker, FormatString);
+    Len = host_vsprint(StartOfBuffer, BufferSize, FormatString, Marker);
+    va_end(Marker);
+    return Len;
+}
+
+UINTN UnicodeVSPrintAsciiFormat(CHAR16 *StartOfBuffer, UINTN BufferSize, CONST CHAR8 *FormatString, va_list Marker)
+{
+    UINTN i;
+    UINTN Len;
+    CHAR8 *Tmp = malloc(BufferSize / sizeof(CHAR16) + 1);
+
+    if (!Tmp || BufferSize < sizeof(CHAR16))
+    {
+        free(Tmp);
+        return 0;
+    }
+
+    Len = host_vsprint(Tmp, BufferSize / sizeof(CHAR16), FormatString, Marker);
+    for (i = 0; i <= Len; i++)
+    {
+        StartOfBuffer[i] = (UINT8)Tmp[i];
+    }
+    free(Tmp);
+    return Len;
+}
+
+UINTN UnicodeSPrintAsciiFormat(CHAR16 *StartOfBuffer, UINTN BufferSize, CONST CHAR8 *FormatString, ...)
+{
+    UINTN Len;
+    va_list Marker;
+
+    va_start(Marker, FormatString);
+    Len = UnicodeVSPrintAsciiFormat(StartOfBuffer, BufferSize, FormatString, Marker);
+    va_end(Marker);
+    return Len;
+}
+
+UINTN GetDevicePathSize(CONST EFI_DEVICE_PATH_PROTOCOL *DevicePath)
+{
+    CONST EFI_DEVICE_PATH_PROTOCOL *Node = DevicePath;
+
+    if (!DevicePath)
+    {
+        return 0;
+    }
+
+    while (!IsDevicePathEnd(Node))
+    {
+        Node = NextDevicePathNode(Node);
+    }
+    return (UINTN)((UINT8 *)Node - (UINT8 *)DevicePath) + DevicePathNodeLength(Node);
+}
+
+EFI_DEVICE_PATH_PROTOCOL *DuplicateDevicePath(CONST EFI_DEVICE_PATH_PROTOCOL *DevicePath)
+{
+    UINTN Size = GetDevicePathSize(DevicePath);
+    EFI_DEVICE_PATH_PROTOCOL *Dup = Size ? malloc(Size) : NULL;
+
+    if (Dup)
+    {
+        memcpy(Dup, DevicePath, Size);
+    }
+    return Dup;
+}
+
+EFI_DEVICE_PATH_PROTOCOL *AppendDevicePathNode(CONST EFI_DEVICE_PATH_PROTOCOL *DevicePath,
+                                               CONST EFI_DEVICE_PATH_PROTOCOL *DevicePathNode)
+{
+    UINTN Size = GetDevicePathSize(DevicePath);
+    UINTN NodeSize = DevicePathNodeLength(DevicePathNode);
+    UINT8 *Path;
+
+    Size = Size ? Size - sizeof(EFI_DEVICE_PATH_PROTOCOL) : 0;
+    Path = malloc(Size + NodeSize + sizeof(EFI_DEVICE_PATH_PROTOCOL));
+    if (!Path)
+    {
+        return NULL;
+    }
+
+    memcpy(Path, DevicePath, Size);
+    memcpy(Path + Size, DevicePathNode, NodeSize);
+    Path[Size + NodeSize] = END_DEVICE_PATH_TYPE;
+    Path[Size + NodeSize + 1] = END_ENTIRE_DEVICE_PATH_SUBTYPE;
+    Path[Size + NodeSize + 2] = sizeof(EFI_DEVICE_PATH_PROTOCOL);
+    Path[Size + NodeSize + 3] = 0;
+    return (EFI_DEVICE_PATH_PROTOCOL *)Path;
+}
+
+CHAR16 *ConvertDevicePathToText(CONST EFI_DEVICE_PATH_PROTOCOL *DevicePath, BOOLEAN DisplayOnly, BOOLEAN AllowShortcuts)
+{
+    (void)DevicePath;
+    (void)DisplayOnly;
+    (void)AllowShortcuts;
+    return NULL;
+}
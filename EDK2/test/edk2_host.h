@@ -0,0 +1,773 @@
+/******************************************************************************
+ * edk2_host.h  ---- the part of EDK2 used by the Ventoy driver, for host tests
+ *
+ * Copyright (c) 2021, longpanda <admin@ventoy.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Every <Uefi.h>, <Library/xxx.h>, <Protocol/xxx.h> and <Guid/xxx.h> included by the
+ * driver is mapped to this file (see EDK2/buildtest.sh). The types and the protocol
+ * layouts follow MdePkg of edk2-stable201911. Only what the driver uses is here.
+ * The library functions are backed by libc, gBS/gST/gRT are set up by the test.
+ * Build with -fshort-wchar so that L"" strings are CHAR16.
+ */
+#ifndef __EDK2_HOST_H__
+#define __EDK2_HOST_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <string.h>
+
+#ifndef MDE_CPU_X64
+#define MDE_CPU_X64
+#endif
+
+#define IN
+#define OUT
+#define OPTIONAL
+#define CONST     const
+#define STATIC    static
+#define VOID      void
+#define EFIAPI
+#define TRUE      ((BOOLEAN)1)
+#define FALSE     ((BOOLEAN)0)
+
+typedef uint8_t   UINT8;
+typedef uint16_t  UINT16;
+typedef uint32_t  UINT32;
+typedef uint64_t  UINT64;
+typedef int8_t    INT8;
+typedef int16_t   INT16;
+typedef int32_t   INT32;
+typedef int64_t   INT64;
+typedef uint64_t  UINTN;
+typedef int64_t   INTN;
+typedef uint8_t   BOOLEAN;
+typedef char      CHAR8;
+typedef uint16_t  CHAR16;
+
+#define VA_LIST             va_list
+#define VA_START(Marker, Parameter)  va_start(Marker, Parameter)
+#define VA_END(Marker)      va_end(Marker)
+#define ARRAY_SIZE(Array)   (sizeof(Array) / sizeof((Array)[0]))
+#define MAX(a, b)           (((a) > (b)) ? (a) : (b))
+#define MIN(a, b)           (((a) < (b)) ? (a) : (b))
+
+#define MAX_UINT32  ((UINT32)0xFFFFFFFF)
+#define MAX_UINT64  ((UINT64)0xFFFFFFFFFFFFFFFFULL)
+#define MAX_UINTN   MAX_UINT64
+
+typedef UINTN   RETURN_STATUS;
+typedef UINTN   EFI_STATUS;
+typedef VOID   *EFI_HANDLE;
+typedef VOID   *EFI_EVENT;
+typedef UINT64  EFI_LBA;
+typedef UINTN   EFI_TPL;
+typedef UINT64  EFI_PHYSICAL_ADDRESS;
+
+#define MAX_BIT   0x8000000000000000ULL
+#define ENCODE_ERROR(a)   ((EFI_STATUS)(MAX_BIT | (a)))
+#define EFI_ERROR(a)      (((INTN)(EFI_STATUS)(a)) < 0)
+
+#define EFI_SUCCESS               0
+#define EFI_LOAD_ERROR            ENCODE_ERROR(1)
+#define EFI_INVALID_PARAMETER     ENCODE_ERROR(2)
+#define EFI_UNSUPPORTED           ENCODE_ERROR(3)
+#define EFI_BAD_BUFFER_SIZE       ENCODE_ERROR(4)
+#define EFI_BUFFER_TOO_SMALL      ENCODE_ERROR(5)
+#define EFI_NOT_READY             ENCODE_ERROR(6)
+#define EFI_DEVICE_ERROR          ENCODE_ERROR(7)
+#define EFI_WRITE_PROTECTED       ENCODE_ERROR(8)
+#define EFI_OUT_OF_RESOURCES      ENCODE_ERROR(9)
+#define EFI_VOLUME_CORRUPTED      ENCODE_ERROR(10)
+#define EFI_VOLUME_FULL           ENCODE_ERROR(11)
+#define EFI_NO_MEDIA              ENCODE_ERROR(12)
+#define EFI_MEDIA_CHANGED         ENCODE_ERROR(13)
+#define EFI_NOT_FOUND             ENCODE_ERROR(14)
+#define EFI_ACCESS_DENIED         ENCODE_ERROR(15)
+#define EFI_ABORTED               ENCODE_ERROR(21)
+
+typedef struct
+{
+    UINT32  Data1;
+    UINT16  Data2;
+    UINT16  Data3;
+    UINT8   Data4[8];
+} EFI_GUID;
+
+typedef struct
+{
+    UINT16  Year;
+    UINT8   Month;
+    UINT8   Day;
+    UINT8   Hour;
+    UINT8   Minute;
+    UINT8   Second;
+    UINT8   Pad1;
+    UINT32  Nanosecond;
+    INT16   TimeZone;
+    UINT8   Daylight;
+    UINT8   Pad2;
+} EFI_TIME;
+
+typedef struct
+{
+    UINT32  Resolution;
+    UINT32  Accuracy;
+    BOOLEAN SetsToZero;
+} EFI_TIME_CAPABILITIES;
+
+#define EFI_SIZE_TO_PAGES(Size)  (((Size) >> 12) + (((Size) & 0xFFF) ? 1 : 0))
+#define EFI_PAGES_TO_SIZE(Pages) ((UINTN)(Pages) << 12)
+
+#define EFI_VARIABLE_NON_VOLATILE        0x00000001
+#define EFI_VARIABLE_BOOTSERVICE_ACCESS  0x00000002
+#define EFI_VARIABLE_RUNTIME_ACCESS      0x00000004
+
+#define EVT_TIMER                         0x80000000
+#define EVT_NOTIFY_WAIT                   0x00000100
+#define EVT_NOTIFY_SIGNAL                 0x00000200
+#define EVT_SIGNAL_EXIT_BOOT_SERVICES     0x00000201
+#define TPL_APPLICATION   4
+#define TPL_CALLBACK      8
+#define TPL_NOTIFY        16
+
+#define EFI_OPEN_PROTOCOL_BY_HANDLE_PROTOCOL  0x00000001
+#define EFI_OPEN_PROTOCOL_GET_PROTOCOL        0x00000002
+#define EFI_OPEN_PROTOCOL_TEST_PROTOCOL       0x00000004
+#define EFI_OPEN_PROTOCOL_BY_CHILD_CONTROLLER 0x00000008
+#define EFI_OPEN_PROTOCOL_BY_DRIVER           0x00000010
+#define EFI_OPEN_PROTOCOL_EXCLUSIVE           0x00000020
+
+#define EFI_REMOVABLE_MEDIA_FILE_NAME_X64  L"\\EFI\\BOOT\\BOOTX64.EFI"
+#define EFI_REMOVABLE_MEDIA_FILE_NAME      EFI_REMOVABLE_MEDIA_FILE_NAME_X64
+
+typedef enum
+{
+    AllocateAnyPages,
+    AllocateMaxAddress,
+    AllocateAddress,
+    MaxAllocateType
+} EFI_ALLOCATE_TYPE;
+
+typedef enum
+{
+    EfiReservedMemoryType,
+    EfiLoaderCode,
+    EfiLoaderData,
+    EfiBootServicesCode,
+    EfiBootServicesData,
+    EfiRuntimeServicesCode,
+    EfiRuntimeServicesData,
+    EfiConventionalMemory,
+    EfiUnusableMemory,
+    EfiACPIReclaimMemory,
+    EfiACPIMemoryNVS,
+    EfiMemoryMappedIO,
+    EfiMemoryMappedIOPortSpace,
+    EfiPalCode,
+    EfiPersistentMemory,
+    EfiMaxMemoryType
+} EFI_MEMORY_TYPE;
+
+typedef enum
+{
+    AllHandles,
+    ByRegisterNotify,
+    ByProtocol
+} EFI_LOCATE_SEARCH_TYPE;
+
+typedef enum
+{
+    EFI_NATIVE_INTERFACE
+} EFI_INTERFACE_TYPE;
+
+typedef enum
+{
+    TimerCancel,
+    TimerPeriodic,
+    TimerRelative
+} EFI_TIMER_DELAY;
+
+/* device path */
+typedef struct
+{
+    UINT8 Type;
+    UINT8 SubType;
+    UINT8 Length[2];
+} EFI_DEVICE_PATH_PROTOCOL;
+
+#define HARDWARE_DEVICE_PATH      0x01
+#define HW_VENDOR_DP              0x04
+#define MEDIA_DEVICE_PATH         0x04
+#define MEDIA_HARDDRIVE_DP        0x01
+#define MEDIA_CDROM_DP            0x02
+#define MEDIA_FILEPATH_DP         0x04
+#define END_DEVICE_PATH_TYPE      0x7f
+#define END_ENTIRE_DEVICE_PATH_SUBTYPE  0xFF
+
+typedef struct
+{
+    EFI_DEVICE_PATH_PROTOCOL Header;
+    EFI_GUID Guid;
+} VENDOR_DEVICE_PATH;
+
+typedef struct
+{
+    EFI_DEVICE_PATH_PROTOCOL Header;
+    CHAR16 PathName[1];
+} FILEPATH_DEVICE_PATH;
+
+#define DevicePathNodeLength(Node)  ((UINTN)(((EFI_DEVICE_PATH_PROTOCOL *)(Node))->Length[0] | \
+                                     (((EFI_DEVICE_PATH_PROTOCOL *)(Node))->Length[1] << 8)))
+#define DevicePathType(Node)        (((EFI_DEVICE_PATH_PROTOCOL *)(Node))->Type)
+#define DevicePathSubType(Node)     (((EFI_DEVICE_PATH_PROTOCOL *)(Node))->SubType)
+#define NextDevicePathNode(Node)    ((EFI_DEVICE_PATH_PROTOCOL *)((UINT8 *)(Node) + DevicePathNodeLength(Node)))
+#define IsDevicePathEnd(Node)       (DevicePathType(Node) == END_DEVICE_PATH_TYPE && \
+                                     DevicePathSubType(Node) == END_ENTIRE_DEVICE_PATH_SUBTYPE)
+
+/* simple text */
+#define CHAR_NULL             0x0000
+#define CHAR_BACKSPACE        0x0008
+#define CHAR_TAB              0x0009
+#define CHAR_LINEFEED         0x000A
+#define CHAR_CARRIAGE_RETURN  0x000D
+#define SCAN_NULL             0x0000
+#define SCAN_UP               0x0001
+#define SCAN_DOWN             0x0002
+#define SCAN_RIGHT            0x0003
+#define SCAN_LEFT             0x0004
+#define SCAN_HOME             0x0005
+#define SCAN_END              0x0006
+#define SCAN_INSERT           0x0007
+#define SCAN_DELETE           0x0008
+#define SCAN_PAGE_UP          0x0009
+#define SCAN_PAGE_DOWN        0x000A
+#define SCAN_ESC              0x0017
+
+typedef struct
+{
+    UINT16  ScanCode;
+    CHAR16  UnicodeChar;
+} EFI_INPUT_KEY;
+
+typedef struct
+{
+    UINT32 KeyShiftState;
+    UINT8  KeyToggleState;
+} EFI_KEY_STATE;
+
+typedef struct
+{
+    EFI_INPUT_KEY Key;
+    EFI_KEY_STATE KeyState;
+} EFI_KEY_DATA;
+
+typedef struct _EFI_SIMPLE_TEXT_INPUT_PROTOCOL EFI_SIMPLE_TEXT_INPUT_PROTOCOL;
+typedef EFI_STATUS (EFIAPI *EFI_INPUT_RESET)(IN EFI_SIMPLE_TEXT_INPUT_PROTOCOL *This, IN BOOLEAN ExtendedVerification);
+typedef EFI_STATUS (EFIAPI *EFI_INPUT_READ_KEY)(IN EFI_SIMPLE_TEXT_INPUT_PROTOCOL *This, OUT EFI_INPUT_KEY *Key);
+struct _EFI_SIMPLE_TEXT_INPUT_PROTOCOL
+{
+    EFI_INPUT_RESET    Reset;
+    EFI_INPUT_READ_KEY ReadKeyStroke;
+    EFI_EVENT          WaitForKey;
+};
+
+typedef struct _EFI_SIMPLE_TEXT_INPUT_EX_PROTOCOL EFI_SIMPLE_TEXT_INPUT_EX_PROTOCOL;
+typedef EFI_STATUS (EFIAPI *EFI_INPUT_RESET_EX)(IN EFI_SIMPLE_TEXT_INPUT_EX_PROTOCOL *This, IN BOOLEAN ExtendedVerification);
+typedef EFI_STATUS (EFIAPI *EFI_INPUT_READ_KEY_EX)(IN EFI_SIMPLE_TEXT_INPUT_EX_PROTOCOL *This, OUT EFI_KEY_DATA *KeyData);
+struct _EFI_SIMPLE_TEXT_INPUT_EX_PROTOCOL
+{
+    EFI_INPUT_RESET_EX    Reset;
+    EFI_INPUT_READ_KEY_EX ReadKeyStrokeEx;
+    EFI_EVENT             WaitForKeyEx;
+    VOID                 *SetState;
+    VOID                 *RegisterKeyNotify;
+    VOID                 *UnregisterKeyNotify;
+};
+
+typedef struct _EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL;
+typedef EFI_STATUS (EFIAPI *EFI_TEXT_STRING)(IN EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL *This, IN CHAR16 *String);
+typedef EFI_STATUS (EFIAPI *EFI_TEXT_CLEAR_SCREEN)(IN EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL *This);
+struct _EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL
+{
+    VOID                 *Reset;
+    EFI_TEXT_STRING       OutputString;
+    VOID                 *TestString;
+    VOID                 *QueryMode;
+    VOID                 *SetMode;
+    VOID                 *SetAttribute;
+    EFI_TEXT_CLEAR_SCREEN ClearScreen;
+    VOID                 *SetCursorPosition;
+    VOID                 *EnableCursor;
+    VOID                 *Mode;
+};
+
+/* block io */
+typedef struct
+{
+    UINT32  MediaId;
+    BOOLEAN RemovableMedia;
+    BOOLEAN MediaPresent;
+    BOOLEAN LogicalPartition;
+    BOOLEAN ReadOnly;
+    BOOLEAN WriteCaching;
+    UINT32  BlockSize;
+    UINT32  IoAlign;
+    EFI_LBA LastBlock;
+    EFI_LBA LowestAlignedLba;
+    UINT32  LogicalBlocksPerPhysicalBlock;
+    UINT32  OptimalTransferLengthGranularity;
+} EFI_BLOCK_IO_MEDIA;
+
+#define EFI_BLOCK_IO_PROTOCOL_REVISION3  0x0002001f
+
+typedef struct _EFI_BLOCK_IO_PROTOCOL EFI_BLOCK_IO_PROTOCOL;
+typedef EFI_STATUS (EFIAPI *EFI_BLOCK_RESET)(IN EFI_BLOCK_IO_PROTOCOL *This, IN BOOLEAN ExtendedVerification);
+typedef EFI_STATUS (EFIAPI *EFI_BLOCK_READ)(IN EFI_BLOCK_IO_PROTOCOL *This, IN UINT32 MediaId, IN EFI_LBA Lba,
+                                            IN UINTN BufferSize, OUT VOID *Buffer);
+typedef EFI_STATUS (EFIAPI *EFI_BLOCK_WRITE)(IN EFI_BLOCK_IO_PROTOCOL *This, IN UINT32 MediaId, IN EFI_LBA Lba,
+                                             IN UINTN BufferSize, IN VOID *Buffer);
+typedef EFI_STATUS (EFIAPI *EFI_BLOCK_FLUSH)(IN EFI_BLOCK_IO_PROTOCOL *This);
+struct _EFI_BLOCK_IO_PROTOCOL
+{
+    UINT64              Revision;
+    EFI_BLOCK_IO_MEDIA *Media;
+    EFI_BLOCK_RESET     Reset;
+    EFI_BLOCK_READ      ReadBlocks;
+    EFI_BLOCK_WRITE     WriteBlocks;
+    EFI_BLOCK_FLUSH     FlushBlocks;
+};
+
+typedef struct
+{
+    EFI_EVENT  Event;
+    EFI_STATUS TransactionStatus;
+} EFI_BLOCK_IO2_TOKEN;
+
+typedef struct _EFI_BLOCK_IO2_PROTOCOL EFI_BLOCK_IO2_PROTOCOL;
+typedef EFI_STATUS (EFIAPI *EFI_BLOCK_RESET_EX)(IN EFI_BLOCK_IO2_PROTOCOL *This, IN BOOLEAN ExtendedVerification);
+typedef EFI_STATUS (EFIAPI *EFI_BLOCK_READ_EX)(IN EFI_BLOCK_IO2_PROTOCOL *This, IN UINT32 MediaId, IN EFI_LBA LBA,
+                                               IN OUT EFI_BLOCK_IO2_TOKEN *Token, IN UINTN BufferSize, OUT VOID *Buffer);
+typedef EFI_STATUS (EFIAPI *EFI_BLOCK_WRITE_EX)(IN EFI_BLOCK_IO2_PROTOCOL *This, IN UINT32 MediaId, IN EFI_LBA LBA,
+                                                IN OUT EFI_BLOCK_IO2_TOKEN *Token, IN UINTN BufferSize, IN VOID *Buffer);
+typedef EFI_STATUS (EFIAPI *EFI_BLOCK_FLUSH_EX)(IN EFI_BLOCK_IO2_PROTOCOL *This, IN OUT EFI_BLOCK_IO2_TOKEN *Token);
+struct _EFI_BLOCK_IO2_PROTOCOL
+{
+    EFI_BLOCK_IO_MEDIA *Media;
+    EFI_BLOCK_RESET_EX  Reset;
+    EFI_BLOCK_READ_EX   ReadBlocksEx;
+    EFI_BLOCK_WRITE_EX  WriteBlocksEx;
+    EFI_BLOCK_FLUSH_EX  FlushBlocksEx;
+};
+
+/* file system */
+#define EFI_FILE_MODE_READ    0x0000000000000001ULL
+#define EFI_FILE_MODE_WRITE   0x0000000000000002ULL
+#define EFI_FILE_MODE_CREATE  0x8000000000000000ULL
+#define EFI_FILE_READ_ONLY    0x0000000000000001ULL
+#define EFI_FILE_DIRECTORY    0x0000000000000010ULL
+#define EFI_FILE_PROTOCOL_REVISION2  0x00020000
+
+typedef struct
+{
+    UINT64   Size;
+    UINT64   FileSize;
+    UINT64   PhysicalSize;
+    EFI_TIME CreateTime;
+    EFI_TIME LastAccessTime;
+    EFI_TIME ModificationTime;
+    UINT64   Attribute;
+    CHAR16   FileName[1];
+} EFI_FILE_INFO;
+
+typedef struct
+{
+    UINT64  Size;
+    BOOLEAN ReadOnly;
+    UINT64  VolumeSize;
+    UINT64  FreeSpace;
+    UINT32  BlockSize;
+    CHAR16  VolumeLabel[1];
+} EFI_FILE_SYSTEM_INFO;
+
+typedef struct
+{
+    EFI_EVENT  Event;
+    EFI_STATUS Status;
+    UINTN      BufferSize;
+    VOID      *Buffer;
+} EFI_FILE_IO_TOKEN;
+
+typedef struct _EFI_FILE_PROTOCOL EFI_FILE_PROTOCOL;
+typedef EFI_FILE_PROTOCOL *EFI_FILE_HANDLE;
+typedef EFI_STATUS (EFIAPI *EFI_FILE_OPEN)(IN EFI_FILE_PROTOCOL *This, OUT EFI_FILE_PROTOCOL **NewHandle,
+                                           IN CHAR16 *FileName, IN UINT64 OpenMode, IN UINT64 Attributes);
+typedef EFI_STATUS (EFIAPI *EFI_FILE_CLOSE)(IN EFI_FILE_PROTOCOL *This);
+typedef EFI_STATUS (EFIAPI *EFI_FILE_DELETE)(IN EFI_FILE_PROTOCOL *This);
+typedef EFI_STATUS (EFIAPI *EFI_FILE_READ)(IN EFI_FILE_PROTOCOL *This, IN OUT UINTN *BufferSize, OUT VOID *Buffer);
+typedef EFI_STATUS (EFIAPI *EFI_FILE_WRITE)(IN EFI_FILE_PROTOCOL *This, IN OUT UINTN *BufferSize, IN VOID *Buffer);
+typedef EFI_STATUS (EFIAPI *EFI_FILE_SET_POSITION)(IN EFI_FILE_PROTOCOL *This, IN UINT64 Position);
+typedef EFI_STATUS (EFIAPI *EFI_FILE_GET_POSITION)(IN EFI_FILE_PROTOCOL *This, OUT UINT64 *Position);
+typedef EFI_STATUS (EFIAPI *EFI_FILE_GET_INFO)(IN EFI_FILE_PROTOCOL *This, IN EFI_GUID *InformationType,
+                                               IN OUT UINTN *BufferSize, OUT VOID *Buffer);
+typedef EFI_STATUS (EFIAPI *EFI_FILE_SET_INFO)(IN EFI_FILE_PROTOCOL *This, IN EFI_GUID *InformationType,
+                                               IN UINTN BufferSize, IN VOID *Buffer);
+typedef EFI_STATUS (EFIAPI *EFI_FILE_FLUSH)(IN EFI_FILE_PROTOCOL *This);
+typedef EFI_STATUS (EFIAPI *EFI_FILE_OPEN_EX)(IN EFI_FILE_PROTOCOL *This, OUT EFI_FILE_PROTOCOL **NewHandle,
+                                              IN CHAR16 *FileName, IN UINT64 OpenMode, IN UINT64 Attributes,
+                                              IN OUT EFI_FILE_IO_TOKEN *Token);
+typedef EFI_STATUS (EFIAPI *EFI_FILE_READ_EX)(IN EFI_FILE_PROTOCOL *This, IN OUT EFI_FILE_IO_TOKEN *Token);
+typedef EFI_STATUS (EFIAPI *EFI_FILE_WRITE_EX)(IN EFI_FILE_PROTOCOL *This, IN OUT EFI_FILE_IO_TOKEN *Token);
+typedef EFI_STATUS (EFIAPI *EFI_FILE_FLUSH_EX)(IN EFI_FILE_PROTOCOL *This, IN OUT EFI_FILE_IO_TOKEN *Token);
+struct _EFI_FILE_PROTOCOL
+{
+    UINT64                Revision;
+    EFI_FILE_OPEN         Open;
+    EFI_FILE_CLOSE        Close;
+    EFI_FILE_DELETE       Delete;
+    EFI_FILE_READ         Read;
+    EFI_FILE_WRITE        Write;
+    EFI_FILE_GET_POSITION GetPosition;
+    EFI_FILE_SET_POSITION SetPosition;
+    EFI_FILE_GET_INFO     GetInfo;
+    EFI_FILE_SET_INFO     SetInfo;
+    EFI_FILE_FLUSH        Flush;
+    EFI_FILE_OPEN_EX      OpenEx;
+    EFI_FILE_READ_EX      ReadEx;
+    EFI_FILE_WRITE_EX     WriteEx;
+    EFI_FILE_FLUSH_EX     FlushEx;
+};
+
+typedef struct _EFI_SIMPLE_FILE_SYSTEM_PROTOCOL EFI_SIMPLE_FILE_SYSTEM_PROTOCOL;
+typedef EFI_STATUS (EFIAPI *EFI_SIMPLE_FILE_SYSTEM_PROTOCOL_OPEN_VOLUME)(IN EFI_SIMPLE_FILE_SYSTEM_PROTOCOL *This,
+                                                                         OUT EFI_FILE_PROTOCOL **Root);
+struct _EFI_SIMPLE_FILE_SYSTEM_PROTOCOL
+{
+    UINT64 Revision;
+    EFI_SIMPLE_FILE_SYSTEM_PROTOCOL_OPEN_VOLUME OpenVolume;
+};
+
+/* ram disk */
+typedef struct _EFI_RAM_DISK_PROTOCOL EFI_RAM_DISK_PROTOCOL;
+typedef EFI_STATUS (EFIAPI *EFI_RAM_DISK_REGISTER_RAMDISK)(IN UINT64 RamDiskBase, IN UINT64 RamDiskSize,
+                                                           IN EFI_GUID *RamDiskType, IN EFI_DEVICE_PATH_PROTOCOL *ParentDevicePath,
+                                                           OUT EFI_DEVICE_PATH_PROTOCOL **DevicePath);
+typedef EFI_STATUS (EFIAPI *EFI_RAM_DISK_UNREGISTER_RAMDISK)(IN EFI_DEVICE_PATH_PROTOCOL *DevicePath);
+struct _EFI_RAM_DISK_PROTOCOL
+{
+    EFI_RAM_DISK_REGISTER_RAMDISK   Register;
+    EFI_RAM_DISK_UNREGISTER_RAMDISK Unregister;
+};
+
+/* loaded image */
+typedef struct _EFI_SYSTEM_TABLE EFI_SYSTEM_TABLE;
+typedef struct
+{
+    UINT32                    Revision;
+    EFI_HANDLE                ParentHandle;
+    EFI_SYSTEM_TABLE         *SystemTable;
+    EFI_HANDLE                DeviceHandle;
+    EFI_DEVICE_PATH_PROTOCOL *FilePath;
+    VOID                     *Reserved;
+    UINT32                    LoadOptionsSize;
+    VOID                     *LoadOptions;
+    VOID                     *ImageBase;
+    UINT64                    ImageSize;
+    EFI_MEMORY_TYPE           ImageCodeType;
+    EFI_MEMORY_TYPE           ImageDataType;
+    VOID                     *Unload;
+} EFI_LOADED_IMAGE_PROTOCOL;
+
+/* driver binding and component name */
+typedef struct _EFI_DRIVER_BINDING_PROTOCOL EFI_DRIVER_BINDING_PROTOCOL;
+typedef EFI_STATUS (EFIAPI *EFI_DRIVER_BINDING_SUPPORTED)(IN EFI_DRIVER_BINDING_PROTOCOL *This, IN EFI_HANDLE ControllerHandle,
+                                                          IN EFI_DEVICE_PATH_PROTOCOL *RemainingDevicePath OPTIONAL);
+typedef EFI_STATUS (EFIAPI *EFI_DRIVER_BINDING_START)(IN EFI_DRIVER_BINDING_PROTOCOL *This, IN EFI_HANDLE ControllerHandle,
+                                                      IN EFI_DEVICE_PATH_PROTOCOL *RemainingDevicePath OPTIONAL);
+typedef EFI_STATUS (EFIAPI *EFI_DRIVER_BINDING_STOP)(IN EFI_DRIVER_BINDING_PROTOCOL *This, IN EFI_HANDLE ControllerHandle,
+                                                     IN UINTN NumberOfChildren, IN EFI_HANDLE *ChildHandleBuffer OPTIONAL);
+struct _EFI_DRIVER_BINDING_PROTOCOL
+{
+    EFI_DRIVER_BINDING_SUPPORTED Supported;
+    EFI_DRIVER_BINDING_START     Start;
+    EFI_DRIVER_BINDING_STOP      Stop;
+    UINT32                       Version;
+    EFI_HANDLE                   ImageHandle;
+    EFI_HANDLE                   DriverBindingHandle;
+};
+
+typedef struct _EFI_COMPONENT_NAME_PROTOCOL EFI_COMPONENT_NAME_PROTOCOL;
+typedef EFI_STATUS (EFIAPI *EFI_COMPONENT_NAME_GET_DRIVER_NAME)(IN EFI_COMPONENT_NAME_PROTOCOL *This, IN CHAR8 *Language,
+                                                                OUT CHAR16 **DriverName);
+struct _EFI_COMPONENT_NAME_PROTOCOL
+{
+    EFI_COMPONENT_NAME_GET_DRIVER_NAME GetDriverName;
+    VOID                              *GetControllerName;
+    CHAR8                             *SupportedLanguages;
+};
+
+typedef struct _EFI_COMPONENT_NAME2_PROTOCOL EFI_COMPONENT_NAME2_PROTOCOL;
+typedef EFI_STATUS (EFIAPI *EFI_COMPONENT_NAME2_GET_DRIVER_NAME)(IN EFI_COMPONENT_NAME2_PROTOCOL *This, IN CHAR8 *Language,
+                                                                 OUT CHAR16 **DriverName);
+struct _EFI_COMPONENT_NAME2_PROTOCOL
+{
+    EFI_COMPONENT_NAME2_GET_DRIVER_NAME GetDriverName;
+    VOID                               *GetControllerName;
+    CHAR8                              *SupportedLanguages;
+};
+
+/* boot services */
+typedef struct
+{
+    EFI_GUID *Protocol;
+    UINT32 Count;
+} EFI_OPEN_PROTOCOL_INFORMATION_ENTRY;
+
+typedef VOID (EFIAPI *EFI_EVENT_NOTIFY)(IN EFI_EVENT Event, IN VOID *Context);
+typedef EFI_STATUS (EFIAPI *EFI_ALLOCATE_PAGES)(IN EFI_ALLOCATE_TYPE Type, IN EFI_MEMORY_TYPE MemoryType,
+                                                IN UINTN Pages, IN OUT EFI_PHYSICAL_ADDRESS *Memory);
+typedef EFI_STATUS (EFIAPI *EFI_FREE_PAGES)(IN EFI_PHYSICAL_ADDRESS Memory, IN UINTN Pages);
+typedef EFI_STATUS (EFIAPI *EFI_ALLOCATE_POOL)(IN EFI_MEMORY_TYPE PoolType, IN UINTN Size, OUT VOID **Buffer);
+typedef EFI_STATUS (EFIAPI *EFI_FREE_POOL)(IN VOID *Buffer);
+typedef EFI_STATUS (EFIAPI *EFI_CREATE_EVENT)(IN UINT32 Type, IN EFI_TPL NotifyTpl, IN EFI_EVENT_NOTIFY NotifyFunction,
+                                              IN VOID *NotifyContext, OUT EFI_EVENT *Event);
+typedef EFI_STATUS (EFIAPI *EFI_SET_TIMER)(IN EFI_EVENT Event, IN EFI_TIMER_DELAY Type, IN UINT64 TriggerTime);
+typedef EFI_STATUS (EFIAPI *EFI_WAIT_FOR_EVENT)(IN UINTN NumberOfEvents, IN EFI_EVENT *Event, OUT UINTN *Index);
+typedef EFI_STATUS (EFIAPI *EFI_SIGNAL_EVENT)(IN EFI_EVENT Event);
+typedef EFI_STATUS (EFIAPI *EFI_CLOSE_EVENT)(IN EFI_EVENT Event);
+typedef EFI_STATUS (EFIAPI *EFI_CHECK_EVENT)(IN EFI_EVENT Event);
+typedef EFI_STATUS (EFIAPI *EFI_INSTALL_PROTOCOL_INTERFACE)(IN OUT EFI_HANDLE *Handle, IN EFI_GUID *Protocol,
+                                                            IN EFI_INTERFACE_TYPE InterfaceType, IN VOID *Interface);
+typedef EFI_STATUS (EFIAPI *EFI_REINSTALL_PROTOCOL_INTERFACE)(IN EFI_HANDLE Handle, IN EFI_GUID *Protocol,
+                                                              IN VOID *OldInterface, IN VOID *NewInterface);
+typedef EFI_STATUS (EFIAPI *EFI_UNINSTALL_PROTOCOL_INTERFACE)(IN EFI_HANDLE Handle, IN EFI_GUID *Protocol, IN VOID *Interface);
+typedef EFI_STATUS (EFIAPI *EFI_HANDLE_PROTOCOL)(IN EFI_HANDLE Handle, IN EFI_GUID *Protocol, OUT VOID **Interface);
+typedef EFI_STATUS (EFIAPI *EFI_LOCATE_HANDLE)(IN EFI_LOCATE_SEARCH_TYPE SearchType, IN EFI_GUID *Protocol OPTIONAL,
+                                               IN VOID *SearchKey OPTIONAL, IN OUT UINTN *BufferSize, OUT EFI_HANDLE *Buffer);
+typedef EFI_STATUS (EFIAPI *EFI_LOCATE_DEVICE_PATH)(IN EFI_GUID *Protocol, IN OUT EFI_DEVICE_PATH_PROTOCOL **DevicePath,
+                                                    OUT EFI_HANDLE *Device);
+typedef EFI_STATUS (EFIAPI *EFI_IMAGE_LOAD)(IN BOOLEAN BootPolicy, IN EFI_HANDLE ParentImageHandle,
+                                            IN EFI_DEVICE_PATH_PROTOCOL *DevicePath, IN VOID *SourceBuffer OPTIONAL,
+                                            IN UINTN SourceSize, OUT EFI_HANDLE *ImageHandle);
+typedef EFI_STATUS (EFIAPI *EFI_IMAGE_START)(IN EFI_HANDLE ImageHandle, OUT UINTN *ExitDataSize, OUT CHAR16 **ExitData OPTIONAL);
+typedef EFI_STATUS (EFIAPI *EFI_EXIT)(IN EFI_HANDLE ImageHandle, IN EFI_STATUS ExitStatus, IN UINTN ExitDataSize,
+                                      IN CHAR16 *ExitData OPTIONAL);
+typedef EFI_STATUS (EFIAPI *EFI_IMAGE_UNLOAD)(IN EFI_HANDLE ImageHandle);
+typedef EFI_STATUS (EFIAPI *EFI_EXIT_BOOT_SERVICES)(IN EFI_HANDLE ImageHandle, IN UINTN MapKey);
+typedef EFI_STATUS (EFIAPI *EFI_STALL)(IN UINTN Microseconds);
+typedef EFI_STATUS (EFIAPI *EFI_SET_WATCHDOG_TIMER)(IN UINTN Timeout, IN UINT64 WatchdogCode, IN UINTN DataSize,
+                                                    IN CHAR16 *WatchdogData OPTIONAL);
+typedef EFI_STATUS (EFIAPI *EFI_CONNECT_CONTROLLER)(IN EFI_HANDLE ControllerHandle, IN EFI_HANDLE *DriverImageHandle OPTIONAL,
+                                                    IN EFI_DEVICE_PATH_PROTOCOL *RemainingDevicePath OPTIONAL, IN BOOLEAN Recursive);
+typedef EFI_STATUS (EFIAPI *EFI_DISCONNECT_CONTROLLER)(IN EFI_HANDLE ControllerHandle, IN EFI_HANDLE DriverImageHandle OPTIONAL,
+                                                       IN EFI_HANDLE ChildHandle OPTIONAL);
+typedef EFI_STATUS (EFIAPI *EFI_OPEN_PROTOCOL)(IN EFI_HANDLE Handle, IN EFI_GUID *Protocol, OUT VOID **Interface OPTIONAL,
+                                               IN EFI_HANDLE AgentHandle, IN EFI_HANDLE ControllerHandle, IN UINT32 Attributes);
+typedef EFI_STATUS (EFIAPI *EFI_CLOSE_PROTOCOL)(IN EFI_HANDLE Handle, IN EFI_GUID *Protocol, IN EFI_HANDLE AgentHandle,
+                                                IN EFI_HANDLE ControllerHandle);
+typedef EFI_STATUS (EFIAPI *EFI_OPEN_PROTOCOL_INFORMATION)(IN EFI_HANDLE Handle, IN EFI_GUID *Protocol,
+                                                           OUT EFI_OPEN_PROTOCOL_INFORMATION_ENTRY **EntryBuffer,
+                                                           OUT UINTN *EntryCount);
+typedef EFI_STATUS (EFIAPI *EFI_PROTOCOLS_PER_HANDLE)(IN EFI_HANDLE Handle, OUT EFI_GUID ***ProtocolBuffer,
+                                                      OUT UINTN *ProtocolBufferCount);
+typedef EFI_STATUS (EFIAPI *EFI_LOCATE_HANDLE_BUFFER)(IN EFI_LOCATE_SEARCH_TYPE SearchType, IN EFI_GUID *Protocol OPTIONAL,
+                                                      IN VOID *SearchKey OPTIONAL, OUT UINTN *NoHandles, OUT EFI_HANDLE **Buffer);
+typedef EFI_STATUS (EFIAPI *EFI_LOCATE_PROTOCOL)(IN EFI_GUID *Protocol, IN VOID *Registration OPTIONAL, OUT VOID **Interface);
+typedef EFI_STATUS (EFIAPI *EFI_INSTALL_MULTIPLE_PROTOCOL_INTERFACES)(IN OUT EFI_HANDLE *Handle, ...);
+typedef EFI_STATUS (EFIAPI *EFI_UNINSTALL_MULTIPLE_PROTOCOL_INTERFACES)(IN EFI_HANDLE Handle, ...);
+typedef VOID (EFIAPI *EFI_COPY_MEM)(IN VOID *Destination, IN VOID *Source, IN UINTN Length);
+typedef VOID (EFIAPI *EFI_SET_MEM)(IN VOID *Buffer, IN UINTN Size, IN UINT8 Value);
+
+typedef struct
+{
+    UINT64 Signature;
+    UINT32 Revision;
+    UINT32 HeaderSize;
+    UINT32 CRC32;
+    UINT32 Reserved;
+} EFI_TABLE_HEADER;
+
+typedef struct
+{
+    EFI_TABLE_HEADER                  Hdr;
+    VOID                             *RaiseTPL;
+    VOID                             *RestoreTPL;
+    EFI_ALLOCATE_PAGES                AllocatePages;
+    EFI_FREE_PAGES                    FreePages;
+    VOID                             *GetMemoryMap;
+    EFI_ALLOCATE_POOL                 AllocatePool;
+    EFI_FREE_POOL                     FreePool;
+    EFI_CREATE_EVENT                  CreateEvent;
+    EFI_SET_TIMER                     SetTimer;
+    EFI_WAIT_FOR_EVENT                WaitForEvent;
+    EFI_SIGNAL_EVENT                  SignalEvent;
+    EFI_CLOSE_EVENT                   CloseEvent;
+    EFI_CHECK_EVENT                   CheckEvent;
+    EFI_INSTALL_PROTOCOL_INTERFACE    InstallProtocolInterface;
+    EFI_REINSTALL_PROTOCOL_INTERFACE  ReinstallProtocolInterface;
+    EFI_UNINSTALL_PROTOCOL_INTERFACE  UninstallProtocolInterface;
+    EFI_HANDLE_PROTOCOL               HandleProtocol;
+    VOID                             *Reserved;
+    VOID                             *RegisterProtocolNotify;
+    EFI_LOCATE_HANDLE                 LocateHandle;
+    EFI_LOCATE_DEVICE_PATH            LocateDevicePath;
+    VOID                             *InstallConfigurationTable;
+    EFI_IMAGE_LOAD                    LoadImage;
+    EFI_IMAGE_START                   StartImage;
+    EFI_EXIT                          Exit;
+    EFI_IMAGE_UNLOAD                  UnloadImage;
+    EFI_EXIT_BOOT_SERVICES            ExitBootServices;
+    VOID                             *GetNextMonotonicCount;
+    EFI_STALL                         Stall;
+    EFI_SET_WATCHDOG_TIMER            SetWatchdogTimer;
+    EFI_CONNECT_CONTROLLER            ConnectController;
+    EFI_DISCONNECT_CONTROLLER         DisconnectController;
+    EFI_OPEN_PROTOCOL                 OpenProtocol;
+    EFI_CLOSE_PROTOCOL                CloseProtocol;
+    EFI_OPEN_PROTOCOL_INFORMATION     OpenProtocolInformation;
+    EFI_PROTOCOLS_PER_HANDLE          ProtocolsPerHandle;
+    EFI_LOCATE_HANDLE_BUFFER          LocateHandleBuffer;
+    EFI_LOCATE_PROTOCOL               LocateProtocol;
+    EFI_INSTALL_MULTIPLE_PROTOCOL_INTERFACES    InstallMultipleProtocolInterfaces;
+    EFI_UNINSTALL_MULTIPLE_PROTOCOL_INTERFACES  UninstallMultipleProtocolInterfaces;
+    VOID                             *CalculateCrc32;
+    EFI_COPY_MEM                      CopyMem;
+    EFI_SET_MEM                       SetMem;
+    VOID                             *CreateEventEx;
+} EFI_BOOT_SERVICES;
+
+typedef EFI_STATUS (EFIAPI *EFI_GET_TIME)(OUT EFI_TIME *Time, OUT EFI_TIME_CAPABILITIES *Capabilities OPTIONAL);
+typedef EFI_STATUS (EFIAPI *EFI_GET_VARIABLE)(IN CHAR16 *VariableName, IN EFI_GUID *VendorGuid, OUT UINT32 *Attributes OPTIONAL,
+                                              IN OUT UINTN *DataSize, OUT VOID *Data OPTIONAL);
+typedef EFI_STATUS (EFIAPI *EFI_SET_VARIABLE)(IN CHAR16 *VariableName, IN EFI_GUID *VendorGuid, IN UINT32 Attributes,
+                                              IN UINTN DataSize, IN VOID *Data);
+typedef struct
+{
+    EFI_TABLE_HEADER  Hdr;
+    EFI_GET_TIME      GetTime;
+    VOID             *SetTime;
+    VOID             *GetWakeupTime;
+    VOID             *SetWakeupTime;
+    VOID             *SetVirtualAddressMap;
+    VOID             *ConvertPointer;
+    EFI_GET_VARIABLE  GetVariable;
+    VOID             *GetNextVariableName;
+    EFI_SET_VARIABLE  SetVariable;
+    VOID             *GetNextHighMonotonicCount;
+    VOID             *ResetSystem;
+} EFI_RUNTIME_SERVICES;
+
+struct _EFI_SYSTEM_TABLE
+{
+    EFI_TABLE_HEADER                  Hdr;
+    CHAR16                           *FirmwareVendor;
+    UINT32                            FirmwareRevision;
+    EFI_HANDLE                        ConsoleInHandle;
+    EFI_SIMPLE_TEXT_INPUT_PROTOCOL   *ConIn;
+    EFI_HANDLE                        ConsoleOutHandle;
+    EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL  *ConOut;
+    EFI_HANDLE                        StandardErrorHandle;
+    EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL  *StdErr;
+    EFI_RUNTIME_SERVICES             *RuntimeServices;
+    EFI_BOOT_SERVICES                *BootServices;
+    UINTN                             NumberOfTableEntries;
+    VOID                             *ConfigurationTable;
+};
+
+extern EFI_BOOT_SERVICES    *gBS;
+extern EFI_SYSTEM_TABLE     *gST;
+extern EFI_RUNTIME_SERVICES *gRT;
+extern EFI_HANDLE            gImageHandle;
+
+/* GUIDs of the [Guids] and [Protocols] sections in Ventoy.inf, the values are not used */
+extern EFI_GUID gShellVariableGuid;
+extern EFI_GUID gEfiVirtualCdGuid;
+extern EFI_GUID gEfiFileInfoGuid;
+extern EFI_GUID gEfiFileSystemInfoGuid;
+extern EFI_GUID gEfiLoadedImageProtocolGuid;
+extern EFI_GUID gEfiBlockIoProtocolGuid;
+extern EFI_GUID gEfiBlockIo2ProtocolGuid;
+extern EFI_GUID gEfiDevicePathProtocolGuid;
+extern EFI_GUID gEfiSimpleFileSystemProtocolGuid;
+extern EFI_GUID gEfiRamDiskProtocolGuid;
+extern EFI_GUID gEfiAbsolutePointerProtocolGuid;
+extern EFI_GUID gEfiAcpiTableProtocolGuid;
+extern EFI_GUID gEfiBusSpecificDriverOverrideProtocolGuid;
+extern EFI_GUID gEfiComponentNameProtocolGuid;
+extern EFI_GUID gEfiComponentName2ProtocolGuid;
+extern EFI_GUID gEfiDriverBindingProtocolGuid;
+extern EFI_GUID gEfiDiskIoProtocolGuid;
+extern EFI_GUID gEfiDiskIo2ProtocolGuid;
+extern EFI_GUID gEfiGraphicsOutputProtocolGuid;
+extern EFI_GUID gEfiHiiConfigAccessProtocolGuid;
+extern EFI_GUID gEfiHiiFontProtocolGuid;
+extern EFI_GUID gEfiLoadFileProtocolGuid;
+extern EFI_GUID gEfiLoadFile2ProtocolGuid;
+extern EFI_GUID gEfiLoadedImageDevicePathProtocolGuid;
+extern EFI_GUID gEfiPciIoProtocolGuid;
+extern EFI_GUID gEfiSerialIoProtocolGuid;
+extern EFI_GUID gEfiSimpleTextInProtocolGuid;
+extern EFI_GUID gEfiSimpleTextInputExProtocolGuid;
+extern EFI_GUID gEfiSimpleTextOutProtocolGuid;
+
+/* BaseMemoryLib and MemoryAllocationLib */
+static inline VOID *CopyMem(VOID *Dst, CONST VOID *Src, UINTN Len) { return memmove(Dst, Src, Len); }
+static inline VOID *SetMem(VOID *Buf, UINTN Len, UINT8 Value) { return memset(Buf, Value, Len); }
+static inline VOID *ZeroMem(VOID *Buf, UINTN Len) { return memset(Buf, 0, Len); }
+static inline INTN CompareMem(CONST VOID *A, CONST VOID *B, UINTN Len) { return memcmp(A, B, Len); }
+static inline BOOLEAN CompareGuid(CONST EFI_GUID *A, CONST EFI_GUID *B) { return memcmp(A, B, sizeof(EFI_GUID)) == 0; }
+static inline VOID *AllocatePool(UINTN Size) { return malloc(Size ? Size : 1); }
+static inline VOID *AllocateZeroPool(UINTN Size) { return calloc(1, Size ? Size : 1); }
+static inline VOID *AllocateRuntimePool(UINTN Size) { return malloc(Size ? Size : 1); }
+static inline VOID *AllocatePages(UINTN Pages) { return calloc(Pages, 4096); }
+static inline VOID FreePool(VOID *Buf) { free(Buf); }
+static inline VOID FreePages(VOID *Buf, UINTN Pages) { (void)Pages; free(Buf); }
+
+/* BaseLib and PrintLib */
+UINTN StrLen(CONST CHAR16 *String);
+UINTN StrSize(CONST CHAR16 *String);
+INTN StrCmp(CONST CHAR16 *First, CONST CHAR16 *Second);
+INTN StrnCmp(CONST CHAR16 *First, CONST CHAR16 *Second, UINTN Length);
+CHAR16 *StrStr(CONST CHAR16 *String, CONST CHAR16 *SearchString);
+RETURN_STATUS StrCpyS(CHAR16 *Destination, UINTN DestMax, CONST CHAR16 *Source);
+UINTN StrDecimalToUintn(CONST CHAR16 *String);
+UINTN StrHexToUintn(CONST CHAR16 *String);
+UINTN AsciiStrLen(CONST CHAR8 *String);
+INTN AsciiStrCmp(CONST CHAR8 *First, CONST CHAR8 *Second);
+INTN AsciiStrnCmp(CONST CHAR8 *First, CONST CHAR8 *Second, UINTN Length);
+CHAR8 *AsciiStrStr(CONST CHAR8 *String, CONST CHAR8 *SearchString);
+RETURN_STATUS AsciiStrCpyS(CHAR8 *Destination, UINTN DestMax, CONST CHAR8 *Source);
+UINTN AsciiStrDecimalToUintn(CONST CHAR8 *String);
+UINTN AsciiStrHexToUintn(CONST CHAR8 *String);
+UINTN AsciiSPrint(CHAR8 *StartOfBuffer, UINTN BufferSize, CONST CHAR8 *FormatString, ...);
+UINTN AsciiVSPrint(CHAR8 *StartOfBuffer, UINTN BufferSize, CONST CHAR8 *FormatString, va_list Marker);
+UINTN UnicodeSPrint(CHAR16 *StartOfBuffer, UINTN BufferSize, CONST CHAR16 *FormatString, ...);
+UINTN UnicodeSPrintAsciiFormat(CHAR16 *StartOfBuffer, UINTN BufferSize, CONST CHAR8 *FormatString, ...);
+UINTN UnicodeVSPrintAsciiFormat(CHAR16 *StartOfBuffer, UINTN BufferSize, CONST CHAR8 *FormatString, va_list Marker);
+UINTN Print(IN CONST CHAR16 *Format, ...);
+
+/* DevicePathLib */
+UINTN GetDevicePathSize(CONST EFI_DEVICE_PATH_PROTOCOL *DevicePath);
+EFI_DEVICE_PATH_PROTOCOL *DuplicateDevicePath(CONST EFI_DEVICE_PATH_PROTOCOL *DevicePath);
+EFI_DEVICE_PATH_PROTOCOL *AppendDevicePathNode(CONST EFI_DEVICE_PATH_PROTOCOL *DevicePath, CONST EFI_DEVICE_PATH_PROTOCOL *DevicePathNode);
+EFI_DEVICE_PATH_PROTOCOL *FileDevicePath(EFI_HANDLE Device, CONST CHAR16 *FileName);
+CHAR16 *ConvertDevicePathToText(CONST EFI_DEVICE_PATH_PROTOCOL *DevicePath, BOOLEAN DisplayOnly, BOOLEAN AllowShortcuts);
+
+#endif /* __EDK2_HOST_H__ */
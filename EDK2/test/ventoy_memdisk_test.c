@@ -0,0 +1,184 @@
+/******************************************************************************
+ * ventoy_memdisk_test.c  ---- host test for the memdisk writeback
+ *
+ * Copyright (c) 2021, longpanda <admin@ventoy.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Linked with Ventoy.c, VentoyDebug.c and VentoyProtocol.c. The memdisk is written
+ * through ventoy_block_io_ramdisk_write, the image file is two fragments on a fake
+ * raw BlockIo backed by memory. The firmware ExitBootServices fails the first time
+ * with a stale MapKey, as it does when the memory map changed, then succeeds.
+ */
+#include <edk2_host.h>
+#include <Ventoy.h>
+
+EFI_STATUS EFIAPI ventoy_block_io_ramdisk_write(IN EFI_BLOCK_IO_PROTOCOL *This, IN UINT32 MediaId, IN EFI_LBA Lba,
+                                                IN UINTN BufferSize, IN VOID *Buffer);
+
+#define TEST_IMG_SECS      64
+#define TEST_DISK_SECS     (TEST_IMG_SECS * 4 + 4096)
+#define TEST_MAP_KEY       0x55AA
+
+static int g_fail = 0;
+static UINT8 *g_disk = NULL;
+static UINTN g_disk_writes = 0;
+static UINTN g_disk_flushes = 0;
+static UINTN g_ebs_calls = 0;
+static UINTN g_ebs_map_key = 0;
+
+static EFI_BLOCK_IO_MEDIA g_raw_media;
+static EFI_BLOCK_IO_PROTOCOL g_raw_blockio;
+static EFI_BOOT_SERVICES g_boot_services;
+
+#define CHECK(cond, fmt, args...) \
+    if (!(cond)) { printf("FAIL %s:%d " fmt "\n", __func__, __LINE__, ##args); g_fail++; }
+
+static EFI_STATUS EFIAPI test_raw_write(IN EFI_BLOCK_IO_PROTOCOL *This, IN UINT32 MediaId, IN EFI_LBA Lba,
+                                        IN UINTN BufferSize, IN VOID *Buffer)
+{
+    (void)This;
+    (void)MediaId;
+
+    CHECK((Lba + BufferSize / 512) <= TEST_DISK_SECS, "write beyond the disk %llu", (unsigned long long)Lba);
+    CopyMem(g_disk + Lba * 512, Buffer, BufferSize);
+    g_disk_writes++;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI test_raw_flush(IN EFI_BLOCK_IO_PROTOCOL *This)
+{
+    (void)This;
+    g_disk_flushes++;
+    return EFI_SUCCESS;
+}
+
+/* the first call has a stale MapKey, the loader gets a new memory map and tries again */
+static EFI_STATUS EFIAPI test_exit_boot_services(IN EFI_HANDLE ImageHandle, IN UINTN MapKey)
+{
+    (void)ImageHandle;
+
+    g_ebs_calls++;
+    if (MapKey != g_ebs_map_key)
+    {
+        g_ebs_map_key = MapKey;
+        return EFI_INVALID_PARAMETER;
+    }
+    return EFI_SUCCESS;
+}
+
+/* disk offset of the image sector, the image is two fragments */
+static UINT8 *disk_sector(UINTN Sector)
+{
+    if (Sector < TEST_IMG_SECS / 2)
+    {
+        return g_disk + (2048 + Sector * 4) * 512;
+    }
+    return g_disk + (3072 + (Sector - TEST_IMG_SECS / 2) * 4) * 512;
+}
+
+static void write_memdisk(UINTN Sector, UINTN Count, UINT8 Fill)
+{
+    UINT8 Buf[8 * 2048];
+
+    SetMem(Buf, Count * 2048, Fill);
+    CHECK(ventoy_block_io_ramdisk_write(&gBlockData.BlockIo, 0, Sector, Count * 2048, Buf) == EFI_SUCCESS,
+          "memdisk write %lu", (unsigned long)Sector);
+}
+
+static void test_setup(void)
+{
+    g_boot_services.ExitBootServices = test_exit_boot_services;
+    gBS = &g_boot_services;
+
+    g_disk = calloc(TEST_DISK_SECS, 512);
+    g_raw_media.BlockSize = 512;
+    g_raw_media.LastBlock = TEST_DISK_SECS - 1;
+    g_raw_blockio.Media = &g_raw_media;
+    g_raw_blockio.WriteBlocks = test_raw_write;
+    g_raw_blockio.FlushBlocks = test_raw_flush;
+    gBlockData.pRawBlockIo = &g_raw_blockio;
+
+    g_chain = calloc(1, sizeof(ventoy_chain_head));
+    g_chain->disk_sector_size = 512;
+    g_chain->real_img_size_in_bytes = TEST_IMG_SECS * 2048;
+    g_chain->virt_img_size_in_bytes = g_chain->real_img_size_in_bytes;
+
+    g_chunk = calloc(2, sizeof(ventoy_img_chunk));
+    g_chunk[0].img_start_sector = 0;
+    g_chunk[0].img_end_sector = TEST_IMG_SECS / 2 - 1;
+    g_chunk[0].disk_start_sector = 2048;
+    g_chunk[0].disk_end_sector = 2048 + TEST_IMG_SECS * 2 - 1;
+    g_chunk[1].img_start_sector = TEST_IMG_SECS / 2;
+    g_chunk[1].img_end_sector = TEST_IMG_SECS - 1;
+    g_chunk[1].disk_start_sector = 3072;
+    g_chunk[1].disk_end_sector = 3072 + TEST_IMG_SECS * 2 - 1;
+    g_img_chunk_num = 2;
+
+    g_iso_buf_size = TEST_IMG_SECS * 2048;
+    g_iso_data_buf = calloc(1, g_iso_buf_size);
+    gSector512Mode = TRUE;
+    gMemdiskMode = TRUE;
+}
+
+static void test_exit_boot(void)
+{
+    CHECK(ventoy_memdisk_writeback_init() == EFI_SUCCESS, "writeback init");
+    CHECK(gBS->ExitBootServices != test_exit_boot_services, "ExitBootServices is not wrapped");
+
+    /* one run inside the first fragment and one across the two fragments */
+    write_memdisk(3, 2, 0x11);
+    write_memdisk(TEST_IMG_SECS / 2 - 1, 2, 0x22);
+    CHECK(g_disk_writes == 0, "memdisk write went to the disk");
+
+    /* first try: flushed before the firmware call, which fails */
+    CHECK(gBS->ExitBootServices(NULL, TEST_MAP_KEY) == EFI_INVALID_PARAMETER, "first ExitBootServices");
+    CHECK(g_ebs_calls == 1, "firmware ExitBootServices calls %lu", (unsigned long)g_ebs_calls);
+    CHECK(disk_sector(3)[0] == 0x11 && disk_sector(4)[2047] == 0x11, "run 1 not written back");
+    CHECK(disk_sector(TEST_IMG_SECS / 2 - 1)[0] == 0x22 && disk_sector(TEST_IMG_SECS / 2)[0] == 0x22,
+          "run 2 not written back");
+    CHECK(g_disk_writes == 3 && g_disk_flushes == 1, "writes:%lu flushes:%lu",
+          (unsigned long)g_disk_writes, (unsigned long)g_disk_flushes);
+
+    /* the retry must not write again */
+    write_memdisk(10, 1, 0x33);
+    CHECK(gBS->ExitBootServices(NULL, TEST_MAP_KEY) == EFI_SUCCESS, "retried ExitBootServices");
+    CHECK(g_ebs_calls == 2, "firmware ExitBootServices calls %lu", (unsigned long)g_ebs_calls);
+    CHECK(g_disk_writes == 3 && disk_sector(10)[0] == 0, "retried ExitBootServices wrote back");
+
+    /* the boot returned: the firmware function is restored and the rest is written back */
+    ventoy_memdisk_writeback_fini();
+    CHECK(gBS->ExitBootServices == test_exit_boot_services, "ExitBootServices not restored");
+    CHECK(disk_sector(10)[0] == 0x33 && g_disk_writes == 4, "fini writeback");
+
+    /* a second boot wraps again and flushes again */
+    CHECK(ventoy_memdisk_writeback_init() == EFI_SUCCESS, "writeback init 2");
+    write_memdisk(20, 1, 0x44);
+    g_ebs_map_key = 0;
+    gBS->ExitBootServices(NULL, TEST_MAP_KEY);
+    CHECK(disk_sector(20)[0] == 0x44, "second boot not written back");
+    ventoy_memdisk_writeback_fini();
+}
+
+int main(void)
+{
+    test_setup();
+    test_exit_boot();
+
+    printf("%s\n", g_fail ? "memdisk test FAILED" : "memdisk test passed");
+    return g_fail ? 1 : 0;
+}
@@ -0,0 +1,252 @@
+/******************************************************************************
+ * ventoy_secover_test.c  ---- host test for the iso9660 sector overflow fixup
+ *
+ * Copyright (c) 2021, longpanda <admin@ventoy.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Linked with Ventoy.c, VentoyDebug.c and VentoyProtocol.c. All the reads go through
+ * ventoy_block_io_read, as the SSTR PE loader would do them on the virtual cdrom.
+ * The raw disk is a fake BlockIo that fills every 512 sector with its LBA, so the
+ * disk sector of every returned 2048 sector is known.
+ *
+ * The image is 6GB with several files beyond 4GB (VENTOY_ISO9660_SECTOR_OVERFLOW).
+ * Their dirents are patched by iso9660 overrides. Reading a dirent arms the file,
+ * the loader then reads the file at first_sector - 4GB (32 bit wrap), which must be
+ * remapped until the whole file is read.
+ */
+#include <edk2_host.h>
+#include <Ventoy.h>
+
+#define TEST_OVERFLOW      2097152   /* VENTOY_ISO9660_SECTOR_OVERFLOW */
+#define TEST_IMG_SECS      (3 * 1024 * 1024)
+#define TEST_DISK_START    2048      /* disk sector of image sector 0 */
+#define TEST_DIRENT_SEC    20
+
+static int g_fail = 0;
+
+static EFI_BLOCK_IO_MEDIA g_raw_media;
+static EFI_BLOCK_IO_PROTOCOL g_raw_blockio;
+static EFI_BOOT_SERVICES g_boot_services;
+
+#define CHECK(cond, fmt, args...) \
+    if (!(cond)) { printf("FAIL %s:%d " fmt "\n", __func__, __LINE__, ##args); g_fail++; }
+
+static EFI_STATUS EFIAPI test_raw_read(IN EFI_BLOCK_IO_PROTOCOL *This, IN UINT32 MediaId, IN EFI_LBA Lba,
+                                       IN UINTN BufferSize, OUT VOID *Buffer)
+{
+    UINTN i;
+
+    (void)This;
+    (void)MediaId;
+
+    for (i = 0; i < BufferSize / 512; i++)
+    {
+        *(UINT64 *)((UINT8 *)Buffer + i * 512) = Lba + i;
+    }
+    return EFI_SUCCESS;
+}
+
+typedef struct test_file
+{
+    const char *name;
+    UINT32 first_sector;
+    UINT32 size;
+    UINT32 dirent_offset;   /* byte offset of the extent field in the image */
+}test_file;
+
+/* A B C are beyond 4GB, D is a normal file, A and B share a dirent sector */
+static test_file g_files[] =
+{
+    { "A", TEST_OVERFLOW + 1000,   5 * 2048,        TEST_DIRENT_SEC * 2048 + 2 },
+    { "B", TEST_OVERFLOW + 50000,  9 * 2048 + 100,  TEST_DIRENT_SEC * 2048 + 2 + 64 },
+    { "C", TEST_OVERFLOW + 900000, 3 * 2048,        (TEST_DIRENT_SEC + 1) * 2048 + 2 },
+    { "D", 300,                    4 * 2048,        (TEST_DIRENT_SEC + 1) * 2048 + 2 + 64 },
+};
+
+#define FILE_A  (g_files + 0)
+#define FILE_B  (g_files + 1)
+#define FILE_C  (g_files + 2)
+#define FILE_D  (g_files + 3)
+
+static UINT64 read_one(UINT64 Lba, UINT32 Count)
+{
+    static UINT8 Buf[64 * 2048];
+    EFI_STATUS Status;
+
+    Status = ventoy_block_io_read(&gBlockData.BlockIo, 0, Lba, Count * 2048, Buf);
+    CHECK(Status == EFI_SUCCESS, "read %llu failed", (unsigned long long)Lba);
+
+    /* image sector of the returned data */
+    return (*(UINT64 *)Buf - TEST_DISK_START) / 4;
+}
+
+/* read the file at the 32 bit wrapped sector, piece by piece, return how many pieces were remapped */
+static UINT32 read_wrapped(test_file *file, UINT32 Piece)
+{
+    UINT32 Sec;
+    UINT32 Count;
+    UINT32 Remap = 0;
+    UINT32 TotSecs = (file->size + 2047) / 2048;
+    UINT64 Data;
+
+    for (Sec = 0; Sec < TotSecs; Sec += Count)
+    {
+        Count = (TotSecs - Sec < Piece) ? TotSecs - Sec : Piece;
+        Data = read_one(file->first_sector - TEST_OVERFLOW + Sec, Count);
+        if (Data == (UINT64)file->first_sector + Sec)
+        {
+            Remap++;
+        }
+        else
+        {
+            CHECK(Data == (UINT64)file->first_sector - TEST_OVERFLOW + Sec, "file %s piece %u data %llu",
+                  file->name, Sec, (unsigned long long)Data);
+        }
+    }
+    return Remap;
+}
+
+static void test_setup(void)
+{
+    UINT32 i;
+    ventoy_iso9660_override *dirent;
+
+    g_boot_services.AllocatePool = NULL;
+    gBS = &g_boot_services;
+
+    g_raw_media.BlockSize = 512;
+    g_raw_media.LastBlock = TEST_DISK_START + (UINT64)TEST_IMG_SECS * 4 - 1;
+    g_raw_blockio.Media = &g_raw_media;
+    g_raw_blockio.ReadBlocks = test_raw_read;
+    gBlockData.pRawBlockIo = &g_raw_blockio;
+
+    g_chain = calloc(1, sizeof(ventoy_chain_head));
+    g_chain->disk_sector_size = 512;
+    g_chain->real_img_size_in_bytes = (UINT64)TEST_IMG_SECS * 2048;
+    g_chain->virt_img_size_in_bytes = g_chain->real_img_size_in_bytes;
+
+    g_chunk = calloc(1, sizeof(ventoy_img_chunk));
+    g_chunk->img_start_sector = 0;
+    g_chunk->img_end_sector = TEST_IMG_SECS - 1;
+    g_chunk->disk_start_sector = TEST_DISK_START;
+    g_chunk->disk_end_sector = TEST_DISK_START + (UINT64)TEST_IMG_SECS * 4 - 1;
+    g_img_chunk_num = 1;
+
+    g_override_chunk_num = sizeof(g_files) / sizeof(g_files[0]);
+    g_override_chunk = calloc(g_override_chunk_num, sizeof(ventoy_override_chunk));
+    for (i = 0; i < g_override_chunk_num; i++)
+    {
+        g_override_chunk[i].img_offset = g_files[i].dirent_offset;
+        g_override_chunk[i].override_size = sizeof(ventoy_iso9660_override);
+        dirent = (ventoy_iso9660_override *)g_override_chunk[i].override_data;
+        dirent->first_sector = g_files[i].first_sector;
+        dirent->first_sector_be = __builtin_bswap32(g_files[i].first_sector);
+        dirent->size = g_files[i].size;
+        dirent->size_be = __builtin_bswap32(g_files[i].size);
+    }
+
+    g_fixup_iso9660_secover_enable = TRUE;
+    CHECK(ventoy_fixup_iso9660_init() == EFI_SUCCESS, "init");
+}
+
+static void test_secover(void)
+{
+    UINT32 TotB = (FILE_B->size + 2047) / 2048;
+
+    /* nothing is armed, the wrapped reads are plain reads */
+    CHECK(read_wrapped(FILE_A, 2) == 0, "A remapped before its dirent is read");
+
+    /* reading the dirent sectors arms A, B and C */
+    read_one(TEST_DIRENT_SEC, 2);
+
+    /*
+     * A is read at its real sector: only A stops waiting.
+     * B and C must still be remapped.
+     */
+    CHECK(read_one(FILE_A->first_sector, 1) == FILE_A->first_sector, "plain read of A");
+    CHECK(read_wrapped(FILE_A, 2) == 0, "A remapped after its plain read");
+    CHECK(read_wrapped(FILE_B, 4) == (TotB + 3) / 4, "B not remapped after the plain read of A");
+
+    /* B is done, a second wrapped read of it is a plain read */
+    CHECK(read_wrapped(FILE_B, 4) == 0, "B remapped after it was fully read");
+
+    /* a plain read of the normal file D doesn't disarm C */
+    CHECK(read_one(FILE_D->first_sector, 1) == FILE_D->first_sector, "plain read of D");
+    CHECK(read_wrapped(FILE_C, 1) == 3, "C not remapped after the plain read of D");
+
+    /* dirent read again: A and B are armed again, interleaved wrapped reads */
+    read_one(TEST_DIRENT_SEC, 1);
+    CHECK(read_one(FILE_A->first_sector - TEST_OVERFLOW, 1) == FILE_A->first_sector, "A first piece");
+    CHECK(read_one(FILE_B->first_sector - TEST_OVERFLOW, 2) == FILE_B->first_sector, "B first piece");
+    CHECK(read_one(FILE_A->first_sector - TEST_OVERFLOW + 1, 4) == FILE_A->first_sector + 1, "A second piece");
+    CHECK(read_one(FILE_B->first_sector - TEST_OVERFLOW + 2, 8) == FILE_B->first_sector + 2, "B second piece");
+    CHECK(read_one(FILE_A->first_sector - TEST_OVERFLOW, 1) == FILE_A->first_sector - TEST_OVERFLOW, "A after done");
+
+    /* everything is read, a read of sector 0 is not remapped and returns image sector 0 */
+    CHECK(read_one(0, 1) == 0, "sector 0");
+}
+
+/* an unallocated block of a dynamic vdisk in the middle of the chunk list reads as zero */
+static void test_zero_chunk(void)
+{
+    UINT32 i;
+    EFI_STATUS Status;
+    static UINT8 Buf[12 * 2048];
+    ventoy_img_chunk *data = g_chunk;
+    ventoy_img_chunk chunk[3] =
+    {
+        { 0,  99,  TEST_DISK_START, TEST_DISK_START + 400 - 1 },
+        { 100, 103, VTOY_ZERO_CHUNK_SECTOR + 400, VTOY_ZERO_CHUNK_SECTOR + 416 - 1 },
+        { 104, TEST_IMG_SECS - 1, TEST_DISK_START + 400, TEST_DISK_START + (UINT64)TEST_IMG_SECS * 4 - 16 - 1 },
+    };
+
+    g_chunk = chunk;
+    g_img_chunk_num = 3;
+
+    SetMem(Buf, sizeof(Buf), 0xFF);
+    Status = ventoy_block_io_read(&gBlockData.BlockIo, 0, 96, sizeof(Buf), Buf);
+    CHECK(Status == EFI_SUCCESS, "read across the hole");
+
+    for (i = 0; i < 12; i++)
+    {
+        if (i >= 4 && i < 8)
+        {
+            CHECK(*(UINT64 *)(Buf + i * 2048) == 0 && *(UINT64 *)(Buf + i * 2048 + 2040) == 0,
+                  "sector %u in the hole is not zero", 96 + i);
+        }
+        else
+        {
+            CHECK(*(UINT64 *)(Buf + i * 2048) == TEST_DISK_START + (96 + i - (i >= 8 ? 4 : 0)) * 4,
+                  "sector %u data %llu", 96 + i, (unsigned long long)*(UINT64 *)(Buf + i * 2048));
+        }
+    }
+
+    g_chunk = data;
+    g_img_chunk_num = 1;
+}
+
+int main(void)
+{
+    test_setup();
+    test_secover();
+    test_zero_chunk();
+    ventoy_fixup_iso9660_fini();
+
+    printf("%s\n", g_fail ? "secover test FAILED" : "secover test passed");
+    return g_fail ? 1 : 0;
+}
@@ -40,6 +40,7 @@ static grub_uint64_t g_ventoy_last_read_dirent_pos = 0;
 static grub_uint64_t g_ventoy_last_read_dirent_offset = 0;
 static grub_uint64_t g_ventoy_last_file_dirent_pos = 0;
 static grub_uint64_t g_ventoy_last_file_dirent_offset = 0;
+static grub_iso9660_cache_stat g_iso9660_stat;
 
 #define GRUB_ISO9660_FSTYPE_DIR		0040000
 #define GRUB_ISO9660_FSTYPE_REG		0100000
@@ -677,6 +678,7 @@ grub_iso9660_iterate_dir (grub_fshelp_node_t dir,
   struct iterate_dir_ctx ctx;
 
   len = get_node_size (dir);
+  g_iso9660_stat.walk++;
 
   for (; offset < len; offset += dirent.len)
     {
@@ -859,6 +861,245 @@ grub_iso9660_iterate_dir (grub_fshelp_node_t dir,
   return 0;
 }
 
+/* 
+ * Path lookup cache for the mounted ISO.
+ * Many paths are probed in the same ISO during boot (distro detection, initrd collection ...), 
+ * every open walks the directory tree from the root, so we cache the result of the lookup 
+ * (dirents of the node, the dirent position for ventoy, or not found).
+ * The cache is dropped when the disk or the volume descriptor changes.
+ */
+#define ISO9660_CACHE_BUCKETS   256
+#define ISO9660_CACHE_MAX       4096
+
+typedef struct iso9660_cache_entry
+{
+    struct iso9660_cache_entry *next;
+    int type;
+    int found;
+    grub_uint64_t dirent_pos;
+    grub_uint64_t dirent_offset;
+    grub_size_t have_dirents;
+    struct grub_iso9660_dir *dirents;
+    char path[1];
+}iso9660_cache_entry;
+
+static int g_iso9660_cache_valid = 0;
+static unsigned long g_iso9660_cache_dev_id = 0;
+static unsigned long g_iso9660_cache_disk_id = 0;
+static int g_iso9660_cache_joliet = 0;
+static int g_iso9660_cache_rockridge = 0;
+static struct grub_iso9660_primary_voldesc g_iso9660_cache_voldesc;
+static iso9660_cache_entry *g_iso9660_cache[ISO9660_CACHE_BUCKETS];
+
+static grub_uint32_t iso9660_cache_hash(const char *path, int type)
+{
+    grub_uint32_t hash = 5381 + type;
+
+    while (*path)
+    {
+        hash = ((hash << 5) + hash) + (grub_uint8_t)(*path++);
+    }
+
+    return hash % ISO9660_CACHE_BUCKETS;
+}
+
+static void iso9660_cache_flush(void)
+{
+    int i;
+    iso9660_cache_entry *entry, *next;
+
+    for (i = 0; i < ISO9660_CACHE_BUCKETS; i++)
+    {
+        for (entry = g_iso9660_cache[i]; entry; entry = next)
+        {
+            next = entry->next;
+            grub_free(entry->dirents);
+            grub_free(entry);
+        }
+        g_iso9660_cache[i] = NULL;
+    }
+
+    if (g_iso9660_stat.entries > 0)
+    {
+        g_iso9660_stat.flush++;
+    }
+    g_iso9660_stat.entries = 0;
+}
+
+/* check whether the cache belongs to this mounted ISO, drop it if not */
+static void iso9660_cache_check(struct grub_iso9660_data *data)
+{
+    grub_disk_t disk = data->disk;
+
+    if (g_iso9660_cache_valid &&
+        g_iso9660_cache_dev_id == disk->dev->id &&
+        g_iso9660_cache_disk_id == disk->id &&
+        g_iso9660_cache_joliet == data->joliet &&
+        g_iso9660_cache_rockridge == data->rockridge &&
+        grub_memcmp(&g_iso9660_cache_voldesc, &data->voldesc, sizeof(data->voldesc)) == 0)
+    {
+        return;
+    }
+
+    iso9660_cache_flush();
+
+    g_iso9660_cache_dev_id = disk->dev->id;
+    g_iso9660_cache_disk_id = disk->id;
+    g_iso9660_cache_joliet = data->joliet;
+    g_iso9660_cache_rockridge = data->rockridge;
+    grub_memcpy(&g_iso9660_cache_voldesc, &data->voldesc, sizeof(data->voldesc));
+    g_iso9660_cache_valid = 1;
+}
+
+static iso9660_cache_entry * iso9660_cache_find(const char *path, int type)
+{
+    iso9660_cache_entry *entry;
+
+    for (entry = g_iso9660_cache[iso9660_cache_hash(path, type)]; entry; entry = entry->next)
+    {
+        if (entry->type == type && grub_strcmp(entry->path, path) == 0)
+        {
+            return entry;
+        }
+    }
+
+    return NULL;
+}
+
+static void iso9660_cache_add(const char *path, int type, struct grub_fshelp_node *node)
+{
+    grub_uint32_t hash;
+    iso9660_cache_entry *entry;
+
+    if (node && node->have_symlink)
+    {
+        return;
+    }
+
+    if (g_iso9660_stat.entries >= ISO9660_CACHE_MAX)
+    {
+        iso9660_cache_flush();
+    }
+
+    entry = grub_zalloc(sizeof(iso9660_cache_entry) + grub_strlen(path));
+    if (!entry)
+    {
+        grub_errno = GRUB_ERR_NONE;
+        return;
+    }
+
+    entry->type = type;
+    grub_strcpy(entry->path, path);
+
+    if (node)
+    {
+        entry->dirents = grub_malloc(node->have_dirents * sizeof(struct grub_iso9660_dir));
+        if (!entry->dirents)
+        {
+            grub_free(entry);
+            grub_errno = GRUB_ERR_NONE;
+            return;
+        }
+
+        grub_memcpy(entry->dirents, node->dirents, node->have_dirents * sizeof(struct grub_iso9660_dir));
+        entry->have_dirents = node->have_dirents;
+        entry->dirent_pos = g_ventoy_last_file_dirent_pos;
+        entry->dirent_offset = g_ventoy_last_file_dirent_offset;
+        entry->found = 1;
+    }
+
+    hash = iso9660_cache_hash(path, type);
+    entry->next = g_iso9660_cache[hash];
+    g_iso9660_cache[hash] = entry;
+    g_iso9660_stat.entries++;
+}
+
+/*
+ * Lookup PATH with the cache.
+ * Return 1 with *foundnode set (or grub_errno set for a cached not found) on cache hit.
+ * Return 0 on cache miss.
+ */
+static int iso9660_cache_lookup(struct grub_iso9660_data *data, const char *path, int type, 
+                                struct grub_fshelp_node **foundnode)
+{
+    grub_size_t alloc;
+    iso9660_cache_entry *entry;
+    struct grub_fshelp_node *node;
+
+    g_iso9660_stat.lookup++;
+
+    iso9660_cache_check(data);
+
+    entry = iso9660_cache_find(path, type);
+    if (!entry)
+    {
+        g_iso9660_stat.miss++;
+        return 0;
+    }
+
+    if (!entry->found)
+    {
+        g_iso9660_stat.neg_hit++;
+        grub_error(GRUB_ERR_FILE_NOT_FOUND, "file `%s' not found", path);
+        return 1;
+    }
+
+    alloc = entry->have_dirents;
+    if (alloc < ARRAY_SIZE (node->dirents))
+    {
+        alloc = ARRAY_SIZE (node->dirents);
+    }
+
+    node = grub_malloc(sizeof(struct grub_fshelp_node) + (alloc - ARRAY_SIZE (node->dirents)) * sizeof(struct grub_iso9660_dir));
+    if (!node)
+    {
+        grub_errno = GRUB_ERR_NONE;
+        g_iso9660_stat.miss++;
+        return 0;
+    }
+
+    node->data = data;
+    node->alloc_dirents = alloc;
+    node->have_dirents = entry->have_dirents;
+    node->have_symlink = 0;
+    grub_memcpy(node->dirents, entry->dirents, entry->have_dirents * sizeof(struct grub_iso9660_dir));
+
+    g_ventoy_last_file_dirent_pos = entry->dirent_pos;
+    g_ventoy_last_file_dirent_offset = entry->dirent_offset;
+
+    g_iso9660_stat.hit++;
+    *foundnode = node;
+    return 1;
+}
+
+/* do the real lookup and save the result to the cache */
+static grub_err_t iso9660_find_file(struct grub_iso9660_data *data, const char *path, 
+                                    struct grub_fshelp_node *rootnode,
+                                    struct grub_fshelp_node **foundnode, 
+                                    enum grub_fshelp_filetype type)
+{
+    grub_err_t err;
+
+    if (iso9660_cache_lookup(data, path, type, foundnode))
+    {
+        return grub_errno;
+    }
+
+    err = grub_fshelp_find_file(path, rootnode, foundnode, grub_iso9660_iterate_dir, grub_iso9660_read_symlink, type);
+    if (err == GRUB_ERR_NONE)
+    {
+        if (*foundnode != rootnode)
+        {
+            iso9660_cache_add(path, type, *foundnode);
+        }
+    }
+    else if (err == GRUB_ERR_FILE_NOT_FOUND)
+    {
+        iso9660_cache_add(path, type, NULL);
+    }
+
+    return err;
+}
 
 
 /* Context for grub_iso9660_dir.  */
@@ -907,11 +1148,7 @@ grub_iso9660_dir (grub_device_t device, const char *path,
   rootnode.dirents[0] = data->voldesc.rootdir;
 
   /* Use the fshelp function to traverse the path.  */
-  if (grub_fshelp_find_file (path, &rootnode,
-			     &foundnode,
-			     grub_iso9660_iterate_dir,
-			     grub_iso9660_read_symlink,
-			     GRUB_FSHELP_DIR))
+  if (iso9660_find_file (data, path, &rootnode, &foundnode, GRUB_FSHELP_DIR))
     goto fail;
 
   /* List the files in the directory.  */
@@ -950,11 +1187,7 @@ grub_iso9660_open (struct grub_file *file, const char *name)
   rootnode.dirents[0] = data->voldesc.rootdir;
 
   /* Use the fshelp function to traverse the path.  */
-  if (grub_fshelp_find_file (name, &rootnode,
-			     &foundnode,
-			     grub_iso9660_iterate_dir,
-			     grub_iso9660_read_symlink,
-			     GRUB_FSHELP_REG))
+  if (iso9660_find_file (data, name, &rootnode, &foundnode, GRUB_FSHELP_REG))
     goto fail;
 
   data->node = foundnode;
@@ -1138,6 +1371,41 @@ grub_uint64_t grub_iso9660_get_last_file_dirent_pos(grub_file_t file)
     return (g_ventoy_last_file_dirent_pos << GRUB_DISK_SECTOR_BITS) + g_ventoy_last_file_dirent_offset;
 }
 
+/* 
+ * Get the first extent (in bytes) of an opened file directly from its dirent, 
+ * so no data read is needed to trigger read_node.
+ * The dirent position is recorded when the file is looked up in grub_iso9660_open.
+ */
+grub_uint64_t grub_iso9660_get_file_extent(grub_file_t file, grub_uint64_t *dirent_pos)
+{
+    struct grub_iso9660_data *data = (struct grub_iso9660_data *)file->data;
+
+    if (dirent_pos)
+    {
+        *dirent_pos = (g_ventoy_last_file_dirent_pos << GRUB_DISK_SECTOR_BITS) + g_ventoy_last_file_dirent_offset;
+    }
+
+    if ((!data) || (!data->node) || data->node->have_dirents == 0)
+    {
+        return 0;
+    }
+
+    return ((grub_uint64_t)grub_le_to_cpu32(data->node->dirents[0].first_sector)) << (GRUB_ISO9660_LOG2_BLKSZ + GRUB_DISK_SECTOR_BITS);
+}
+
+void grub_iso9660_get_cache_stat(grub_iso9660_cache_stat *stat)
+{
+    grub_memcpy(stat, &g_iso9660_stat, sizeof(g_iso9660_stat));
+}
+
+void grub_iso9660_reset_cache_stat(void)
+{
+    grub_uint32_t entries = g_iso9660_stat.entries;
+
+    grub_memset(&g_iso9660_stat, 0, sizeof(g_iso9660_stat));
+    g_iso9660_stat.entries = entries;
+}
+
 static struct grub_fs grub_iso9660_fs =
   {
     .name = "iso9660",
@@ -1164,4 +1432,5 @@ GRUB_MOD_INIT(iso9660)
 GRUB_MOD_FINI(iso9660)
 {
   grub_fs_unregister (&grub_iso9660_fs);
+  iso9660_cache_flush ();
 }
@@ -1412,6 +1412,193 @@ grub_uint64_t grub_udf_get_last_file_attr_offset
     return attr_offset;
 }
 
+static int grub_udf_add_file_chunk(struct grub_fshelp_node *node, ventoy_img_chunk_list *chunk_list,
+    grub_uint16_t part_ref, grub_uint32_t block, grub_uint32_t adlen, grub_uint32_t adtype, grub_uint64_t *left)
+{
+    grub_uint32_t sector;
+    grub_uint64_t size;
+
+    if (*left == 0 || adlen == 0)
+    {
+        return 0;
+    }
+
+    /* not recorded extent (sparse) can not be mapped to the disk */
+    if (adtype != 0)
+    {
+        grub_dprintf("udf", "unrecorded extent type:%u len:%u\n", adtype, adlen);
+        return 1;
+    }
+
+    sector = grub_udf_get_block(node->data, part_ref, block);
+    if (grub_errno)
+    {
+        return 1;
+    }
+
+    size = (adlen < *left) ? adlen : *left;
+    *left -= size;
+
+    return grub_disk_blocklist_read(chunk_list, ((grub_uint64_t)sector) << node->data->lbshift, size, 
+                                    node->data->disk->log_sector_size) ? 1 : 0;
+}
+
+/* 
+ * Walk the short/long allocation descriptors (and the allocation extent descriptors chain) of the file,
+ * so that the file data is not needed to be read through the read hook.
+ * Return 0 on success, or non-zero (chunk_list unchanged) if the caller need to fall back to the read hook.
+ */
+int grub_udf_get_file_chunk(grub_uint64_t part_start, grub_file_t file, ventoy_img_chunk_list *chunk_list)
+{
+    int ret = 1;
+    int loop = 0;
+    grub_uint32_t i;
+    grub_uint32_t old_chunk;
+    grub_uint32_t aed_block = 0;
+    grub_uint32_t adlen = 0;
+    grub_uint32_t adtype = 0;
+    grub_uint32_t bsize;
+    grub_uint16_t flags;
+    grub_uint64_t left;
+    grub_ssize_t len;
+    char *ptr = NULL;
+    char *buf = NULL;
+    struct grub_udf_aed *extension;
+    struct grub_fshelp_node *node = (struct grub_fshelp_node *)file->data;
+
+    old_chunk = chunk_list->cur_chunk;
+    left = U64(node->block.fe.file_size);
+    bsize = U32(node->data->lvd.bsize);
+    flags = U16(node->block.fe.icbtag.flags) & GRUB_UDF_ICBTAG_FLAG_AD_MASK;
+
+    if (flags != GRUB_UDF_ICBTAG_FLAG_AD_SHORT && flags != GRUB_UDF_ICBTAG_FLAG_AD_LONG)
+    {
+        grub_dprintf("udf", "alloc type %u not supported\n", flags);
+        return 1;
+    }
+
+    switch (U16(node->block.fe.tag.tag_ident))
+    {
+        case GRUB_UDF_TAG_IDENT_FE:
+            ptr = (char *)&node->block.fe.ext_attr[0] + U32(node->block.fe.ext_attr_length);
+            len = U32(node->block.fe.alloc_descs_length);
+            break;
+        case GRUB_UDF_TAG_IDENT_EFE:
+            ptr = (char *)&node->block.efe.ext_attr[0] + U32(node->block.efe.ext_attr_length);
+            len = U32(node->block.efe.alloc_descs_length);
+            break;
+        default:
+            return 1;
+    }
+
+    buf = grub_malloc(bsize);
+    if (!buf)
+    {
+        return 1;
+    }
+
+    while (left > 0)
+    {
+        if (flags == GRUB_UDF_ICBTAG_FLAG_AD_SHORT)
+        {
+            struct grub_udf_short_ad *ad = (struct grub_udf_short_ad *)ptr;
+
+            if (len < (grub_ssize_t)sizeof(struct grub_udf_short_ad))
+            {
+                break;
+            }
+
+            adlen = U32(ad->length) & 0x3fffffff;
+            adtype = U32(ad->length) >> 30;
+            if (adtype == 3)
+            {
+                aed_block = grub_udf_get_block(node->data, node->part_ref, ad->position);
+            }
+            else if (grub_udf_add_file_chunk(node, chunk_list, node->part_ref, ad->position, adlen, adtype, &left))
+            {
+                goto end;
+            }
+
+            ptr += sizeof(struct grub_udf_short_ad);
+            len -= sizeof(struct grub_udf_short_ad);
+        }
+        else
+        {
+            struct grub_udf_long_ad *ad = (struct grub_udf_long_ad *)ptr;
+
+            if (len < (grub_ssize_t)sizeof(struct grub_udf_long_ad))
+            {
+                break;
+            }
+
+            adlen = U32(ad->length) & 0x3fffffff;
+            adtype = U32(ad->length) >> 30;
+            if (adtype == 3)
+            {
+                aed_block = grub_udf_get_block(node->data, ad->block.part_ref, ad->block.block_num);
+            }
+            else if (grub_udf_add_file_chunk(node, chunk_list, ad->block.part_ref, ad->block.block_num, adlen, adtype, &left))
+            {
+                goto end;
+            }
+
+            ptr += sizeof(struct grub_udf_long_ad);
+            len -= sizeof(struct grub_udf_long_ad);
+        }
+
+        /* next extent of allocation descriptors */
+        if (adtype == 3)
+        {
+            if (grub_errno || adlen > bsize || adlen <= sizeof(struct grub_udf_aed) || ++loop > 4096)
+            {
+                goto end;
+            }
+
+            if (grub_disk_read(node->data->disk, ((grub_disk_addr_t)aed_block) << node->data->lbshift, 0, adlen, buf))
+            {
+                goto end;
+            }
+
+            extension = (struct grub_udf_aed *)buf;
+            if (U16(extension->tag.tag_ident) != GRUB_UDF_TAG_IDENT_AED)
+            {
+                grub_dprintf("udf", "invalid aed tag %u\n", U16(extension->tag.tag_ident));
+                goto end;
+            }
+
+            ptr = buf + sizeof(struct grub_udf_aed);
+            len = U32(extension->ae_len);
+            if (len > (grub_ssize_t)(adlen - sizeof(struct grub_udf_aed)))
+            {
+                goto end;
+            }
+        }
+    }
+
+    if (left > 0)
+    {
+        grub_dprintf("udf", "allocation descriptors end with %llu bytes left\n", (unsigned long long)left);
+        goto end;
+    }
+
+    for (i = old_chunk; i < chunk_list->cur_chunk; i++)
+    {
+        chunk_list->chunk[i].disk_start_sector += part_start;
+        chunk_list->chunk[i].disk_end_sector += part_start;
+    }
+
+    ret = 0;
+
+end:
+    grub_free(buf);
+    if (ret)
+    {
+        chunk_list->cur_chunk = old_chunk;
+        grub_errno = GRUB_ERR_NONE;
+    }
+    return ret;
+}
+
 static struct grub_fs grub_udf_fs = {
   .name = "udf",
   .fs_dir = grub_udf_dir,
@@ -56,6 +56,214 @@ grub_err_t (*grub_disk_write_weak) (grub_disk_t disk,
 				    const void *buf);
 #include "disk_common.c"
 
+/* ventoy: second level LRU cache.
+   Ventoy's directory scan, iso9660 lookup and chunk list check keep evicting
+   each other in the small direct mapped table, so the evicted entries are kept
+   here and moved back to the table on hit.  */
+struct grub_disk_lru_cache
+{
+  unsigned long dev_id;
+  unsigned long disk_id;
+  grub_disk_addr_t sector;
+  char *data;
+  struct grub_disk_lru_cache *prev;
+  struct grub_disk_lru_cache *next;
+  struct grub_disk_lru_cache *hnext;
+};
+
+static struct grub_disk_lru_cache *grub_disk_lru_table;
+static struct grub_disk_lru_cache **grub_disk_lru_hash;
+static struct grub_disk_lru_cache *grub_disk_lru_head;
+static struct grub_disk_lru_cache *grub_disk_lru_tail;
+static struct grub_disk_lru_cache *grub_disk_lru_free;
+static unsigned long grub_disk_lru_num;
+static unsigned long grub_disk_lru_used;
+
+static struct grub_disk_cache_stat grub_disk_stat;
+
+static unsigned long
+grub_disk_lru_index (unsigned long dev_id, unsigned long disk_id,
+		     grub_disk_addr_t sector)
+{
+  return ((dev_id * 524287UL + disk_id * 2606459UL
+	   + ((unsigned long) (sector >> GRUB_DISK_CACHE_BITS)))
+	  % grub_disk_lru_num);
+}
+
+static struct grub_disk_lru_cache *
+grub_disk_lru_find (unsigned long dev_id, unsigned long disk_id,
+		    grub_disk_addr_t sector)
+{
+  struct grub_disk_lru_cache *e;
+
+  if (! grub_disk_lru_num)
+    return 0;
+
+  for (e = grub_disk_lru_hash[grub_disk_lru_index (dev_id, disk_id, sector)];
+       e; e = e->hnext)
+    if (e->dev_id == dev_id && e->disk_id == disk_id && e->sector == sector)
+      return e;
+
+  return 0;
+}
+
+/* Remove the entry from the LRU list and the hash table, return its data.  */
+static char *
+grub_disk_lru_take (struct grub_disk_lru_cache *e)
+{
+  struct grub_disk_lru_cache **pp;
+  char *data = e->data;
+
+  pp = grub_disk_lru_hash + grub_disk_lru_index (e->dev_id, e->disk_id,
+						  e->sector);
+  while (*pp != e)
+    pp = &(*pp)->hnext;
+  *pp = e->hnext;
+
+  if (e->prev)
+    e->prev->next = e->next;
+  else
+    grub_disk_lru_head = e->next;
+  if (e->next)
+    e->next->prev = e->prev;
+  else
+    grub_disk_lru_tail = e->prev;
+
+  e->data = 0;
+  e->next = grub_disk_lru_free;
+  grub_disk_lru_free = e;
+  grub_disk_lru_used--;
+
+  return data;
+}
+
+/* The LRU cache takes the ownership of DATA.  */
+static void
+grub_disk_lru_put (unsigned long dev_id, unsigned long disk_id,
+		   grub_disk_addr_t sector, char *data)
+{
+  struct grub_disk_lru_cache *e;
+  unsigned long index;
+
+  if (! grub_disk_lru_num)
+    {
+      grub_free (data);
+      return;
+    }
+
+  e = grub_disk_lru_find (dev_id, disk_id, sector);
+  if (e)
+    grub_free (grub_disk_lru_take (e));
+
+  if (! grub_disk_lru_free)
+    grub_free (grub_disk_lru_take (grub_disk_lru_tail));
+
+  e = grub_disk_lru_free;
+  grub_disk_lru_free = e->next;
+
+  e->dev_id = dev_id;
+  e->disk_id = disk_id;
+  e->sector = sector;
+  e->data = data;
+
+  e->prev = 0;
+  e->next = grub_disk_lru_head;
+  if (grub_disk_lru_head)
+    grub_disk_lru_head->prev = e;
+  else
+    grub_disk_lru_tail = e;
+  grub_disk_lru_head = e;
+
+  index = grub_disk_lru_index (dev_id, disk_id, sector);
+  e->hnext = grub_disk_lru_hash[index];
+  grub_disk_lru_hash[index] = e;
+  grub_disk_lru_used++;
+}
+
+static void
+grub_disk_lru_invalidate_all (void)
+{
+  unsigned long i;
+
+  grub_disk_lru_head = grub_disk_lru_tail = grub_disk_lru_free = 0;
+  grub_disk_lru_used = 0;
+
+  for (i = 0; i < grub_disk_lru_num; i++)
+    {
+      grub_free (grub_disk_lru_table[i].data);
+      grub_disk_lru_table[i].data = 0;
+      grub_disk_lru_table[i].next = grub_disk_lru_free;
+      grub_disk_lru_free = grub_disk_lru_table + i;
+      grub_disk_lru_hash[i] = 0;
+    }
+}
+
+void
+grub_disk_cache_set_lru_size (unsigned long kb)
+{
+  unsigned long num;
+  struct grub_disk_lru_cache *table;
+  struct grub_disk_lru_cache **hash;
+
+  num = kb / ((GRUB_DISK_SECTOR_SIZE << GRUB_DISK_CACHE_BITS) >> 10);
+  if (num == grub_disk_lru_num)
+    return;
+
+  grub_disk_lru_invalidate_all ();
+  table = grub_disk_lru_table;
+  hash = grub_disk_lru_hash;
+
+  /* grub_malloc may invalidate the cache when out of memory */
+  grub_disk_lru_num = 0;
+  grub_disk_lru_table = 0;
+  grub_disk_lru_hash = 0;
+  grub_free (table);
+  grub_free (hash);
+
+  if (num == 0)
+    return;
+
+  table = grub_zalloc (num * sizeof (*table));
+  hash = grub_zalloc (num * sizeof (*hash));
+  if (! table || ! hash)
+    {
+      grub_free (table);
+      grub_free (hash);
+      grub_errno = GRUB_ERR_NONE;
+      return;
+    }
+
+  grub_disk_lru_table = table;
+  grub_disk_lru_hash = hash;
+  grub_disk_lru_num = num;
+  grub_disk_lru_invalidate_all ();
+}
+
+void
+grub_disk_cache_invalidate_lru (unsigned long dev_id, unsigned long disk_id,
+				grub_disk_addr_t sector)
+{
+  struct grub_disk_lru_cache *e;
+
+  e = grub_disk_lru_find (dev_id, disk_id, sector);
+  if (e)
+    grub_free (grub_disk_lru_take (e));
+}
+
+void
+grub_disk_cache_get_stat (struct grub_disk_cache_stat *stat)
+{
+  grub_memcpy (stat, &grub_disk_stat, sizeof (*stat));
+  stat->lru_num = grub_disk_lru_num;
+  stat->lru_used = grub_disk_lru_used;
+}
+
+void
+grub_disk_cache_reset_stat (void)
+{
+  grub_memset (&grub_disk_stat, 0, sizeof (grub_disk_stat));
+}
+
 void
 grub_disk_cache_invalidate_all (void)
 {
@@ -71,6 +279,8 @@ grub_disk_cache_invalidate_all (void)
 	  cache->data = 0;
 	}
     }
+
+  grub_disk_lru_invalidate_all ();
 }
 
 static char *
@@ -90,12 +300,41 @@ grub_disk_cache_fetch (unsigned long dev_id, unsigned long disk_id,
 #if DISK_CACHE_STATS
       grub_disk_cache_hits++;
 #endif
+      /* the entry of an invalidated block is kept without data */
+      if (cache->data)
+	grub_disk_stat.hits++;
+      else
+	grub_disk_stat.misses++;
       return cache->data;
     }
 
+  /* ventoy: move it back from the LRU cache, the old one goes to the LRU.  */
+  if (! cache->lock)
+    {
+      struct grub_disk_lru_cache *e;
+
+      e = grub_disk_lru_find (dev_id, disk_id, sector);
+      if (e)
+	{
+	  char *data = grub_disk_lru_take (e);
+
+	  if (cache->data)
+	    grub_disk_lru_put (cache->dev_id, cache->disk_id, cache->sector,
+			       cache->data);
+	  cache->dev_id = dev_id;
+	  cache->disk_id = disk_id;
+	  cache->sector = sector;
+	  cache->data = data;
+	  cache->lock = 1;
+	  grub_disk_stat.lru_hits++;
+	  return cache->data;
+	}
+    }
+
 #if DISK_CACHE_STATS
   grub_disk_cache_misses++;
 #endif
+  grub_disk_stat.misses++;
 
   return 0;
 }
@@ -126,7 +365,12 @@ grub_disk_cache_store (unsigned long dev_id, unsigned long disk_id,
   cache = grub_disk_cache_table + cache_index;
 
   cache->lock = 1;
-  grub_free (cache->data);
+  if (cache->data && (cache->dev_id != dev_id || cache->disk_id != disk_id
+		      || cache->sector != sector))
+    grub_disk_lru_put (cache->dev_id, cache->disk_id, cache->sector,
+		       cache->data);
+  else
+    grub_free (cache->data);
   cache->data = 0;
   cache->lock = 0;
 
@@ -342,6 +586,8 @@ grub_disk_read_small_real (grub_disk_t disk, grub_disk_addr_t sector,
       < (disk->total_sectors << (disk->log_sector_size - GRUB_DISK_SECTOR_BITS)))
     {
       grub_err_t err;
+      grub_disk_stat.reads++;
+      grub_disk_stat.read_sectors += GRUB_DISK_CACHE_SIZE;
       err = (disk->dev->disk_read) (disk, transform_sector (disk, sector),
 				    1U << (GRUB_DISK_CACHE_BITS
 					   + GRUB_DISK_SECTOR_BITS
@@ -377,7 +623,9 @@ grub_disk_read_small_real (grub_disk_t disk, grub_disk_addr_t sector,
     tmp_buf = grub_malloc (num << disk->log_sector_size);
     if (!tmp_buf)
       return grub_errno;
-    
+
+    grub_disk_stat.reads++;
+    grub_disk_stat.read_sectors += num << (disk->log_sector_size - GRUB_DISK_SECTOR_BITS);
     if ((disk->dev->disk_read) (disk, transform_sector (disk, aligned_sector),
 				num, tmp_buf))
       {
@@ -546,6 +794,8 @@ grub_disk_read (grub_disk_t disk, grub_disk_addr_t sector,
 	{
 	  grub_disk_addr_t i;
 
+	  grub_disk_stat.reads++;
+	  grub_disk_stat.read_sectors += agglomerate << GRUB_DISK_CACHE_BITS;
 	  err = (disk->dev->disk_read) (disk, transform_sector (disk, sector),
 					agglomerate << (GRUB_DISK_CACHE_BITS
 							+ GRUB_DISK_SECTOR_BITS
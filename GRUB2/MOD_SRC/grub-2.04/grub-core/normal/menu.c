@@ -403,6 +403,8 @@ int g_ventoy_tip_label_enable = 0;
 const char * g_ventoy_tip_msg1 = NULL;
 const char * g_ventoy_tip_msg2 = NULL;
 static const char *g_ventoy_cur_img_path = NULL;
+static const char *g_ventoy_idle_img_path = NULL;
+void (*g_ventoy_menu_idle_hook)(const char *path) = NULL;
 static void menu_set_chosen_tip(grub_menu_t menu, int entry)
 {
     img_info *img;
@@ -411,6 +413,7 @@ static void menu_set_chosen_tip(grub_menu_t menu, int entry)
     grub_menu_entry_t e = grub_menu_get_entry (menu, entry);
 
     g_ventoy_tip_msg1 = g_ventoy_tip_msg2 = NULL;
+    g_ventoy_idle_img_path = NULL;
     if (e && e->id && grub_strncmp(e->id, "VID_", 4) == 0) 
     {
         img = (img_info *)(void *)grub_strtoul(e->id + 4, NULL, 16);
@@ -419,6 +422,7 @@ static void menu_set_chosen_tip(grub_menu_t menu, int entry)
             g_ventoy_tip_msg1 = img->tip1;
             g_ventoy_tip_msg2 = img->tip2;
             g_ventoy_cur_img_path = img->path;
+            g_ventoy_idle_img_path = img->path;
         }
     }
     else if (e && e->id && grub_strncmp(e->id, "DIR_", 4) == 0) 
@@ -781,6 +785,9 @@ run_menu (grub_menu_t menu, int nested, int *auto_boot)
 
       c = grub_getkey_noblock ();
 
+      if (c == GRUB_TERM_NO_KEY && g_ventoy_menu_idle_hook)
+        g_ventoy_menu_idle_hook (g_ventoy_idle_img_path);
+
       /* Negative values are returned on error. */
       if ((c != GRUB_TERM_NO_KEY) && (c > 0))
 	{
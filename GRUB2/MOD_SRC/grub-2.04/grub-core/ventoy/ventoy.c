@@ -30,6 +30,7 @@
 #include <grub/file.h>
 #include <grub/normal.h>
 #include <grub/extcmd.h>
+#include <grub/env.h>
 #include <grub/datetime.h>
 #include <grub/net.h>
 #include <grub/misc.h>
@@ -167,10 +168,14 @@ GRUB_MOD_INIT(ventoy)
     ventoy_env_init();
     ventoy_arch_mode_init();
     ventoy_register_all_cmd();
+    g_ventoy_menu_idle_hook = ventoy_menu_idle_prefetch;
 }
 
 GRUB_MOD_FINI(ventoy)
 {
+    g_ventoy_menu_idle_hook = NULL;
+    grub_register_variable_hook("VTOY_DISK_CACHE_KB", 0, 0);
+    grub_disk_cache_set_lru_size(0);
     ventoy_unregister_all_cmd();
 }
 
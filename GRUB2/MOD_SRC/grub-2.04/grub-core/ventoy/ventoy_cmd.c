@@ -30,6 +30,7 @@
 #include <grub/file.h>
 #include <grub/normal.h>
 #include <grub/extcmd.h>
+#include <grub/env.h>
 #include <grub/datetime.h>
 #include <grub/i18n.h>
 #include <grub/net.h>
@@ -47,7 +48,6 @@
 #include <grub/lib/crc.h>
 #include <grub/ventoy.h>
 #include "ventoy_def.h"
-#include "miniz.h"
 
 GRUB_MOD_LICENSE ("GPLv3+");
 
@@ -778,47 +778,6 @@ int ventoy_is_dir_exist(const char *fmt, ...)
     return 0;
 }
 
-int ventoy_gzip_compress(void *mem_in, int mem_in_len, void *mem_out, int mem_out_len)
-{
-	mz_stream s;
-    grub_uint8_t *outbuf;
-    grub_uint8_t gzHdr[10] = 
-    {
-		0x1F, 0x8B,	/* magic */
-		8,		    /* z method */
-		0,		    /* flags */
-		0,0,0,0,	/* mtime */
-		4,		    /* xfl */
-		3,		    /* OS */
-	};
-
-	grub_memset(&s, 0, sizeof(mz_stream));
-
-    mz_deflateInit2(&s, 1, MZ_DEFLATED, -MZ_DEFAULT_WINDOW_BITS, 6, MZ_DEFAULT_STRATEGY);
-    
-    outbuf = (grub_uint8_t *)mem_out;
-
-    mem_out_len -= sizeof(gzHdr) + 8;
-    grub_memcpy(outbuf, gzHdr, sizeof(gzHdr));
-    outbuf += sizeof(gzHdr);
-
-    s.avail_in = mem_in_len;
-    s.next_in = mem_in;
-
-    s.avail_out = mem_out_len;
-    s.next_out = outbuf;
-
-    mz_deflate(&s, MZ_FINISH);
-
-    mz_deflateEnd(&s);
-
-    outbuf += s.total_out;
-    *(grub_uint32_t *)outbuf = grub_getcrc32c(0, outbuf, s.total_out);
-    *(grub_uint32_t *)(outbuf + 4) = (grub_uint32_t)(s.total_out);
-
-    return s.total_out + sizeof(gzHdr) + 8;    
-}
-
 
 #if 0
 ventoy grub cmds
@@ -1260,20 +1219,416 @@ static grub_err_t ventoy_cmd_load_file_to_mem(grub_extcmd_context_t ctxt, int ar
     return rc;
 }
 
+static ventoy_prefetch g_prefetch;
+static char *g_prefetch_buf = NULL;
+
+static void ventoy_prefetch_reset(const char *path)
+{
+    grub_check_free(g_prefetch.chunk_list.chunk);
+    grub_memset(&g_prefetch, 0, sizeof(g_prefetch));
+    grub_snprintf(g_prefetch.path, sizeof(g_prefetch.path), "%s", path);
+    g_prefetch.start_ms = g_prefetch.last_ms = grub_get_time_ms();
+}
+
+static void ventoy_prefetch_init(void)
+{
+    int fs_type;
+    const char *isopart;
+    grub_file_t file;
+
+    g_prefetch.inited = 1;
+    g_prefetch.done = 1;
+
+    isopart = grub_env_get("vtoy_iso_part");
+    if (!isopart)
+    {
+        return;
+    }
+
+    file = ventoy_grub_file_open(VENTOY_FILE_TYPE, "%s%s", isopart, g_prefetch.path);
+    if (!file)
+    {
+        return;
+    }
+
+    g_prefetch.size = (file->size < VTOY_PREFETCH_MAX) ? file->size : VTOY_PREFETCH_MAX;
+    grub_snprintf(g_prefetch.diskname, sizeof(g_prefetch.diskname), "%s", file->device->disk->name);
+
+    /* 
+     * only when the chunk list can be got without reading the file,
+     * ventoy_get_block_list may fall back to read the whole file on UDF, so
+     * call grub_udf_get_file_chunk directly and use the file step if it fails
+     */
+    fs_type = ventoy_get_fs_type(file->fs->name);
+    if (fs_type == ventoy_fs_exfat || fs_type == ventoy_fs_ext || fs_type == ventoy_fs_udf)
+    {
+        g_prefetch.chunk_list.chunk = grub_malloc(sizeof(ventoy_img_chunk) * DEFAULT_CHUNK_NUM);
+        if (g_prefetch.chunk_list.chunk)
+        {
+            g_prefetch.chunk_list.max_chunk = DEFAULT_CHUNK_NUM;
+            if (fs_type == ventoy_fs_udf)
+            {
+                if (grub_udf_get_file_chunk(file->device->disk->partition->start, file, &g_prefetch.chunk_list) != 0)
+                {
+                    debug("udf file chunk failed, prefetch by file read\n");
+                    grub_errno = GRUB_ERR_NONE;
+                    g_prefetch.chunk_list.cur_chunk = 0;
+                }
+            }
+            else
+            {
+                ventoy_get_block_list(file, &g_prefetch.chunk_list, file->device->disk->partition->start);
+            }
+        }
+    }
+
+    grub_file_close(file);
+
+    if (!g_prefetch_buf)
+    {
+        g_prefetch_buf = grub_malloc(VTOY_PREFETCH_STEP);
+    }
+
+    g_prefetch.done = g_prefetch_buf ? 0 : 1;
+}
+
+/* read one step by the chunk list, return the length */
+static grub_uint64_t ventoy_prefetch_chunk_step(void)
+{
+    grub_uint64_t len = 0;
+    grub_disk_t disk = NULL;
+    ventoy_img_chunk *chunk = NULL;
+
+    while (g_prefetch.cur_chunk < g_prefetch.chunk_list.cur_chunk)
+    {
+        chunk = g_prefetch.chunk_list.chunk + g_prefetch.cur_chunk;
+        len = (chunk->disk_end_sector + 1 - chunk->disk_start_sector) * 512;
+        if (g_prefetch.chunk_pos < len)
+        {
+            break;
+        }
+
+        g_prefetch.cur_chunk++;
+        g_prefetch.chunk_pos = 0;
+    }
+
+    if (g_prefetch.cur_chunk >= g_prefetch.chunk_list.cur_chunk)
+    {
+        return 0;
+    }
+
+    len -= g_prefetch.chunk_pos;
+    if (len > VTOY_PREFETCH_STEP)
+    {
+        len = VTOY_PREFETCH_STEP;
+    }
+
+    disk = grub_disk_open(g_prefetch.diskname);
+    if (!disk)
+    {
+        grub_errno = GRUB_ERR_NONE;
+        return 0;
+    }
+
+    if (grub_disk_read(disk, chunk->disk_start_sector + (g_prefetch.chunk_pos >> 9), 0, len, g_prefetch_buf))
+    {
+        grub_errno = GRUB_ERR_NONE;
+        len = 0;
+    }
+    grub_disk_close(disk);
+
+    g_prefetch.chunk_pos += len;
+    return len;
+}
+
+static grub_uint64_t ventoy_prefetch_file_step(void)
+{
+    grub_ssize_t len = VTOY_PREFETCH_STEP;
+    grub_file_t file;
+
+    file = ventoy_grub_file_open(VENTOY_FILE_TYPE, "%s%s", grub_env_get("vtoy_iso_part"), g_prefetch.path);
+    if (!file)
+    {
+        return 0;
+    }
+
+    grub_file_seek(file, g_prefetch.total);
+    len = grub_file_read(file, g_prefetch_buf, len);
+    grub_file_close(file);
+
+    grub_errno = GRUB_ERR_NONE;
+    return (len > 0) ? (grub_uint64_t)len : 0;
+}
+
+/* 
+ * Called by the menu loop every time no key is pressed.
+ * GRUB has no async IO, so every call only reads VTOY_PREFETCH_STEP of the highlighted
+ * image, the data is kept in the GRUB disk cache and the key is checked again soon.
+ */
+void ventoy_menu_idle_prefetch(const char *path)
+{
+    grub_uint64_t len = 0;
+    grub_uint64_t cur = 0;
+    const char *env = NULL;
+    grub_disk_t disk = NULL;
+
+    if (!path || g_ventoy_memdisk_mode)
+    {
+        return;
+    }
+
+    env = ventoy_get_env("VTOY_MENU_PREFETCH");
+    if (env && env[0] == '0')
+    {
+        return;
+    }
+
+    if (grub_strcmp(path, g_prefetch.path) != 0)
+    {
+        ventoy_prefetch_reset(path);
+        return;
+    }
+
+    cur = grub_get_time_ms();
+
+    /* don't prefetch when the user is moving quickly through the menu */
+    if (!g_prefetch.inited)
+    {
+        if (cur - g_prefetch.start_ms >= VTOY_PREFETCH_DELAY_MS)
+        {
+            ventoy_prefetch_init();
+        }
+        return;
+    }
+
+    if (g_prefetch.done)
+    {
+        /* the disk cache is dropped when no disk is opened for a while, keep it alive */
+        if (g_prefetch.diskname[0] && cur - g_prefetch.last_ms >= 1000)
+        {
+            g_prefetch.last_ms = cur;
+            disk = grub_disk_open(g_prefetch.diskname);
+            if (disk)
+            {
+                grub_disk_close(disk);
+            }
+            grub_errno = GRUB_ERR_NONE;
+        }
+        return;
+    }
+
+    if (g_prefetch.chunk_list.cur_chunk > 0)
+    {
+        len = ventoy_prefetch_chunk_step();
+    }
+    else
+    {
+        len = ventoy_prefetch_file_step();
+    }
+
+    g_prefetch.total += len;
+    g_prefetch.last_ms = grub_get_time_ms();
+
+    if (len == 0 || g_prefetch.total >= g_prefetch.size)
+    {
+        g_prefetch.done = 1;
+        debug("prefetch %s %llu bytes in %llu ms\n", g_prefetch.path, (ulonglong)g_prefetch.total, 
+            (ulonglong)(g_prefetch.last_ms - g_prefetch.start_ms));
+    }
+}
+
+/* return 1 if ESC is pressed */
+static int ventoy_memdisk_progress(ventoy_load_progress *prog, const char *data, grub_uint64_t len)
+{
+    grub_uint64_t ro = 0;
+    grub_uint64_t cur = 0;
+    grub_uint64_t speed = 0;
+    grub_uint64_t eta = 0;
+    grub_uint64_t percent = 0;
+
+    if (prog->md5ctx)
+    {
+        GRUB_MD_MD5->write(prog->md5ctx, data, len);
+    }
+
+    prog->done += len;
+
+    if (grub_getkey_noblock() == GRUB_TERM_ESC)
+    {
+        grub_printf("\nAborted by ESC.\n");
+        grub_refresh();
+        return 1;
+    }
+
+    cur = grub_get_time_ms();
+    if (cur - prog->last_ms < 500 && prog->done < prog->total)
+    {
+        return 0;
+    }
+    prog->last_ms = cur;
+
+    /* bytes per second */
+    speed = grub_divmod64(prog->done * 1000, (cur > prog->start_ms) ? (cur - prog->start_ms) : 1, &ro);
+    if (speed > 0)
+    {
+        eta = grub_divmod64(prog->total - prog->done, speed, &ro);
+    }
+    percent = grub_divmod64(prog->done * 100, prog->total, &ro);
+
+    grub_printf("\r  %3d%%   %llu MB/s   ETA %llus      ", (int)percent, 
+        (ulonglong)(speed / VTOY_SIZE_1MB), (ulonglong)eta);
+    grub_refresh();
+
+    return 0;
+}
+
+/* 
+ * Read the image file by its chunk list, every chunk is a continuous area of the disk,
+ * so it's read with large grub_disk_read directly instead of walking the file system.
+ */
+static int ventoy_memdisk_read_by_chunk(grub_file_t file, ventoy_img_chunk_list *chunklist, char *buf, ventoy_load_progress *prog)
+{
+    int rc = 1;
+    grub_uint32_t i;
+    grub_uint64_t len;
+    grub_uint64_t cur;
+    grub_uint64_t offset;
+    grub_disk_addr_t sector;
+    grub_disk_t disk = NULL;
+    ventoy_img_chunk *chunk = NULL;
+
+    /* the disk sectors in the chunk list are relative to the whole disk */
+    disk = grub_disk_open(file->device->disk->name);
+    if (!disk)
+    {
+        return 1;
+    }
+
+    for (i = 0; i < chunklist->cur_chunk; i++)
+    {
+        chunk = chunklist->chunk + i;
+        offset = (grub_uint64_t)chunk->img_start_sector * 2048;
+        if (offset >= file->size)
+        {
+            break;
+        }
+
+        len = (chunk->disk_end_sector + 1 - chunk->disk_start_sector) * 512;
+        if (offset + len > file->size)
+        {
+            len = file->size - offset;
+        }
+
+        sector = chunk->disk_start_sector;
+        while (len > 0)
+        {
+            cur = (len > VTOY_SIZE_16MB) ? VTOY_SIZE_16MB : len;
+            if (grub_disk_read(disk, sector, 0, cur, buf + offset))
+            {
+                debug("disk read failed %llu %llu %d\n", (ulonglong)sector, (ulonglong)cur, grub_errno);
+                goto end;
+            }
+
+            if (ventoy_memdisk_progress(prog, buf + offset, cur))
+            {
+                goto end;
+            }
+
+            sector += cur >> 9;
+            offset += cur;
+            len -= cur;
+        }
+    }
+
+    rc = (prog->done == file->size) ? 0 : 1;
+
+end:
+    grub_disk_close(disk);
+    return rc;
+}
+
+static int ventoy_memdisk_read_by_file(grub_file_t file, char *buf, ventoy_load_progress *prog)
+{
+    grub_ssize_t cur;
+    grub_uint64_t left = file->size;
+
+    grub_file_seek(file, 0);
+    while (left > 0)
+    {
+        cur = (left > VTOY_SIZE_16MB) ? VTOY_SIZE_16MB : (grub_ssize_t)left;
+        if (grub_file_read(file, buf + prog->done, cur) != cur)
+        {
+            return 1;
+        }
+
+        if (ventoy_memdisk_progress(prog, buf + prog->done, cur))
+        {
+            return 1;
+        }
+
+        left -= cur;
+    }
+
+    return 0;
+}
+
+/* compare with the sidecar file xxx.md5 (md5sum format) if it exists */
+static int ventoy_memdisk_check_md5(const char *path, ventoy_load_progress *prog)
+{
+    int i;
+    char hex[40] = {0};
+    char calc[40] = {0};
+    grub_uint8_t *md5 = NULL;
+    grub_file_t file;
+
+    file = ventoy_grub_file_open(VENTOY_FILE_TYPE, "%s.md5", path);
+    if (!file)
+    {
+        return 0;
+    }
+
+    grub_file_read(file, hex, 32);
+    grub_file_close(file);
+
+    GRUB_MD_MD5->final(prog->md5ctx);
+    md5 = GRUB_MD_MD5->read(prog->md5ctx);
+    for (i = 0; i < 16; i++)
+    {
+        grub_snprintf(calc + i * 2, 3, "%02x", md5[i]);
+    }
+
+    if (grub_strncasecmp(hex, calc, 32) != 0)
+    {
+        grub_printf("\nMD5 mismatch, %s.md5: %s  calculated: %s\n", path, hex, calc);
+        grub_refresh();
+        return 1;
+    }
+
+    grub_printf("\nMD5 check OK.\n");
+    return 0;
+}
+
 static grub_err_t ventoy_cmd_load_img_memdisk(grub_extcmd_context_t ctxt, int argc, char **args)
 {
     int rc = 1;
+    int fs_type;
     int headlen;
+    int writeback = 0;
     char name[32];
     char value[32];
     char *buf = NULL;
+    grub_uint32_t chunklen = 0;
+    grub_uint64_t chunkoff = 0;
     grub_file_t file;
+    ventoy_chain_head *chain = NULL;
+    ventoy_img_chunk_list chunk_list;
+    ventoy_load_progress prog;
     
     (void)ctxt;
     (void)argc;
     (void)args;
 
-    if (argc != 2)
+    if (argc != 2 && argc != 3)
     {
         return rc;
     }
@@ -1286,16 +1641,100 @@ static grub_err_t ventoy_cmd_load_img_memdisk(grub_extcmd_context_t ctxt, int ar
     }
 
     headlen = sizeof(ventoy_chain_head);
+    writeback = (argc == 3 && grub_strcmp(args[2], "writeback") == 0);
+
+    /* 
+     * The chunk list is cheap to get for exfat/ext/udf, and is needed by writeback.
+     * For writeback, it's appended after the image data, so that the modified 
+     * sectors can be written back to the image file.
+     */
+    grub_memset(&prog, 0, sizeof(prog));
+    grub_memset(&chunk_list, 0, sizeof(chunk_list));
+    fs_type = ventoy_get_fs_type(file->fs->name);
+    if (writeback || fs_type == ventoy_fs_exfat || fs_type == ventoy_fs_ext || fs_type == ventoy_fs_udf)
+    {
+        chunk_list.chunk = grub_malloc(sizeof(ventoy_img_chunk) * DEFAULT_CHUNK_NUM);
+        if (chunk_list.chunk)
+        {
+            chunk_list.max_chunk = DEFAULT_CHUNK_NUM;
+            ventoy_get_block_list(file, &chunk_list, file->device->disk->partition->start);
+            if (ventoy_check_block_list(file, &chunk_list, file->device->disk->partition->start))
+            {
+                debug("unsupported chunk list, read by file\n");
+                chunk_list.cur_chunk = 0;
+            }
+        }
+
+        if (writeback)
+        {
+            chunkoff = (headlen + file->size + 7) & (~7ULL);
+            chunklen = chunk_list.cur_chunk * sizeof(ventoy_img_chunk);
+        }
+    }
 
 #ifdef GRUB_MACHINE_EFI
-    buf = (char *)grub_efi_allocate_iso_buf(headlen + file->size);
+    buf = (char *)grub_efi_allocate_iso_buf(chunklen ? (chunkoff + chunklen) : (headlen + file->size));
 #else
-    buf = (char *)grub_malloc(headlen + file->size);
+    buf = (char *)grub_malloc(chunklen ? (chunkoff + chunklen) : (headlen + file->size));
 #endif   
 
+    if (!buf)
+    {
+        grub_printf("Failed to alloc memory for %s\n", args[0]);
+        goto end;
+    }
+
+    grub_memset(buf, 0, headlen);
     ventoy_fill_os_param(file, (ventoy_os_param *)buf);
 
-    grub_file_read(file, buf + headlen, file->size);
+    prog.total = file->size;
+    prog.start_ms = grub_get_time_ms();
+    if (ventoy_is_file_exist("%s.md5", args[0]))
+    {
+        prog.md5ctx = grub_zalloc(GRUB_MD_MD5->contextsize);
+        if (prog.md5ctx)
+        {
+            GRUB_MD_MD5->init(prog.md5ctx);
+        }
+    }
+
+    if (chunk_list.cur_chunk > 0)
+    {
+        rc = ventoy_memdisk_read_by_chunk(file, &chunk_list, buf + headlen, &prog);
+    }
+    else
+    {
+        rc = ventoy_memdisk_read_by_file(file, buf + headlen, &prog);
+    }
+
+    debug("memdisk load %llu bytes in %llu ms by %s rc=%d\n", (ulonglong)prog.done, 
+        (ulonglong)(grub_get_time_ms() - prog.start_ms), chunk_list.cur_chunk ? "chunk" : "file", rc);
+
+    if (rc == 0 && prog.md5ctx)
+    {
+        rc = ventoy_memdisk_check_md5(args[0], &prog);
+    }
+
+    if (rc)
+    {
+#ifndef GRUB_MACHINE_EFI
+        grub_free(buf);
+#endif
+        goto end;
+    }
+
+    if (chunklen > 0)
+    {
+        chain = (ventoy_chain_head *)buf;
+        chain->disk_drive = file->device->disk->id;
+        chain->disk_sector_size = (1 << file->device->disk->log_sector_size);
+        chain->real_img_size_in_bytes = file->size;
+        chain->virt_img_size_in_bytes = file->size;
+        chain->img_chunk_offset = (grub_uint32_t)chunkoff;
+        chain->img_chunk_num = chunk_list.cur_chunk;
+        grub_memcpy(buf + chunkoff, chunk_list.chunk, chunklen);
+        debug("memdisk writeback chunk num %u\n", chunk_list.cur_chunk);
+    }
 
     grub_snprintf(name, sizeof(name), "%s_addr", args[1]);
     grub_snprintf(value, sizeof(value), "0x%llx", (unsigned long long)(unsigned long)buf);
@@ -1305,8 +1744,10 @@ static grub_err_t ventoy_cmd_load_img_memdisk(grub_extcmd_context_t ctxt, int ar
     grub_snprintf(value, sizeof(value), "%llu", (unsigned long long)file->size);
     grub_env_set(name, value);
 
+end:
+    grub_check_free(prog.md5ctx);
+    grub_check_free(chunk_list.chunk);
     grub_file_close(file); 
-    rc = 0;
     
     return rc;
 }
@@ -1349,6 +1790,44 @@ static grub_err_t ventoy_cmd_iso9660_nojoliet(grub_extcmd_context_t ctxt, int ar
     return 0;
 }
 
+static grub_err_t ventoy_cmd_iso9660_cache_stat(grub_extcmd_context_t ctxt, int argc, char **args)
+{
+    grub_iso9660_cache_stat stat;
+
+    (void)ctxt;
+
+    grub_iso9660_get_cache_stat(&stat);
+
+    grub_printf("lookup:%u hit:%u neg_hit:%u miss:%u walk:%u flush:%u entries:%u\n",
+        stat.lookup, stat.hit, stat.neg_hit, stat.miss, stat.walk, stat.flush, stat.entries);
+
+    if (argc > 0 && grub_strcmp(args[0], "reset") == 0)
+    {
+        grub_iso9660_reset_cache_stat();
+    }
+
+    return 0;
+}
+
+static grub_err_t ventoy_cmd_disk_cache_stat(grub_extcmd_context_t ctxt, int argc, char **args)
+{
+    struct grub_disk_cache_stat stat;
+
+    (void)ctxt;
+
+    grub_disk_cache_get_stat(&stat);
+
+    grub_printf("hit:%lu lru_hit:%lu miss:%lu reads:%lu read_sectors:%lu lru:%lu/%lu\n",
+        stat.hits, stat.lru_hits, stat.misses, stat.reads, stat.read_sectors, stat.lru_used, stat.lru_num);
+
+    if (argc > 0 && grub_strcmp(args[0], "reset") == 0)
+    {
+        grub_disk_cache_reset_stat();
+    }
+
+    return 0;
+}
+
 static grub_err_t ventoy_cmd_is_udf(grub_extcmd_context_t ctxt, int argc, char **args)
 {
     int i;
@@ -2867,6 +3346,31 @@ int ventoy_check_block_list(grub_file_t file, ventoy_img_chunk_list *chunklist,
     return 0;
 }
 
+static void ventoy_get_block_list_by_read(grub_file_t file, ventoy_img_chunk_list *chunklist, grub_disk_addr_t start)
+{
+    grub_uint32_t i = 0;
+    grub_off_t size = 0;
+    grub_off_t read = 0;
+
+    file->read_hook = (grub_disk_read_hook_t)grub_disk_blocklist_read;
+    file->read_hook_data = chunklist;
+
+    for (size = file->size; size > 0; size -= read)
+    {
+        read = (size > VTOY_SIZE_1GB) ? VTOY_SIZE_1GB : size;
+        grub_file_read(file, NULL, read);
+    }
+
+    file->read_hook = NULL;
+    file->read_hook_data = NULL;
+
+    for (i = 0; start > 0 && i < chunklist->cur_chunk; i++)
+    {
+        chunklist->chunk[i].disk_start_sector += start;
+        chunklist->chunk[i].disk_end_sector += start;
+    }
+}
+
 int ventoy_get_block_list(grub_file_t file, ventoy_img_chunk_list *chunklist, grub_disk_addr_t start)
 {
     int fs_type;
@@ -2874,8 +3378,6 @@ int ventoy_get_block_list(grub_file_t file, ventoy_img_chunk_list *chunklist, gr
     grub_uint32_t i = 0;
     grub_uint32_t sector = 0;
     grub_uint32_t count = 0;
-    grub_off_t size = 0;
-    grub_off_t read = 0;
 
     fs_type = ventoy_get_fs_type(file->fs->name);
     if (fs_type == ventoy_fs_exfat)
@@ -2888,19 +3390,10 @@ int ventoy_get_block_list(grub_file_t file, ventoy_img_chunk_list *chunklist, gr
     }
     else
     {
-        file->read_hook = (grub_disk_read_hook_t)grub_disk_blocklist_read;
-        file->read_hook_data = chunklist;
-
-        for (size = file->size; size > 0; size -= read)
+        /* UDF: get the extents from the allocation descriptors, no need to read the whole file */
+        if (ventoy_fs_udf != fs_type || grub_udf_get_file_chunk(start, file, chunklist) != 0)
         {
-            read = (size > VTOY_SIZE_1GB) ? VTOY_SIZE_1GB : size;
-            grub_file_read(file, NULL, read);
-        }
-
-        for (i = 0; start > 0 && i < chunklist->cur_chunk; i++)
-        {
-            chunklist->chunk[i].disk_start_sector += start;
-            chunklist->chunk[i].disk_end_sector += start;
+            ventoy_get_block_list_by_read(file, chunklist, start);
         }
 
         if (ventoy_fs_udf == fs_type)
@@ -3257,6 +3750,198 @@ static grub_err_t ventoy_cmd_dump_img_sector(grub_extcmd_context_t ctxt, int arg
     VENTOY_CMD_RETURN(GRUB_ERR_NONE);
 }
 
+/*
+ * vt_dump_chain {file}
+ * GRUB can not create files, so the dump file must already exist (e.g. created by
+ * dd/fallocate on Linux) and it is overwritten in place through its block list,
+ * the same way as save_env does with grubenv.
+ * The file format is described in ventoy_chain_dump_head.
+ */
+static grub_err_t ventoy_cmd_dump_chain(grub_extcmd_context_t ctxt, int argc, char **args)
+{
+    int rc = 1;
+    grub_uint32_t i;
+    grub_uint32_t size;
+    grub_uint32_t total;
+    grub_uint32_t left;
+    grub_uint64_t secs;
+    const char *addr;
+    const char *len;
+    char *buf = NULL;
+    char *cur = NULL;
+    grub_file_t file = NULL;
+    grub_disk_t disk = NULL;
+    ventoy_chain_head *chain;
+    ventoy_chain_dump_head *head;
+    ventoy_img_chunk_list chunklist;
+
+    (void)ctxt;
+
+    grub_memset(&chunklist, 0, sizeof(chunklist));
+
+    if (argc != 1)
+    {
+        return grub_error(GRUB_ERR_BAD_ARGUMENT, "Usage: %s {file}\n", cmd_raw_name);
+    }
+
+    addr = grub_env_get("vtoy_chain_mem_addr");
+    len = grub_env_get("vtoy_chain_mem_size");
+    if (!addr || !len)
+    {
+        return grub_error(GRUB_ERR_BAD_ARGUMENT, "No chain data, run vt_xxx_chain_data first\n");
+    }
+
+    chain = (ventoy_chain_head *)grub_strtoul(addr, NULL, 16);
+    size = (grub_uint32_t)grub_strtoul(len, NULL, 10);
+    if (!chain || size < sizeof(ventoy_chain_head))
+    {
+        return grub_error(GRUB_ERR_BAD_ARGUMENT, "Invalid chain data %s %s\n", addr, len);
+    }
+
+    file = ventoy_grub_file_open(VENTOY_FILE_TYPE, "%s", args[0]);
+    if (!file)
+    {
+        return grub_error(GRUB_ERR_BAD_ARGUMENT, "Can't open file %s\n", args[0]);
+    }
+
+    total = ventoy_align(sizeof(ventoy_chain_dump_head) + size, 512);
+    if (file->size < total)
+    {
+        grub_error(GRUB_ERR_OUT_OF_RANGE, "File %s is too small, at least %u bytes needed\n", args[0], total);
+        goto end;
+    }
+
+    if (!file->device->disk || !file->device->disk->partition ||
+        ventoy_get_fs_type(file->fs->name) >= ventoy_fs_max)
+    {
+        grub_error(GRUB_ERR_BAD_ARGUMENT, "Unsupported filesystem for %s\n", args[0]);
+        goto end;
+    }
+
+    chunklist.chunk = grub_malloc(sizeof(ventoy_img_chunk) * DEFAULT_CHUNK_NUM);
+    if (!chunklist.chunk)
+    {
+        grub_error(GRUB_ERR_OUT_OF_MEMORY, "Can't allocate image chunk memoty\n");
+        goto end;
+    }
+    chunklist.max_chunk = DEFAULT_CHUNK_NUM;
+    chunklist.cur_chunk = 0;
+
+    ventoy_get_block_list(file, &chunklist, file->device->disk->partition->start);
+    if (ventoy_check_block_list(file, &chunklist, file->device->disk->partition->start))
+    {
+        grub_error(GRUB_ERR_BAD_ARGUMENT, "Unsupported chunk list for %s\n", args[0]);
+        goto end;
+    }
+
+    buf = grub_zalloc(total);
+    if (!buf)
+    {
+        grub_error(GRUB_ERR_OUT_OF_MEMORY, "Can't allocate dump buffer %u\n", total);
+        goto end;
+    }
+
+    head = (ventoy_chain_dump_head *)buf;
+    grub_memcpy(head->magic, VENTOY_CHAIN_DUMP_MAGIC, sizeof(head->magic));
+    head->version = VENTOY_CHAIN_DUMP_VERSION;
+    head->head_size = sizeof(ventoy_chain_dump_head);
+    head->chain_type = chain->os_param.vtoy_reserved[2];
+    head->chain_size = size;
+    head->chain_crc32c = grub_getcrc32c(0, chain, size);
+    head->chain_head_size = sizeof(ventoy_chain_head);
+    head->img_chunk_size = sizeof(ventoy_img_chunk);
+    head->override_chunk_size = sizeof(ventoy_override_chunk);
+    head->virt_chunk_size = sizeof(ventoy_virt_chunk);
+    head->efi = ventoy_is_efi_os() ? 1 : 0;
+    grub_memcpy(head + 1, chain, size);
+
+    /* chunk list is in absolute disk sectors, so write through the whole disk */
+    disk = grub_disk_open(file->device->disk->name);
+    if (!disk)
+    {
+        grub_error(GRUB_ERR_BAD_DEVICE, "Can't open disk %s\n", file->device->disk->name);
+        goto end;
+    }
+
+    cur = buf;
+    left = total;
+    for (i = 0; i < chunklist.cur_chunk && left > 0; i++)
+    {
+        secs = chunklist.chunk[i].disk_end_sector + 1 - chunklist.chunk[i].disk_start_sector;
+        size = (secs * 512 > left) ? left : (grub_uint32_t)(secs * 512);
+
+        if (grub_disk_write(disk, chunklist.chunk[i].disk_start_sector, 0, size, cur))
+        {
+            goto end;
+        }
+
+        cur += size;
+        left -= size;
+    }
+
+    if (left > 0)
+    {
+        grub_error(GRUB_ERR_WRITE_ERROR, "Only %u of %u bytes written\n", total - left, total);
+        goto end;
+    }
+
+    debug("dump chain type:%u size:%u to %s\n", head->chain_type, head->chain_size, args[0]);
+    rc = 0;
+
+end:
+    check_free(disk, grub_disk_close);
+    grub_check_free(buf);
+    grub_check_free(chunklist.chunk);
+    grub_file_close(file);
+
+    if (rc)
+    {
+        return grub_errno;
+    }
+
+    VENTOY_CMD_RETURN(GRUB_ERR_NONE);
+}
+
+static void ventoy_test_udf_block_list(grub_file_t file, ventoy_img_chunk_list *chunklist)
+{
+    grub_uint32_t i;
+    ventoy_img_chunk_list readlist;
+
+    grub_memset(&readlist, 0, sizeof(readlist));
+    readlist.chunk = grub_malloc(sizeof(ventoy_img_chunk) * DEFAULT_CHUNK_NUM);
+    if (NULL == readlist.chunk)
+    {
+        return;
+    }
+    readlist.max_chunk = DEFAULT_CHUNK_NUM;
+
+    grub_file_seek(file, 0);
+    ventoy_get_block_list_by_read(file, &readlist, 0);
+
+    if (readlist.cur_chunk != chunklist->cur_chunk)
+    {
+        grub_printf("UDF read hook entry number:<%u> MISMATCH\n", readlist.cur_chunk);
+        goto end;
+    }
+
+    for (i = 0; i < readlist.cur_chunk; i++)
+    {
+        if (readlist.chunk[i].disk_start_sector != chunklist->chunk[i].disk_start_sector ||
+            readlist.chunk[i].disk_end_sector != chunklist->chunk[i].disk_end_sector)
+        {
+            grub_printf("UDF read hook chunk %u [%llu %llu] MISMATCH\n", i, 
+                (ulonglong)readlist.chunk[i].disk_start_sector,
+                (ulonglong)readlist.chunk[i].disk_end_sector);
+            goto end;
+        }
+    }
+
+    grub_printf("UDF allocation descriptors match the read hook result\n");
+
+end:
+    grub_free(readlist.chunk);
+}
+
 static grub_err_t ventoy_cmd_test_block_list(grub_extcmd_context_t ctxt, int argc, char **args)
 {
     grub_uint32_t i;
@@ -3292,6 +3977,12 @@ static grub_err_t ventoy_cmd_test_block_list(grub_extcmd_context_t ctxt, int arg
 
     grub_printf("filesystem: <%s> entry number:<%u>\n", file->fs->name, chunklist.cur_chunk);
 
+    /* cross check the UDF allocation descriptors result with the read hook result */
+    if (ventoy_get_fs_type(file->fs->name) == ventoy_fs_udf)
+    {
+        ventoy_test_udf_block_list(file, &chunklist);
+    }
+
     for (i = 0; i < chunklist.cur_chunk; i++)
     {
         grub_printf("%llu+%llu,", (ulonglong)chunklist.chunk[i].disk_start_sector,
@@ -4053,7 +4744,14 @@ static grub_err_t ventoy_cmd_acpi_param(grub_extcmd_context_t ctxt, int argc, ch
         return 1;
     }
 
+    /* chunks placed after the image (linux cpio payload) are not part of the image */
     img_chunk_num = chain->img_chunk_num;
+    chunk = (ventoy_img_chunk *)((char *)chain + chain->img_chunk_offset);
+    while (img_chunk_num > 1 && 
+           chunk[img_chunk_num - 1].img_start_sector >= (chain->real_img_size_in_bytes + 2047) / 2048)
+    {
+        img_chunk_num--;
+    }
 
     loclen = sizeof(ventoy_image_location) + (img_chunk_num - 1) * sizeof(ventoy_image_disk_region);
     datalen = sizeof(ventoy_os_param) + loclen;
@@ -5090,6 +5788,17 @@ out:
     return ret;
 }
 
+/* VTOY_DISK_CACHE_KB can be set in the control plugin of ventoy.json */
+static char * ventoy_env_write_disk_cache(struct grub_env_var *var, const char *val)
+{
+    (void)var;
+
+    grub_disk_cache_set_lru_size(grub_strtoul(val, NULL, 10));
+    debug("disk cache lru size %s KB\n", val);
+
+    return grub_strdup(val);
+}
+
 int ventoy_env_init(void)
 {
     char buf[64];
@@ -5134,6 +5843,8 @@ int ventoy_env_init(void)
     grub_env_set("vtoy_chain_file_read", buf);
     grub_env_export("vtoy_chain_file_read");
 
+    grub_register_variable_hook("VTOY_DISK_CACHE_KB", 0, ventoy_env_write_disk_cache);
+
     return 0;
 }
 
@@ -5159,6 +5870,7 @@ static cmd_para ventoy_cmds[] =
     { "vt_ext_select_img_path", ventoy_cmd_ext_select_img_path, 0, NULL, "{var}", "select chosen img path", NULL },
     { "vt_img_sector", ventoy_cmd_img_sector, 0, NULL, "{imageName}", "", NULL },
     { "vt_dump_img_sector", ventoy_cmd_dump_img_sector, 0, NULL, "", "", NULL },
+    { "vt_dump_chain", ventoy_cmd_dump_chain, 0, NULL, "{file}", "dump chain data to a preallocated file", NULL },
     { "vt_load_wimboot", ventoy_cmd_load_wimboot, 0, NULL, "", "", NULL },
     { "vt_load_vhdboot", ventoy_cmd_load_vhdboot, 0, NULL, "", "", NULL },
     { "vt_patch_vhdboot", ventoy_cmd_patch_vhdboot, 0, NULL, "", "", NULL },
@@ -5201,6 +5913,8 @@ static cmd_para ventoy_cmds[] =
 
     { "vt_iso9660_nojoliet", ventoy_cmd_iso9660_nojoliet, 0, NULL, "", "", NULL },
     { "vt_iso9660_isjoliet", ventoy_cmd_iso9660_is_joliet, 0, NULL, "", "", NULL },
+    { "vt_iso9660_cache_stat", ventoy_cmd_iso9660_cache_stat, 0, NULL, "", "", NULL },
+    { "vt_disk_cache_stat", ventoy_cmd_disk_cache_stat, 0, NULL, "", "", NULL },
     { "vt_is_udf", ventoy_cmd_is_udf, 0, NULL, "", "", NULL },
     { "vt_file_size", ventoy_cmd_file_size, 0, NULL, "", "", NULL },
     { "vt_load_file_to_mem", ventoy_cmd_load_file_to_mem, 0, NULL, "", "", NULL },
@@ -34,6 +34,7 @@
 #define VTOY_SIZE_2MB     (2 * 1024 * 1024)
 #define VTOY_SIZE_4MB     (4 * 1024 * 1024)
 #define VTOY_SIZE_512KB   (512 * 1024)
+#define VTOY_SIZE_16MB    (16 * 1024 * 1024)
 #define VTOY_SIZE_1KB     1024
 
 #define JSON_SUCCESS    0
@@ -139,6 +140,26 @@ typedef struct cpio_newc_header
 }cpio_newc_header;
 #pragma pack()
 
+/*
+ * A large file in the ventoy cpio (injection archive/dud) whose data is not
+ * loaded into memory but read from the disk directly through its chunk list.
+ * In memory the cpio is split into parts, the data of the file sits between
+ * the part ending at mem_offset + mem_size and the next part.
+ */
+#define VTOY_CPIO_PAYLOAD_MIN   (1024 * 1024)
+#define VTOY_CPIO_PAYLOAD_MAX   32
+typedef struct cpio_payload
+{
+    char *path;
+    grub_uint64_t size;
+    grub_uint32_t data_secs;   /* full 2048 sectors of the file data, read from disk */
+    grub_uint32_t img_sector;  /* image sector of the data in the chain image chunk list */
+    grub_uint32_t mem_offset;  /* memory part before the data (2048 aligned) */
+    grub_uint32_t mem_size;
+    char *tail;                /* the last (size % 2048) bytes, put in memory */
+    ventoy_img_chunk_list chunk_list;
+}cpio_payload;
+
 
 #define cmd_raw_name ctxt->extcmd->cmd->name
 #define check_free(p, func) if (p) { func(p); p = NULL; }
@@ -282,10 +303,25 @@ typedef struct initrd_info
     grub_uint32_t override_length;
     char          override_data[32];
 
+    int           located;   // 0: not looked up yet  1: found  -1: not exist
+    grub_uint64_t file_size;
+
     struct initrd_info *next;
     struct initrd_info *prev;
 }initrd_info;
 
+/* initrd names parsed from the config files of an image, keyed by image path/size and the parse command */
+#define VTOY_INITRD_CACHE_MAX   128
+typedef struct initrd_cfg_cache
+{
+    char *key;
+    char *names;   // name1\0name2\0...
+    int namelen;
+    int maxlen;
+
+    struct initrd_cfg_cache *next;
+}initrd_cfg_cache;
+
 extern initrd_info *g_initrd_img_list;
 extern initrd_info *g_initrd_img_tail;
 extern int g_initrd_img_count;
@@ -618,6 +654,38 @@ grub_err_t ventoy_cmd_dump_wim_patch(grub_extcmd_context_t ctxt, int argc, char
 grub_err_t ventoy_cmd_sel_wimboot(grub_extcmd_context_t ctxt, int argc, char **args);
 grub_err_t ventoy_cmd_set_wim_prompt(grub_extcmd_context_t ctxt, int argc, char **args);
 grub_ssize_t ventoy_load_file_with_prompt(grub_file_t file, void *buf, grub_ssize_t size);
+
+/* idle prefetch of the highlighted image while waiting in the boot menu */
+#define VTOY_PREFETCH_DELAY_MS  300
+#define VTOY_PREFETCH_STEP      (256 * 1024)
+#define VTOY_PREFETCH_MAX       VTOY_SIZE_16MB
+
+typedef struct ventoy_prefetch
+{
+    char path[512];
+    char diskname[64];
+    int inited;
+    int done;
+    grub_uint64_t size;
+    grub_uint64_t total;
+    grub_uint64_t start_ms;
+    grub_uint64_t last_ms;
+    grub_uint32_t cur_chunk;
+    grub_uint64_t chunk_pos;
+    ventoy_img_chunk_list chunk_list;
+}ventoy_prefetch;
+
+extern void (*g_ventoy_menu_idle_hook)(const char *path);
+void ventoy_menu_idle_prefetch(const char *path);
+
+typedef struct ventoy_load_progress
+{
+    grub_uint64_t total;
+    grub_uint64_t done;
+    grub_uint64_t start_ms;
+    grub_uint64_t last_ms;
+    void *md5ctx;
+}ventoy_load_progress;
 int ventoy_need_prompt_load_file(void);
 
 VTOY_JSON *vtoy_json_find_item
@@ -778,40 +846,6 @@ typedef struct ventoy_gpt_info
     ventoy_gpt_part_tbl PartTbl[128];
 }ventoy_gpt_info;
 
-typedef struct vhd_footer_t
-{
-    char             cookie[8];    // Cookie
-    grub_uint32_t    features;     // Features
-    grub_uint32_t    ffversion;    // File format version
-    grub_uint32_t    dataoffset;   // Data offset
-    grub_uint32_t    timestamp;    // Timestamp
-    grub_uint32_t    creatorapp;   // Creator application
-    grub_uint32_t    creatorver;   // Creator version
-    grub_uint32_t    creatorhos;   // Creator host OS
-    grub_uint32_t    origsize;     // Original size
-    grub_uint32_t    currsize;     // Current size
-    grub_uint32_t    diskgeom;     // Disk geometry
-    grub_uint32_t    disktype;     // Disk type
-    grub_uint32_t    checksum;     // Checksum
-    grub_uint8_t     uniqueid[16]; // Unique ID
-    grub_uint8_t     savedst;      // Saved state
-}vhd_footer_t;
-
-#define VDI_IMAGE_FILE_INFO   "<<< Oracle VM VirtualBox Disk Image >>>\n"
-
-/** Image signature. */
-#define VDI_IMAGE_SIGNATURE   (0xbeda107f)
-
-typedef struct VDIPREHEADER
-{
-    /** Just text info about image type, for eyes only. */
-    char            szFileInfo[64];
-    /** The image signature (VDI_IMAGE_SIGNATURE). */
-    grub_uint32_t   u32Signature;
-    /** The image version (VDI_IMAGE_VERSION). */
-    grub_uint32_t   u32Version;
-} VDIPREHEADER, *PVDIPREHEADER;
-
 #pragma pack()
 
 typedef struct ventoy_video_mode
@@ -1072,6 +1106,7 @@ int ventoy_plugin_check_memdisk(const char *isopath);
 int ventoy_plugin_get_image_list_index(int type, const char *name);
 conf_replace * ventoy_plugin_find_conf_replace(const char *iso);
 dud * ventoy_plugin_find_dud(const char *iso);
+int ventoy_plugin_load_dud_file(dud *node, int index, const char *isopart);
 int ventoy_plugin_load_dud(dud *node, const char *isopart);
 int ventoy_get_block_list(grub_file_t file, ventoy_img_chunk_list *chunklist, grub_disk_addr_t start);
 int ventoy_check_block_list(grub_file_t file, ventoy_img_chunk_list *chunklist, grub_disk_addr_t start);
@@ -1104,7 +1139,6 @@ int ventoy_check_password(const vtoy_password *pwd, int retry);
 int ventoy_plugin_add_custom_boot(const char *vcfgpath);
 const char * ventoy_plugin_get_custom_boot(const char *isopath);
 grub_err_t ventoy_cmd_dump_custom_boot(grub_extcmd_context_t ctxt, int argc, char **args);
-int ventoy_gzip_compress(void *mem_in, int mem_in_len, void *mem_out, int mem_out_len);
 int ventoy_load_part_table(const char *diskname);
 int ventoy_env_init(void);
 int ventoy_register_all_cmd(void);
@@ -0,0 +1,287 @@
+/******************************************************************************
+ * ventoy_gzip.c
+ *
+ * Copyright (c) 2021, longpanda <admin@ventoy.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <grub/types.h>
+#include <grub/misc.h>
+#include <grub/mm.h>
+#include <grub/dl.h>
+#include "miniz.h"
+#include "ventoy_gzip.h"
+
+GRUB_MOD_LICENSE ("GPLv3+");
+
+/* the same as ventoy_def.h, which can't be used on the host */
+extern int g_ventoy_debug;
+void ventoy_debug(const char *fmt, ...);
+#define debug(fmt, args...) if (g_ventoy_debug) ventoy_debug("[VTOY]: "fmt, ##args)
+
+#define VTOY_GZIP_HDR_LEN     10
+#define VTOY_GZIP_TAIL_LEN    8
+#define VTOY_STORED_BLK_MAX   65535
+
+struct ventoy_gzip_stream
+{
+    mz_stream s;
+    int header;
+    grub_uint32_t crc;
+    grub_uint32_t isize;
+};
+
+static const grub_uint8_t g_gzip_header[VTOY_GZIP_HDR_LEN] = 
+{
+    0x1F, 0x8B, /* magic */
+    8,          /* z method */
+    0,          /* flags */
+    0,0,0,0,    /* mtime */
+    4,          /* xfl */
+    3,          /* OS */
+};
+
+static void ventoy_gzip_put_u32(grub_uint8_t *buf, grub_uint32_t value)
+{
+    buf[0] = (grub_uint8_t)(value);
+    buf[1] = (grub_uint8_t)(value >> 8);
+    buf[2] = (grub_uint8_t)(value >> 16);
+    buf[3] = (grub_uint8_t)(value >> 24);
+}
+
+static int ventoy_gzip_stored_len(int mem_in_len)
+{
+    int blocks = (mem_in_len + VTOY_STORED_BLK_MAX - 1) / VTOY_STORED_BLK_MAX;
+
+    if (blocks == 0)
+    {
+        blocks = 1;
+    }
+
+    return mem_in_len + blocks * 5;
+}
+
+/* raw deflate data made of stored blocks, it never fails if mem_out_len is big enough */
+static int ventoy_deflate_stored(const grub_uint8_t *mem_in, int mem_in_len, grub_uint8_t *mem_out, int mem_out_len)
+{
+    int len;
+    int left = mem_in_len;
+    grub_uint8_t *outbuf = mem_out;
+
+    if (ventoy_gzip_stored_len(mem_in_len) > mem_out_len)
+    {
+        return -1;
+    }
+
+    do 
+    {
+        len = (left > VTOY_STORED_BLK_MAX) ? VTOY_STORED_BLK_MAX : left;
+        left -= len;
+
+        outbuf[0] = (left == 0) ? 1 : 0; /* BFINAL, BTYPE=00 */
+        outbuf[1] = (grub_uint8_t)(len);
+        outbuf[2] = (grub_uint8_t)(len >> 8);
+        outbuf[3] = (grub_uint8_t)(~len);
+        outbuf[4] = (grub_uint8_t)((~len) >> 8);
+        grub_memcpy(outbuf + 5, mem_in, len);
+
+        outbuf += 5 + len;
+        mem_in += len;
+    } while (left > 0);
+
+    return (int)(outbuf - mem_out);
+}
+
+int ventoy_gzip_bound(int mem_in_len)
+{
+    return VTOY_GZIP_HDR_LEN + ventoy_gzip_stored_len(mem_in_len) + VTOY_GZIP_TAIL_LEN;
+}
+
+/* 
+ * level: 0 (stored) ~ 9 
+ * return the gzip data length, or -1 if mem_out_len is less than ventoy_gzip_bound() and the data can't be compressed into it
+ */
+int ventoy_gzip_compress_level(void *mem_in, int mem_in_len, void *mem_out, int mem_out_len, int level)
+{
+    int ret;
+    int len = -1;
+    int deflate_len;
+    mz_stream s;
+    grub_uint8_t *outbuf;
+
+    if (mem_in_len < 0 || mem_out_len < VTOY_GZIP_HDR_LEN + VTOY_GZIP_TAIL_LEN)
+    {
+        return -1;
+    }
+
+    if (level < 0 || level > MZ_BEST_COMPRESSION)
+    {
+        level = VTOY_GZIP_LEVEL_DEFAULT;
+    }
+
+    outbuf = (grub_uint8_t *)mem_out;
+    grub_memcpy(outbuf, g_gzip_header, VTOY_GZIP_HDR_LEN);
+    outbuf += VTOY_GZIP_HDR_LEN;
+    deflate_len = mem_out_len - VTOY_GZIP_HDR_LEN - VTOY_GZIP_TAIL_LEN;
+
+    if (level > 0)
+    {
+        grub_memset(&s, 0, sizeof(mz_stream));
+        if (mz_deflateInit2(&s, level, MZ_DEFLATED, -MZ_DEFAULT_WINDOW_BITS, 6, MZ_DEFAULT_STRATEGY) == MZ_OK)
+        {
+            s.avail_in = mem_in_len;
+            s.next_in = mem_in;
+            s.avail_out = deflate_len;
+            s.next_out = outbuf;
+
+            ret = mz_deflate(&s, MZ_FINISH);
+            if (ret == MZ_STREAM_END && (int)s.total_out < ventoy_gzip_stored_len(mem_in_len))
+            {
+                len = (int)s.total_out;
+            }
+            else
+            {
+                debug("deflate ret:%d out:%lu fallback to stored\n", ret, (unsigned long)s.total_out);
+            }
+
+            mz_deflateEnd(&s);
+        }
+    }
+
+    if (len < 0)
+    {
+        len = ventoy_deflate_stored(mem_in, mem_in_len, outbuf, deflate_len);
+        if (len < 0)
+        {
+            debug("gzip output buffer too small %d %d\n", mem_in_len, mem_out_len);
+            return -1;
+        }
+    }
+
+    outbuf += len;
+    ventoy_gzip_put_u32(outbuf, (grub_uint32_t)mz_crc32(MZ_CRC32_INIT, mem_in, mem_in_len));
+    ventoy_gzip_put_u32(outbuf + 4, (grub_uint32_t)mem_in_len);
+
+    return len + VTOY_GZIP_HDR_LEN + VTOY_GZIP_TAIL_LEN;
+}
+
+int ventoy_gzip_compress(void *mem_in, int mem_in_len, void *mem_out, int mem_out_len)
+{
+    return ventoy_gzip_compress_level(mem_in, mem_in_len, mem_out, mem_out_len, VTOY_GZIP_LEVEL_DEFAULT);
+}
+
+ventoy_gzip_stream * ventoy_gzip_stream_open(int level)
+{
+    ventoy_gzip_stream *stream = NULL;
+
+    if (level < 0 || level > MZ_BEST_COMPRESSION)
+    {
+        level = VTOY_GZIP_LEVEL_DEFAULT;
+    }
+
+    stream = grub_zalloc(sizeof(ventoy_gzip_stream));
+    if (!stream)
+    {
+        return NULL;
+    }
+
+    if (mz_deflateInit2(&stream->s, level, MZ_DEFLATED, -MZ_DEFAULT_WINDOW_BITS, 6, MZ_DEFAULT_STRATEGY) != MZ_OK)
+    {
+        grub_free(stream);
+        return NULL;
+    }
+
+    stream->crc = MZ_CRC32_INIT;
+    return stream;
+}
+
+/* 
+ * All the input is consumed and flushed in one call, so out_len must be at least ventoy_gzip_bound(in_len).
+ * The output contains the gzip header on the first call and the gzip trailer when finish is set.
+ * Return the output length, or -1 on failure (the stream is useless after that).
+ */
+int ventoy_gzip_stream_write(ventoy_gzip_stream *stream, const void *in, int in_len, void *out, int out_len, int finish)
+{
+    int ret;
+    int len = 0;
+    grub_uint8_t *outbuf = (grub_uint8_t *)out;
+
+    if (!stream || in_len < 0)
+    {
+        return -1;
+    }
+
+    if (stream->header == 0)
+    {
+        if (out_len < VTOY_GZIP_HDR_LEN)
+        {
+            return -1;
+        }
+
+        grub_memcpy(outbuf, g_gzip_header, VTOY_GZIP_HDR_LEN);
+        len += VTOY_GZIP_HDR_LEN;
+        stream->header = 1;
+    }
+
+    if (in_len > 0)
+    {
+        stream->crc = (grub_uint32_t)mz_crc32(stream->crc, in, in_len);
+        stream->isize += (grub_uint32_t)in_len;
+    }
+
+    stream->s.next_in = in;
+    stream->s.avail_in = in_len;
+    stream->s.next_out = outbuf + len;
+    stream->s.avail_out = out_len - len;
+
+    if (in_len == 0 && finish == 0)
+    {
+        return len;
+    }
+
+    ret = mz_deflate(&stream->s, finish ? MZ_FINISH : MZ_SYNC_FLUSH);
+    if (finish ? (ret != MZ_STREAM_END) : (ret != MZ_OK || stream->s.avail_in > 0))
+    {
+        debug("gzip stream deflate failed ret:%d avail_in:%u\n", ret, stream->s.avail_in);
+        return -1;
+    }
+
+    len = (int)(stream->s.next_out - outbuf);
+
+    if (finish)
+    {
+        if (out_len - len < VTOY_GZIP_TAIL_LEN)
+        {
+            return -1;
+        }
+
+        ventoy_gzip_put_u32(outbuf + len, stream->crc);
+        ventoy_gzip_put_u32(outbuf + len + 4, stream->isize);
+        len += VTOY_GZIP_TAIL_LEN;
+    }
+
+    return len;
+}
+
+void ventoy_gzip_stream_close(ventoy_gzip_stream *stream)
+{
+    if (stream)
+    {
+        mz_deflateEnd(&stream->s);
+        grub_free(stream);
+    }
+}
+
@@ -0,0 +1,39 @@
+/******************************************************************************
+ * ventoy_gzip.h
+ *
+ * Copyright (c) 2021, longpanda <admin@ventoy.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __VENTOY_GZIP_H__
+#define __VENTOY_GZIP_H__
+
+/* 
+ * gzip writer on top of miniz deflate, kept apart from ventoy_cmd.c so that it
+ * can also be built on the host (see GRUB2/buildtest.sh)
+ */
+#define VTOY_GZIP_LEVEL_STORED   0
+#define VTOY_GZIP_LEVEL_DEFAULT  1
+typedef struct ventoy_gzip_stream ventoy_gzip_stream;
+int ventoy_gzip_bound(int mem_in_len);
+int ventoy_gzip_compress(void *mem_in, int mem_in_len, void *mem_out, int mem_out_len);
+int ventoy_gzip_compress_level(void *mem_in, int mem_in_len, void *mem_out, int mem_out_len, int level);
+ventoy_gzip_stream * ventoy_gzip_stream_open(int level);
+int ventoy_gzip_stream_write(ventoy_gzip_stream *stream, const void *in, int in_len, void *out, int out_len, int finish);
+void ventoy_gzip_stream_close(ventoy_gzip_stream *stream);
+
+#endif /* __VENTOY_GZIP_H__ */
+
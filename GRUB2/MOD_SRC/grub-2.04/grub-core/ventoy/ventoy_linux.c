@@ -41,6 +41,14 @@ GRUB_MOD_LICENSE ("GPLv3+");
 #define VTOY_APPEND_EXT_SIZE 4096
 static int g_append_ext_sector = 0;
 
+static int g_initrd_cache_count = 0;
+static initrd_cfg_cache *g_initrd_cache_head = NULL;
+static initrd_cfg_cache *g_initrd_cache_cur = NULL;
+
+static int g_cpio_payload_num = 0;
+static cpio_payload g_cpio_payload[VTOY_CPIO_PAYLOAD_MAX];
+static grub_uint32_t g_ventoy_cpio_mem_size = 0;
+
 char * ventoy_get_line(char *start)
 {
     if (start == NULL)
@@ -80,6 +88,203 @@ static initrd_info * ventoy_find_initrd_by_name(initrd_info *list, const char *n
     return NULL;
 }
 
+static void ventoy_linux_add_initrd(initrd_info *img)
+{
+    if (ventoy_find_initrd_by_name(g_initrd_img_list, img->name))
+    {
+        grub_free(img);
+        return;
+    }
+
+    if (g_initrd_img_list)
+    {
+        img->prev = g_initrd_img_tail;
+        g_initrd_img_tail->next = img;
+    }
+    else
+    {
+        g_initrd_img_list = img;
+    }
+
+    g_initrd_img_tail = img;
+    g_initrd_img_count++;
+}
+
+static void ventoy_initrd_cache_free(void)
+{
+    initrd_cfg_cache *node = g_initrd_cache_head;
+    initrd_cfg_cache *next;
+
+    while (node)
+    {
+        next = node->next;
+        grub_check_free(node->key);
+        grub_check_free(node->names);
+        grub_free(node);
+        node = next;
+    }
+
+    g_initrd_cache_head = NULL;
+    g_initrd_cache_count = 0;
+}
+
+/* key: image path + image size (taken from the loop disk) + parse command + args */
+static char * ventoy_initrd_cache_key(const char *cmd, int argc, char **args)
+{
+    int i;
+    int len;
+    int pos;
+    char *key;
+    const char *path;
+    grub_disk_t disk;
+    char size[32];
+
+    path = ventoy_get_env("vt_chosen_path");
+    if (!path)
+    {
+        return NULL;
+    }
+
+    disk = grub_disk_open("loop");
+    if (!disk)
+    {
+        grub_errno = GRUB_ERR_NONE;
+        return NULL;
+    }
+
+    grub_snprintf(size, sizeof(size), "%llu", (ulonglong)grub_disk_get_size(disk));
+    grub_disk_close(disk);
+
+    len = (int)(grub_strlen(path) + grub_strlen(size) + grub_strlen(cmd)) + 3;
+    for (i = 0; i < argc; i++)
+    {
+        len += (int)grub_strlen(args[i]) + 1;
+    }
+
+    key = grub_malloc(len + 1);
+    if (!key)
+    {
+        return NULL;
+    }
+
+    pos = grub_snprintf(key, len + 1, "%s|%s|%s", path, size, cmd);
+    for (i = 0; i < argc; i++)
+    {
+        pos += grub_snprintf(key + pos, len + 1 - pos, "|%s", args[i]);
+    }
+
+    return key;
+}
+
+static int ventoy_initrd_cache_replay(const char *key)
+{
+    int pos;
+    initrd_info *img = NULL;
+    initrd_cfg_cache *node = NULL;
+
+    for (node = g_initrd_cache_head; node; node = node->next)
+    {
+        if (grub_strcmp(node->key, key) == 0)
+        {
+            break;
+        }
+    }
+
+    if (!node)
+    {
+        return 0;
+    }
+
+    debug("initrd cache hit <%s> %d\n", key, node->namelen);
+
+    for (pos = 0; pos < node->namelen; pos += (int)grub_strlen(node->names + pos) + 1)
+    {
+        img = grub_zalloc(sizeof(initrd_info));
+        if (!img)
+        {
+            break;
+        }
+
+        grub_strncpy(img->name, node->names + pos, sizeof(img->name) - 1);
+        ventoy_linux_add_initrd(img);
+    }
+
+    return 1;
+}
+
+static void ventoy_initrd_cache_begin(char *key)
+{
+    if (!key)
+    {
+        return;
+    }
+
+    if (g_initrd_cache_count >= VTOY_INITRD_CACHE_MAX)
+    {
+        ventoy_initrd_cache_free();
+    }
+
+    g_initrd_cache_cur = grub_zalloc(sizeof(initrd_cfg_cache));
+    if (!g_initrd_cache_cur)
+    {
+        grub_free(key);
+        return;
+    }
+
+    g_initrd_cache_cur->key = key;
+}
+
+/* the walk failed somewhere, don't cache a partial (or empty) initrd list */
+static void ventoy_initrd_cache_drop(void)
+{
+    if (g_initrd_cache_cur)
+    {
+        grub_check_free(g_initrd_cache_cur->key);
+        grub_check_free(g_initrd_cache_cur->names);
+        grub_free(g_initrd_cache_cur);
+        g_initrd_cache_cur = NULL;
+    }
+}
+
+static void ventoy_initrd_cache_record(const char *name)
+{
+    int len;
+    char *names;
+    initrd_cfg_cache *node = g_initrd_cache_cur;
+
+    if (!node)
+    {
+        return;
+    }
+
+    len = (int)grub_strlen(name) + 1;
+    if (node->namelen + len > node->maxlen)
+    {
+        names = grub_realloc(node->names, node->maxlen + len + 1024);
+        if (!names)
+        {
+            ventoy_initrd_cache_drop();
+            return;
+        }
+        node->names = names;
+        node->maxlen += len + 1024;
+    }
+
+    grub_memcpy(node->names + node->namelen, name, len);
+    node->namelen += len;
+}
+
+static void ventoy_initrd_cache_end(void)
+{
+    if (g_initrd_cache_cur)
+    {
+        g_initrd_cache_cur->next = g_initrd_cache_head;
+        g_initrd_cache_head = g_initrd_cache_cur;
+        g_initrd_cache_count++;
+        g_initrd_cache_cur = NULL;
+    }
+}
+
 grub_err_t ventoy_cmd_clear_initrd_list(grub_extcmd_context_t ctxt, int argc, char **args)
 {
     initrd_info *node = g_initrd_img_list;
@@ -168,10 +373,14 @@ static grub_err_t ventoy_isolinux_initrd_collect(grub_file_t file, const char *p
     buf = grub_zalloc(file->size + 2);
     if (!buf)
     {
+        ventoy_initrd_cache_drop();
         return 0;
     }
 
-    grub_file_read(file, buf, file->size);
+    if (grub_file_read(file, buf, file->size) != (grub_ssize_t)file->size)
+    {
+        ventoy_initrd_cache_drop();
+    }
 
     for (start = buf; start; start = nextline)
     {
@@ -226,6 +435,8 @@ static grub_err_t ventoy_isolinux_initrd_collect(grub_file_t file, const char *p
                 img->name[i++] = *pos++;
             }
 
+            ventoy_initrd_cache_record(img->name);
+
             if (ventoy_find_initrd_by_name(g_initrd_img_list, img->name))
             {
                 grub_free(img);
@@ -278,6 +489,7 @@ static int ventoy_isolinux_initrd_hook(const char *filename, const struct grub_d
     file = ventoy_grub_file_open(VENTOY_FILE_TYPE, "%s%s", ctx->path_prefix, filename);
     if (!file)
     {
+        ventoy_initrd_cache_drop();
         return 0;
     }
 
@@ -292,12 +504,22 @@ grub_err_t ventoy_cmd_isolinux_initrd_collect(grub_extcmd_context_t ctxt, int ar
     grub_fs_t fs;
     grub_device_t dev = NULL;
     char *device_name = NULL;
+    char *key = NULL;
     ventoy_initrd_ctx ctx;
     char directory[256];
     
     (void)ctxt;
     (void)argc;
 
+    key = ventoy_initrd_cache_key("isolinux", argc, args);
+    if (key && ventoy_initrd_cache_replay(key))
+    {
+        grub_free(key);
+        VENTOY_CMD_RETURN(GRUB_ERR_NONE);
+    }
+
+    ventoy_initrd_cache_begin(key);
+
     device_name = grub_file_get_device_name(args[0]);
     if (!device_name)
     {
@@ -324,9 +546,13 @@ grub_err_t ventoy_cmd_isolinux_initrd_collect(grub_extcmd_context_t ctxt, int ar
 
     debug("path_prefix=<%s> dir_prefix=<%s>\n", ctx.path_prefix, ctx.dir_prefix);
 
-    fs->fs_dir(dev, directory, ventoy_isolinux_initrd_hook, &ctx);
+    if (fs->fs_dir(dev, directory, ventoy_isolinux_initrd_hook, &ctx) == GRUB_ERR_NONE)
+    {
+        ventoy_initrd_cache_end();
+    }
 
 end:
+    ventoy_initrd_cache_drop();
     check_free(device_name, grub_free);
     check_free(dev, grub_device_close);
 
@@ -350,17 +576,22 @@ static grub_err_t ventoy_grub_cfg_initrd_collect(const char *fileName)
     file = ventoy_grub_file_open(VENTOY_FILE_TYPE, "%s", fileName);
     if (!file)
     {
+        ventoy_initrd_cache_drop();
         return 0;
     }
     
     buf = grub_zalloc(file->size + 2);
     if (!buf)
     {
+        ventoy_initrd_cache_drop();
         grub_file_close(file);
         return 0;
     }
 
-    grub_file_read(file, buf, file->size);
+    if (grub_file_read(file, buf, file->size) != (grub_ssize_t)file->size)
+    {
+        ventoy_initrd_cache_drop();
+    }
 
     for (start = buf; start; start = nextline)
     {
@@ -421,6 +652,11 @@ static grub_err_t ventoy_grub_cfg_initrd_collect(const char *fileName)
                 debug("Remove quotation <%s>\n", img->name);
             }
 
+            if (dollar == 0)
+            {
+                ventoy_initrd_cache_record(img->name);
+            }
+
             if (dollar == 1 || ventoy_find_initrd_by_name(g_initrd_img_list, img->name))
             {
                 grub_free(img);
@@ -488,8 +724,10 @@ static int ventoy_grub_initrd_hook(const char *filename, const struct grub_dirho
 grub_err_t ventoy_cmd_grub_initrd_collect(grub_extcmd_context_t ctxt, int argc, char **args)
 {
     grub_fs_t fs;
+    grub_err_t err;
     grub_device_t dev = NULL;
     char *device_name = NULL;
+    char *key = NULL;
     ventoy_initrd_ctx ctx;
     
     (void)ctxt;
@@ -502,9 +740,20 @@ grub_err_t ventoy_cmd_grub_initrd_collect(grub_extcmd_context_t ctxt, int argc,
 
     debug("grub initrd collect %s %s\n", args[0], args[1]);
 
+    key = ventoy_initrd_cache_key("grub", argc, args);
+    if (key && ventoy_initrd_cache_replay(key))
+    {
+        grub_free(key);
+        VENTOY_CMD_RETURN(GRUB_ERR_NONE);
+    }
+
+    ventoy_initrd_cache_begin(key);
+
     if (grub_strcmp(args[0], "file") == 0)
     {
-        return ventoy_grub_cfg_initrd_collect(args[1]);
+        err = ventoy_grub_cfg_initrd_collect(args[1]);
+        ventoy_initrd_cache_end();
+        return err;
     }
 
     device_name = grub_file_get_device_name(args[1]);
@@ -541,9 +790,13 @@ grub_err_t ventoy_cmd_grub_initrd_collect(grub_extcmd_context_t ctxt, int argc,
 
     debug("ctx.path_prefix:<%s>\n", ctx.path_prefix);
 
-    fs->fs_dir(dev, ctx.path_prefix, ventoy_grub_initrd_hook, &ctx);
+    if (fs->fs_dir(dev, ctx.path_prefix, ventoy_grub_initrd_hook, &ctx) == GRUB_ERR_NONE)
+    {
+        ventoy_initrd_cache_end();
+    }
 
 end:
+    ventoy_initrd_cache_drop();
     check_free(device_name, grub_free);
     check_free(dev, grub_device_close);
 
@@ -652,9 +905,54 @@ int ventoy_cpio_newc_fill_head(void *buf, int filesize, const void *filedata, co
     return headlen;
 }
 
+static grub_uint32_t ventoy_linux_get_payload_chunk_count(void)
+{
+    int i;
+    grub_uint32_t count = 0;
+
+    for (i = 0; i < g_cpio_payload_num; i++)
+    {
+        count += g_cpio_payload[i].chunk_list.cur_chunk;
+    }
+
+    return count;
+}
+
+static void ventoy_linux_fill_payload_chunk(grub_uint64_t isosize, ventoy_img_chunk *chunk)
+{
+    int i;
+    grub_uint32_t j;
+    grub_uint32_t sector;
+    cpio_payload *payload;
+
+    /* payload data are placed after the image, they are only accessed through virt chunk remap */
+    sector = g_img_chunk_list.chunk[g_img_chunk_list.cur_chunk - 1].img_end_sector + 1;
+    if (sector < (isosize + 2047) / 2048)
+    {
+        sector = (grub_uint32_t)((isosize + 2047) / 2048);
+    }
+
+    for (i = 0; i < g_cpio_payload_num; i++)
+    {
+        payload = g_cpio_payload + i;
+        payload->img_sector = sector;
+
+        for (j = 0; j < payload->chunk_list.cur_chunk; j++)
+        {
+            chunk->img_start_sector  = payload->chunk_list.chunk[j].img_start_sector + sector;
+            chunk->img_end_sector    = payload->chunk_list.chunk[j].img_end_sector + sector;
+            chunk->disk_start_sector = payload->chunk_list.chunk[j].disk_start_sector;
+            chunk->disk_end_sector   = payload->chunk_list.chunk[j].disk_end_sector;
+            chunk++;
+        }
+
+        sector += payload->data_secs;
+    }
+}
+
 static grub_uint32_t ventoy_linux_get_virt_chunk_count(void)
 {
-    grub_uint32_t count = g_valid_initrd_count;
+    grub_uint32_t count = g_valid_initrd_count * (1 + g_cpio_payload_num);
     
     if (g_conf_replace_offset > 0)
     {
@@ -673,7 +971,7 @@ static grub_uint32_t ventoy_linux_get_virt_chunk_size(void)
 {
     grub_uint32_t size;
     
-    size = (sizeof(ventoy_virt_chunk) + g_ventoy_cpio_size) * g_valid_initrd_count;
+    size = (sizeof(ventoy_virt_chunk) * (1 + g_cpio_payload_num) + g_ventoy_cpio_mem_size) * g_valid_initrd_count;
     
     if (g_conf_replace_offset > 0)
     {
@@ -690,20 +988,22 @@ static grub_uint32_t ventoy_linux_get_virt_chunk_size(void)
 
 static void ventoy_linux_fill_virt_data(    grub_uint64_t isosize, ventoy_chain_head *chain)
 {
+    int i;
     int id = 0;
     int virtid = 0;
     initrd_info *node;
     grub_uint64_t sector;
     grub_uint32_t offset;
+    grub_uint32_t memoff;
     grub_uint32_t cpio_secs;
     grub_uint32_t initrd_secs;
     char *override;
+    cpio_payload *payload;
     ventoy_virt_chunk *cur;
     char name[32];
 
     override = (char *)chain + chain->virt_chunk_offset;
     sector = (isosize + 2047) / 2048;
-    cpio_secs = g_ventoy_cpio_size / 2048;
 
     offset = ventoy_linux_get_virt_chunk_count() * sizeof(ventoy_virt_chunk);
     cur = (ventoy_virt_chunk *)override;
@@ -717,9 +1017,30 @@ static void ventoy_linux_fill_virt_data(    grub_uint64_t isosize, ventoy_chain_
 
         initrd_secs = (grub_uint32_t)((node->size + 2047) / 2048);
 
+        /* memory part + payload data from disk */
+        memoff = 0;
+        for (i = 0; i < g_cpio_payload_num; i++)
+        {
+            payload = g_cpio_payload + i;
+
+            cur->mem_sector_start   = sector;
+            cur->mem_sector_end     = cur->mem_sector_start + payload->mem_size / 2048;
+            cur->mem_sector_offset  = offset + payload->mem_offset;
+            cur->remap_sector_start = cur->mem_sector_end;
+            cur->remap_sector_end   = cur->remap_sector_start + payload->data_secs;
+            cur->org_sector_start   = payload->img_sector;
+
+            memoff = payload->mem_offset + payload->mem_size;
+            sector = cur->remap_sector_end;
+            cur++;
+            virtid++;
+        }
+
+        cpio_secs = (g_ventoy_cpio_mem_size - memoff) / 2048;
+
         cur->mem_sector_start   = sector;
         cur->mem_sector_end     = cur->mem_sector_start + cpio_secs;
-        cur->mem_sector_offset  = offset;
+        cur->mem_sector_offset  = offset + memoff;
         cur->remap_sector_start = cur->mem_sector_end;
         cur->remap_sector_end   = cur->remap_sector_start + initrd_secs;
         cur->org_sector_start   = (grub_uint32_t)(node->offset / 2048);
@@ -732,11 +1053,11 @@ static void ventoy_linux_fill_virt_data(    grub_uint64_t isosize, ventoy_chain_
         grub_memcpy(g_ventoy_initrd_head + 1, name, 16);
         ventoy_cpio_newc_fill_int((grub_uint32_t)node->size, g_ventoy_initrd_head->c_filesize, 8);
 
-        grub_memcpy(override + offset, g_ventoy_cpio_buf, g_ventoy_cpio_size);
+        grub_memcpy(override + offset, g_ventoy_cpio_buf, g_ventoy_cpio_mem_size);
 
         chain->virt_img_size_in_bytes += g_ventoy_cpio_size + initrd_secs * 2048;
 
-        offset += g_ventoy_cpio_size;
+        offset += g_ventoy_cpio_mem_size;
         sector += cpio_secs + initrd_secs;
         cur++;
         virtid++;
@@ -947,9 +1268,9 @@ grub_err_t ventoy_cmd_valid_initrd_count(grub_extcmd_context_t ctxt, int argc, c
 
 static grub_err_t ventoy_linux_locate_initrd(int filt, int *filtcnt)
 {
-    int data;
     int filtbysize = 1;
     int sizefilt = 0;
+    grub_uint64_t pos = 0;
     grub_file_t file;
     initrd_info *node;
 
@@ -964,13 +1285,39 @@ static grub_err_t ventoy_linux_locate_initrd(int filt, int *filtcnt)
     
     for (node = g_initrd_img_list; node; node = node->next)
     {
-        file = ventoy_grub_file_open(VENTOY_FILE_TYPE, "(loop)%s", node->name);
-        if (!file)
+        /* the lookup result is kept in the node, so the second pass (no filt) need not open it again */
+        if (node->located == 0)
+        {
+            node->located = -1;
+
+            file = ventoy_grub_file_open(VENTOY_FILE_TYPE, "(loop)%s", node->name);
+            if (!file)
+            {
+                continue;
+            }
+
+            if (grub_strcmp(file->fs->name, "iso9660") == 0)
+            {
+                node->iso_type = 0;
+                node->offset = grub_iso9660_get_file_extent(file, &pos);
+                node->override_offset = pos + 2;
+            }
+            else
+            {
+                /* TBD */
+            }
+
+            node->file_size = file->size;
+            node->located = 1;
+            grub_file_close(file);
+        }
+
+        if (node->located < 0)
         {
             continue;
         }
 
-        debug("file <%s> size:%d\n", node->name, (int)file->size);
+        debug("file <%s> size:%d\n", node->name, (int)node->file_size);
 
         /* initrd file too small */
         if (filtbysize 
@@ -978,38 +1325,22 @@ static grub_err_t ventoy_linux_locate_initrd(int filt, int *filtcnt)
             && (NULL == grub_strstr(node->name, "initrd.xz"))
             )
         {
-            if (filt > 0 && file->size <= g_ventoy_cpio_size + 2048)
+            if (filt > 0 && node->file_size <= g_ventoy_cpio_size + 2048)
             {
                 debug("file size too small %d\n", (int)g_ventoy_cpio_size);
-                grub_file_close(file);
                 sizefilt++;
                 continue;
             }
         }
 
         /* skip hdt.img */
-        if (file->size <= VTOY_SIZE_1MB && grub_strcmp(node->name, "/boot/hdt.img") == 0)
+        if (node->file_size <= VTOY_SIZE_1MB && grub_strcmp(node->name, "/boot/hdt.img") == 0)
         {
             continue;
         }
 
-        if (grub_strcmp(file->fs->name, "iso9660") == 0)
-        {
-            node->iso_type = 0;
-            node->override_offset = grub_iso9660_get_last_file_dirent_pos(file) + 2;
-            
-            grub_file_read(file, &data, 1); // just read for hook trigger
-            node->offset = grub_iso9660_get_last_read_pos(file);
-        }
-        else
-        {
-            /* TBD */
-        }
-
-        node->size = file->size;
+        node->size = node->file_size;
         g_valid_initrd_count++;
-
-        grub_file_close(file);
     }
 
     *filtcnt = sizefilt;
@@ -1090,8 +1421,9 @@ static int ventoy_cpio_busybox64(cpio_newc_header *head, const char *file)
 
     grub_snprintf(filepath, sizeof(filepath), "ventoy/busybox/%s", file);
     
+    /* busybox is in the arch cpio, stop before the ventoy files (payload data may be not in memory) */
     name = (char *)(head + 1);
-    while (name[0] && count < 2)
+    while (name[0] && count < 2 && grub_strcmp(name, "ventoy/ventoy_image_map"))
     {
         if (grub_strcmp(name, "ventoy/busybox/ash") == 0)
         {
@@ -1186,6 +1518,249 @@ grub_err_t ventoy_cmd_append_ext_sector(grub_extcmd_context_t ctxt, int argc, ch
     VENTOY_CMD_RETURN(GRUB_ERR_NONE);
 }
 
+static void ventoy_linux_free_payload(void)
+{
+    int i;
+
+    for (i = 0; i < g_cpio_payload_num; i++)
+    {
+        grub_check_free(g_cpio_payload[i].path);
+        grub_check_free(g_cpio_payload[i].tail);
+        grub_check_free(g_cpio_payload[i].chunk_list.chunk);
+    }
+
+    grub_memset(g_cpio_payload, 0, sizeof(g_cpio_payload));
+    g_cpio_payload_num = 0;
+}
+
+static int ventoy_linux_check_payload_chunk(grub_disk_t disk, cpio_payload *payload)
+{
+    grub_uint32_t i;
+    grub_uint32_t ratio;
+    grub_uint32_t count;
+    grub_uint32_t sector = 0;
+    grub_uint64_t disksecs;
+    ventoy_img_chunk *chunk = NULL;
+    ventoy_img_chunk_list *chunklist = &(payload->chunk_list);
+
+    if (disk->log_sector_size > 11)
+    {
+        return 1;
+    }
+
+    ratio = 2048 >> disk->log_sector_size;
+
+    /* every 2048 sector of the data must be mapped to the disk exactly */
+    for (i = 0; i < chunklist->cur_chunk && sector < payload->data_secs; i++)
+    {
+        chunk = chunklist->chunk + i;
+        if (chunk->img_start_sector != sector)
+        {
+            debug("payload chunk %u not continuous %u %u\n", i, chunk->img_start_sector, sector);
+            return 1;
+        }
+
+        count = chunk->img_end_sector + 1 - chunk->img_start_sector;
+        if (sector + count > payload->data_secs)
+        {
+            count = payload->data_secs - sector;
+        }
+
+        disksecs = chunk->disk_end_sector + 1 - chunk->disk_start_sector;
+        if (disksecs < (grub_uint64_t)count * ratio || 
+            (sector + count < payload->data_secs && disksecs != (grub_uint64_t)count * ratio))
+        {
+            debug("payload chunk %u not aligned %u %llu\n", i, count, (ulonglong)disksecs);
+            return 1;
+        }
+
+        chunk->img_end_sector = sector + count - 1;
+        chunk->disk_end_sector = chunk->disk_start_sector + (grub_uint64_t)count * ratio - 1;
+        sector += count;
+    }
+
+    if (sector < payload->data_secs)
+    {
+        debug("payload chunk not enough %u %u\n", sector, payload->data_secs);
+        return 1;
+    }
+
+    chunklist->cur_chunk = i;
+    return 0;
+}
+
+static cpio_payload * ventoy_linux_add_payload(const char *isopart, const char *path)
+{
+    int len;
+    grub_uint32_t tailsize;
+    grub_uint64_t start;
+    grub_file_t file = NULL;
+    cpio_payload *payload = NULL;
+
+    if (g_cpio_payload_num >= VTOY_CPIO_PAYLOAD_MAX)
+    {
+        return NULL;
+    }
+
+    file = ventoy_grub_file_open(VENTOY_FILE_TYPE, "%s%s", isopart, path);
+    if (!file)
+    {
+        return NULL;
+    }
+
+    if (file->size < VTOY_CPIO_PAYLOAD_MIN || file->size > 0xFFFFFFFFULL || 
+        (!file->device->disk) || (!file->device->disk->partition))
+    {
+        grub_file_close(file);
+        return NULL;
+    }
+
+    payload = g_cpio_payload + g_cpio_payload_num;
+    grub_memset(payload, 0, sizeof(cpio_payload));
+    payload->size = file->size;
+    payload->data_secs = (grub_uint32_t)(file->size / 2048);
+
+    len = (int)(grub_strlen(isopart) + grub_strlen(path) + 1);
+    payload->path = grub_malloc(len);
+    payload->tail = grub_malloc(2048);
+    payload->chunk_list.chunk = grub_malloc(sizeof(ventoy_img_chunk) * DEFAULT_CHUNK_NUM);
+    if (!payload->path || !payload->tail || !payload->chunk_list.chunk)
+    {
+        goto fail;
+    }
+
+    grub_snprintf(payload->path, len, "%s%s", isopart, path);
+    payload->chunk_list.max_chunk = DEFAULT_CHUNK_NUM;
+    payload->chunk_list.cur_chunk = 0;
+
+    start = file->device->disk->partition->start;
+    ventoy_get_block_list(file, &(payload->chunk_list), start);
+    if (0 != ventoy_check_block_list(file, &(payload->chunk_list), start) ||
+        0 != ventoy_linux_check_payload_chunk(file->device->disk, payload))
+    {
+        debug("payload %s can not be read from disk directly\n", payload->path);
+        goto fail;
+    }
+
+    tailsize = (grub_uint32_t)(file->size % 2048);
+    if (tailsize > 0)
+    {
+        grub_file_seek(file, (grub_uint64_t)payload->data_secs * 2048);
+        if (grub_file_read(file, payload->tail, tailsize) != (grub_ssize_t)tailsize)
+        {
+            goto fail;
+        }
+    }
+
+    debug("payload %s size:%llu chunk:%u\n", payload->path, (ulonglong)payload->size, payload->chunk_list.cur_chunk);
+
+    grub_file_close(file);
+    g_cpio_payload_num++;
+    return payload;
+
+fail:
+    grub_check_free(payload->path);
+    grub_check_free(payload->tail);
+    grub_check_free(payload->chunk_list.chunk);
+    grub_file_close(file);
+    return NULL;
+}
+
+static grub_uint8_t * ventoy_linux_put_payload(grub_uint8_t *buf, cpio_payload *payload, const char *name)
+{
+    grub_uint32_t cur;
+    grub_uint32_t padsize;
+    grub_uint32_t padhead;
+    grub_uint32_t headlen;
+    grub_uint32_t tailsize;
+
+    /* insert a pad file to make the payload data start at a 2048 boundary */
+    padhead = ventoy_cpio_newc_fill_head(buf, 0, NULL, "ventoy/ventoy_pad");
+    headlen = ventoy_cpio_newc_fill_head(buf, 0, NULL, name);
+    cur = (grub_uint32_t)(buf - g_ventoy_cpio_buf) + padhead + headlen;
+    padsize = (2048 - (cur % 2048)) % 2048;
+
+    padhead = ventoy_cpio_newc_fill_head(buf, padsize, NULL, "ventoy/ventoy_pad");
+    grub_memset(buf + padhead, 0, padsize);
+    buf += padhead + padsize;
+
+    headlen = ventoy_cpio_newc_fill_head(buf, (grub_uint32_t)payload->size, NULL, name);
+    buf += headlen;
+
+    if (payload > g_cpio_payload)
+    {
+        payload->mem_offset = (payload - 1)->mem_offset + (payload - 1)->mem_size;
+    }
+    payload->mem_size = (grub_uint32_t)(buf - g_ventoy_cpio_buf) - payload->mem_offset;
+
+    /* the full sectors are read from disk, the tail is in memory at the start of the next part */
+    tailsize = (grub_uint32_t)(payload->size % 2048);
+    grub_memcpy(buf, payload->tail, tailsize);
+    buf += ventoy_align(tailsize, 4);
+
+    return buf;
+}
+
+static int ventoy_linux_flat_cpio(void)
+{
+    int i;
+    grub_uint32_t pos = 0;
+    grub_uint32_t memoff = 0;
+    grub_uint8_t *buf = NULL;
+    cpio_payload *payload = NULL;
+    grub_file_t file;
+
+    if (g_cpio_payload_num == 0)
+    {
+        return 0;
+    }
+
+    buf = grub_malloc(g_ventoy_cpio_size);
+    if (!buf)
+    {
+        return 1;
+    }
+
+    for (i = 0; i < g_cpio_payload_num; i++)
+    {
+        payload = g_cpio_payload + i;
+
+        grub_memcpy(buf + pos, g_ventoy_cpio_buf + payload->mem_offset, payload->mem_size);
+        pos += payload->mem_size;
+
+        file = ventoy_grub_file_open(VENTOY_FILE_TYPE, "%s", payload->path);
+        if (!file)
+        {
+            grub_free(buf);
+            return 1;
+        }
+
+        if (grub_file_read(file, buf + pos, payload->data_secs * 2048) != (grub_ssize_t)(payload->data_secs * 2048))
+        {
+            debug("failed to read payload %s %u sectors\n", payload->path, payload->data_secs);
+            grub_file_close(file);
+            grub_free(buf);
+            return 1;
+        }
+        grub_file_close(file);
+
+        pos += payload->data_secs * 2048;
+        memoff = payload->mem_offset + payload->mem_size;
+    }
+
+    grub_memcpy(buf + pos, g_ventoy_cpio_buf + memoff, g_ventoy_cpio_mem_size - memoff);
+
+    g_ventoy_runtime_buf = buf + pos + (g_ventoy_runtime_buf - g_ventoy_cpio_buf - memoff);
+    g_ventoy_initrd_head = (cpio_newc_header *)(buf + pos + ((grub_uint8_t *)g_ventoy_initrd_head - g_ventoy_cpio_buf - memoff));
+
+    grub_free(g_ventoy_cpio_buf);
+    g_ventoy_cpio_buf = buf;
+    g_ventoy_cpio_mem_size = g_ventoy_cpio_size;
+
+    ventoy_linux_free_payload();
+    return 0;
+}
+
 grub_err_t ventoy_cmd_load_cpio(grub_extcmd_context_t ctxt, int argc, char **args)
 {
     int i;
@@ -1196,6 +1771,8 @@ grub_err_t ventoy_cmd_load_cpio(grub_extcmd_context_t ctxt, int argc, char **arg
     char *persistent_buf = NULL;
     char *injection_buf = NULL;
     dud *dudnode = NULL;
+    cpio_payload *injection_payload = NULL;
+    cpio_payload **dud_payload = NULL;
     char tmpname[128];
     const char *injection_file = NULL;
     grub_uint8_t *buf = NULL;
@@ -1248,8 +1825,11 @@ grub_err_t ventoy_cmd_load_cpio(grub_extcmd_context_t ctxt, int argc, char **arg
         grub_free(g_ventoy_cpio_buf);
         g_ventoy_cpio_buf = NULL;
         g_ventoy_cpio_size = 0;
+        g_ventoy_cpio_mem_size = 0;
     }
 
+    ventoy_linux_free_payload();
+
     rc = ventoy_plugin_get_persistent_chunklist(args[1], -1, &chunk_list);
     if (rc == 0 && chunk_list.cur_chunk > 0 && chunk_list.chunk)
     {
@@ -1288,8 +1868,13 @@ grub_err_t ventoy_cmd_load_cpio(grub_extcmd_context_t ctxt, int argc, char **arg
     if (injection_file)
     {
         debug("injection archive: <%s>\n", injection_file);
-        tmpfile = ventoy_grub_file_open(VENTOY_FILE_TYPE, "%s%s", args[2], injection_file);
-        if (tmpfile)
+        injection_payload = ventoy_linux_add_payload(args[2], injection_file);
+        tmpfile = injection_payload ? NULL : ventoy_grub_file_open(VENTOY_FILE_TYPE, "%s%s", args[2], injection_file);
+        if (injection_payload)
+        {
+            debug("injection archive size:%llu read from disk\n", (ulonglong)injection_payload->size);
+        }
+        else if (tmpfile)
         {
             debug("injection archive size:%d\n", (int)tmpfile->size);
             injection_size = tmpfile->size;
@@ -1315,9 +1900,21 @@ grub_err_t ventoy_cmd_load_cpio(grub_extcmd_context_t ctxt, int argc, char **arg
     if (dudnode)
     {
         debug("dud file: <%d>\n", dudnode->dudnum);
-        ventoy_plugin_load_dud(dudnode, args[2]);
+        dud_payload = grub_zalloc(sizeof(cpio_payload *) * dudnode->dudnum);
         for (i = 0; i < dudnode->dudnum; i++)
         {
+            if (dud_payload && dudnode->files[i].size == 0)
+            {
+                dud_payload[i] = ventoy_linux_add_payload(args[2], dudnode->dudpath[i].path);
+            }
+
+            if (dud_payload && dud_payload[i])
+            {
+                dud_size += sizeof(cpio_newc_header);
+                continue;
+            }
+
+            ventoy_plugin_load_dud_file(dudnode, i, args[2]);
             if (dudnode->files[i].size > 0)
             {
                 dud_size += dudnode->files[i].size + sizeof(cpio_newc_header);                
@@ -1329,10 +1926,12 @@ grub_err_t ventoy_cmd_load_cpio(grub_extcmd_context_t ctxt, int argc, char **arg
         debug("dud not configed %s\n", args[1]);
     }
 
+    /* each payload needs a pad file and its tail data in memory */
     g_ventoy_cpio_buf = grub_malloc(file->size + archfile->size + 40960 + template_size + 
-        persistent_size + injection_size + dud_size + img_chunk_size);
+        persistent_size + injection_size + dud_size + img_chunk_size + g_cpio_payload_num * 8192);
     if (NULL == g_ventoy_cpio_buf)
     {
+        grub_check_free(dud_payload);
         grub_file_close(file);
         grub_file_close(archfile);
         return grub_error(GRUB_ERR_BAD_ARGUMENT, "Can't alloc memory %llu\n", file->size);
@@ -1374,7 +1973,11 @@ grub_err_t ventoy_cmd_load_cpio(grub_extcmd_context_t ctxt, int argc, char **arg
         persistent_buf = NULL;
     }
 
-    if (injection_size > 0 && injection_buf)
+    if (injection_payload)
+    {
+        buf = ventoy_linux_put_payload(buf, injection_payload, "ventoy/ventoy_injection");
+    }
+    else if (injection_size > 0 && injection_buf)
     {
         headlen = ventoy_cpio_newc_fill_head(buf, injection_size, injection_buf, "ventoy/ventoy_injection");
         buf += headlen + ventoy_align(injection_size, 4);
@@ -1389,6 +1992,12 @@ grub_err_t ventoy_cmd_load_cpio(grub_extcmd_context_t ctxt, int argc, char **arg
         {
             pos = grub_strrchr(dudnode->dudpath[i].path, '.');
             grub_snprintf(tmpname, sizeof(tmpname), "ventoy/ventoy_dud%d%s", i, (pos ? pos : ".iso"));
+            if (dud_payload && dud_payload[i])
+            {
+                buf = ventoy_linux_put_payload(buf, dud_payload[i], tmpname);
+                continue;
+            }
+
             dud_size = dudnode->files[i].size;
             headlen = ventoy_cpio_newc_fill_head(buf, dud_size, dudnode->files[i].buf, tmpname);
             buf += headlen + ventoy_align(dud_size, 4);
@@ -1406,6 +2015,14 @@ grub_err_t ventoy_cmd_load_cpio(grub_extcmd_context_t ctxt, int argc, char **arg
         padlen += 2048 - mod;
     }
 
+    /* g_ventoy_cpio_size is the size seen by the OS, the payload data are not in memory */
+    g_ventoy_cpio_mem_size = g_ventoy_cpio_size;
+    for (i = 0; i < g_cpio_payload_num; i++)
+    {
+        g_ventoy_cpio_size += g_cpio_payload[i].data_secs * 2048;
+    }
+    grub_check_free(dud_payload);
+
     /* update os param data size, the data will be updated before chain boot */
     ventoy_cpio_newc_fill_int(padlen, ((cpio_newc_header *)buf)->c_filesize, 8);
     g_ventoy_runtime_buf = (grub_uint8_t *)buf + headlen;
@@ -1461,6 +2078,12 @@ grub_err_t ventoy_cmd_trailer_cpio(grub_extcmd_context_t ctxt, int argc, char **
     (void)ctxt;
     (void)argc;
 
+    /* the cpio is used as a whole here, so read the payload data into memory */
+    if (ventoy_linux_flat_cpio())
+    {
+        return 1;
+    }
+
     file = ventoy_grub_file_open(VENTOY_FILE_TYPE, "%s%s", args[0], args[1]);
     if (!file)
     {
@@ -1534,6 +2157,7 @@ grub_err_t ventoy_cmd_linux_chain_data(grub_extcmd_context_t ctxt, int argc, cha
     grub_uint64_t isosize = 0;
     grub_uint32_t boot_catlog = 0;
     grub_uint32_t img_chunk_size = 0;
+    grub_uint32_t payload_chunk_num = 0;
     grub_uint32_t override_count = 0;
     grub_uint32_t override_size = 0;
     grub_uint32_t virt_chunk_count = 0;
@@ -1607,6 +2231,8 @@ grub_err_t ventoy_cmd_linux_chain_data(grub_extcmd_context_t ctxt, int argc, cha
     }
     else
     {
+        payload_chunk_num = ventoy_linux_get_payload_chunk_count();
+        img_chunk_size += payload_chunk_num * sizeof(ventoy_img_chunk);
         override_size = ventoy_linux_get_override_chunk_size();
         virt_chunk_size = ventoy_linux_get_virt_chunk_size();
         size = sizeof(ventoy_chain_head) + img_chunk_size + override_size + virt_chunk_size;
@@ -1659,13 +2285,21 @@ grub_err_t ventoy_cmd_linux_chain_data(grub_extcmd_context_t ctxt, int argc, cha
     /* part 3: image chunk */
     chain->img_chunk_offset = sizeof(ventoy_chain_head);
     chain->img_chunk_num = g_img_chunk_list.cur_chunk;
-    grub_memcpy((char *)chain + chain->img_chunk_offset, g_img_chunk_list.chunk, img_chunk_size);
+    grub_memcpy((char *)chain + chain->img_chunk_offset, g_img_chunk_list.chunk, 
+        g_img_chunk_list.cur_chunk * sizeof(ventoy_img_chunk));
 
     if (ventoy_compatible)
     {
         return 0;
     }
 
+    /* part 3.1: payload chunk, after the image chunk */
+    if (payload_chunk_num > 0)
+    {
+        ventoy_linux_fill_payload_chunk(isosize, (ventoy_img_chunk *)((char *)chain + chain->img_chunk_offset) + chain->img_chunk_num);
+        chain->img_chunk_num += payload_chunk_num;
+    }
+
     /* part 4: override chunk */
     if (override_count > 0)
     {
@@ -3061,32 +3061,40 @@ dud * ventoy_plugin_find_dud(const char *iso)
     return NULL;
 }
 
-int ventoy_plugin_load_dud(dud *node, const char *isopart)
+int ventoy_plugin_load_dud_file(dud *node, int index, const char *isopart)
 {
-    int i;
     char *buf;
     grub_file_t file;
 
-    for (i = 0; i < node->dudnum; i++)
+    if (node->files[index].size > 0)
     {
-        if (node->files[i].size > 0)
-        {
-            debug("file %d has been loaded\n", i);
-            continue;
-        }
-    
-        file = ventoy_grub_file_open(VENTOY_FILE_TYPE, "%s%s", isopart, node->dudpath[i].path);
-        if (file)
+        debug("file %d has been loaded\n", index);
+        return 0;
+    }
+
+    file = ventoy_grub_file_open(VENTOY_FILE_TYPE, "%s%s", isopart, node->dudpath[index].path);
+    if (file)
+    {
+        buf = grub_malloc(file->size);
+        if (buf)
         {
-            buf = grub_malloc(file->size);
-            if (buf)
-            {
-                grub_file_read(file, buf, file->size);            
-                node->files[i].size = (int)file->size;
-                node->files[i].buf = buf;                
-            }
-            grub_file_close(file);
+            grub_file_read(file, buf, file->size);            
+            node->files[index].size = (int)file->size;
+            node->files[index].buf = buf;                
         }
+        grub_file_close(file);
+    }
+
+    return 0;
+}
+
+int ventoy_plugin_load_dud(dud *node, const char *isopart)
+{
+    int i;
+
+    for (i = 0; i < node->dudnum; i++)
+    {
+        ventoy_plugin_load_dud_file(node, i, isopart);
     }
 
     return 0;
@@ -37,6 +37,7 @@
 #include <grub/elfload.h>
 #include <grub/ventoy.h>
 #include "ventoy_def.h"
+#include "ventoy_gzip.h"
 
 GRUB_MOD_LICENSE ("GPLv3+");
 
@@ -46,6 +47,7 @@ char *g_conf_new_data = NULL;
 
 int g_mod_new_len = 0;
 char *g_mod_new_data = NULL;
+static int g_mod_new_nogzip = 0;
 
 grub_uint64_t g_mod_override_offset = 0;
 grub_uint64_t g_conf_override_offset = 0;
@@ -260,6 +262,7 @@ grub_err_t ventoy_cmd_unix_reset(grub_extcmd_context_t ctxt, int argc, char **ar
     
     g_conf_new_len = 0;
     g_mod_new_len = 0;
+    g_mod_new_nogzip = 0;
     g_mod_override_offset = 0;
     g_conf_override_offset = 0;
 
@@ -632,7 +635,7 @@ grub_err_t ventoy_cmd_unix_replace_ko(grub_extcmd_context_t ctxt, int argc, char
 
     (void)ctxt;
 
-    if (argc != 2)
+    if (argc != 2 && argc != 3)
     {
         debug("Replace ko invalid argc %d\n", argc);
         return 1;
@@ -640,6 +643,9 @@ grub_err_t ventoy_cmd_unix_replace_ko(grub_extcmd_context_t ctxt, int argc, char
 
     debug("replace ko %s\n", args[0]);
 
+    /* nogzip: the new ko file is used as it is, vt_unix_gzip_new_ko will do nothing */
+    g_mod_new_nogzip = (argc == 3 && grub_strcmp(args[2], "nogzip") == 0) ? 1 : 0;
+
     if (ventoy_get_file_override(args[0], &offset) == 0)
     {
         grub_snprintf(g_ko_mod_path, sizeof(g_ko_mod_path), "%s", args[0]);
@@ -743,31 +749,43 @@ end:
 
 grub_err_t ventoy_cmd_unix_gzip_newko(grub_extcmd_context_t ctxt, int argc, char **args)
 {
+    int level = VTOY_GZIP_LEVEL_DEFAULT;
     int newlen;
+    int buflen;
     grub_uint8_t *buf;
 
     (void)ctxt;
-    (void)argc;
-    (void)args;
 
-    debug("ventoy_cmd_unix_gzip_newko %p\n", g_mod_new_data);
+    debug("ventoy_cmd_unix_gzip_newko %p nogzip:%d\n", g_mod_new_data, g_mod_new_nogzip);
 
-    if (!g_mod_new_data)
+    if (!g_mod_new_data || g_mod_new_nogzip)
     {
         goto end;
     }
 
-    buf = grub_malloc(g_mod_new_len);
+    if (argc > 0)
+    {
+        level = (int)grub_strtoul(args[0], NULL, 10);
+    }
+
+    buflen = ventoy_gzip_bound(g_mod_new_len);
+    buf = grub_malloc(buflen);
     if (!buf)
     {
         goto end;
     }
 
-    newlen = ventoy_gzip_compress(g_mod_new_data, g_mod_new_len, buf, g_mod_new_len);
+    newlen = ventoy_gzip_compress_level(g_mod_new_data, g_mod_new_len, buf, buflen, level);
+    if (newlen < 0)
+    {
+        debug("gzip new ko failed, keep the original data\n");
+        grub_free(buf);
+        goto end;
+    }
 
     grub_free(g_mod_new_data);
 
-    debug("gzip org len:%d  newlen:%d\n", g_mod_new_len, newlen);
+    debug("gzip level:%d org len:%d  newlen:%d\n", level, g_mod_new_len, newlen);
 
     g_mod_new_data = (char *)buf;
     g_mod_new_len = newlen;
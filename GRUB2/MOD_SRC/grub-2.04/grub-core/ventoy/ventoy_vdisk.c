@@ -0,0 +1,621 @@
+/******************************************************************************
+ * ventoy_vdisk.c
+ *
+ * Copyright (c) 2021, longpanda <admin@ventoy.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <grub/types.h>
+#include <grub/misc.h>
+#include <grub/mm.h>
+#include <grub/file.h>
+#include <grub/dl.h>
+#include <grub/ventoy.h>
+#include "ventoy_vdisk.h"
+
+GRUB_MOD_LICENSE ("GPLv3+");
+
+/* the same as ventoy_def.h, which can't be used on the host */
+extern int g_ventoy_debug;
+void ventoy_debug(const char *fmt, ...);
+#define debug(fmt, args...) if (g_ventoy_debug) ventoy_debug("[VTOY]: "fmt, ##args)
+#define grub_check_free(p) if (p) { grub_free(p); p = NULL; }
+#define ulonglong  unsigned long long
+
+/* VHDX GUIDs in the on-disk byte order */
+static const grub_uint8_t g_vhdx_bat_guid[16] = 
+{
+    0x66, 0x77, 0xC2, 0x2D, 0x23, 0xF6, 0x00, 0x42, 0x9D, 0x64, 0x11, 0x5E, 0x9B, 0xFD, 0x4A, 0x08
+};
+static const grub_uint8_t g_vhdx_metadata_guid[16] = 
+{
+    0x06, 0xA2, 0x7C, 0x8B, 0x90, 0x47, 0x9A, 0x4B, 0xB8, 0xFE, 0x57, 0x5F, 0x05, 0x0F, 0x88, 0x6E
+};
+static const grub_uint8_t g_vhdx_file_param_guid[16] = 
+{
+    0x37, 0x67, 0xA1, 0xCA, 0x36, 0xFA, 0x43, 0x4D, 0xB3, 0xB6, 0x33, 0xF0, 0xAA, 0x44, 0xE7, 0x6B
+};
+static const grub_uint8_t g_vhdx_disk_size_guid[16] = 
+{
+    0x24, 0x42, 0xA5, 0x2F, 0x1B, 0xCD, 0x76, 0x48, 0xB2, 0x11, 0x5D, 0xBE, 0xD8, 0x3B, 0xF4, 0xB8
+};
+static const grub_uint8_t g_vhdx_sector_size_guid[16] = 
+{
+    0x1D, 0xBF, 0x41, 0x81, 0x6F, 0xA9, 0x09, 0x47, 0xBA, 0x47, 0xF2, 0x33, 0xA8, 0xFA, 0xAB, 0x5F
+};
+
+void ventoy_vdisk_map_free(ventoy_vdisk_map *map)
+{
+    grub_check_free(map->block_offset);
+    grub_memset(map, 0, sizeof(ventoy_vdisk_map));
+}
+
+static int ventoy_vdisk_map_init(ventoy_vdisk_map *map, int fmt, grub_uint64_t disk_size, grub_uint32_t block_size)
+{
+    grub_uint64_t block_num;
+
+    if (block_size == 0 || (block_size % 2048) != 0 || disk_size == 0)
+    {
+        debug("invalid vdisk block size %u disk size %llu\n", block_size, (ulonglong)disk_size);
+        return 1;
+    }
+
+    block_num = (disk_size + block_size - 1) / block_size;
+    if (block_num > 0x1000000)
+    {
+        debug("too many vdisk blocks %llu\n", (ulonglong)block_num);
+        return 1;
+    }
+
+    map->block_offset = grub_zalloc(block_num * sizeof(grub_uint64_t));
+    if (!map->block_offset)
+    {
+        return 1;
+    }
+
+    map->fmt = fmt;
+    map->disk_size = disk_size;
+    map->block_size = block_size;
+    map->block_num = (grub_uint32_t)block_num;
+    return 0;
+}
+
+static void * ventoy_vdisk_read_table(grub_file_t file, grub_uint64_t offset, grub_uint32_t size)
+{
+    void *buf = NULL;
+
+    buf = grub_malloc(size);
+    if (!buf)
+    {
+        return NULL;
+    }
+
+    grub_file_seek(file, offset);
+    if (grub_file_read(file, buf, size) != (grub_ssize_t)size)
+    {
+        debug("Failed to read vdisk table %llu %u\n", (ulonglong)offset, size);
+        grub_free(buf);
+        return NULL;
+    }
+
+    return buf;
+}
+
+int ventoy_vdisk_parse_vhd(grub_file_t file, vhd_footer_t *foot, ventoy_vdisk_map *map)
+{
+    int rc = 1;
+    grub_uint32_t i;
+    grub_uint32_t entry;
+    grub_uint32_t bitmap;
+    grub_uint32_t *bat = NULL;
+    vhd_dyn_header_t dyn;
+
+    grub_file_seek(file, grub_be_to_cpu64(foot->dataoffset));
+    if (grub_file_read(file, &dyn, sizeof(dyn)) != sizeof(dyn) || grub_strncmp(dyn.cookie, "cxsparse", 8) != 0)
+    {
+        debug("invalid vhd dynamic header\n");
+        return 1;
+    }
+
+    if (ventoy_vdisk_map_init(map, VTOY_VDISK_FMT_VHD, grub_be_to_cpu64(foot->currsize), grub_be_to_cpu32(dyn.blocksize)))
+    {
+        return 1;
+    }
+
+    if (map->block_num > grub_be_to_cpu32(dyn.maxtableentries))
+    {
+        debug("invalid vhd BAT entries %u %u\n", map->block_num, grub_be_to_cpu32(dyn.maxtableentries));
+        goto end;
+    }
+
+    bat = ventoy_vdisk_read_table(file, grub_be_to_cpu64(dyn.tableoffset), map->block_num * sizeof(grub_uint32_t));
+    if (!bat)
+    {
+        goto end;
+    }
+
+    /* every block begins with a sector bitmap, padded to 512 bytes */
+    bitmap = ((map->block_size / 512 / 8) + 511) / 512 * 512;
+
+    for (i = 0; i < map->block_num; i++)
+    {
+        entry = grub_be_to_cpu32(bat[i]);
+        if (entry != 0xFFFFFFFF)
+        {
+            map->block_offset[i] = (grub_uint64_t)entry * 512 + bitmap;
+        }
+    }
+
+    rc = 0;
+
+end:
+    grub_check_free(bat);
+    if (rc)
+    {
+        ventoy_vdisk_map_free(map);
+    }
+    return rc;
+}
+
+int ventoy_vdisk_parse_vhdx(grub_file_t file, ventoy_vdisk_map *map)
+{
+    int rc = 1;
+    grub_uint32_t i;
+    grub_uint32_t count;
+    grub_uint32_t block_size = 0;
+    grub_uint32_t sector_size = 0;
+    grub_uint32_t params[2] = { 0, 0 };
+    grub_uint64_t disk_size = 0;
+    grub_uint64_t entry;
+    grub_uint64_t ratio;
+    grub_uint64_t bat_num;
+    grub_uint64_t bat_offset = 0;
+    grub_uint64_t bat_length = 0;
+    grub_uint64_t meta_offset = 0;
+    grub_uint64_t *bat = NULL;
+    vhdx_header_t head[2];
+    vhdx_header_t *cur = NULL;
+    vhdx_region_head_t region;
+    vhdx_region_entry_t *regions = NULL;
+    vhdx_metadata_head_t meta;
+    vhdx_metadata_entry_t *metas = NULL;
+    grub_uint8_t zero[16] = { 0 };
+
+    grub_file_seek(file, VHDX_HEADER1_OFFSET);
+    grub_file_read(file, head, sizeof(vhdx_header_t));
+    grub_file_seek(file, VHDX_HEADER2_OFFSET);
+    grub_file_read(file, head + 1, sizeof(vhdx_header_t));
+
+    /* the current header is the valid one with the larger sequence number */
+    for (i = 0; i < 2; i++)
+    {
+        if (grub_memcmp(head[i].signature, "head", 4) == 0 &&
+            (cur == NULL || grub_le_to_cpu64(head[i].seqnum) > grub_le_to_cpu64(cur->seqnum)))
+        {
+            cur = head + i;
+        }
+    }
+
+    if (!cur)
+    {
+        debug("no valid vhdx header\n");
+        return 1;
+    }
+
+    if (grub_memcmp(cur->logguid, zero, 16))
+    {
+        debug("vhdx log is not empty, it must be replayed first\n");
+        return 1;
+    }
+
+    grub_file_seek(file, VHDX_REGION_OFFSET);
+    grub_file_read(file, &region, sizeof(region));
+    count = grub_le_to_cpu32(region.entrycount);
+    if (grub_memcmp(region.signature, "regi", 4) || count > VHDX_MAX_TABLE_ENTRY)
+    {
+        debug("invalid vhdx region table\n");
+        return 1;
+    }
+
+    regions = ventoy_vdisk_read_table(file, VHDX_REGION_OFFSET + sizeof(region), count * sizeof(vhdx_region_entry_t));
+    if (!regions)
+    {
+        return 1;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        if (grub_memcmp(regions[i].guid, g_vhdx_bat_guid, 16) == 0)
+        {
+            bat_offset = grub_le_to_cpu64(regions[i].offset);
+            bat_length = grub_le_to_cpu32(regions[i].length);
+        }
+        else if (grub_memcmp(regions[i].guid, g_vhdx_metadata_guid, 16) == 0)
+        {
+            meta_offset = grub_le_to_cpu64(regions[i].offset);
+        }
+    }
+
+    if (bat_offset == 0 || meta_offset == 0)
+    {
+        debug("vhdx BAT or metadata region not found\n");
+        goto end;
+    }
+
+    grub_file_seek(file, meta_offset);
+    grub_file_read(file, &meta, sizeof(meta));
+    count = grub_le_to_cpu16(meta.entrycount);
+    if (grub_memcmp(meta.signature, "metadata", 8) || count > VHDX_MAX_TABLE_ENTRY)
+    {
+        debug("invalid vhdx metadata table\n");
+        goto end;
+    }
+
+    metas = ventoy_vdisk_read_table(file, meta_offset + sizeof(meta), count * sizeof(vhdx_metadata_entry_t));
+    if (!metas)
+    {
+        goto end;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        grub_file_seek(file, meta_offset + grub_le_to_cpu32(metas[i].offset));
+        if (grub_memcmp(metas[i].itemid, g_vhdx_file_param_guid, 16) == 0)
+        {
+            grub_file_read(file, params, sizeof(params));
+            block_size = grub_le_to_cpu32(params[0]);
+        }
+        else if (grub_memcmp(metas[i].itemid, g_vhdx_disk_size_guid, 16) == 0)
+        {
+            grub_file_read(file, &disk_size, sizeof(disk_size));
+            disk_size = grub_le_to_cpu64(disk_size);
+        }
+        else if (grub_memcmp(metas[i].itemid, g_vhdx_sector_size_guid, 16) == 0)
+        {
+            grub_file_read(file, &sector_size, sizeof(sector_size));
+            sector_size = grub_le_to_cpu32(sector_size);
+        }
+    }
+
+    if (grub_le_to_cpu32(params[1]) & VHDX_FILE_HAS_PARENT)
+    {
+        debug("differencing vhdx is not supported\n");
+        goto end;
+    }
+
+    /* the virtual disk is always presented with 512 bytes sector */
+    if (sector_size != 512)
+    {
+        debug("unsupported vhdx logical sector size %u\n", sector_size);
+        goto end;
+    }
+
+    if (ventoy_vdisk_map_init(map, VTOY_VDISK_FMT_VHDX, disk_size, block_size))
+    {
+        goto end;
+    }
+
+    /* a sector bitmap entry follows every chunk ratio payload entries */
+    ratio = ((grub_uint64_t)1 << 23) * sector_size / block_size;
+    bat_num = map->block_num + (map->block_num - 1) / ratio;
+    if (bat_num * sizeof(grub_uint64_t) > bat_length)
+    {
+        debug("invalid vhdx BAT length %llu %llu\n", (ulonglong)bat_num, (ulonglong)bat_length);
+        goto end;
+    }
+
+    bat = ventoy_vdisk_read_table(file, bat_offset, bat_num * sizeof(grub_uint64_t));
+    if (!bat)
+    {
+        goto end;
+    }
+
+    for (i = 0; i < map->block_num; i++)
+    {
+        entry = grub_le_to_cpu64(bat[i + i / ratio]);
+        if ((entry & VHDX_BAT_STATE_MASK) == VHDX_BAT_FULLY_PRESENT)
+        {
+            map->block_offset[i] = (entry >> 20) << 20;
+        }
+        else if ((entry & VHDX_BAT_STATE_MASK) == VHDX_BAT_PART_PRESENT)
+        {
+            debug("vhdx block %u is partially present\n", i);
+            goto end;
+        }
+    }
+
+    rc = 0;
+
+end:
+    grub_check_free(bat);
+    grub_check_free(metas);
+    grub_check_free(regions);
+    if (rc)
+    {
+        ventoy_vdisk_map_free(map);
+    }
+    return rc;
+}
+
+int ventoy_vdisk_parse_vdi(grub_file_t file, VDIHEADER1PLUS *hdr, ventoy_vdisk_map *map)
+{
+    int rc = 1;
+    grub_uint32_t i;
+    grub_uint32_t entry;
+    grub_uint32_t extra;
+    grub_uint32_t *blocks = NULL;
+
+    if (ventoy_vdisk_map_init(map, VTOY_VDISK_FMT_VDI, grub_le_to_cpu64(hdr->cbDisk), grub_le_to_cpu32(hdr->cbBlock)))
+    {
+        return 1;
+    }
+
+    if (map->block_num > grub_le_to_cpu32(hdr->cBlocks))
+    {
+        debug("invalid vdi block count %u %u\n", map->block_num, grub_le_to_cpu32(hdr->cBlocks));
+        goto end;
+    }
+
+    blocks = ventoy_vdisk_read_table(file, grub_le_to_cpu32(hdr->offBlocks), map->block_num * sizeof(grub_uint32_t));
+    if (!blocks)
+    {
+        goto end;
+    }
+
+    extra = grub_le_to_cpu32(hdr->cbBlockExtra);
+    for (i = 0; i < map->block_num; i++)
+    {
+        entry = grub_le_to_cpu32(blocks[i]);
+        if (entry != VDI_IMAGE_BLOCK_FREE && entry != VDI_IMAGE_BLOCK_ZERO)
+        {
+            map->block_offset[i] = grub_le_to_cpu32(hdr->offData) + 
+                (grub_uint64_t)entry * (map->block_size + extra) + extra;
+        }
+    }
+
+    rc = 0;
+
+end:
+    grub_check_free(blocks);
+    if (rc)
+    {
+        ventoy_vdisk_map_free(map);
+    }
+    return rc;
+}
+
+/* read the virtual disk data through the block map */
+int ventoy_vdisk_read(grub_file_t file, ventoy_vdisk_map *map, grub_uint64_t offset, void *buf, grub_uint32_t len)
+{
+    grub_uint32_t blk;
+    grub_uint32_t inblk;
+    grub_uint32_t size;
+    char *data = (char *)buf;
+
+    if (map->fmt == VTOY_VDISK_FMT_NONE)
+    {
+        grub_file_seek(file, offset);
+        return (grub_file_read(file, buf, len) == (grub_ssize_t)len) ? 0 : 1;
+    }
+
+    if (offset + len > map->disk_size)
+    {
+        return 1;
+    }
+
+    while (len > 0)
+    {
+        blk = (grub_uint32_t)(offset / map->block_size);
+        inblk = (grub_uint32_t)(offset % map->block_size);
+        size = map->block_size - inblk;
+        if (size > len)
+        {
+            size = len;
+        }
+
+        /* unallocated block */
+        if (map->block_offset[blk] == 0)
+        {
+            grub_memset(data, 0, size);
+        }
+        else
+        {
+            grub_file_seek(file, map->block_offset[blk] + inblk);
+            if (grub_file_read(file, data, size) != (grub_ssize_t)size)
+            {
+                return 1;
+            }
+        }
+
+        data += size;
+        offset += size;
+        len -= size;
+    }
+
+    return 0;
+}
+
+static ventoy_img_chunk * ventoy_vdisk_find_chunk(ventoy_img_chunk_list *chunk_list, grub_uint64_t offset)
+{
+    grub_uint32_t low = 0;
+    grub_uint32_t mid = 0;
+    grub_uint32_t high = chunk_list->cur_chunk;
+    grub_uint64_t sector = offset / 2048;
+    ventoy_img_chunk *chunk = NULL;
+
+    while (low < high)
+    {
+        mid = low + (high - low) / 2;
+        chunk = chunk_list->chunk + mid;
+        if (sector < chunk->img_start_sector)
+        {
+            high = mid;
+        }
+        else if (sector > chunk->img_end_sector)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            return chunk;
+        }
+    }
+
+    return NULL;
+}
+
+/* append len bytes at the virtual disk address virt, from the disk sector, merged with the last chunk if possible */
+static int ventoy_vdisk_add_chunk(ventoy_img_chunk_list *list, grub_uint64_t virt, grub_uint64_t sector, grub_uint64_t len)
+{
+    ventoy_img_chunk *last;
+    ventoy_img_chunk *newchunk;
+
+    last = list->cur_chunk > 0 ? list->chunk + list->cur_chunk - 1 : NULL;
+    if (last && last->img_end_sector + 1 == virt / 2048 && last->disk_end_sector + 1 == sector)
+    {
+        last->img_end_sector += (grub_uint32_t)(len / 2048);
+        last->disk_end_sector += len / 512;
+        return 0;
+    }
+
+    if (list->cur_chunk >= list->max_chunk)
+    {
+        newchunk = grub_realloc(list->chunk, list->max_chunk * 2 * sizeof(ventoy_img_chunk));
+        if (!newchunk)
+        {
+            return 1;
+        }
+        list->chunk = newchunk;
+        list->max_chunk *= 2;
+    }
+
+    newchunk = list->chunk + list->cur_chunk;
+    newchunk->img_start_sector = (grub_uint32_t)(virt / 2048);
+    newchunk->img_end_sector = (grub_uint32_t)((virt + len) / 2048 - 1);
+    newchunk->disk_start_sector = sector;
+    newchunk->disk_end_sector = sector + len / 512 - 1;
+    list->cur_chunk++;
+
+    return 0;
+}
+
+/* map the file range [offset, offset + len) of chunk_list to the virtual disk address virt */
+static int ventoy_vdisk_add_range
+(
+    ventoy_img_chunk_list *chunk_list,
+    ventoy_img_chunk_list *list,
+    grub_uint64_t virt,
+    grub_uint64_t offset,
+    grub_uint64_t len
+)
+{
+    grub_uint64_t run;
+    grub_uint64_t sector;
+    ventoy_img_chunk *src;
+
+    while (len > 0)
+    {
+        src = ventoy_vdisk_find_chunk(chunk_list, offset);
+        if ((offset % 512) || !src)
+        {
+            debug("invalid vdisk block offset %llu\n", (ulonglong)offset);
+            return 1;
+        }
+
+        run = ((grub_uint64_t)src->img_end_sector + 1) * 2048 - offset;
+        if (run > len)
+        {
+            run = len;
+        }
+
+        /* a 2KB image sector can not cross the file fragments */
+        if (run % 2048)
+        {
+            debug("vdisk block at %llu is not aligned with the file fragment\n", (ulonglong)offset);
+            return 1;
+        }
+
+        sector = src->disk_start_sector + (offset - (grub_uint64_t)src->img_start_sector * 2048) / 512;
+        if (ventoy_vdisk_add_chunk(list, virt, sector, run))
+        {
+            return 1;
+        }
+
+        virt += run;
+        offset += run;
+        len -= run;
+    }
+
+    return 0;
+}
+
+/* 
+ * Replace the chunk list of the vdisk file (512 bytes disk sector) with the
+ * chunk list of the virtual disk. It covers the whole virtual disk, the
+ * unallocated blocks are zero chunks (VTOY_ZERO_CHUNK_SECTOR).
+ */
+int ventoy_vdisk_compose_chunk(ventoy_vdisk_map *map, ventoy_img_chunk_list *chunk_list)
+{
+    int rc;
+    grub_uint32_t i;
+    grub_uint32_t hole = 0;
+    grub_uint64_t virt;
+    grub_uint64_t len;
+    ventoy_img_chunk_list list;
+
+    list.chunk = grub_malloc(sizeof(ventoy_img_chunk) * DEFAULT_CHUNK_NUM);
+    if (!list.chunk)
+    {
+        return 1;
+    }
+    list.max_chunk = DEFAULT_CHUNK_NUM;
+    list.cur_chunk = 0;
+
+    for (i = 0; i < map->block_num; i++)
+    {
+        virt = (grub_uint64_t)i * map->block_size;
+        len = map->disk_size - virt;
+        if (len > map->block_size)
+        {
+            len = map->block_size;
+        }
+        len = (len + 2047) / 2048 * 2048;
+
+        if (map->block_offset[i] == 0)
+        {
+            /* the zero chunk sector follows the virtual disk address, so adjacent holes merge */
+            rc = ventoy_vdisk_add_chunk(&list, virt, VTOY_ZERO_CHUNK_SECTOR + virt / 512, len);
+            hole++;
+        }
+        else
+        {
+            rc = ventoy_vdisk_add_range(chunk_list, &list, virt, map->block_offset[i], len);
+        }
+
+        if (rc)
+        {
+            grub_free(list.chunk);
+            return 1;
+        }
+    }
+
+    debug("vdisk fmt:%d blocks:%u unallocated:%u file chunks:%u disk chunks:%u\n", map->fmt, 
+        map->block_num, hole, chunk_list->cur_chunk, list.cur_chunk);
+
+    grub_free(chunk_list->chunk);
+    grub_memcpy(chunk_list, &list, sizeof(list));
+    return 0;
+}
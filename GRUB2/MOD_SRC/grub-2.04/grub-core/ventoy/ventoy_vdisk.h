@@ -0,0 +1,192 @@
+/******************************************************************************
+ * ventoy_vdisk.h
+ *
+ * Copyright (c) 2021, longpanda <admin@ventoy.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __VENTOY_VDISK_H__
+#define __VENTOY_VDISK_H__
+
+/* 
+ * VHD/VHDX/VDI block map, kept apart from ventoy_vhd.c so that it
+ * can also be built on the host (see GRUB2/buildtest.sh)
+ */
+
+#pragma pack(1)
+
+typedef struct vhd_footer_t
+{
+    char             cookie[8];    // Cookie
+    grub_uint32_t    features;     // Features
+    grub_uint32_t    ffversion;    // File format version
+    grub_uint64_t    dataoffset;   // Data offset
+    grub_uint32_t    timestamp;    // Timestamp
+    grub_uint32_t    creatorapp;   // Creator application
+    grub_uint32_t    creatorver;   // Creator version
+    grub_uint32_t    creatorhos;   // Creator host OS
+    grub_uint64_t    origsize;     // Original size
+    grub_uint64_t    currsize;     // Current size
+    grub_uint32_t    diskgeom;     // Disk geometry
+    grub_uint32_t    disktype;     // Disk type
+    grub_uint32_t    checksum;     // Checksum
+    grub_uint8_t     uniqueid[16]; // Unique ID
+    grub_uint8_t     savedst;      // Saved state
+}vhd_footer_t;
+
+#define VHD_DISK_TYPE_FIXED    2
+#define VHD_DISK_TYPE_DYNAMIC  3
+#define VHD_DISK_TYPE_DIFF     4
+
+/* dynamic disk header, all the fields are big endian */
+typedef struct vhd_dyn_header_t
+{
+    char             cookie[8];       // "cxsparse"
+    grub_uint64_t    dataoffset;      // Data offset (unused)
+    grub_uint64_t    tableoffset;     // BAT offset
+    grub_uint32_t    headerversion;   // Header version
+    grub_uint32_t    maxtableentries; // Max BAT entries
+    grub_uint32_t    blocksize;       // Block size
+    grub_uint32_t    checksum;        // Checksum
+    grub_uint8_t     parentuuid[16];  // Parent unique ID
+}vhd_dyn_header_t;
+
+#define VHDX_HEADER1_OFFSET     (64 * 1024)
+#define VHDX_HEADER2_OFFSET     (128 * 1024)
+#define VHDX_REGION_OFFSET      (192 * 1024)
+#define VHDX_MAX_TABLE_ENTRY    2047
+
+#define VHDX_BAT_STATE_MASK     7
+#define VHDX_BAT_FULLY_PRESENT  6
+#define VHDX_BAT_PART_PRESENT   7
+#define VHDX_FILE_HAS_PARENT    2
+
+typedef struct vhdx_header_t
+{
+    char             signature[4];   // "head"
+    grub_uint32_t    checksum;
+    grub_uint64_t    seqnum;
+    grub_uint8_t     filewriteguid[16];
+    grub_uint8_t     datawriteguid[16];
+    grub_uint8_t     logguid[16];
+    grub_uint16_t    logversion;
+    grub_uint16_t    version;
+    grub_uint32_t    loglength;
+    grub_uint64_t    logoffset;
+}vhdx_header_t;
+
+typedef struct vhdx_region_head_t
+{
+    char             signature[4];   // "regi"
+    grub_uint32_t    checksum;
+    grub_uint32_t    entrycount;
+    grub_uint32_t    reserved;
+}vhdx_region_head_t;
+
+typedef struct vhdx_region_entry_t
+{
+    grub_uint8_t     guid[16];
+    grub_uint64_t    offset;
+    grub_uint32_t    length;
+    grub_uint32_t    required;
+}vhdx_region_entry_t;
+
+typedef struct vhdx_metadata_head_t
+{
+    char             signature[8];   // "metadata"
+    grub_uint16_t    reserved;
+    grub_uint16_t    entrycount;
+    grub_uint8_t     reserved2[20];
+}vhdx_metadata_head_t;
+
+typedef struct vhdx_metadata_entry_t
+{
+    grub_uint8_t     itemid[16];
+    grub_uint32_t    offset;         // relative to the metadata region
+    grub_uint32_t    length;
+    grub_uint32_t    flags;
+    grub_uint32_t    reserved;
+}vhdx_metadata_entry_t;
+
+#define VDI_IMAGE_FILE_INFO   "<<< Oracle VM VirtualBox Disk Image >>>\n"
+
+/** Image signature. */
+#define VDI_IMAGE_SIGNATURE   (0xbeda107f)
+
+typedef struct VDIPREHEADER
+{
+    /** Just text info about image type, for eyes only. */
+    char            szFileInfo[64];
+    /** The image signature (VDI_IMAGE_SIGNATURE). */
+    grub_uint32_t   u32Signature;
+    /** The image version (VDI_IMAGE_VERSION). */
+    grub_uint32_t   u32Version;
+} VDIPREHEADER, *PVDIPREHEADER;
+
+#define VDI_IMAGE_TYPE_NORMAL  1
+#define VDI_IMAGE_TYPE_FIXED   2
+
+#define VDI_IMAGE_BLOCK_FREE   ((grub_uint32_t)~0)
+#define VDI_IMAGE_BLOCK_ZERO   ((grub_uint32_t)~1)
+
+/* header of VDI version 1.1, just after the VDIPREHEADER */
+typedef struct VDIHEADER1PLUS
+{
+    grub_uint32_t   cbHeader;
+    grub_uint32_t   u32Type;
+    grub_uint32_t   fFlags;
+    char            szComment[256];
+    grub_uint32_t   offBlocks;
+    grub_uint32_t   offData;
+    grub_uint32_t   LegacyGeometry[4];
+    grub_uint32_t   u32Dummy;
+    grub_uint64_t   cbDisk;
+    grub_uint32_t   cbBlock;
+    grub_uint32_t   cbBlockExtra;
+    grub_uint32_t   cBlocks;
+    grub_uint32_t   cBlocksAllocated;
+} VDIHEADER1PLUS, *PVDIHEADER1PLUS;
+
+#pragma pack()
+
+#define VTOY_VDISK_FMT_NONE  0
+#define VTOY_VDISK_FMT_VHD   1
+#define VTOY_VDISK_FMT_VHDX  2
+#define VTOY_VDISK_FMT_VDI   3
+
+/* block map of a dynamic vdisk */
+typedef struct ventoy_vdisk_map
+{
+    int fmt;
+    grub_uint64_t disk_size;       /* virtual disk size in bytes */
+    grub_uint32_t block_size;
+    grub_uint32_t block_num;
+    grub_uint64_t *block_offset;   /* file offset of the block data, 0 for unallocated block */
+}ventoy_vdisk_map;
+
+/* 
+ * Only fully allocated dynamic vdisks are accepted, the parse fails if any
+ * block has no data in the file, because there is no storage for the OS to
+ * write that block.
+ */
+void ventoy_vdisk_map_free(ventoy_vdisk_map *map);
+int ventoy_vdisk_parse_vhd(grub_file_t file, vhd_footer_t *foot, ventoy_vdisk_map *map);
+int ventoy_vdisk_parse_vhdx(grub_file_t file, ventoy_vdisk_map *map);
+int ventoy_vdisk_parse_vdi(grub_file_t file, VDIHEADER1PLUS *hdr, ventoy_vdisk_map *map);
+int ventoy_vdisk_read(grub_file_t file, ventoy_vdisk_map *map, grub_uint64_t offset, void *buf, grub_uint32_t len);
+int ventoy_vdisk_compose_chunk(ventoy_vdisk_map *map, ventoy_img_chunk_list *chunk_list);
+
+#endif /* __VENTOY_VDISK_H__ */
@@ -41,6 +41,7 @@
 #endif
 #include <grub/ventoy.h>
 #include "ventoy_def.h"
+#include "ventoy_vdisk.h"
 
 GRUB_MOD_LICENSE ("GPLv3+");
 
@@ -48,6 +49,7 @@ static int g_vhdboot_isolen = 0;
 static char *g_vhdboot_totbuf = NULL;
 static char *g_vhdboot_isobuf = NULL;
 static grub_uint64_t g_img_trim_head_secnum = 0;
+static ventoy_vdisk_map g_vdisk_map;
 
 static int ventoy_vhd_find_bcd(int *bcdoffset, int *bcdlen, const char *path)
 {
@@ -495,12 +497,15 @@ grub_err_t ventoy_cmd_get_vtoy_type(grub_extcmd_context_t ctxt, int argc, char *
     grub_uint8_t data = 0;
     vhd_footer_t vhdfoot;
     VDIPREHEADER vdihdr;
+    VDIHEADER1PLUS vdihdr1;
     char type[16] = {0};
-    ventoy_gpt_info *gpt;
+    char magic[8] = {0};
+    ventoy_gpt_info *gpt = NULL;
     
     (void)ctxt;
 
     g_img_trim_head_secnum = 0;
+    ventoy_vdisk_map_free(&g_vdisk_map);
 
     if (argc != 4)
     {
@@ -519,21 +524,69 @@ grub_err_t ventoy_cmd_get_vtoy_type(grub_extcmd_context_t ctxt, int argc, char *
     grub_file_seek(file, file->size - 512);
     grub_file_read(file, &vhdfoot, sizeof(vhdfoot));
 
+    grub_file_seek(file, 0);
+    grub_file_read(file, magic, sizeof(magic));
+
     if (grub_strncmp(vhdfoot.cookie, "conectix", 8) == 0)
     {
         offset = 0;
-        grub_snprintf(type, sizeof(type), "vhd%u", grub_swap_bytes32(vhdfoot.disktype));
+        grub_snprintf(type, sizeof(type), "vhd%u", grub_be_to_cpu32(vhdfoot.disktype));
+
+        if (grub_be_to_cpu32(vhdfoot.disktype) == VHD_DISK_TYPE_DYNAMIC)
+        {
+            if (ventoy_vdisk_parse_vhd(file, &vhdfoot, &g_vdisk_map))
+            {
+                offset = -1;
+                grub_snprintf(type, sizeof(type), "unknown");
+            }
+        }
+        else if (grub_be_to_cpu32(vhdfoot.disktype) != VHD_DISK_TYPE_FIXED)
+        {
+            debug("vhd disk type %u is not supported\n", grub_be_to_cpu32(vhdfoot.disktype));
+            offset = -1;
+            grub_snprintf(type, sizeof(type), "unknown");
+        }
+    }
+    else if (grub_strncmp(magic, "vhdxfile", 8) == 0)
+    {
+        offset = 0;
+        grub_snprintf(type, sizeof(type), "vhdx");
+
+        if (ventoy_vdisk_parse_vhdx(file, &g_vdisk_map))
+        {
+            offset = -1;
+            grub_snprintf(type, sizeof(type), "unknown");
+        }
     }
     else
     {
         grub_file_seek(file, 0);
         grub_file_read(file, &vdihdr, sizeof(vdihdr));
+        grub_file_read(file, &vdihdr1, sizeof(vdihdr1));
         if (vdihdr.u32Signature == VDI_IMAGE_SIGNATURE &&
             grub_strncmp(vdihdr.szFileInfo, VDI_IMAGE_FILE_INFO, grub_strlen(VDI_IMAGE_FILE_INFO)) == 0)
         {
-            offset = 2 * 1048576;
-            g_img_trim_head_secnum = offset / 512;
             grub_snprintf(type, sizeof(type), "vdi");
+            
+            if (grub_le_to_cpu32(vdihdr1.u32Type) == VDI_IMAGE_TYPE_FIXED)
+            {
+                offset = 2 * 1048576;
+                if (vdihdr1.offData > 0 && (grub_le_to_cpu32(vdihdr1.offData) % 2048) == 0)
+                {
+                    offset = (int)grub_le_to_cpu32(vdihdr1.offData);
+                }
+                g_img_trim_head_secnum = offset / 512;
+            }
+            else if (grub_le_to_cpu32(vdihdr1.u32Type) == VDI_IMAGE_TYPE_NORMAL && 
+                     ventoy_vdisk_parse_vdi(file, &vdihdr1, &g_vdisk_map) == 0)
+            {
+                offset = 0;
+            }
+            else
+            {
+                debug("vdi image type %u is not supported\n", grub_le_to_cpu32(vdihdr1.u32Type));
+                grub_snprintf(type, sizeof(type), "unknown");
+            }
         }
         else
         {
@@ -554,8 +607,7 @@ grub_err_t ventoy_cmd_get_vtoy_type(grub_extcmd_context_t ctxt, int argc, char *
             goto end;
         }
     
-        grub_file_seek(file, offset);
-        grub_file_read(file, gpt, sizeof(ventoy_gpt_info));
+        ventoy_vdisk_read(file, &g_vdisk_map, offset, gpt, sizeof(ventoy_gpt_info));
 
         if (gpt->MBR.Byte55 != 0x55 || gpt->MBR.ByteAA != 0xAA)
         {
@@ -591,8 +643,7 @@ grub_err_t ventoy_cmd_get_vtoy_type(grub_extcmd_context_t ctxt, int argc, char *
             {
                 if (gpt->MBR.BootCode[92] == 0x22)
                 {
-                    grub_file_seek(file, offset + 17908);
-                    grub_file_read(file, &data, 1);
+                    ventoy_vdisk_read(file, &g_vdisk_map, offset + 17908, &data, 1);
                     if (data == 0x23)
                     {
                         altboot = 1;
@@ -667,6 +718,15 @@ grub_err_t ventoy_cmd_raw_chain_data(grub_extcmd_context_t ctxt, int argc, char
         return 1;
     }
 
+    if (g_vdisk_map.fmt != VTOY_VDISK_FMT_NONE && 
+        (file->device->disk->log_sector_size != 9 || ventoy_vdisk_compose_chunk(&g_vdisk_map, &g_img_chunk_list)))
+    {
+        grub_printf("Failed to build the chunk list of the dynamic vdisk\n");
+        ventoy_vdisk_map_free(&g_vdisk_map);
+        grub_file_close(file);
+        return 1;
+    }
+
     img_chunk_size = g_img_chunk_list.cur_chunk * sizeof(ventoy_img_chunk);
     
     size = sizeof(ventoy_chain_head) + img_chunk_size;
@@ -686,6 +746,7 @@ grub_err_t ventoy_cmd_raw_chain_data(grub_extcmd_context_t ctxt, int argc, char
     if (!chain)
     {
         grub_printf("Failed to alloc chain memory size %u\n", size);
+        ventoy_vdisk_map_free(&g_vdisk_map);
         grub_file_close(file);
         return 1;
     }
@@ -714,6 +775,10 @@ grub_err_t ventoy_cmd_raw_chain_data(grub_extcmd_context_t ctxt, int argc, char
     {
         chain->real_img_size_in_bytes -= g_img_trim_head_secnum * 512;
     }
+    else if (g_vdisk_map.fmt != VTOY_VDISK_FMT_NONE)
+    {
+        chain->real_img_size_in_bytes = g_vdisk_map.disk_size;
+    }
     
     chain->virt_img_size_in_bytes = chain->real_img_size_in_bytes;
     chain->boot_catalog = 0;
@@ -723,9 +788,10 @@ grub_err_t ventoy_cmd_raw_chain_data(grub_extcmd_context_t ctxt, int argc, char
     chain->img_chunk_num = g_img_chunk_list.cur_chunk;
     grub_memcpy((char *)chain + chain->img_chunk_offset, g_img_chunk_list.chunk, img_chunk_size);
 
-    grub_file_seek(file, g_img_trim_head_secnum * 512);
-    grub_file_read(file, chain->boot_catalog_sector, 512);
+    ventoy_vdisk_read(file, &g_vdisk_map, g_img_trim_head_secnum * 512, chain->boot_catalog_sector, 512);
 
+    /* the chunk list has been composed, don't do it again */
+    ventoy_vdisk_map_free(&g_vdisk_map);
     grub_file_close(file);
     
     VENTOY_CMD_RETURN(GRUB_ERR_NONE);
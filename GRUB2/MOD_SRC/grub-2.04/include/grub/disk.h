@@ -177,6 +177,28 @@ typedef struct grub_disk_memberlist *grub_disk_memberlist_t;
 /* This is called from the memory manager.  */
 void grub_disk_cache_invalidate_all (void);
 
+/* ventoy: statistics of the disk cache, always enabled.  */
+struct grub_disk_cache_stat
+{
+  unsigned long hits;
+  unsigned long lru_hits;
+  unsigned long misses;
+  unsigned long reads;
+  unsigned long read_sectors;
+  unsigned long lru_num;
+  unsigned long lru_used;
+};
+
+/* ventoy: entries evicted from grub_disk_cache_table are kept in a second
+   level LRU cache of KB kilobytes (0 to disable, the default).  */
+void EXPORT_FUNC(grub_disk_cache_set_lru_size) (unsigned long kb);
+/* Called by grub_disk_write for every sector it writes.  */
+void EXPORT_FUNC(grub_disk_cache_invalidate_lru) (unsigned long dev_id,
+						  unsigned long disk_id,
+						  grub_disk_addr_t sector);
+void EXPORT_FUNC(grub_disk_cache_get_stat) (struct grub_disk_cache_stat *stat);
+void EXPORT_FUNC(grub_disk_cache_reset_stat) (void);
+
 void EXPORT_FUNC(grub_disk_dev_register) (grub_disk_dev_t dev);
 void EXPORT_FUNC(grub_disk_dev_unregister) (grub_disk_dev_t dev);
 static inline int
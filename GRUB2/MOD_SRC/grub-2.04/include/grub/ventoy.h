@@ -208,6 +208,13 @@ typedef struct ventoy_img_chunk
     grub_uint64_t disk_end_sector;   // included
 }ventoy_img_chunk;
 
+/*
+ * A chunk whose disk sectors start from VTOY_ZERO_CHUNK_SECTOR has no storage
+ * (unallocated block of a dynamic vdisk). It reads as zero and can't be written.
+ */
+#define VTOY_ZERO_CHUNK_SECTOR    0x8000000000000000ULL
+#define VTOY_IS_ZERO_CHUNK(chunk) ((chunk)->disk_start_sector >= VTOY_ZERO_CHUNK_SECTOR)
+
 
 typedef struct ventoy_override_chunk
 {
@@ -237,6 +244,45 @@ typedef struct ventoy_img_chunk_list
 
 #pragma pack()
 
+/*
+ * vt_dump_chain output file format (little endian)
+ *
+ *   ventoy_chain_dump_head      512 bytes
+ *   chain memory                chain_size bytes, exactly as passed to the EFI/legacy driver
+ *     ventoy_chain_head                               at 0
+ *     ventoy_img_chunk      [img_chunk_num]           at img_chunk_offset
+ *     ventoy_override_chunk [override_chunk_num]      at override_chunk_offset
+ *     ventoy_virt_chunk     [virt_chunk_num]          at virt_chunk_offset
+ *     virt memory data                                at virt_chunk_offset + mem_sector_offset
+ *
+ * All the offsets in ventoy_chain_head are relative to the start of the chain memory.
+ * The rest of the dump file (if any) is filled with zero.
+ */
+#define VENTOY_CHAIN_DUMP_MAGIC     "VTCHDUMP"
+#define VENTOY_CHAIN_DUMP_VERSION   1
+
+#pragma pack(1)
+
+typedef struct ventoy_chain_dump_head
+{
+    char          magic[8];            /* VENTOY_CHAIN_DUMP_MAGIC */
+    grub_uint32_t version;             /* VENTOY_CHAIN_DUMP_VERSION */
+    grub_uint32_t head_size;           /* sizeof(ventoy_chain_dump_head) */
+    grub_uint32_t chain_type;          /* ventoy_chain_type */
+    grub_uint32_t chain_size;          /* chain memory size in bytes */
+    grub_uint32_t chain_crc32c;        /* crc32c of the chain memory */
+    grub_uint32_t chain_head_size;     /* sizeof(ventoy_chain_head) */
+    grub_uint32_t img_chunk_size;      /* sizeof(ventoy_img_chunk) */
+    grub_uint32_t override_chunk_size; /* sizeof(ventoy_override_chunk) */
+    grub_uint32_t virt_chunk_size;     /* sizeof(ventoy_virt_chunk) */
+    grub_uint32_t efi;                 /* 1: dumped in UEFI mode  0: legacy BIOS */
+    grub_uint8_t  reserved[464];
+}ventoy_chain_dump_head;
+
+#pragma pack()
+
+COMPILE_ASSERT(3,sizeof(ventoy_chain_dump_head) == 512);
+
 #define ventoy_filt_register grub_file_filter_register
 
 #pragma pack(1)
@@ -267,12 +313,27 @@ typedef struct ventoy_grub_param
 
 #pragma pack()
 
+typedef struct grub_iso9660_cache_stat
+{
+    grub_uint32_t lookup;   /* path lookups in open/dir */
+    grub_uint32_t hit;      /* served from the cache */
+    grub_uint32_t neg_hit;  /* cached "not found" */
+    grub_uint32_t miss;     /* real lookups */
+    grub_uint32_t walk;     /* directory iterations */
+    grub_uint32_t flush;
+    grub_uint32_t entries;  /* current cache entries */
+}grub_iso9660_cache_stat;
+
 int grub_ext_get_file_chunk(grub_uint64_t part_start, grub_file_t file, ventoy_img_chunk_list *chunk_list);
 int grub_fat_get_file_chunk(grub_uint64_t part_start, grub_file_t file, ventoy_img_chunk_list *chunk_list);
 void grub_iso9660_set_nojoliet(int nojoliet);
 int grub_iso9660_is_joliet(void);
 grub_uint64_t grub_iso9660_get_last_read_pos(grub_file_t file);
 grub_uint64_t grub_iso9660_get_last_file_dirent_pos(grub_file_t file);
+grub_uint64_t grub_iso9660_get_file_extent(grub_file_t file, grub_uint64_t *dirent_pos);
+void grub_iso9660_get_cache_stat(grub_iso9660_cache_stat *stat);
+void grub_iso9660_reset_cache_stat(void);
+int grub_udf_get_file_chunk(grub_uint64_t part_start, grub_file_t file, ventoy_img_chunk_list *chunk_list);
 grub_uint64_t grub_udf_get_file_offset(grub_file_t file);
 grub_uint64_t grub_udf_get_last_pd_size_offset(void);
 grub_uint64_t grub_udf_get_last_file_attr_offset
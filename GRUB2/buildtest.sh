@@ -0,0 +1,78 @@
+#!/bin/bash
+
+# Host tests for the grub module sources that don't depend on grub itself.
+# Every <grub/xxx.h> they include is mapped to test/grub_host.h, except
+# <grub/ventoy.h> which only needs the grub types.
+
+VT_GRUB_DIR=$PWD
+VT_MOD_DIR=$VT_GRUB_DIR/MOD_SRC/grub-2.04/grub-core/ventoy
+VT_INC_DIR=$VT_GRUB_DIR/MOD_SRC/grub-2.04/include
+
+TMP_DIR=$(mktemp -d)
+mkdir -p $TMP_DIR/grub
+
+for h in $(grep -ho '<grub/[a-z0-9_]*\.h>' $VT_MOD_DIR/miniz.c $VT_MOD_DIR/ventoy_gzip.c $VT_MOD_DIR/ventoy_vdisk.c | sort -u | sed 's/[<>]//g'); do
+    [ "$h" = "grub/ventoy.h" ] && continue
+    echo '#include <grub_host.h>' > $TMP_DIR/$h
+done
+
+XXFLAG="-O2 -Wno-unused-function -I$TMP_DIR -I$VT_GRUB_DIR/test -I$VT_MOD_DIR -I$VT_INC_DIR"
+
+# miniz is third party code, don't care about its warnings
+gcc $XXFLAG -w -c $VT_MOD_DIR/miniz.c -o $TMP_DIR/miniz.o || { rm -rf $TMP_DIR; exit 1; }
+
+gcc $XXFLAG -Wall \
+    $VT_GRUB_DIR/test/ventoy_gzip_test.c $VT_MOD_DIR/ventoy_gzip.c $TMP_DIR/miniz.o \
+    -o $TMP_DIR/ventoy_gzip_test || { rm -rf $TMP_DIR; exit 1; }
+
+gcc $XXFLAG -Wall \
+    $VT_GRUB_DIR/test/ventoy_vdisk_test.c $VT_MOD_DIR/ventoy_vdisk.c \
+    -o $TMP_DIR/ventoy_vdisk_test || { rm -rf $TMP_DIR; exit 1; }
+
+# kern/disk.c and lib/disk.c with the real grub/disk.h, the other headers are
+# mapped to test/disk_host.h, disk_common.c comes with the grub tarball
+VT_CORE_DIR=$VT_GRUB_DIR/MOD_SRC/grub-2.04/grub-core
+DISK_DIR=$TMP_DIR/disk
+mkdir -p $DISK_DIR/inc/grub $DISK_DIR/kern
+cp $VT_GRUB_DIR/test/disk_common.c $DISK_DIR/kern/
+echo '#include <disk_host.h>' > $DISK_DIR/inc/config.h
+for h in $(grep -ho '<grub/[a-z0-9_]*\.h>' $VT_CORE_DIR/kern/disk.c $VT_CORE_DIR/lib/disk.c $VT_INC_DIR/grub/disk.h | sort -u | sed 's/[<>]//g'); do
+    [ "$h" = "grub/ventoy.h" -o "$h" = "grub/disk.h" ] && continue
+    echo '#include <disk_host.h>' > $DISK_DIR/inc/$h
+done
+
+gcc -O2 -Wall -Wno-unused-function -I$DISK_DIR/inc -I$DISK_DIR/kern -I$VT_GRUB_DIR/test -I$VT_INC_DIR \
+    $VT_GRUB_DIR/test/ventoy_disk_cache_test.c $VT_CORE_DIR/kern/disk.c $VT_CORE_DIR/lib/disk.c \
+    -o $TMP_DIR/ventoy_disk_cache_test || { rm -rf $TMP_DIR; exit 1; }
+
+$TMP_DIR/ventoy_gzip_test
+rc=$?
+
+$TMP_DIR/ventoy_disk_cache_test || rc=1
+
+# compare the dynamic vdisk block map with qemu-img
+if which qemu-img >/dev/null 2>&1; then
+    RAW=$TMP_DIR/raw.img
+
+    # 61MB + 1KB random data with zero holes, the size is not a multiple of any block size
+    dd if=/dev/zero of=$RAW bs=1k count=62465 status=none
+    dd if=/dev/urandom of=$RAW bs=1M count=5 conv=notrunc status=none
+    dd if=/dev/urandom of=$RAW bs=1M seek=23 count=9 conv=notrunc status=none
+    dd if=/dev/urandom of=$RAW bs=1k seek=60417 count=2048 conv=notrunc status=none
+
+    for fmt in "vpc -o subformat=dynamic,force_size=on" "vhdx -o subformat=dynamic,block_size=1M" "vdi -o static=off"; do
+        name=${fmt%% *}
+
+        # -S 0 writes every block, the default skips the zero blocks
+        qemu-img convert -q -f raw -O $fmt -S 0 $RAW $TMP_DIR/full.$name && \
+            $TMP_DIR/ventoy_vdisk_test $RAW $TMP_DIR/full.$name full || rc=1
+
+        qemu-img convert -q -f raw -O $fmt $RAW $TMP_DIR/sparse.$name && \
+            $TMP_DIR/ventoy_vdisk_test $RAW $TMP_DIR/sparse.$name sparse || rc=1
+    done
+else
+    echo "qemu-img not found, skip the vdisk test"
+fi
+
+rm -rf $TMP_DIR
+exit $rc
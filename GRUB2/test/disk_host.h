@@ -0,0 +1,80 @@
+/******************************************************************************
+ * disk_host.h  ---- grub shim to build kern/disk.c and lib/disk.c on the host
+ *
+ * Copyright (c) 2021, longpanda <admin@ventoy.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#ifndef __DISK_HOST_H__
+#define __DISK_HOST_H__
+
+#include <grub_host.h>
+
+#define EXPORT_FUNC(x) x
+#define EXPORT_VAR(x)  x
+
+#define N_(str) str
+
+typedef grub_uint64_t grub_disk_addr_t;
+
+typedef enum
+{
+    GRUB_ERR_NONE = 0,
+    GRUB_ERR_OUT_OF_MEMORY,
+    GRUB_ERR_OUT_OF_RANGE,
+    GRUB_ERR_READ_ERROR,
+    GRUB_ERR_WRITE_ERROR,
+    GRUB_ERR_UNKNOWN_DEVICE,
+    GRUB_ERR_NOT_IMPLEMENTED_YET,
+}grub_err_t;
+
+extern grub_err_t grub_errno;
+extern char grub_errmsg[256];
+
+grub_err_t grub_error(grub_err_t n, const char *fmt, ...);
+
+static inline void grub_error_push(void) {}
+static inline void grub_error_pop(void) {}
+
+#define grub_dprintf(condition, fmt, args...)
+
+static inline char * grub_strdup(const char *s) { return strdup(s); }
+
+/* the disk cache timeout never expires */
+static inline grub_uint64_t grub_get_time_ms(void) { return 0; }
+
+/* the test disks have no partition */
+struct grub_partition
+{
+    grub_disk_addr_t start;
+    grub_uint64_t len;
+    struct grub_partition *parent;
+};
+typedef struct grub_partition *grub_partition_t;
+
+static inline grub_partition_t grub_partition_probe(void *disk, const char *str)
+{
+    (void)disk;
+    (void)str;
+    return NULL;
+}
+
+static inline grub_uint64_t grub_partition_get_len(const grub_partition_t p) { return p->len; }
+static inline grub_disk_addr_t grub_partition_get_start(const grub_partition_t p) { return p->start; }
+
+#define GRUB_MOD_INIT(name) void grub_mod_init_##name(void)
+#define GRUB_MOD_FINI(name) void grub_mod_fini_##name(void)
+
+#endif /* __DISK_HOST_H__ */
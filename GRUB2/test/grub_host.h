@@ -0,0 +1,87 @@
+/******************************************************************************
+ * grub_host.h  ---- minimal grub shim to build some ventoy module files on the host
+ *
+ * Copyright (c) 2021, longpanda <admin@ventoy.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#ifndef __GRUB_HOST_H__
+#define __GRUB_HOST_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+
+typedef uint8_t  grub_uint8_t;
+typedef uint16_t grub_uint16_t;
+typedef uint32_t grub_uint32_t;
+typedef uint64_t grub_uint64_t;
+typedef size_t   grub_size_t;
+typedef ssize_t  grub_ssize_t;
+typedef uint64_t grub_off_t;
+
+/* functions, not macros: miniz maps memset/memcpy/memcmp back to grub_xxx */
+static inline void * grub_memset(void *s, int c, grub_size_t n) { return memset(s, c, n); }
+static inline void * grub_memcpy(void *d, const void *s, grub_size_t n) { return memcpy(d, s, n); }
+static inline int grub_memcmp(const void *s1, const void *s2, grub_size_t n) { return memcmp(s1, s2, n); }
+static inline void * grub_malloc(grub_size_t size) { return malloc(size); }
+static inline void * grub_zalloc(grub_size_t size) { return calloc(1, size); }
+static inline void * grub_realloc(void *ptr, grub_size_t size) { return realloc(ptr, size); }
+static inline void grub_free(void *ptr) { free(ptr); }
+
+static inline int grub_strncmp(const char *s1, const char *s2, grub_size_t n) { return strncmp(s1, s2, n); }
+static inline grub_size_t grub_strlen(const char *s) { return strlen(s); }
+
+/* the host is little endian */
+#define grub_le_to_cpu16(x) ((grub_uint16_t)(x))
+#define grub_le_to_cpu32(x) ((grub_uint32_t)(x))
+#define grub_le_to_cpu64(x) ((grub_uint64_t)(x))
+#define grub_be_to_cpu32(x) __builtin_bswap32(x)
+#define grub_be_to_cpu64(x) __builtin_bswap64(x)
+
+/* a grub file is a host file descriptor */
+struct grub_file
+{
+    int fd;
+    grub_off_t offset;
+    grub_off_t size;
+};
+typedef struct grub_file *grub_file_t;
+
+static inline grub_off_t grub_file_seek(grub_file_t file, grub_off_t offset)
+{
+    grub_off_t old = file->offset;
+
+    file->offset = offset;
+    return old;
+}
+
+static inline grub_ssize_t grub_file_read(grub_file_t file, void *buf, grub_size_t len)
+{
+    grub_ssize_t ret = pread(file->fd, buf, len, (off_t)file->offset);
+
+    if (ret > 0)
+    {
+        file->offset += ret;
+    }
+    return ret;
+}
+
+#define GRUB_MOD_LICENSE(license)
+
+#endif /* __GRUB_HOST_H__ */
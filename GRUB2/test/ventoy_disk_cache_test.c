@@ -0,0 +1,242 @@
+/******************************************************************************
+ * ventoy_disk_cache_test.c  ---- host test for the LRU level of the grub disk cache
+ *
+ * Copyright (c) 2021, longpanda <admin@ventoy.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Linked with kern/disk.c and lib/disk.c. The disk is generated: every 512 sector
+ * holds its own number and a generation, grub_disk_write sets the generation.
+ * So a stale cache entry shows up as an old generation.
+ */
+#include <stdarg.h>
+#include <disk_host.h>
+#include <grub/disk.h>
+
+/* cache blocks with the same index in grub_disk_cache_table */
+#define TEST_CONFLICT      ((grub_disk_addr_t)GRUB_DISK_CACHE_NUM * GRUB_DISK_CACHE_SIZE)
+#define TEST_DISK_SECS     (TEST_CONFLICT * 4)
+#define TEST_SET_BLOCKS    32
+#define TEST_PASSES        20
+
+void grub_mod_init_disk(void);
+
+grub_err_t grub_errno = GRUB_ERR_NONE;
+char grub_errmsg[256];
+
+static int g_fail = 0;
+static grub_uint8_t *g_gen = NULL;
+static unsigned long g_dev_reads = 0;
+static unsigned long g_dev_read_secs = 0;
+
+#define CHECK(cond, fmt, args...) \
+    if (!(cond)) { printf("FAIL %s:%d " fmt "\n", __func__, __LINE__, ##args); g_fail++; }
+
+grub_err_t grub_error(grub_err_t n, const char *fmt, ...)
+{
+    va_list ap;
+
+    va_start(ap, fmt);
+    vsnprintf(grub_errmsg, sizeof(grub_errmsg), fmt, ap);
+    va_end(ap);
+
+    grub_errno = n;
+    return n;
+}
+
+static grub_err_t test_disk_open(const char *name, struct grub_disk *disk)
+{
+    (void)name;
+
+    disk->total_sectors = TEST_DISK_SECS;
+    disk->id = 1;
+    return GRUB_ERR_NONE;
+}
+
+static grub_err_t test_disk_read(struct grub_disk *disk, grub_disk_addr_t sector, grub_size_t size, char *buf)
+{
+    grub_size_t i;
+    grub_uint64_t *data;
+
+    (void)disk;
+
+    g_dev_reads++;
+    g_dev_read_secs += size;
+
+    for (i = 0; i < size; i++)
+    {
+        data = (grub_uint64_t *)(buf + i * 512);
+        data[0] = sector + i;
+        data[1] = g_gen[sector + i];
+    }
+    return GRUB_ERR_NONE;
+}
+
+static grub_err_t test_disk_write(struct grub_disk *disk, grub_disk_addr_t sector, grub_size_t size, const char *buf)
+{
+    grub_size_t i;
+
+    (void)disk;
+
+    for (i = 0; i < size; i++)
+    {
+        g_gen[sector + i] = (grub_uint8_t)((const grub_uint64_t *)(buf + i * 512))[1];
+    }
+    return GRUB_ERR_NONE;
+}
+
+static struct grub_disk_dev g_test_dev =
+{
+    .name = "test",
+    .id = GRUB_DISK_DEVICE_MEMDISK_ID,
+    .disk_open = test_disk_open,
+    .disk_read = test_disk_read,
+    .disk_write = test_disk_write,
+};
+
+/* read one 2048 sector, return its generation */
+static grub_uint64_t read_gen(grub_disk_t disk, grub_disk_addr_t sector)
+{
+    grub_uint64_t buf[256];
+
+    CHECK(grub_disk_read(disk, sector, 0, sizeof(buf), buf) == GRUB_ERR_NONE, "read %llu",
+          (unsigned long long)sector);
+    CHECK(buf[0] == sector, "sector %llu returned %llu", (unsigned long long)sector, (unsigned long long)buf[0]);
+    return buf[1];
+}
+
+static void write_gen(grub_disk_t disk, grub_disk_addr_t sector, grub_size_t secs, grub_uint64_t gen)
+{
+    grub_size_t i;
+    grub_uint64_t *buf = calloc(secs, 512);
+
+    for (i = 0; i < secs; i++)
+    {
+        buf[i * 64] = sector + i;
+        buf[i * 64 + 1] = gen;
+    }
+    CHECK(grub_disk_write_weak(disk, sector, 0, secs * 512, buf) == GRUB_ERR_NONE, "write %llu",
+          (unsigned long long)sector);
+    free(buf);
+}
+
+/* a sector written after its cache block was moved to the LRU level must not be read stale */
+static void test_write_invalidate(grub_disk_t disk)
+{
+    grub_uint64_t gen;
+    grub_disk_addr_t sec = 8 * GRUB_DISK_CACHE_SIZE;
+
+    grub_disk_cache_set_lru_size(8192);
+
+    CHECK(read_gen(disk, sec) == 0, "first read");
+    CHECK(read_gen(disk, sec + TEST_CONFLICT) == 0, "conflict read");
+
+    /* the first block is in the LRU level now */
+    write_gen(disk, sec, 4, 1);
+    CHECK(read_gen(disk, sec) == 1, "stale data after a single write");
+
+    /* same for the multi sector write path */
+    CHECK(read_gen(disk, sec + TEST_CONFLICT) == 0, "conflict read 2");
+    write_gen(disk, sec, GRUB_DISK_CACHE_SIZE * 2, 2);
+    CHECK(read_gen(disk, sec) == 2, "stale data after a multi block write");
+    CHECK(read_gen(disk, sec + GRUB_DISK_CACHE_SIZE) == 2, "stale data in the second block");
+
+    /* a partial sector write, only the generation field */
+    CHECK(read_gen(disk, sec + TEST_CONFLICT) == 0, "conflict read 3");
+    gen = 3;
+    CHECK(grub_disk_write_weak(disk, sec, 8, sizeof(gen), &gen) == GRUB_ERR_NONE, "partial write");
+    CHECK(read_gen(disk, sec) == 3, "stale data after a partial sector write");
+
+    grub_disk_cache_set_lru_size(0);
+}
+
+/*
+ * Three sets of cache blocks that have the same indexes in grub_disk_cache_table,
+ * read one after another, as the directory scan, the iso9660 lookup and the chunk
+ * list check do. Return the device sectors read.
+ */
+static unsigned long read_conflict_sets(grub_disk_t disk, unsigned long kb)
+{
+    int pass;
+    int set;
+    int blk;
+    struct grub_disk_cache_stat stat;
+
+    grub_disk_cache_invalidate_all();
+    grub_disk_cache_set_lru_size(kb);
+    grub_disk_cache_reset_stat();
+    g_dev_reads = g_dev_read_secs = 0;
+
+    for (pass = 0; pass < TEST_PASSES; pass++)
+    {
+        for (set = 0; set < 3; set++)
+        {
+            for (blk = 0; blk < TEST_SET_BLOCKS; blk++)
+            {
+                read_gen(disk, TEST_CONFLICT * set + (grub_disk_addr_t)blk * GRUB_DISK_CACHE_SIZE);
+            }
+        }
+    }
+
+    grub_disk_cache_get_stat(&stat);
+    printf("LRU %5luKB: device reads:%lu sectors:%lu hit:%lu lru_hit:%lu miss:%lu\n", kb,
+           g_dev_reads, g_dev_read_secs, stat.hits, stat.lru_hits, stat.misses);
+
+    CHECK(stat.reads == g_dev_reads && stat.read_sectors == g_dev_read_secs, "stat %lu %lu",
+          stat.reads, stat.read_sectors);
+    CHECK(stat.misses == g_dev_reads, "misses %lu", stat.misses);
+
+    grub_disk_cache_set_lru_size(0);
+    return g_dev_read_secs;
+}
+
+static void test_read_count(grub_disk_t disk)
+{
+    unsigned long before;
+    unsigned long after;
+
+    before = read_conflict_sets(disk, 0);
+    after = read_conflict_sets(disk, 8192);
+
+    CHECK(before == (unsigned long)TEST_PASSES * 3 * TEST_SET_BLOCKS * GRUB_DISK_CACHE_SIZE, "before %lu", before);
+    CHECK(after == 3UL * TEST_SET_BLOCKS * GRUB_DISK_CACHE_SIZE, "after %lu", after);
+}
+
+int main(void)
+{
+    grub_disk_t disk;
+
+    g_gen = calloc(1, TEST_DISK_SECS);
+    grub_mod_init_disk();
+    grub_disk_dev_register(&g_test_dev);
+
+    disk = grub_disk_open("test");
+    if (!disk)
+    {
+        printf("failed to open the test disk\n");
+        return 1;
+    }
+
+    test_write_invalidate(disk);
+    test_read_count(disk);
+
+    grub_disk_close(disk);
+    free(g_gen);
+
+    printf("%s\n", g_fail ? "disk cache test FAILED" : "disk cache test passed");
+    return g_fail ? 1 : 0;
+}
@@ -0,0 +1,227 @@
+/******************************************************************************
+ * ventoy_gzip_test.c  ---- host round-trip test for ventoy_gzip.c and mz_crc32
+ *
+ * Copyright (c) 2021, longpanda <admin@ventoy.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Build and run with GRUB2/buildtest.sh
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <string.h>
+#include "miniz.h"
+#include "ventoy_gzip.h"
+
+int g_ventoy_debug = 0;
+static int g_fail = 0;
+
+void ventoy_debug(const char *fmt, ...)
+{
+    va_list ap;
+
+    va_start(ap, fmt);
+    vprintf(fmt, ap);
+    va_end(ap);
+}
+
+#define CHECK(cond, fmt, args...) \
+    if (!(cond)) { printf("FAIL %s:%d " fmt "\n", __func__, __LINE__, ##args); g_fail++; }
+
+/* bitwise IEEE CRC32 as the reference */
+static uint32_t ref_crc32(uint32_t crc, const uint8_t *buf, size_t len)
+{
+    int k;
+
+    crc = ~crc;
+    while (len--)
+    {
+        crc ^= *buf++;
+        for (k = 0; k < 8; k++)
+        {
+            crc = (crc & 1) ? ((crc >> 1) ^ 0xEDB88320) : (crc >> 1);
+        }
+    }
+    return ~crc;
+}
+
+static uint32_t get_u32(const uint8_t *buf)
+{
+    return buf[0] | (buf[1] << 8) | (buf[2] << 16) | ((uint32_t)buf[3] << 24);
+}
+
+/* check the gzip header and trailer and inflate the data back */
+static int check_gzip(const char *name, const uint8_t *gz, int gzlen, const uint8_t *data, int len)
+{
+    int ret;
+    mz_stream s;
+    uint8_t *out = NULL;
+
+    if (gzlen < 18 || gz[0] != 0x1F || gz[1] != 0x8B || gz[2] != 8)
+    {
+        printf("FAIL %s bad gzip header len:%d\n", name, gzlen);
+        return 1;
+    }
+
+    if (get_u32(gz + gzlen - 8) != ref_crc32(0, data, len) || get_u32(gz + gzlen - 4) != (uint32_t)len)
+    {
+        printf("FAIL %s bad gzip trailer crc:%08x isize:%u\n", name, get_u32(gz + gzlen - 8), get_u32(gz + gzlen - 4));
+        return 1;
+    }
+
+    out = malloc(len + 1);
+    memset(&s, 0, sizeof(s));
+    mz_inflateInit2(&s, -MZ_DEFAULT_WINDOW_BITS);
+    s.next_in = gz + 10;
+    s.avail_in = gzlen - 18;
+    s.next_out = out;
+    s.avail_out = len + 1;
+    ret = mz_inflate(&s, MZ_FINISH);
+    mz_inflateEnd(&s);
+
+    if (ret != MZ_STREAM_END || (int)s.total_out != len || memcmp(out, data, len) || s.avail_in != 0)
+    {
+        printf("FAIL %s inflate ret:%d out:%lu/%d left:%u\n", name, ret, (unsigned long)s.total_out, len, s.avail_in);
+        free(out);
+        return 1;
+    }
+
+    free(out);
+    return 0;
+}
+
+static void test_crc32(const uint8_t *data, int len)
+{
+    int i;
+    mz_ulong crc = MZ_CRC32_INIT;
+
+    CHECK(mz_crc32(MZ_CRC32_INIT, (const uint8_t *)"123456789", 9) == 0xCBF43926, "crc32 check value");
+    CHECK(mz_crc32(MZ_CRC32_INIT, NULL, 0) == MZ_CRC32_INIT, "crc32 of nothing");
+
+    /* the chained crc has high bits set, that is what leaked on LP64 */
+    for (i = 0; i < len; i += 4099)
+    {
+        crc = mz_crc32(crc, data + i, (len - i > 4099) ? 4099 : (len - i));
+        CHECK(crc <= 0xFFFFFFFFUL, "crc32 out of 32 bit %lx", (unsigned long)crc);
+    }
+    CHECK(crc == ref_crc32(0, data, len), "crc32 chained %lx", (unsigned long)crc);
+    CHECK(mz_crc32(MZ_CRC32_INIT, data, len) == ref_crc32(0, data, len), "crc32 whole");
+}
+
+static void test_compress(const char *name, uint8_t *data, int len)
+{
+    int level;
+    int gzlen;
+    int bound = ventoy_gzip_bound(len);
+    uint8_t *gz = malloc(bound);
+    char desc[128];
+
+    for (level = VTOY_GZIP_LEVEL_STORED; level <= 9; level++)
+    {
+        snprintf(desc, sizeof(desc), "%s level %d", name, level);
+        gzlen = ventoy_gzip_compress_level(data, len, gz, bound, level);
+        CHECK(gzlen > 0 && gzlen <= bound, "%s gzlen:%d bound:%d", desc, gzlen, bound);
+        if (gzlen > 0)
+        {
+            g_fail += check_gzip(desc, gz, gzlen, data, len);
+        }
+    }
+
+    gzlen = ventoy_gzip_compress(data, len, gz, bound);
+    g_fail += (gzlen > 0) ? check_gzip(name, gz, gzlen, data, len) : 1;
+
+    free(gz);
+}
+
+static void test_stream(const char *name, uint8_t *data, int len, int step)
+{
+    int pos;
+    int cur;
+    int ret;
+    int total = 0;
+    int gzmax = (len / step + 1) * ventoy_gzip_bound(step);
+    uint8_t *gz = malloc(gzmax);
+    ventoy_gzip_stream *stream = NULL;
+
+    stream = ventoy_gzip_stream_open(VTOY_GZIP_LEVEL_DEFAULT);
+    CHECK(stream, "%s stream open", name);
+    if (!stream)
+    {
+        free(gz);
+        return;
+    }
+
+    pos = 0;
+    do
+    {
+        /* every write needs ventoy_gzip_bound(cur) output space */
+        cur = (len - pos > step) ? step : (len - pos);
+        CHECK(gzmax - total >= ventoy_gzip_bound(cur), "%s no space at %d", name, pos);
+        ret = ventoy_gzip_stream_write(stream, data + pos, cur, gz + total, gzmax - total, pos + cur >= len);
+        CHECK(ret >= 0, "%s stream write at %d ret:%d total:%d left:%d", name, pos, ret, total, gzmax - total);
+        if (ret < 0)
+        {
+            break;
+        }
+        total += ret;
+        pos += cur;
+    } while (pos < len);
+
+    ventoy_gzip_stream_close(stream);
+
+    if (ret >= 0)
+    {
+        g_fail += check_gzip(name, gz, total, data, len);
+    }
+    free(gz);
+}
+
+int main(void)
+{
+    int i;
+    int len = 1024 * 1024 + 12345;
+    uint8_t *rnd = malloc(len);
+    uint8_t *txt = malloc(len);
+    uint8_t *small = malloc(100);
+
+    srand(1);
+    for (i = 0; i < len; i++)
+    {
+        rnd[i] = (uint8_t)rand();
+        txt[i] = (uint8_t)("ventoy gzip test "[i % 17] + (i / 4096) % 3);
+    }
+
+    test_crc32(rnd, len);
+
+    test_compress("empty", txt, 0);
+    test_compress("random", rnd, len);
+    test_compress("text", txt, len);
+
+    /* incompressible data doesn't fit in less than the bound */
+    CHECK(ventoy_gzip_compress_level(rnd, len, small, 100, 1) == -1, "small output buffer");
+
+    test_stream("stream text", txt, len, 65536);
+    test_stream("stream random", rnd, len, 100000);
+    test_stream("stream odd", txt, len, 777);
+    test_stream("stream empty", txt, 0, 1);
+
+    free(rnd);
+    free(txt);
+    free(small);
+
+    printf("%s\n", g_fail ? "gzip test FAILED" : "gzip test passed");
+    return g_fail ? 1 : 0;
+}
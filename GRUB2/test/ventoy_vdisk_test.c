@@ -0,0 +1,262 @@
+/******************************************************************************
+ * ventoy_vdisk_test.c  ---- host test for the dynamic vdisk block map in ventoy_vdisk.c
+ *
+ * Copyright (c) 2021, longpanda <admin@ventoy.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Usage: ventoy_vdisk_test raw.img image full|sparse
+ *
+ * image is made from raw.img by qemu-img (see GRUB2/buildtest.sh).
+ * full:   every block is allocated
+ * sparse: the zero blocks of raw.img are unallocated
+ * The virtual disk read through the block map and through the composed chunk
+ * list must be the same as raw.img, the unallocated blocks read as zero.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <grub_host.h>
+#include <grub/ventoy.h>
+#include "ventoy_vdisk.h"
+
+int g_ventoy_debug = 0;
+static int g_fail = 0;
+
+void ventoy_debug(const char *fmt, ...)
+{
+    va_list ap;
+
+    va_start(ap, fmt);
+    vprintf(fmt, ap);
+    va_end(ap);
+}
+
+#define CHECK(cond, fmt, args...) \
+    if (!(cond)) { printf("FAIL %s:%d " fmt "\n", __func__, __LINE__, ##args); g_fail++; }
+
+static int parse_image(grub_file_t file, ventoy_vdisk_map *map)
+{
+    char magic[8];
+    vhd_footer_t foot;
+    VDIPREHEADER vdihdr;
+    VDIHEADER1PLUS vdihdr1;
+
+    grub_file_seek(file, file->size - 512);
+    grub_file_read(file, &foot, sizeof(foot));
+    grub_file_seek(file, 0);
+    grub_file_read(file, magic, sizeof(magic));
+
+    if (memcmp(foot.cookie, "conectix", 8) == 0)
+    {
+        if (grub_be_to_cpu32(foot.disktype) != VHD_DISK_TYPE_DYNAMIC)
+        {
+            printf("vhd disk type %u is not dynamic\n", grub_be_to_cpu32(foot.disktype));
+            return -1;
+        }
+        return ventoy_vdisk_parse_vhd(file, &foot, map);
+    }
+    else if (memcmp(magic, "vhdxfile", 8) == 0)
+    {
+        return ventoy_vdisk_parse_vhdx(file, map);
+    }
+
+    grub_file_seek(file, 0);
+    grub_file_read(file, &vdihdr, sizeof(vdihdr));
+    grub_file_read(file, &vdihdr1, sizeof(vdihdr1));
+    if (vdihdr.u32Signature == VDI_IMAGE_SIGNATURE && vdihdr1.u32Type == VDI_IMAGE_TYPE_NORMAL)
+    {
+        return ventoy_vdisk_parse_vdi(file, &vdihdr1, map);
+    }
+
+    printf("unknown image format\n");
+    return -1;
+}
+
+/* the vdisk file as one fragment, or split every fragsec 2KB sectors, at disk sector = file offset / 512 */
+static void make_file_chunk(ventoy_img_chunk_list *list, grub_off_t size, grub_uint32_t fragsec)
+{
+    grub_uint32_t sector;
+    grub_uint32_t total = (grub_uint32_t)((size + 2047) / 2048);
+    ventoy_img_chunk *chunk;
+
+    list->max_chunk = total / fragsec + 1;
+    list->cur_chunk = 0;
+    list->chunk = calloc(list->max_chunk, sizeof(ventoy_img_chunk));
+
+    for (sector = 0; sector < total; sector += fragsec)
+    {
+        chunk = list->chunk + list->cur_chunk++;
+        chunk->img_start_sector = sector;
+        chunk->img_end_sector = ((total - sector > fragsec) ? sector + fragsec : total) - 1;
+        chunk->disk_start_sector = (grub_uint64_t)sector * 4;
+        chunk->disk_end_sector = (grub_uint64_t)chunk->img_end_sector * 4 + 3;
+    }
+}
+
+static void test_map_read(grub_file_t file, ventoy_vdisk_map *map, const uint8_t *raw)
+{
+    grub_uint64_t pos;
+    grub_uint32_t len;
+    grub_uint32_t step = 1024 * 1024 - 512;
+    uint8_t *buf = malloc(step);
+
+    /* the step is not a multiple of the block size, so the reads cross the blocks */
+    for (pos = 0; pos < map->disk_size; pos += len)
+    {
+        len = (map->disk_size - pos > step) ? step : (grub_uint32_t)(map->disk_size - pos);
+        if (ventoy_vdisk_read(file, map, pos, buf, len) || memcmp(buf, raw + pos, len))
+        {
+            CHECK(0, "vdisk read differs at %llu len %u", (unsigned long long)pos, len);
+            break;
+        }
+    }
+
+    CHECK(ventoy_vdisk_read(file, map, map->disk_size, buf, 512) != 0, "read past the vdisk end");
+    free(buf);
+}
+
+static void test_compose(grub_file_t file, ventoy_vdisk_map *map, const uint8_t *raw, grub_uint32_t fragsec)
+{
+    grub_uint32_t i;
+    grub_uint32_t next = 0;
+    grub_uint32_t zero = 0;
+    grub_uint32_t filechunk;
+    grub_uint64_t len;
+    grub_uint64_t pos;
+    grub_uint32_t total = (grub_uint32_t)((map->disk_size + 2047) / 2048);
+    ventoy_img_chunk *chunk;
+    ventoy_img_chunk_list list;
+    uint8_t *buf = NULL;
+
+    make_file_chunk(&list, file->size, fragsec);
+    filechunk = list.cur_chunk;
+    if (ventoy_vdisk_compose_chunk(map, &list))
+    {
+        /* block data that is not 2KB aligned may cross a fragment, that is rejected */
+        CHECK(fragsec != 0xFFFFFFFF, "compose the whole file fmt:%d", map->fmt);
+        printf("  fragment %u: vdisk blocks are not aligned with the fragments, rejected\n", fragsec);
+        free(list.chunk);
+        return;
+    }
+
+    for (i = 0; i < list.cur_chunk; i++)
+    {
+        chunk = list.chunk + i;
+        CHECK(chunk->img_start_sector == next, "chunk %u starts at %u, expect %u", i, chunk->img_start_sector, next);
+        CHECK((chunk->disk_end_sector + 1 - chunk->disk_start_sector) ==
+              ((grub_uint64_t)chunk->img_end_sector + 1 - chunk->img_start_sector) * 4, "chunk %u size", i);
+        next = chunk->img_end_sector + 1;
+
+        pos = (grub_uint64_t)chunk->img_start_sector * 2048;
+        len = ((grub_uint64_t)chunk->img_end_sector + 1) * 2048 - pos;
+        if (pos + len > map->disk_size)
+        {
+            len = map->disk_size - pos;
+        }
+
+        buf = realloc(buf, len);
+        if (VTOY_IS_ZERO_CHUNK(chunk))
+        {
+            CHECK(chunk->disk_start_sector == VTOY_ZERO_CHUNK_SECTOR + pos / 512, "zero chunk %u sector", i);
+            memset(buf, 0, len);
+            zero++;
+        }
+        else if (pread(file->fd, buf, len, chunk->disk_start_sector * 512) != (ssize_t)len)
+        {
+            CHECK(0, "chunk %u read failed at %llu", i, (unsigned long long)pos);
+            continue;
+        }
+
+        if (memcmp(buf, raw + pos, len))
+        {
+            CHECK(0, "chunk %u data differs at %llu", i, (unsigned long long)pos);
+        }
+    }
+    CHECK(next == total, "chunk list covers %u sectors, expect %u", next, total);
+    printf("  fragment %u: %u file chunks -> %u disk chunks, %u zero\n", fragsec, filechunk, list.cur_chunk, zero);
+
+    free(buf);
+    free(list.chunk);
+}
+
+int main(int argc, char **argv)
+{
+    int rc;
+    int rawfd;
+    grub_uint32_t i;
+    grub_uint32_t hole;
+    struct stat st;
+    struct grub_file file;
+    ventoy_vdisk_map map;
+    uint8_t *raw = NULL;
+
+    if (argc != 4)
+    {
+        printf("Usage: %s raw.img image full|sparse\n", argv[0]);
+        return 1;
+    }
+
+    memset(&map, 0, sizeof(map));
+    memset(&file, 0, sizeof(file));
+    rawfd = open(argv[1], O_RDONLY);
+    file.fd = open(argv[2], O_RDONLY);
+    if (rawfd < 0 || file.fd < 0 || fstat(file.fd, &st))
+    {
+        printf("failed to open %s %s\n", argv[1], argv[2]);
+        return 1;
+    }
+    file.size = st.st_size;
+
+    rc = parse_image(&file, &map);
+    printf("%s: fmt:%d disk size:%llu block size:%u blocks:%u\n", argv[2], map.fmt,
+        (unsigned long long)map.disk_size, map.block_size, map.block_num);
+
+    CHECK(rc == 0, "%s image is rejected rc:%d", argv[3], rc);
+    if (rc == 0)
+    {
+        for (hole = 0, i = 0; i < map.block_num; i++)
+        {
+            hole += (map.block_offset[i] == 0) ? 1 : 0;
+        }
+        printf("  %u of %u blocks unallocated\n", hole, map.block_num);
+        CHECK((strcmp(argv[3], "sparse") == 0) == (hole > 0), "%s image has %u unallocated blocks", argv[3], hole);
+
+        if (fstat(rawfd, &st) == 0)
+        {
+            CHECK((grub_uint64_t)st.st_size == map.disk_size, "raw size %llu", (unsigned long long)st.st_size);
+            raw = malloc(map.disk_size);
+            if (pread(rawfd, raw, map.disk_size, 0) == (ssize_t)map.disk_size)
+            {
+                test_map_read(&file, &map, raw);
+                test_compose(&file, &map, raw, 0xFFFFFFFF);
+                test_compose(&file, &map, raw, 512);
+                test_compose(&file, &map, raw, 13);
+            }
+            free(raw);
+        }
+    }
+
+    ventoy_vdisk_map_free(&map);
+    close(file.fd);
+    close(rawfd);
+
+    printf("%s\n", g_fail ? "vdisk test FAILED" : "vdisk test passed");
+    return g_fail ? 1 : 0;
+}
@@ -28,17 +28,9 @@ ventoy_os_install_dmsetup() {
     # dump iso file location
     $VTOY_PATH/tool/vtoydm -i -f $VTOY_PATH/ventoy_image_map -d ${vt_usb_disk} > $VTOY_PATH/iso_file_list
 
-    # install dmsetup 
-    LINE=$($GREP ' dmsetup.*\.udeb'  $VTOY_PATH/iso_file_list)
-    if [ $? -eq 0 ]; then
-        install_udeb_from_line "$LINE" ${vt_usb_disk}
-    fi
-
-    # install libdevmapper
-    LINE=$($GREP ' libdevmapper.*\.udeb'  $VTOY_PATH/iso_file_list)
-    if [ $? -eq 0 ]; then
-        install_udeb_from_line "$LINE" ${vt_usb_disk}
-    fi
+    # dmsetup / libdevmapper / md-modules are extracted together and installed in this order
+    DMLINE=$($GREP ' dmsetup.*\.udeb'  $VTOY_PATH/iso_file_list)
+    LIBDMLINE=$($GREP ' libdevmapper.*\.udeb'  $VTOY_PATH/iso_file_list)
 
     # install md-modules
     LINE=$($GREP -i ' md-modules.*\.udeb'  $VTOY_PATH/iso_file_list)
@@ -55,9 +47,10 @@ ventoy_os_install_dmsetup() {
                 LINE=$($GREP -i ' md-modules.*\.udeb'  $VTOY_PATH/iso_file_list | $GREP -i -m1 $VER)
             fi
         fi
-        install_udeb_from_line "$LINE" ${vt_usb_disk} 
     fi
 
+    install_udeb_from_lines ${vt_usb_disk} "$DMLINE" "$LIBDMLINE" "$LINE"
+
     # insmod md-mod if needed
     if $GREP -q 'device-mapper' /proc/devices; then
         vtlog "device mapper module is loaded"
@@ -42,9 +42,18 @@ else
     vPart="${vtdiskname}2"
 fi
 
-# TinyCore linux distro doesn't contain dmsetup, we use aoe here
-sudo modprobe aoe aoe_iflist=lo
-if [ -e /sys/module/aoe ]; then
+# TinyCore linux distro doesn't contain dmsetup
+# try ublk/nbd first, they are much faster than aoe over loopback
+sudo modprobe ublk_drv > /dev/null 2>&1
+sudo modprobe nbd > /dev/null 2>&1
+vtBlkDev=$(sudo $VTOY_PATH/tool/vtoyblk -D $VTOY_PATH/ventoy_image_map "$vtdiskname")
+
+if [ -n "$vtBlkDev" ] && [ -b "$vtBlkDev" ]; then
+    vtlog "use $vtBlkDev for $vPart"
+    sudo cp -a "$vtBlkDev"  "$vPart"
+
+    ventoy_find_bin_run rebuildfstab
+elif sudo modprobe aoe aoe_iflist=lo; [ -e /sys/module/aoe ]; then
     VBLADE_BIN=$(ventoy_get_vblade_bin)
     
     sudo nohup $VBLADE_BIN -r -f $VTOY_PATH/ventoy_image_map 9 0 lo "$vtdiskname" > /dev/null & 
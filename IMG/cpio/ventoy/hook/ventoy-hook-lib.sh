@@ -83,6 +83,15 @@ get_ventoy_iso_name() {
 }
 
 wait_for_usb_disk_ready() {
+    # vtoydump waits for the block uevents and only returns when partition 2 is ready
+    vtwait=$($VTOY_PATH/tool/vtoydump -f /ventoy/ventoy_os_param -w ${VTOY_DISK_WAIT_TIMEOUT:-0})
+    if [ $? -eq 0 ]; then
+        usb_disk=${vtwait%% *}
+        vtpart2=${vtwait##* }
+        vtlog "wait_for_usb_disk_ready $usb_disk $vtpart2 finish"
+        return
+    fi
+
     vtloop=0
     while [ -n "Y" ]; do
         usb_disk=$(get_ventoy_disk_name)
@@ -238,6 +247,27 @@ create_ventoy_device_mapper() {
     fi
     
     $VTOY_PATH/tool/vtoydm -p -f $VTOY_PATH/ventoy_image_map -d $1 > $VTOY_PATH/ventoy_dm_table        
+
+    # Without dmsetup in the system there is no udev sync either, so load the table through the dm ioctl directly
+    if [ "$VT_DM_BIN" = "$VTOY_PATH/tool/dmsetup" ]; then
+        if [ -z "$2" ]; then
+            vtdmopt=""
+        elif [ "$2" = "--readonly" ]; then
+            vtdmopt="-r"
+        else
+            vtdmopt="unknown"
+        fi
+
+        if [ "$vtdmopt" != "unknown" ]; then
+            # the prebuilt vtoydm fallbacks ignore -c and still exit 0, so check the device node
+            if $VTOY_PATH/tool/vtoydm -c $vtdmopt -f $VTOY_PATH/ventoy_image_map -d $1 >>$VTLOG 2>&1 && [ -b $VTOY_DM_PATH ]; then
+                vtlog "vtoydm create ventoy success"
+                return
+            fi
+            vtlog "vtoydm create ventoy failed, try $VT_DM_BIN"
+        fi
+    fi
+
     if [ -z "$2" ]; then
         $VT_DM_BIN create ventoy $VTOY_PATH/ventoy_dm_table >>$VTLOG 2>&1
     else
@@ -352,6 +382,48 @@ install_udeb_from_line() {
     $BUSYBOX_PATH/rm -f /tmp/xxx.udeb
 }
 
+# install_udeb_from_lines disk "line1" "line2" ...
+# all the udebs are extracted by one vtoydm call (in disk order) and then installed in the input order
+install_udeb_from_lines() {
+    vtdisk=$1
+    shift
+    vtlog "install_udeb_from_lines $vtdisk $#"
+
+    if ! [ -b "$vtdisk" ]; then
+        vterr "disk #$vtdisk# not exist"
+        return 
+    fi
+
+    vtcnt=0
+    $BUSYBOX_PATH/rm -f $VTOY_PATH/udeb_manifest
+    for vtline in "$@"; do
+        if [ -n "$vtline" ]; then
+            sector=$(echo $vtline | $AWK '{print $(NF-1)}')
+            length=$(echo $vtline | $AWK '{print $NF}')
+            echo "$sector $length /tmp/vtoy_batch_${vtcnt}.udeb" >> $VTOY_PATH/udeb_manifest
+            let vtcnt=vtcnt+1
+        fi
+    done
+
+    if [ $vtcnt -eq 0 ]; then
+        return
+    fi
+
+    $VTOY_PATH/tool/vtoydm -m $VTOY_PATH/udeb_manifest -f $VTOY_PATH/ventoy_image_map -d ${vtdisk} -v >> $VTLOG 2>&1
+
+    vtidx=0
+    while [ $vtidx -lt $vtcnt ]; do
+        if [ -e /tmp/vtoy_batch_${vtidx}.udeb ]; then
+            vtlog "extract udeb file $vtidx from iso success"
+            install_udeb_pkg /tmp/vtoy_batch_${vtidx}.udeb
+            $BUSYBOX_PATH/rm -f /tmp/vtoy_batch_${vtidx}.udeb
+        else
+            vterr "extract udeb file $vtidx from iso fail"
+        fi
+        let vtidx=vtidx+1
+    done
+}
+
 extract_file_from_line() {
     vtlog "extract_file_from_line $1 disk=#$2#"
     if ! [ -b "$2" ]; then
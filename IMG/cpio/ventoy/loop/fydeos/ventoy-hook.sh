@@ -26,24 +26,9 @@ VTPATH_OLD=$PATH; PATH=$BUSYBOX_PATH:$VTOY_PATH/tool:$PATH
 mkdir /sys
 mount -t sysfs sys /sys
 mdev -s
-sleep 2
 
-while [ -n "Y" ]; do
-    usb_disk=$(get_ventoy_disk_name)
-    
-    if echo $usb_disk | egrep -q "nvme|mmc|nbd"; then
-        vtpart2=${usb_disk}p2
-    else
-        vtpart2=${usb_disk}2
-    fi
-    
-    if [ -e "${vtpart2}" ]; then
-        break
-    else
-        sleep 2
-        mdev -s
-    fi
-done
+# vtoydump creates the missing device nodes itself, so no need to loop with mdev -s here
+wait_for_usb_disk_ready
 
 vtdiskname=$(get_ventoy_disk_name)
 if [ "$vtdiskname" = "unknown" ]; then
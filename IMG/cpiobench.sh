@@ -0,0 +1,84 @@
+#!/bin/bash
+
+# Compare the size and the unpack time of the packed archives in ventoy_xxx.cpio with xz/zstd/lz4
+# Run it after mkcpio.sh. The time is measured with the tools on the build host,
+# so only the ratio between the methods makes sense, not the absolute value.
+#
+# Usage: sh cpiobench.sh [loop count]
+
+VENTOY_PATH=$PWD/../
+LOOP=${1:-10}
+
+vtoy_raw_cat() {
+    vtmagic=$(od -A n -N 4 -t x1 $1 | tr -d ' \n')
+    if [ "$vtmagic" = "28b52ffd" ]; then
+        zstd -q -d -c $1
+    elif [ "$vtmagic" = "04224d18" ]; then
+        lz4 -q -d -c $1
+    else
+        xz -d -c $1
+    fi
+}
+
+vtoy_compress_to() {
+    if [ "$1" = "zstd" ]; then
+        zstd -q -19 -c $2 > $3
+    elif [ "$1" = "lz4" ]; then
+        lz4 -q -9 -c $2 > $3
+    else
+        xz -c $2 > $3
+    fi
+}
+
+vtoy_time_ms() {
+    begin=$(date +%s%N)
+    for i in $(seq 1 $LOOP); do
+        vtoy_raw_cat $1 > /dev/null
+    done
+    end=$(date +%s%N)
+    echo $(( (end - begin) / 1000000 / LOOP ))
+}
+
+for tool in cpio xz zstd lz4; do
+    if ! which $tool > /dev/null 2>&1; then
+        echo "$tool is needed"
+        exit 1
+    fi
+done
+
+rm -rf bench_tmp
+mkdir bench_tmp
+cd bench_tmp
+
+printf "%-8s %-10s %-6s %12s %12s %10s\n" "cpio" "archive" "method" "raw" "packed" "unpack(ms)"
+
+for arch in x86 arm64 mips64; do
+    mkdir $arch
+    cd $arch
+
+    cpio -idm < $VENTOY_PATH/INSTALL/ventoy/ventoy.cpio 2>/dev/null
+    cpio -idm < $VENTOY_PATH/INSTALL/ventoy/ventoy_$arch.cpio 2>/dev/null
+
+    for name in tool.cpio hook.cpio loop.cpio; do
+        for ext in xz zst lz4; do
+            if [ -e ventoy/$name.$ext ]; then
+                vtoy_raw_cat ventoy/$name.$ext > $name
+                break
+            fi
+        done
+
+        [ -f $name ] || continue
+
+        rawsize=$(stat -c %s $name)
+        for method in xz zstd lz4; do
+            vtoy_compress_to $method $name $name.$method
+            packsize=$(stat -c %s $name.$method)
+            printf "%-8s %-10s %-6s %12s %12s %10s\n" $arch $name $method $rawsize $packsize $(vtoy_time_ms $name.$method)
+        done
+    done
+
+    cd ..
+done
+
+cd ..
+rm -rf bench_tmp
@@ -2,6 +2,34 @@
 
 VENTOY_PATH=$PWD/../
 
+# packed archives in the cpio: xz(default) zstd lz4
+# zstd and lz4 are much faster to unpack than xz on weak CPUs, but the cpio is bigger
+VTOY_CPIO_COMP=${VTOY_CPIO_COMP:-xz}
+
+vtoy_compress() {
+    if [ "$1" = "zstd" ]; then
+        zstd -q -19 --rm $2
+    elif [ "$1" = "lz4" ]; then
+        lz4 -q -9 --rm $2
+    else
+        xz $2
+    fi
+}
+
+# zstdcat is not available for mips64el
+if [ "$VTOY_CPIO_COMP" = "lz4" ]; then
+    VTOY_COMM_COMP=lz4
+else
+    VTOY_COMM_COMP=xz
+fi
+
+if [ "$VTOY_CPIO_COMP" = "zstd" ]; then
+    VTOY_M64E_COMP=xz
+else
+    VTOY_M64E_COMP=$VTOY_CPIO_COMP
+fi
+
+echo "cpio compress: $VTOY_CPIO_COMP common: $VTOY_COMM_COMP mips64: $VTOY_M64E_COMP"
 
 if [ -d cpio_tmp ]; then
     rm -rf cpio_tmp
@@ -22,14 +50,14 @@ ln -s sbin/init linuxrc
 cd ventoy
 
 find ./loop | cpio  -o -H newc --owner=root:root >loop.cpio
-xz loop.cpio
+vtoy_compress $VTOY_COMM_COMP loop.cpio
 rm -rf loop
 
-xz ventoy_chain.sh
-xz ventoy_loop.sh
+vtoy_compress $VTOY_COMM_COMP ventoy_chain.sh
+vtoy_compress $VTOY_COMM_COMP ventoy_loop.sh
 
 find ./hook | cpio  -o -H newc --owner=root:root >hook.cpio
-xz hook.cpio
+vtoy_compress $VTOY_COMM_COMP hook.cpio
 rm -rf hook
 cd ..
 
@@ -65,10 +93,15 @@ cp -a $VENTOY_PATH/LZIP/lunzip64 tool/
 cp -a $VENTOY_PATH/cryptsetup/veritysetup32 tool/
 cp -a $VENTOY_PATH/cryptsetup/veritysetup64 tool/
 
-chmod -R 777 ./tool
+# the unpack tool must be out of tool.cpio
+if [ "$VTOY_CPIO_COMP" != "xz" ]; then
+    cp -a tool/${VTOY_CPIO_COMP}cat tool/${VTOY_CPIO_COMP}cat64 busybox/
+fi
+
+chmod -R 777 ./tool ./busybox
 
 find ./tool | cpio  -o -H newc --owner=root:root >tool.cpio
-xz tool.cpio
+vtoy_compress $VTOY_CPIO_COMP tool.cpio
 rm -rf tool
 
 cd ..
@@ -96,10 +129,14 @@ cp -a $VENTOY_PATH/VBLADE/vblade-master/vblade_aa64 tool/
 
 cp -a $VENTOY_PATH/LZIP/lunzipaa64 tool/
 
-chmod -R 777 ./tool
+if [ "$VTOY_CPIO_COMP" != "xz" ]; then
+    cp -a tool/${VTOY_CPIO_COMP}cataa64 busybox/
+fi
+
+chmod -R 777 ./tool ./busybox
 
 find ./tool | cpio  -o -H newc --owner=root:root >tool.cpio
-xz tool.cpio
+vtoy_compress $VTOY_CPIO_COMP tool.cpio
 rm -rf tool
 
 cd ..
@@ -128,10 +165,14 @@ rm -f tool/vtoytool/00/vtoytool_aa64
 
 # cp -a $VENTOY_PATH/LZIP/lunzipaa64 tool/
 
-chmod -R 777 ./tool
+if [ "$VTOY_M64E_COMP" != "xz" ]; then
+    cp -a tool/${VTOY_M64E_COMP}catm64e busybox/
+fi
+
+chmod -R 777 ./tool ./busybox
 
 find ./tool | cpio  -o -H newc --owner=root:root >tool.cpio
-xz tool.cpio
+vtoy_compress $VTOY_M64E_COMP tool.cpio
 rm -rf tool
 
 cd ..
@@ -150,6 +150,16 @@ static int ventoy_vdisk_read_real_hdd(uint64_t lba, unsigned int count, unsigned
         readcount = left;
         maplba = ventoy_remap_lba_hdd(curlba, &readcount);
 
+        /* unallocated block of a dynamic vdisk, no storage */
+        if (g_cur_chunk && VTOY_IS_ZERO_CHUNK(g_cur_chunk))
+        {
+            memset((void *)buffer, 0, readcount * 512);
+            curlba += readcount;
+            left -= readcount;
+            buffer += (readcount * 512);
+            continue;
+        }
+
         tmpcount = readcount;
         
         phyaddr = user_to_phys(buffer, 0);
@@ -218,6 +228,15 @@ static int ventoy_vdisk_read_real(uint64_t lba, unsigned int count, unsigned lon
     {
         readcount = left;
         maplba = ventoy_remap_lba(curlba, &readcount);
+
+        if (g_cur_chunk && VTOY_IS_ZERO_CHUNK(g_cur_chunk))
+        {
+            memset((void *)buffer, 0, readcount * 2048);
+            curlba += readcount;
+            left -= readcount;
+            buffer += (readcount * 2048);
+            continue;
+        }
         
         if (g_disk_sector_size == 512)
         {
@@ -651,9 +670,17 @@ static int ventoy_update_image_location(ventoy_os_param *param)
     userptr_t address = 0;
     ventoy_image_location *location = NULL;
     ventoy_image_disk_region *region = NULL;
+    uint32_t region_count = g_img_chunk_num;
     ventoy_img_chunk *chunk = g_chunk;
 
-    length = sizeof(ventoy_image_location) + (g_img_chunk_num - 1) * sizeof(ventoy_image_disk_region);
+    /* chunks placed after the image (linux cpio payload) are not part of the image */
+    while (region_count > 1 && 
+           g_chunk[region_count - 1].img_start_sector >= (g_chain->real_img_size_in_bytes + 2047) / 2048)
+    {
+        region_count--;
+    }
+
+    length = sizeof(ventoy_image_location) + (region_count - 1) * sizeof(ventoy_image_disk_region);
 
     address = umalloc(length + 4096 * 2);
     if (!address)
@@ -686,13 +713,13 @@ static int ventoy_update_image_location(ventoy_os_param *param)
     memcpy(&location->guid, &param->guid, sizeof(ventoy_guid));
     location->image_sector_size = g_hddmode ? 512 : 2048;
     location->disk_sector_size  = g_chain->disk_sector_size;
-    location->region_count = g_img_chunk_num;
+    location->region_count = region_count;
 
     region = location->regions;
 
     if (g_hddmode)
     {
-        for (i = 0; i < g_img_chunk_num; i++)
+        for (i = 0; i < region_count; i++)
         {
             region->image_sector_count = chunk->disk_end_sector - chunk->disk_start_sector + 1;
             region->image_start_sector = chunk->img_start_sector * 4;
@@ -703,7 +730,7 @@ static int ventoy_update_image_location(ventoy_os_param *param)
     }
     else
     {
-        for (i = 0; i < g_img_chunk_num; i++)
+        for (i = 0; i < region_count; i++)
         {
             region->image_sector_count = chunk->img_end_sector - chunk->img_start_sector + 1;
             region->image_start_sector = chunk->img_start_sector;
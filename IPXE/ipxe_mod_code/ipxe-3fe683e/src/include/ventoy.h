@@ -147,6 +147,13 @@ typedef struct ventoy_img_chunk
     grub_uint64_t disk_end_sector;
 }ventoy_img_chunk;
 
+/*
+ * A chunk whose disk sectors start from VTOY_ZERO_CHUNK_SECTOR has no storage
+ * (unallocated block of a dynamic vdisk). It reads as zero and can't be written.
+ */
+#define VTOY_ZERO_CHUNK_SECTOR    0x8000000000000000ULL
+#define VTOY_IS_ZERO_CHUNK(chunk) ((chunk)->disk_start_sector >= VTOY_ZERO_CHUNK_SECTOR)
+
 
 typedef struct ventoy_override_chunk
 {
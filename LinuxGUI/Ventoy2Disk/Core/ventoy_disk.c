@@ -28,15 +28,23 @@
 #include <sys/ioctl.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/socket.h>
 #include <linux/fs.h>
+#include <linux/netlink.h>
 #include <dirent.h>
 #include <time.h>
+#include <pthread.h>
 #include <ventoy_define.h>
 #include <ventoy_disk.h>
 #include <ventoy_util.h>
 #include <fat_filelib.h>
 
 int g_disk_num = 0;
+pthread_mutex_t g_fatlib_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t g_disk_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static ventoy_disk_cache *g_disk_cache = NULL;
+static int g_uevent_sock = -1;
+static const char *g_sysfs_root = "/sys";
 static int g_fatlib_media_fd = 0;
 static uint64_t g_fatlib_media_offset = 0;
 ventoy_disk *g_disk_list = NULL;
@@ -106,7 +114,7 @@ static int ventoy_get_disk_devnum(const char *name, int *major, int* minor)
     char *pos;
     char devnum[16] = {0};
     
-    rc = ventoy_get_sys_file_line(devnum, sizeof(devnum), "/sys/block/%s/dev", name);
+    rc = ventoy_get_sys_file_line(devnum, sizeof(devnum), "%s/block/%s/dev", g_sysfs_root, name);
     if (rc)
     {
         return 1;
@@ -133,7 +141,7 @@ static ventoy_dev_type ventoy_get_dev_type(const char *name, int major, int mino
     memset(syspath, 0, sizeof(syspath));
     memset(dstpath, 0, sizeof(dstpath));
     
-    scnprintf(syspath, "/sys/block/%s", name);
+    scnprintf(syspath, "%s/block/%s", g_sysfs_root, name);
     rc = readlink(syspath, dstpath, sizeof(dstpath) - 1);
     if (rc > 0 && strstr(dstpath, "/usb"))
     {
@@ -269,7 +277,7 @@ uint64_t ventoy_get_disk_size_in_byte(const char *disk)
     char sizebuf[64] = {0};
 
     // Try 1: get size from sysfs
-    snprintf(diskpath, sizeof(diskpath) - 1, "/sys/block/%s/size", disk);
+    snprintf(diskpath, sizeof(diskpath) - 1, "%s/block/%s/size", g_sysfs_root, disk);
     if (access(diskpath, F_OK) >= 0)
     {
         vdebug("get disk size from sysfs for %s\n", disk);
@@ -313,12 +321,12 @@ uint64_t ventoy_get_disk_size_in_byte(const char *disk)
 
 int ventoy_get_disk_vendor(const char *name, char *vendorbuf, int bufsize)
 {
-    return ventoy_get_sys_file_line(vendorbuf, bufsize, "/sys/block/%s/device/vendor", name);
+    return ventoy_get_sys_file_line(vendorbuf, bufsize, "%s/block/%s/device/vendor", g_sysfs_root, name);
 }
 
 int ventoy_get_disk_model(const char *name, char *modelbuf, int bufsize)
 {
-    return ventoy_get_sys_file_line(modelbuf, bufsize, "/sys/block/%s/device/model", name);
+    return ventoy_get_sys_file_line(modelbuf, bufsize, "%s/block/%s/device/model", g_sysfs_root, name);
 }
 
 static int fatlib_media_sector_read(uint32 sector, uint8 *buffer, uint32 sector_count)
@@ -518,6 +526,7 @@ int ventoy_get_vtoy_data(ventoy_disk *info, int *ppartstyle)
 
     vdebug("now check secure boot for %s ...\n", info->disk_path);
 
+    pthread_mutex_lock(&g_fatlib_mutex);
     g_fatlib_media_fd = fd;
     g_fatlib_media_offset = part2_start_sector;
     fl_init();
@@ -542,6 +551,7 @@ int ventoy_get_vtoy_data(ventoy_disk *info, int *ppartstyle)
     fl_shutdown();
     g_fatlib_media_fd = -1;
     g_fatlib_media_offset = 0;
+    pthread_mutex_unlock(&g_fatlib_mutex);
 
     if (vtoy->ventoy_ver[0] == 0)
     {
@@ -640,63 +650,271 @@ static int ventoy_disk_compare(const ventoy_disk *disk1, const ventoy_disk *disk
     }
 }
 
-static int ventoy_disk_sort(void)
+static int ventoy_disk_qsort_cmp(const void *a, const void *b)
 {
-    int i, j;
-    ventoy_disk *tmp;
+    return ventoy_disk_compare((const ventoy_disk *)a, (const ventoy_disk *)b);
+}
+
+static int ventoy_disk_sort(ventoy_disk *list, int num)
+{
+    qsort(list, num, sizeof(ventoy_disk), ventoy_disk_qsort_cmp);
+    return 0;
+}
+
+static int ventoy_uevent_init(void)
+{
+    struct sockaddr_nl addr;
 
-    tmp = malloc(sizeof(ventoy_disk));
-    if (!tmp)
+    g_uevent_sock = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_KOBJECT_UEVENT);
+    if (g_uevent_sock < 0)
     {
+        vlog("Failed to create uevent socket %d, disk cache disabled\n", errno);
         return 1;
     }
 
-    for (i = 0; i < g_disk_num; i++)
-    for (j = i + 1; j < g_disk_num; j++)
+    memset(&addr, 0, sizeof(addr));
+    addr.nl_family = AF_NETLINK;
+    addr.nl_pid = 0;
+    addr.nl_groups = 1;
+
+    if (bind(g_uevent_sock, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+    {
+        vlog("Failed to bind uevent socket %d, disk cache disabled\n", errno);
+        close(g_uevent_sock);
+        g_uevent_sock = -1;
+        return 1;
+    }
+
+    return 0;
+}
+
+/* must be called with g_disk_cache_mutex held, NULL name means all */
+static void ventoy_disk_cache_drop(const char *name)
+{
+    int i;
+
+    for (i = 0; i < MAX_DISK_NUM; i++)
+    {
+        if (g_disk_cache[i].valid && (name == NULL || strcmp(g_disk_cache[i].disk.disk_name, name) == 0))
+        {
+            vdebug("disk cache drop %s\n", g_disk_cache[i].disk.disk_name);
+            g_disk_cache[i].valid = 0;
+        }
+    }
+}
+
+/*
+ * Drain the pending kernel uevents and drop the cache of the disks involved.
+ * DEVPATH is like .../block/sdb or .../block/sdb/sdb1, the component after
+ * "/block/" is the disk name for both the disk and its partitions.
+ */
+static void ventoy_uevent_proc(void)
+{
+    int len;
+    int pos;
+    char *line = NULL;
+    char *disk = NULL;
+    char *end = NULL;
+    int isblock;
+    char buf[4096];
+
+    while (1)
+    {
+        len = (int)recv(g_uevent_sock, buf, sizeof(buf) - 1, 0);
+        if (len < 0)
+        {
+            if (errno == ENOBUFS)
+            {
+                /* some events lost */
+                ventoy_disk_cache_drop(NULL);
+                continue;
+            }
+            break;
+        }
+        else if (len == 0)
+        {
+            break;
+        }
+        buf[len] = 0;
+
+        isblock = 0;
+        disk = NULL;
+        for (pos = 0; pos < len; pos += (int)strlen(line) + 1)
+        {
+            line = buf + pos;
+            if (strcmp(line, "SUBSYSTEM=block") == 0)
+            {
+                isblock = 1;
+            }
+            else if (strncmp(line, "DEVPATH=", 8) == 0)
+            {
+                disk = strstr(line, "/block/");
+            }
+        }
+
+        if (isblock && disk)
+        {
+            disk += 7;
+            end = strchr(disk, '/');
+            if (end)
+            {
+                *end = 0;
+            }
+            ventoy_disk_cache_drop(disk);
+        }
+    }
+}
+
+void ventoy_disk_cache_invalidate(const char *name)
+{
+    if (g_disk_cache == NULL)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&g_disk_cache_mutex);
+    ventoy_disk_cache_drop(name);
+    pthread_mutex_unlock(&g_disk_cache_mutex);
+}
+
+static uint64_t ventoy_get_disk_seq(const char *name)
+{
+    char buf[64] = {0};
+
+    /* diskseq is increased on every media change (kernel 5.15+) */
+    if (ventoy_get_sys_file_line(buf, sizeof(buf), "%s/block/%s/diskseq", g_sysfs_root, name))
+    {
+        return 0;
+    }
+    return (uint64_t)strtoull(buf, NULL, 10);
+}
+
+static int ventoy_get_disk_info_cached(const char *name, ventoy_disk *info, int *probe)
+{
+    int i;
+    int major = 0;
+    int minor = 0;
+    int slot = -1;
+    uint64_t size;
+    uint64_t seq;
+    ventoy_disk_cache *cache = NULL;
+
+    if (g_disk_cache == NULL || g_uevent_sock < 0)
+    {
+        *probe = 1;
+        return ventoy_get_disk_info(name, info);
+    }
+
+    ventoy_get_disk_devnum(name, &major, &minor);
+    size = ventoy_get_disk_size_in_byte(name);
+    seq = ventoy_get_disk_seq(name);
+
+    for (i = 0; i < MAX_DISK_NUM; i++)
     {
-        if (ventoy_disk_compare(g_disk_list + i, g_disk_list + j) > 0)
+        cache = g_disk_cache + i;
+        if (cache->valid == 0)
         {
-            memcpy(tmp, g_disk_list + i, sizeof(ventoy_disk));
-            memcpy(g_disk_list + i, g_disk_list + j, sizeof(ventoy_disk));
-            memcpy(g_disk_list + j, tmp, sizeof(ventoy_disk));
+            if (slot < 0)
+            {
+                slot = i;
+            }
+            continue;
+        }
+
+        if (strcmp(cache->disk.disk_name, name) == 0)
+        {
+            if (cache->major == major && cache->minor == minor && 
+                cache->size_in_byte == size && cache->diskseq == seq)
+            {
+                memcpy(info, &cache->disk, sizeof(ventoy_disk));
+                *probe = 0;
+                return 0;
+            }
+
+            /* signature changed, probe again and reuse the slot */
+            cache->valid = 0;
+            slot = i;
+            break;
         }
     }
 
-    free(tmp);
+    *probe = 1;
+    if (ventoy_get_disk_info(name, info))
+    {
+        return 1;
+    }
+
+    if (slot >= 0)
+    {
+        cache = g_disk_cache + slot;
+        cache->major = major;
+        cache->minor = minor;
+        cache->size_in_byte = size;
+        cache->diskseq = seq;
+        memcpy(&cache->disk, info, sizeof(ventoy_disk));
+        cache->valid = 1;
+    }
+
     return 0;
 }
 
-int ventoy_disk_enumerate_all(void)
+/* enumerate the disks into list (at most max), return the disk number */
+int ventoy_disk_enumerate_list(ventoy_disk *list, int max)
 {
-    int rc = 0;
+    int num = 0;
+    int probe = 0;
+    int probenum = 0;
     DIR* dir = NULL;
     struct dirent* p = NULL;
+    char syspath[256];
 
-    vdebug("ventoy_disk_enumerate_all\n");
+    vdebug("ventoy_disk_enumerate_list\n");
 
-    dir = opendir("/sys/block");
+    scnprintf(syspath, "%s/block", g_sysfs_root);
+    dir = opendir(syspath);
     if (!dir)
     {
-        vlog("Failed to open /sys/block %d\n", errno);
-        return 1;
+        vlog("Failed to open %s %d\n", syspath, errno);
+        return 0;
     }
 
-    while (((p = readdir(dir)) != NULL) && (g_disk_num < MAX_DISK_NUM))
+    pthread_mutex_lock(&g_disk_cache_mutex);
+
+    if (g_disk_cache && g_uevent_sock >= 0)
+    {
+        ventoy_uevent_proc();
+    }
+
+    while (((p = readdir(dir)) != NULL) && (num < max))
     {
         if (ventoy_is_possible_blkdev(p->d_name))
         {
-            memset(g_disk_list + g_disk_num, 0, sizeof(ventoy_disk));
-            if (0 == ventoy_get_disk_info(p->d_name, g_disk_list + g_disk_num))
+            memset(list + num, 0, sizeof(ventoy_disk));
+            if (0 == ventoy_get_disk_info_cached(p->d_name, list + num, &probe))
             {
-                g_disk_num++;                    
+                num++;                    
+                probenum += probe;
             }
         }
     }
+
+    pthread_mutex_unlock(&g_disk_cache_mutex);
     closedir(dir);
 
-    ventoy_disk_sort();
+    ventoy_disk_sort(list, num);
+
+    vdebug("enumerate %d disks, %d probed, %d from cache\n", num, probenum, num - probenum);
     
-    return rc;
+    return num;
+}
+
+int ventoy_disk_enumerate_all(void)
+{
+    vdebug("ventoy_disk_enumerate_all\n");
+
+    g_disk_num = ventoy_disk_enumerate_list(g_disk_list, MAX_DISK_NUM);
+    
+    return 0;
 }
 
 void ventoy_disk_dump(ventoy_disk *cur)
@@ -731,10 +949,22 @@ int ventoy_disk_install(ventoy_disk *disk, void *efipartimg)
 }
 
 
+/* only for test, the default is /sys */
+void ventoy_disk_set_sysfs_root(const char *root)
+{
+    g_sysfs_root = root ? root : "/sys";
+}
+
 int ventoy_disk_init(void)
 {
     g_disk_list = malloc(sizeof(ventoy_disk) * MAX_DISK_NUM);
 
+    /* cache is only used when we can get notified of the disk changes */
+    if (0 == ventoy_uevent_init())
+    {
+        g_disk_cache = zalloc(sizeof(ventoy_disk_cache) * MAX_DISK_NUM);
+    }
+
     ventoy_disk_enumerate_all();
     ventoy_disk_dump_all();
     
@@ -746,6 +976,14 @@ void ventoy_disk_exit(void)
     check_free(g_disk_list);        
     g_disk_list = NULL;
     g_disk_num  = 0;
+
+    check_free(g_disk_cache);
+    g_disk_cache = NULL;
+    if (g_uevent_sock >= 0)
+    {
+        close(g_uevent_sock);
+        g_uevent_sock = -1;
+    }
 }
 
 
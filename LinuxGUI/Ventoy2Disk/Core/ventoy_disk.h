@@ -20,6 +20,8 @@
 #ifndef __VENTOY_DISK_H__
 #define __VENTOY_DISK_H__
 
+#include <pthread.h>
+
 typedef enum 
 {
     VTOY_DEVICE_UNKNOWN = 0,
@@ -135,8 +137,26 @@ typedef enum
 #define VENTOY_FILE_STG1_IMG    "boot/core.img.xz"
 #define VENTOY_FILE_DISK_IMG    "ventoy/ventoy.disk.img.xz"
 
+/*
+ * Cached disk info, reused as long as the signature (name, major:minor,
+ * size and diskseq) is the same and no uevent has been received for it.
+ */
+typedef struct ventoy_disk_cache
+{
+    int valid;
+    int major;
+    int minor;
+    uint64_t size_in_byte;
+    uint64_t diskseq;
+    ventoy_disk disk;
+}ventoy_disk_cache;
+
 extern int g_disk_num;
 extern ventoy_disk *g_disk_list;
+extern pthread_mutex_t g_fatlib_mutex;
+void ventoy_disk_cache_invalidate(const char *name);
+void ventoy_disk_set_sysfs_root(const char *root);
+int ventoy_disk_enumerate_list(ventoy_disk *list, int max);
 int ventoy_disk_enumerate_all(void);
 int ventoy_disk_init(void);
 void ventoy_disk_exit(void);
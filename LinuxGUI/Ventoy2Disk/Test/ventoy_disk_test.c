@@ -0,0 +1,300 @@
+/******************************************************************************
+ * ventoy_disk_test.c  ---- host test for the disk info cache
+ * Copyright (c) 2021, longpanda <admin@ventoy.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Runs ventoy_disk_enumerate_all against a fake sysfs tree. The disks are
+ * sparse files under <root>/dev, open("/dev/xxx") is redirected there and
+ * counted (-Wl,--wrap=open,--wrap=open64). The netlink uevent socket is replaced by a
+ * socketpair (-Wl,--wrap=socket,--wrap=bind) so that the test can send
+ * uevents itself. Needs no root. Build and run with LinuxGUI/build_test.sh
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <linux/limits.h>
+#include <ventoy_define.h>
+#include <ventoy_util.h>
+#include <ventoy_disk.h>
+
+char g_log_file[PATH_MAX];
+int ventoy_log_init(void);
+void ventoy_log_exit(void);
+
+static char g_test_root[256];
+static int g_dev_open_count = 0;
+static int g_uevent_fake = -1;
+static int g_uevent_peer = -1;
+static int g_fail = 0;
+
+int __real_open(const char *path, int flags, ...);
+int __wrap_open(const char *path, int flags, ...);
+int __real_open64(const char *path, int flags, ...);
+int __wrap_open64(const char *path, int flags, ...);
+int __real_socket(int domain, int type, int protocol);
+int __wrap_socket(int domain, int type, int protocol);
+int __real_bind(int fd, const struct sockaddr *addr, socklen_t len);
+int __wrap_bind(int fd, const struct sockaddr *addr, socklen_t len);
+
+/* with _FILE_OFFSET_BITS=64 glibc redirects open to open64 */
+static int test_open(int large, const char *path, int flags, mode_t mode)
+{
+    char fakepath[PATH_MAX];
+
+    if (strncmp(path, "/dev/", 5) == 0)
+    {
+        g_dev_open_count++;
+        snprintf(fakepath, sizeof(fakepath), "%s/dev/%s", g_test_root, path + 5);
+        path = fakepath;
+    }
+
+    return large ? __real_open64(path, flags, mode) : __real_open(path, flags, mode);
+}
+
+int __wrap_open(const char *path, int flags, ...)
+{
+    mode_t mode = 0;
+    va_list arg;
+
+    if (flags & O_CREAT)
+    {
+        va_start(arg, flags);
+        mode = (mode_t)va_arg(arg, int);
+        va_end(arg);
+    }
+
+    return test_open(0, path, flags, mode);
+}
+
+int __wrap_open64(const char *path, int flags, ...)
+{
+    mode_t mode = 0;
+    va_list arg;
+
+    if (flags & O_CREAT)
+    {
+        va_start(arg, flags);
+        mode = (mode_t)va_arg(arg, int);
+        va_end(arg);
+    }
+
+    return test_open(1, path, flags, mode);
+}
+
+int __wrap_socket(int domain, int type, int protocol)
+{
+    int sv[2];
+
+    if (domain != AF_NETLINK)
+    {
+        return __real_socket(domain, type, protocol);
+    }
+
+    if (socketpair(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, sv) < 0)
+    {
+        return -1;
+    }
+
+    g_uevent_fake = sv[0];
+    g_uevent_peer = sv[1];
+    return g_uevent_fake;
+}
+
+int __wrap_bind(int fd, const struct sockaddr *addr, socklen_t len)
+{
+    if (fd >= 0 && fd == g_uevent_fake)
+    {
+        return 0;
+    }
+
+    return __real_bind(fd, addr, len);
+}
+
+static int write_file(const char *data, const char *fmt, ...)
+{
+    FILE *fp;
+    va_list arg;
+    char path[PATH_MAX];
+
+    va_start(arg, fmt);
+    vsnprintf(path, sizeof(path), fmt, arg);
+    va_end(arg);
+
+    fp = fopen(path, "w");
+    if (!fp)
+    {
+        printf("failed to create %s %d\n", path, errno);
+        return 1;
+    }
+    fputs(data, fp);
+    fclose(fp);
+    return 0;
+}
+
+static int mkdir_p(const char *path)
+{
+    char cmd[PATH_MAX + 16];
+
+    snprintf(cmd, sizeof(cmd), "mkdir -p '%s'", path);
+    return system(cmd) == 0 ? 0 : 1;
+}
+
+static int make_fake_disk(const char *name, int minor, uint64_t size)
+{
+    int fd;
+    char buf[64];
+    char path[PATH_MAX];
+    uint8_t sig[2] = { 0x55, 0xAA };
+
+    snprintf(path, sizeof(path), "%s/sys/block/%s/device", g_test_root, name);
+    if (mkdir_p(path))
+    {
+        return 1;
+    }
+
+    snprintf(buf, sizeof(buf), "8:%d\n", minor);
+    write_file(buf, "%s/sys/block/%s/dev", g_test_root, name);
+    snprintf(buf, sizeof(buf), "%llu\n", (_ull)(size / 512));
+    write_file(buf, "%s/sys/block/%s/size", g_test_root, name);
+    write_file("1\n", "%s/sys/block/%s/diskseq", g_test_root, name);
+    write_file("FAKE\n", "%s/sys/block/%s/device/vendor", g_test_root, name);
+    write_file("Disk\n", "%s/sys/block/%s/device/model", g_test_root, name);
+
+    /* sparse file as the disk, MBR magic only, so no ventoy is found */
+    snprintf(path, sizeof(path), "%s/dev/%s", g_test_root, name);
+    fd = test_open(1, path, O_CREAT | O_RDWR | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        printf("failed to create %s %d\n", path, errno);
+        return 1;
+    }
+    ftruncate(fd, (off_t)size);
+    pwrite(fd, sig, 2, 510);
+    close(fd);
+
+    return 0;
+}
+
+static void remove_fake_disk(const char *name)
+{
+    char cmd[PATH_MAX + 64];
+
+    snprintf(cmd, sizeof(cmd), "rm -rf '%s/sys/block/%s' '%s/dev/%s'", g_test_root, name, g_test_root, name);
+    system(cmd);
+}
+
+static void send_uevent(const char *action, const char *devpath)
+{
+    int len;
+    char buf[512];
+
+    len  = snprintf(buf, sizeof(buf), "%s@%s", action, devpath) + 1;
+    len += snprintf(buf + len, sizeof(buf) - len, "ACTION=%s", action) + 1;
+    len += snprintf(buf + len, sizeof(buf) - len, "DEVPATH=%s", devpath) + 1;
+    len += snprintf(buf + len, sizeof(buf) - len, "SUBSYSTEM=block") + 1;
+
+    send(g_uevent_peer, buf, len, 0);
+}
+
+static void check_refresh(const char *step, int expdisk, int expopen)
+{
+    g_dev_open_count = 0;
+    ventoy_disk_enumerate_all();
+
+    if (g_disk_num != expdisk || g_dev_open_count != expopen)
+    {
+        printf("FAIL %-28s disks:%d(%d) opens:%d(%d)\n", step, g_disk_num, expdisk, g_dev_open_count, expopen);
+        g_fail++;
+    }
+    else
+    {
+        printf("OK   %-28s disks:%d opens:%d\n", step, g_disk_num, g_dev_open_count);
+    }
+}
+
+int main(void)
+{
+    char cmd[PATH_MAX + 16];
+    char path[PATH_MAX];
+
+    snprintf(g_test_root, sizeof(g_test_root), "/tmp/vtoy_disk_test.XXXXXX");
+    if (!mkdtemp(g_test_root))
+    {
+        printf("mkdtemp failed %d\n", errno);
+        return 1;
+    }
+    snprintf(g_log_file, sizeof(g_log_file), "%s/log.txt", g_test_root);
+    snprintf(path, sizeof(path), "%s/dev", g_test_root);
+    mkdir_p(path);
+
+    if (make_fake_disk("sdx", 0, 64ULL * SIZE_1MB) || make_fake_disk("sdy", 16, 128ULL * SIZE_1MB))
+    {
+        return 1;
+    }
+
+    snprintf(path, sizeof(path), "%s/sys", g_test_root);
+    ventoy_disk_set_sysfs_root(path);
+    ventoy_log_init();
+
+    g_dev_open_count = 0;
+    ventoy_disk_init();
+    if (g_uevent_fake < 0)
+    {
+        printf("FAIL uevent socket not created\n");
+        return 1;
+    }
+    printf("%s %-28s disks:%d opens:%d\n", (g_disk_num == 2 && g_dev_open_count == 2) ? "OK  " : "FAIL",
+        "first enumerate", g_disk_num, g_dev_open_count);
+    g_fail += (g_disk_num == 2 && g_dev_open_count == 2) ? 0 : 1;
+
+    check_refresh("no change", 2, 0);
+
+    send_uevent("change", "/devices/virtual/block/sdy/sdy1");
+    check_refresh("uevent on sdy1", 2, 1);
+    check_refresh("no change after uevent", 2, 0);
+
+    write_file("2\n", "%s/sys/block/sdx/diskseq", g_test_root);
+    check_refresh("diskseq changed on sdx", 2, 1);
+
+    ventoy_disk_cache_invalidate(NULL);
+    check_refresh("invalidate all", 2, 2);
+
+    remove_fake_disk("sdy");
+    send_uevent("remove", "/devices/virtual/block/sdy");
+    check_refresh("sdy removed", 1, 0);
+
+    make_fake_disk("sdy", 16, 256ULL * SIZE_1MB);
+    check_refresh("sdy added back", 2, 1);
+
+    ventoy_disk_exit();
+    ventoy_log_exit();
+
+    snprintf(cmd, sizeof(cmd), "rm -rf '%s'", g_test_root);
+    system(cmd);
+
+    printf("%s\n", g_fail ? "disk cache test FAILED" : "disk cache test passed");
+    return g_fail ? 1 : 0;
+}
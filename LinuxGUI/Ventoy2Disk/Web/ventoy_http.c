@@ -30,6 +30,7 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/mount.h>
+#include <sys/resource.h>
 #include <linux/fs.h>
 #include <linux/limits.h>
 #include <dirent.h>
@@ -51,14 +52,233 @@ static int  g_cur_show_all = 0;
 static char g_cur_server_token[64];
 static struct mg_context *g_ventoy_http_ctx = NULL;
 
-static uint32_t g_efi_part_offset = 0;
-static uint8_t *g_efi_part_raw_img = NULL;
+/* per worker thread, the xz callbacks have no context parameter */
+static __thread int g_efi_part_xz_fd = -1;
+static __thread int g_efi_part_disk_fd = -1;
+static __thread uint64_t g_efi_part_disk_offset = 0;
+static __thread uint32_t g_efi_part_offset = 0;
+static __thread uint32_t g_efi_part_wbuf_len = 0;
+static __thread uint8_t *g_efi_part_wbuf = NULL;
+static __thread uint32_t g_efi_part_crc[VTOYEFI_PART_BYTES / SIZE_1MB];
+
+static int g_fat_cache_fd = -1;
+static uint64_t g_fat_cache_offset = 0;
+static ventoy_fat_cache *g_fat_cache = NULL;
 static uint8_t *g_grub_stg1_raw_img = NULL;
 
-static char g_cur_process_diskname[64];
-static char g_cur_process_type[64];
-static volatile int g_cur_process_result = 0;
-static volatile PROGRESS_POINT g_current_progress = PT_FINISH;
+static pthread_mutex_t g_job_mutex;
+static pthread_mutex_t g_disk_mutex;
+static pthread_mutex_t g_refresh_mutex;
+static pthread_mutex_t g_stg1_mutex;
+static pthread_mutex_t g_mkexfat_mutex;
+static ventoy_job *g_job_list = NULL;
+static int g_last_job = -1;
+static volatile int g_disk_refreshing = 0;
+static __thread ventoy_job *g_cur_job = NULL;
+
+#define VTOY_JOB_CHECK_CANCEL() \
+    if (ventoy_job_canceled()) \
+    { \
+        vlog("%s is canceled\n", disk->disk_name); \
+        goto err; \
+    }
+
+static void ventoy_set_progress(PROGRESS_POINT pt)
+{
+    if (g_cur_job)
+    {
+        g_cur_job->progress = pt;
+    }
+}
+
+static int ventoy_job_canceled(void)
+{
+    return (g_cur_job && g_cur_job->cancel) ? 1 : 0;
+}
+
+static const char * ventoy_job_result_str(ventoy_job *job)
+{
+    if (job == NULL || job->result == VTOY_JOB_RESULT_SUCCESS)
+    {
+        return "success";
+    }
+    else if (job->result == VTOY_JOB_RESULT_CANCELED)
+    {
+        return "canceled";
+    }
+    return "failed";
+}
+
+static ventoy_job * ventoy_last_job(void)
+{
+    return (g_last_job >= 0) ? g_job_list + g_last_job : NULL;
+}
+
+static int ventoy_any_job_running(void)
+{
+    int i;
+
+    for (i = 0; i < VTOY_MAX_JOB_NUM; i++)
+    {
+        if (g_job_list[i].running)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* must be called with g_job_mutex held */
+static ventoy_job * ventoy_find_job(const char *diskname)
+{
+    int i;
+
+    for (i = 0; i < VTOY_MAX_JOB_NUM; i++)
+    {
+        if (g_job_list[i].used && strcmp(g_job_list[i].diskname, diskname) == 0)
+        {
+            return g_job_list + i;
+        }
+    }
+    return NULL;
+}
+
+/* reserve a job slot for the disk, NULL if the disk is busy or no free slot */
+static ventoy_job * ventoy_job_alloc(const char *type, const char *diskname)
+{
+    int i;
+    ventoy_job *job = NULL;
+
+    pthread_mutex_lock(&g_job_mutex);
+
+    job = ventoy_find_job(diskname);
+    if (job && job->running)
+    {
+        job = NULL;
+        goto end;
+    }
+
+    for (i = 0; job == NULL && i < VTOY_MAX_JOB_NUM; i++)
+    {
+        if (g_job_list[i].used == 0)
+        {
+            job = g_job_list + i;
+        }
+    }
+
+    /* reuse the slot of a finished job */
+    for (i = 0; job == NULL && i < VTOY_MAX_JOB_NUM; i++)
+    {
+        if (g_job_list[i].running == 0)
+        {
+            job = g_job_list + i;
+        }
+    }
+
+    if (job)
+    {
+        job->used = 1;
+        job->running = 1;
+        job->cancel = 0;
+        job->result = VTOY_JOB_RESULT_SUCCESS;
+        job->progress = PT_START;
+        scnprintf(job->type, "%s", type);
+        scnprintf(job->diskname, "%s", diskname);
+    }
+
+end:
+    pthread_mutex_unlock(&g_job_mutex);
+    return job;
+}
+
+static void ventoy_job_release(ventoy_job *job)
+{
+    pthread_mutex_lock(&g_job_mutex);
+    if (g_last_job == (int)(job - g_job_list))
+    {
+        g_last_job = -1;
+    }
+    job->running = 0;
+    job->used = 0;
+    job->progress = PT_FINISH;
+    pthread_mutex_unlock(&g_job_mutex);
+}
+
+static void ventoy_job_start(ventoy_job *job)
+{
+    pthread_mutex_lock(&g_job_mutex);
+    g_last_job = (int)(job - g_job_list);
+    pthread_mutex_unlock(&g_job_mutex);
+}
+
+static void ventoy_job_finish(int failed)
+{
+    /* disk content changed, don't use the cached info anymore */
+    ventoy_disk_cache_invalidate(g_cur_job->diskname);
+
+    if (failed)
+    {
+        g_cur_job->result = g_cur_job->cancel ? VTOY_JOB_RESULT_CANCELED : VTOY_JOB_RESULT_FAILED;
+    }
+    g_cur_job->progress = PT_FINISH;
+    g_cur_job->running = 0;
+    g_cur_job = NULL;
+}
+
+/* copy the disk info from the cached disk list, 0: found */
+static int ventoy_find_disk(const char *diskname, ventoy_disk *disk)
+{
+    int i;
+    int rc = 1;
+
+    pthread_mutex_lock(&g_disk_mutex);
+    for (i = 0; i < g_disk_num; i++)
+    {
+        if (strcmp(g_disk_list[i].disk_name, diskname) == 0)
+        {
+            memcpy(disk, g_disk_list + i, sizeof(ventoy_disk));
+            rc = 0;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&g_disk_mutex);
+
+    return rc;
+}
+
+/* enumerate into a temp list, so the cached list is only locked for the copy */
+static int ventoy_refresh_disk_list(void)
+{
+    int num;
+    ventoy_disk *list = NULL;
+
+    pthread_mutex_lock(&g_refresh_mutex);
+    g_disk_refreshing = 1;
+
+    list = malloc(sizeof(ventoy_disk) * MAX_DISK_NUM);
+    if (list)
+    {
+        num = ventoy_disk_enumerate_list(list, MAX_DISK_NUM);
+
+        pthread_mutex_lock(&g_disk_mutex);
+        memcpy(g_disk_list, list, sizeof(ventoy_disk) * num);
+        g_disk_num = num;
+        pthread_mutex_unlock(&g_disk_mutex);
+
+        free(list);
+    }
+
+    g_disk_refreshing = 0;
+    pthread_mutex_unlock(&g_refresh_mutex);
+    return list ? 0 : 1;
+}
+
+static void * ventoy_refresh_thread(void *data)
+{
+    (void)data;
+    ventoy_refresh_disk_list();
+    return NULL;
+}
 
 static int ventoy_load_mbr_template(void)
 {
@@ -78,47 +298,101 @@ static int ventoy_load_mbr_template(void)
     return 0;
 }
 
+static int ventoy_disk_xz_fill(void *dest, unsigned int size)
+{
+    return (int)read(g_efi_part_xz_fd, dest, size);
+}
+
 static int ventoy_disk_xz_flush(void *src, unsigned int size)
 {
-    memcpy(g_efi_part_raw_img + g_efi_part_offset, src, size);
-    g_efi_part_offset += size;
+    ssize_t len;
+    uint32_t copy;
+    uint32_t left = size;
+    uint8_t *data = (uint8_t *)src;
+
+    while (left > 0)
+    {
+        copy = SIZE_1MB - g_efi_part_wbuf_len;
+        if (copy > left)
+        {
+            copy = left;
+        }
+
+        memcpy(g_efi_part_wbuf + g_efi_part_wbuf_len, data, copy);
+        g_efi_part_wbuf_len += copy;
+        data += copy;
+        left -= copy;
+
+        if (g_efi_part_wbuf_len == SIZE_1MB)
+        {
+            if (ventoy_job_canceled())
+            {
+                return -1;
+            }
+
+            if (g_efi_part_offset + SIZE_1MB > VTOYEFI_PART_BYTES)
+            {
+                vlog("disk img is larger than part2\n");
+                return -1;
+            }
+
+            len = pwrite(g_efi_part_disk_fd, g_efi_part_wbuf, SIZE_1MB, g_efi_part_disk_offset + g_efi_part_offset);
+            if (len != SIZE_1MB)
+            {
+                vlog("write part2 failed offset:%u len:%lld err:%d\n", g_efi_part_offset, (_ll)len, errno);
+                return -1;
+            }
+
+            g_efi_part_offset += SIZE_1MB;
+            g_efi_part_wbuf_len = 0;
+            ventoy_set_progress(PT_WRITE_VENTOY_START + (g_efi_part_offset / SIZE_1MB) / 4);
+        }
+    }
 
-    g_current_progress = PT_LOAD_DISK_IMG + (g_efi_part_offset / SIZE_1MB);
     return (int)size;
 }
 
-static int ventoy_unxz_efipart_img(void)
+/*
+ * Decompress ventoy.disk.img.xz and write it directly to part2 as we go.
+ * Only the xz dictionary and a 1MB write buffer are kept in memory.
+ */
+static int ventoy_unxz_efipart_img(int fd, uint64_t offset)
 {
     int rc;
-    int inlen;
-    int xzlen;
-    void *xzbuf = NULL;
-    uint8_t *buf = NULL;
+    int inlen = 0;
 
-    rc = ventoy_read_file_to_buf(VENTOY_FILE_DISK_IMG, 0, &xzbuf, &xzlen);
-    vdebug("read disk.img.xz rc:%d len:%d\n", rc, xzlen);
-
-    if (g_efi_part_raw_img)
+    g_efi_part_xz_fd = open(VENTOY_FILE_DISK_IMG, O_RDONLY | O_BINARY);
+    if (g_efi_part_xz_fd < 0)
     {
-        buf = g_efi_part_raw_img;
+        vlog("Failed to open file %s err:%d\n", VENTOY_FILE_DISK_IMG, errno);
+        return 1;
     }
-    else
+
+    g_efi_part_wbuf = malloc(SIZE_1MB);
+    if (!g_efi_part_wbuf)
     {
-        buf = malloc(VTOYEFI_PART_BYTES);
-        if (!buf)
-        {
-            check_free(xzbuf);
-            return 1;
-        }
+        vtoy_safe_close_fd(g_efi_part_xz_fd);
+        return 1;
     }
 
+    g_efi_part_disk_fd = fd;
+    g_efi_part_disk_offset = offset;
     g_efi_part_offset = 0;
-    g_efi_part_raw_img = buf;
-    
-    rc = unxz(xzbuf, xzlen, NULL, ventoy_disk_xz_flush, buf, &inlen, NULL);
+    g_efi_part_wbuf_len = 0;
+
+    rc = unxz(NULL, 0, ventoy_disk_xz_fill, ventoy_disk_xz_flush, NULL, &inlen, NULL);
     vdebug("ventoy_unxz_efipart_img len:%d rc:%d unxzlen:%u\n", inlen, rc, g_efi_part_offset);
 
-    check_free(xzbuf);
+    check_free(g_efi_part_wbuf);
+    g_efi_part_wbuf = NULL;
+    vtoy_safe_close_fd(g_efi_part_xz_fd);
+
+    if (rc || g_efi_part_wbuf_len || g_efi_part_offset != VTOYEFI_PART_BYTES)
+    {
+        vlog("unxz disk img failed rc:%d unxzlen:%u left:%u\n", rc, g_efi_part_offset, g_efi_part_wbuf_len);
+        return 1;
+    }
+
     return 0;
 }
 
@@ -130,21 +404,23 @@ static int ventoy_unxz_stg1_img(void)
     void *xzbuf = NULL;
     uint8_t *buf = NULL;
 
-    rc = ventoy_read_file_to_buf(VENTOY_FILE_STG1_IMG, 0, &xzbuf, &xzlen);
-    vdebug("read core.img.xz rc:%d len:%d\n", rc, xzlen);
-
+    /* loaded only once and shared (read only) by all the worker threads */
+    pthread_mutex_lock(&g_stg1_mutex);
     if (g_grub_stg1_raw_img)
     {
-        buf = g_grub_stg1_raw_img;
+        pthread_mutex_unlock(&g_stg1_mutex);
+        return 0;
     }
-    else
+
+    rc = ventoy_read_file_to_buf(VENTOY_FILE_STG1_IMG, 0, &xzbuf, &xzlen);
+    vdebug("read core.img.xz rc:%d len:%d\n", rc, xzlen);
+
+    buf = zalloc(SIZE_1MB);
+    if (!buf)
     {
-        buf = zalloc(SIZE_1MB);
-        if (!buf)
-        {
-            check_free(xzbuf);
-            return 1;
-        }
+        check_free(xzbuf);
+        pthread_mutex_unlock(&g_stg1_mutex);
+        return 1;
     }
     
     rc = unxz(xzbuf, xzlen, NULL, NULL, buf, &inlen, NULL);
@@ -153,6 +429,7 @@ static int ventoy_unxz_stg1_img(void)
     g_grub_stg1_raw_img = buf;
 
     check_free(xzbuf);
+    pthread_mutex_unlock(&g_stg1_mutex);
     return 0;
 }
 
@@ -276,9 +553,13 @@ static int ventoy_api_sysinfo(struct mg_connection *conn, VTOY_JSON *json)
     int buflen = 0;
     char buf[512];
     
+    ventoy_job *job = NULL;
+    
     (void)json;
 
-    busy = (g_current_progress == PT_FINISH) ? 0 : 1;
+    pthread_mutex_lock(&g_job_mutex);
+    busy = ventoy_any_job_running();
+    job = ventoy_last_job();
 
     buflen = sizeof(buf) - 1;
     VTOY_JSON_FMT_BEGIN(pos, buf, buflen);
@@ -288,10 +569,11 @@ static int ventoy_api_sysinfo(struct mg_connection *conn, VTOY_JSON *json)
     VTOY_JSON_FMT_STRN("ventoy_ver", ventoy_get_local_version());
     VTOY_JSON_FMT_UINT("partstyle", g_cur_part_style);
     VTOY_JSON_FMT_BOOL("busy", busy);
-    VTOY_JSON_FMT_STRN("process_disk", g_cur_process_diskname);
-    VTOY_JSON_FMT_STRN("process_type", g_cur_process_type);
+    VTOY_JSON_FMT_STRN("process_disk", job ? job->diskname : "");
+    VTOY_JSON_FMT_STRN("process_type", job ? job->type : "");
     VTOY_JSON_FMT_OBJ_END();
     VTOY_JSON_FMT_END(pos);
+    pthread_mutex_unlock(&g_job_mutex);
 
     ventoy_json_buffer(conn, buf, pos);
     return 0;
@@ -302,23 +584,123 @@ static int ventoy_api_get_percent(struct mg_connection *conn, VTOY_JSON *json)
     int pos = 0;
     int buflen = 0;
     int percent = 0;
-    char buf[128];
-    
-    (void)json;
+    char buf[256];
+    ventoy_job *job = NULL;
+    const char *diskname = NULL;
 
-    percent = g_current_progress * 100 / PT_FINISH;
+    /* without disk parameter, return the last started job */
+    diskname = vtoy_json_get_string_ex(json, "disk");
+
+    pthread_mutex_lock(&g_job_mutex);
+    job = diskname ? ventoy_find_job(diskname) : ventoy_last_job();
+    if (diskname && job == NULL)
+    {
+        pthread_mutex_unlock(&g_job_mutex);
+        ventoy_json_result(conn, VTOY_JSON_NOTFOUND_RET);
+        return 0;
+    }
+
+    percent = (job ? job->progress : PT_FINISH) * 100 / PT_FINISH;
 
     buflen = sizeof(buf) - 1;
     VTOY_JSON_FMT_BEGIN(pos, buf, buflen);
     VTOY_JSON_FMT_OBJ_BEGIN();
-    VTOY_JSON_FMT_STRN("result", g_cur_process_result ? "failed" : "success");
-    VTOY_JSON_FMT_STRN("process_disk", g_cur_process_diskname);
-    VTOY_JSON_FMT_STRN("process_type", g_cur_process_type);
+    VTOY_JSON_FMT_STRN("result", ventoy_job_result_str(job));
+    VTOY_JSON_FMT_STRN("process_disk", job ? job->diskname : "");
+    VTOY_JSON_FMT_STRN("process_type", job ? job->type : "");
     VTOY_JSON_FMT_UINT("percent", percent);
+    VTOY_JSON_FMT_BOOL("busy", job ? job->running : 0);
+    VTOY_JSON_FMT_OBJ_END();
+    VTOY_JSON_FMT_END(pos);
+    pthread_mutex_unlock(&g_job_mutex);
+
+    ventoy_json_buffer(conn, buf, pos);
+    return 0;
+}
+
+static int ventoy_api_get_job_list(struct mg_connection *conn, VTOY_JSON *json)
+{
+    int i;
+    int pos = 0;
+    int buflen = 0;
+    char *buf = NULL;
+    ventoy_job *job = NULL;
+
+    (void)json;
+
+    buflen = VTOY_MAX_JOB_NUM * 256;
+    buf = (char *)malloc(buflen + 1024);
+    if (!buf)
+    {
+        ventoy_json_result(conn, VTOY_JSON_FAILED_RET);
+        return 0;
+    }
+
+    pthread_mutex_lock(&g_job_mutex);
+
+    VTOY_JSON_FMT_BEGIN(pos, buf, buflen);
+    VTOY_JSON_FMT_OBJ_BEGIN();
+    VTOY_JSON_FMT_KEY("list");
+    VTOY_JSON_FMT_ARY_BEGIN();
+
+    for (i = 0; i < VTOY_MAX_JOB_NUM; i++)
+    {
+        job = g_job_list + i;
+        if (job->used == 0)
+        {
+            continue;
+        }
+
+        VTOY_JSON_FMT_OBJ_BEGIN();
+        VTOY_JSON_FMT_STRN("disk", job->diskname);
+        VTOY_JSON_FMT_STRN("type", job->type);
+        VTOY_JSON_FMT_UINT("percent", job->progress * 100 / PT_FINISH);
+        VTOY_JSON_FMT_BOOL("busy", job->running);
+        VTOY_JSON_FMT_STRN("result", ventoy_job_result_str(job));
+        VTOY_JSON_FMT_OBJ_ENDEX();
+    }
+
+    VTOY_JSON_FMT_ARY_END();
     VTOY_JSON_FMT_OBJ_END();
     VTOY_JSON_FMT_END(pos);
 
+    pthread_mutex_unlock(&g_job_mutex);
+
     ventoy_json_buffer(conn, buf, pos);
+    free(buf);
+    return 0;
+}
+
+static int ventoy_api_cancel(struct mg_connection *conn, VTOY_JSON *json)
+{
+    int running = 0;
+    ventoy_job *job = NULL;
+    const char *diskname = NULL;
+
+    diskname = vtoy_json_get_string_ex(json, "disk");
+    if (diskname == NULL)
+    {
+        ventoy_json_result(conn, VTOY_JSON_INVALID_RET);
+        return 0;
+    }
+
+    pthread_mutex_lock(&g_job_mutex);
+    job = ventoy_find_job(diskname);
+    if (job && job->running)
+    {
+        vlog("cancel %s %s ...\n", job->type, diskname);
+        job->cancel = 1;
+        running = 1;
+    }
+    pthread_mutex_unlock(&g_job_mutex);
+
+    if (running == 0)
+    {
+        ventoy_json_result(conn, VTOY_JSON_NOTRUNNING_RET);
+        return 0;
+    }
+
+    ventoy_json_result(conn, VTOY_JSON_SUCCESS_RET);
     return 0;
 }
 
@@ -329,8 +711,10 @@ static int ventoy_api_set_language(struct mg_connection *conn, VTOY_JSON *json)
     lang = vtoy_json_get_string_ex(json, "language");
     if (lang)
     {
+        pthread_mutex_lock(&g_api_mutex);
         scnprintf(g_cur_language, "%s", lang);
         ventoy_http_save_cfg();
+        pthread_mutex_unlock(&g_api_mutex);
     }
 
     ventoy_json_result(conn, VTOY_JSON_SUCCESS_RET);
@@ -347,8 +731,10 @@ static int ventoy_api_set_partstyle(struct mg_connection *conn, VTOY_JSON *json)
     {
         if ((style == 0) || (style == 1))
         {
+            pthread_mutex_lock(&g_api_mutex);
             g_cur_part_style = style;
             ventoy_http_save_cfg();            
+            pthread_mutex_unlock(&g_api_mutex);
         }
     }
 
@@ -391,15 +777,20 @@ static int ventoy_write_legacy_grub(int fd, int partstyle)
 {
     ssize_t len;
     off_t offset;
+    uint8_t sector[512];
     
     if (partstyle)
     {
         vlog("Write GPT stage1 ...\n");
 
+        /* the stage1 image is shared by all the jobs, update blocklist in a copy */
+        memcpy(sector, g_grub_stg1_raw_img, 512);
+        sector[500] = 35;
+
         offset = lseek(fd, 512 * 34, SEEK_SET);
 
-        g_grub_stg1_raw_img[500] = 35;//update blocklist
-        len = write(fd, g_grub_stg1_raw_img, SIZE_1MB - 512 * 34);
+        len = write(fd, sector, 512);
+        len += write(fd, g_grub_stg1_raw_img + 512, SIZE_1MB - 512 * 34 - 512);
 
         vlog("lseek offset:%llu(%u) writelen:%llu(%u)\n", (_ull)offset, 512 * 34, (_ull)len, SIZE_1MB - 512 * 34);
         if (SIZE_1MB - 512 * 34 != len)
@@ -425,29 +816,117 @@ static int ventoy_write_legacy_grub(int fd, int partstyle)
     return 0;
 }
 
-static int VentoyFatMemRead(uint32 Sector, uint8 *Buffer, uint32 SectorCount)
+static int ventoy_fat_cache_writeback(ventoy_fat_cache *cache)
+{
+    ssize_t len;
+
+    if (cache->valid && cache->dirty)
+    {
+        len = pwrite(g_fat_cache_fd, cache->data, 512, g_fat_cache_offset + (uint64_t)cache->sector * 512);
+        if (len != 512)
+        {
+            vlog("fat cache write back sector %u failed err:%d\n", cache->sector, errno);
+            return 1;
+        }
+        cache->dirty = 0;
+    }
+
+    return 0;
+}
+
+static ventoy_fat_cache * ventoy_fat_cache_get(uint32 Sector, int load)
+{
+    ssize_t len;
+    ventoy_fat_cache *cache = g_fat_cache + (Sector % VTOY_FAT_CACHE_NUM);
+
+    if (cache->valid && cache->sector == Sector)
+    {
+        return cache;
+    }
+
+    if (ventoy_fat_cache_writeback(cache))
+    {
+        return NULL;
+    }
+
+    cache->valid = 0;
+    cache->sector = Sector;
+
+    if (load)
+    {
+        len = pread(g_fat_cache_fd, cache->data, 512, g_fat_cache_offset + (uint64_t)Sector * 512);
+        if (len != 512)
+        {
+            vlog("fat cache read sector %u failed err:%d\n", Sector, errno);
+            return NULL;
+        }
+    }
+
+    cache->valid = 1;
+    return cache;
+}
+
+static int ventoy_fat_cache_init(int fd, uint64_t offset)
+{
+    g_fat_cache = zalloc(sizeof(ventoy_fat_cache) * VTOY_FAT_CACHE_NUM);
+    if (!g_fat_cache)
+    {
+        return 1;
+    }
+
+    g_fat_cache_fd = fd;
+    g_fat_cache_offset = offset;
+    return 0;
+}
+
+static int ventoy_fat_cache_exit(void)
+{
+    int i;
+    int rc = 0;
+
+    for (i = 0; i < VTOY_FAT_CACHE_NUM; i++)
+    {
+        rc |= ventoy_fat_cache_writeback(g_fat_cache + i);
+    }
+
+    check_free(g_fat_cache);
+    g_fat_cache = NULL;
+    g_fat_cache_fd = -1;
+    return rc;
+}
+
+static int VentoyFatDiskRead(uint32 Sector, uint8 *Buffer, uint32 SectorCount)
 {
 	uint32 i;
-	uint32 offset;
+    ventoy_fat_cache *cache = NULL;
 
 	for (i = 0; i < SectorCount; i++)
 	{
-		offset = (Sector + i) * 512;
-        memcpy(Buffer + i * 512, g_efi_part_raw_img + offset, 512);
+        cache = ventoy_fat_cache_get(Sector + i, 1);
+        if (!cache)
+        {
+            return 0;
+        }
+        memcpy(Buffer + i * 512, cache->data, 512);
 	}
 
 	return 1;
 }
 
-static int VentoyFatMemWrite(uint32 Sector, uint8 *Buffer, uint32 SectorCount)
+static int VentoyFatDiskWrite(uint32 Sector, uint8 *Buffer, uint32 SectorCount)
 {
 	uint32 i;
-	uint32 offset;
+    ventoy_fat_cache *cache = NULL;
 
 	for (i = 0; i < SectorCount; i++)
 	{
-		offset = (Sector + i) * 512;
-        memcpy(g_efi_part_raw_img + offset, Buffer + i * 512, 512);
+        cache = ventoy_fat_cache_get(Sector + i, 0);
+        if (!cache)
+        {
+            return 0;
+        }
+        memcpy(cache->data, Buffer + i * 512, 512);
+        cache->dirty = 1;
 	}
 
 	return 1;
@@ -470,7 +949,7 @@ static int VentoyProcSecureBoot(int SecureBoot)
 
 	fl_init();
 
-	if (0 == fl_attach_media(VentoyFatMemRead, VentoyFatMemWrite))
+	if (0 == fl_attach_media(VentoyFatDiskRead, VentoyFatDiskWrite))
 	{
 		file = fl_fopen("/EFI/BOOT/grubx64_real.efi", "rb");
 		vlog("Open ventoy efi file %p \n", file);
@@ -573,6 +1052,7 @@ static int VentoyProcSecureBoot(int SecureBoot)
 static int ventoy_check_efi_part_data(int fd, uint64_t offset)
 {
     int i;
+    int rc = 0;
     ssize_t len;
     char *buf;
 
@@ -586,44 +1066,99 @@ static int ventoy_check_efi_part_data(int fd, uint64_t offset)
     for (i = 0; i < 32; i++)
     {
         len = read(fd, buf, SIZE_1MB);
-        if (len != SIZE_1MB || memcmp(buf, g_efi_part_raw_img + i * SIZE_1MB, SIZE_1MB))
+        if (len != SIZE_1MB || ventoy_crc32(buf, SIZE_1MB) != g_efi_part_crc[i])
         {
             vlog("part2 data check failed i=%d len:%llu\n", i, (_ull)len);
-            return 1;
+            rc = 1;
+            break;
         }
 
-        g_current_progress = PT_CHECK_PART2 + (i / 4);
+        ventoy_set_progress(PT_CHECK_PART2 + (i / 4));
     }
 
-    return 0;
+    free(buf);
+    return rc;
 }
 
-static int ventoy_write_efipart(int fd, uint64_t offset, uint32_t secureboot)
+/*
+ * Record the checksum of what we have written to part2, it will be compared
+ * with the data read back from the device after it is reopened.
+ */
+static int ventoy_calc_efi_part_crc(int fd, uint64_t offset)
 {
     int i;
     ssize_t len;
-    
-    vlog("Formatting part2 EFI offset:%llu ...\n", (_ull)offset);
-    lseek(fd, offset, SEEK_SET);
+    char *buf;
 
-    VentoyProcSecureBoot((int)secureboot);
+    buf = malloc(SIZE_1MB);
+    if (!buf)
+    {
+        return 1;
+    }
 
-    g_current_progress = PT_WRITE_VENTOY_START;
     for (i = 0; i < 32; i++)
     {
-        len = write(fd, g_efi_part_raw_img + i * SIZE_1MB, SIZE_1MB);
-        vlog("write disk writelen:%lld datalen:%d [ %s ]\n", 
-            (_ll)len, SIZE_1MB, (len == SIZE_1MB) ? "success" : "failed");
-        
+        len = pread(fd, buf, SIZE_1MB, offset + (uint64_t)i * SIZE_1MB);
         if (len != SIZE_1MB)
         {
-            vlog("failed to format part2 EFI\n");
+            vlog("read back part2 failed i=%d len:%lld err:%d\n", i, (_ll)len, errno);
+            free(buf);
             return 1;
         }
-    
-        g_current_progress = PT_WRITE_VENTOY_START + i / 4;
+        g_efi_part_crc[i] = ventoy_crc32(buf, SIZE_1MB);
     }
 
+    free(buf);
+    return 0;
+}
+
+static int ventoy_write_efipart(int fd, uint64_t offset, uint32_t secureboot)
+{
+    int rc;
+    uint64_t ms;
+    struct rusage usage;
+    struct timespec start, end;
+
+    vlog("Formatting part2 EFI offset:%llu ...\n", (_ull)offset);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    ventoy_set_progress(PT_WRITE_VENTOY_START);
+    if (ventoy_unxz_efipart_img(fd, offset))
+    {
+        vlog("failed to format part2 EFI\n");
+        return 1;
+    }
+
+    /* fat_io_lib and the sector cache are global, one user at a time */
+    pthread_mutex_lock(&g_fatlib_mutex);
+    if (ventoy_fat_cache_init(fd, offset))
+    {
+        pthread_mutex_unlock(&g_fatlib_mutex);
+        return 1;
+    }
+
+    VentoyProcSecureBoot((int)secureboot);
+
+    rc = ventoy_fat_cache_exit();
+    pthread_mutex_unlock(&g_fatlib_mutex);
+    if (rc)
+    {
+        vlog("failed to write back part2 FAT data\n");
+        return 1;
+    }
+
+    if (ventoy_calc_efi_part_crc(fd, offset))
+    {
+        return 1;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    getrusage(RUSAGE_SELF, &usage);
+
+    ms = (uint64_t)(end.tv_sec - start.tv_sec) * 1000 + (end.tv_nsec - start.tv_nsec) / 1000000;
+    vlog("write part2 EFI success time:%llums maxrss:%ldKB\n", (_ull)ms, (long)usage.ru_maxrss);
+
     return 0;
 }
 
@@ -687,6 +1222,7 @@ static void * ventoy_update_thread(void *data)
     int fd;
     ssize_t len;
     off_t offset;
+    int failed = 0;
     MBR_HEAD MBR;
     ventoy_disk *disk = NULL;
     ventoy_thread_data *thread = (ventoy_thread_data *)data;
@@ -695,8 +1231,9 @@ static void * ventoy_update_thread(void *data)
 
     fd = thread->diskfd;
     disk = thread->disk;
+    g_cur_job = thread->job;
 
-    g_current_progress = PT_PRAPARE_FOR_CLEAN;
+    ventoy_set_progress(PT_PRAPARE_FOR_CLEAN);
     vdebug("check disk %s\n", disk->disk_name);
     if (ventoy_is_disk_mounted(disk->disk_path))
     {
@@ -714,13 +1251,12 @@ static void * ventoy_update_thread(void *data)
         vlog("disk is not mounted now, we can do continue ...\n");
     }
 
-    g_current_progress = PT_LOAD_CORE_IMG;
+    VTOY_JOB_CHECK_CANCEL();
+    ventoy_set_progress(PT_LOAD_CORE_IMG);
     ventoy_unxz_stg1_img();
     
-    g_current_progress = PT_LOAD_DISK_IMG;
-    ventoy_unxz_efipart_img();
-
-    g_current_progress = PT_FORMAT_PART2;
+    VTOY_JOB_CHECK_CANCEL();
+    ventoy_set_progress(PT_FORMAT_PART2);
 
     vlog("Formatting part2 EFI ...\n");
     if (0 != ventoy_write_efipart(fd, disk->vtoydata.part2_start_sector * 512, thread->secure_boot))
@@ -729,7 +1265,8 @@ static void * ventoy_update_thread(void *data)
         goto err;
     }
 
-    g_current_progress = PT_WRITE_STG1_IMG;
+    VTOY_JOB_CHECK_CANCEL();
+    ventoy_set_progress(PT_WRITE_STG1_IMG);
 
     vlog("Writing legacy grub ...\n");
     if (0 != ventoy_write_legacy_grub(fd, disk->vtoydata.partition_style))
@@ -755,13 +1292,13 @@ static void * ventoy_update_thread(void *data)
         vlog("set MBR partition 1 active flag enabled offset:%llu len:%llu\n", (_ull)offset, (_ull)len);
     }
     
-    g_current_progress = PT_SYNC_DATA1;
+    ventoy_set_progress(PT_SYNC_DATA1);
 
     vlog("fsync data1...\n");
     fsync(fd);
     vtoy_safe_close_fd(fd);
 
-    g_current_progress = PT_SYNC_DATA2;
+    ventoy_set_progress(PT_SYNC_DATA2);
 
     vlog("====================================\n");
     vlog("====== ventoy update success ======\n");
@@ -769,11 +1306,11 @@ static void * ventoy_update_thread(void *data)
     goto end;
 
 err:
-    g_cur_process_result = 1;
+    failed = 1;
     vtoy_safe_close_fd(fd);        
 
 end:
-    g_current_progress = PT_FINISH;
+    ventoy_job_finish(failed);
 
     check_free(thread);
     
@@ -785,6 +1322,8 @@ static void * ventoy_install_thread(void *data)
     int fd;
     ssize_t len;
     off_t offset;
+    int rc;
+    int failed = 0;
     MBR_HEAD MBR;
     ventoy_disk *disk = NULL;
     VTOY_GPT_INFO *gpt = NULL;
@@ -797,8 +1336,9 @@ static void * ventoy_install_thread(void *data)
 
     fd = thread->diskfd;
     disk = thread->disk;
+    g_cur_job = thread->job;
 
-    g_current_progress = PT_PRAPARE_FOR_CLEAN;
+    ventoy_set_progress(PT_PRAPARE_FOR_CLEAN);
     vdebug("check disk %s\n", disk->disk_name);
     if (ventoy_is_disk_mounted(disk->disk_path))
     {
@@ -816,15 +1356,13 @@ static void * ventoy_install_thread(void *data)
         vlog("disk is not mounted now, we can do continue ...\n");
     }
 
-    g_current_progress = PT_DEL_ALL_PART;
+    VTOY_JOB_CHECK_CANCEL();
+    ventoy_set_progress(PT_DEL_ALL_PART);
     ventoy_clean_disk(fd, disk->size_in_byte);
     
-    g_current_progress = PT_LOAD_CORE_IMG;
+    ventoy_set_progress(PT_LOAD_CORE_IMG);
     ventoy_unxz_stg1_img();
     
-    g_current_progress = PT_LOAD_DISK_IMG;
-    ventoy_unxz_efipart_img();
-
     if (thread->partstyle)
     {
         vdebug("Fill GPT part table\n");
@@ -852,15 +1390,22 @@ static void * ventoy_install_thread(void *data)
         sleep(1);
     }
 
-    g_current_progress = PT_FORMAT_PART1;
+    VTOY_JOB_CHECK_CANCEL();
+    ventoy_set_progress(PT_FORMAT_PART1);
     vlog("Formatting part1 exFAT %s ...\n", disk->disk_path);
-    if (0 != mkexfat_main(disk->disk_path, fd, Part1SectorCount))
+
+    /* mkexfat keeps the disk fd and part size in globals */
+    pthread_mutex_lock(&g_mkexfat_mutex);
+    rc = mkexfat_main(disk->disk_path, fd, Part1SectorCount);
+    pthread_mutex_unlock(&g_mkexfat_mutex);
+    if (0 != rc)
     {
         vlog("Failed to format exfat ...\n");
         goto err;
     }
 
-    g_current_progress = PT_FORMAT_PART2;
+    VTOY_JOB_CHECK_CANCEL();
+    ventoy_set_progress(PT_FORMAT_PART2);
     vlog("Formatting part2 EFI ...\n");
     if (0 != ventoy_write_efipart(fd, Part2StartSector * 512, thread->secure_boot))
     {
@@ -868,7 +1413,8 @@ static void * ventoy_install_thread(void *data)
         goto err;
     }
 
-    g_current_progress = PT_WRITE_STG1_IMG;
+    VTOY_JOB_CHECK_CANCEL();
+    ventoy_set_progress(PT_WRITE_STG1_IMG);
     vlog("Writing legacy grub ...\n");
     if (0 != ventoy_write_legacy_grub(fd, thread->partstyle))
     {
@@ -876,14 +1422,14 @@ static void * ventoy_install_thread(void *data)
         goto err;
     }
 
-    g_current_progress = PT_SYNC_DATA1;
+    ventoy_set_progress(PT_SYNC_DATA1);
     vlog("fsync data1...\n");
     fsync(fd);
     vtoy_safe_close_fd(fd);
 
     /* reopen for check part2 data */
     vlog("Checking part2 efi data %s ...\n", disk->disk_path);
-    g_current_progress = PT_CHECK_PART2;
+    ventoy_set_progress(PT_CHECK_PART2);
     fd = open(disk->disk_path, O_RDONLY | O_BINARY);
     if (fd < 0)
     {
@@ -904,7 +1450,7 @@ static void * ventoy_install_thread(void *data)
     vtoy_safe_close_fd(fd);
     
     /* reopen for write part table */
-    g_current_progress = PT_WRITE_PART_TABLE;
+    ventoy_set_progress(PT_WRITE_PART_TABLE);
     vlog("Writting Partition Table style:%d...\n", thread->partstyle);
 
     fd = open(disk->disk_path, O_RDWR | O_BINARY);
@@ -929,7 +1475,7 @@ static void * ventoy_install_thread(void *data)
         }
     }
 
-    g_current_progress = PT_SYNC_DATA2;
+    ventoy_set_progress(PT_SYNC_DATA2);
     vlog("fsync data2...\n");
     fsync(fd);
     vtoy_safe_close_fd(fd);
@@ -941,11 +1487,11 @@ static void * ventoy_install_thread(void *data)
     goto end;
 
 err:
-    g_cur_process_result = 1;
+    failed = 1;
     vtoy_safe_close_fd(fd);        
 
 end:
-    g_current_progress = PT_FINISH;
+    ventoy_job_finish(failed);
 
     check_free(gpt);
     check_free(thread);
@@ -955,18 +1501,13 @@ end:
 
 static int ventoy_api_clean(struct mg_connection *conn, VTOY_JSON *json)
 {
-    int i = 0;
     int fd = 0;
+    ventoy_job *job = NULL;
     ventoy_disk *disk = NULL;
     const char *diskname = NULL;
+    const char *result = VTOY_JSON_SUCCESS_RET;
     char path[128];
-    
-    if (g_current_progress != PT_FINISH)
-    {
-        ventoy_json_result(conn, VTOY_JSON_BUSY_RET);
-        return 0;  
-    }
-    
+
     diskname = vtoy_json_get_string_ex(json, "disk");
     if (diskname == NULL)
     {
@@ -974,28 +1515,27 @@ static int ventoy_api_clean(struct mg_connection *conn, VTOY_JSON *json)
         return 0;
     }
 
-    for (i = 0; i < g_disk_num; i++)
+    job = ventoy_job_alloc("clean", diskname);
+    if (job == NULL)
     {
-        if (strcmp(g_disk_list[i].disk_name, diskname) == 0)
-        {
-            disk = g_disk_list + i;
-            break;
-        }
+        ventoy_json_result(conn, VTOY_JSON_BUSY_RET);
+        return 0;
     }
+    disk = &job->disk;
 
-    if (disk == NULL)
+    if (ventoy_find_disk(diskname, disk))
     {
         vlog("disk %s not found\n", diskname);
-        ventoy_json_result(conn, VTOY_JSON_NOTFOUND_RET);
-        return 0;
+        result = VTOY_JSON_NOTFOUND_RET;
+        goto end;
     }
 
     scnprintf(path, "/sys/block/%s", diskname);
     if (access(path, F_OK) < 0)
     {
         vlog("File %s not exist anymore\n", path);
-        ventoy_json_result(conn, VTOY_JSON_NOTFOUND_RET);
-        return 0;
+        result = VTOY_JSON_NOTFOUND_RET;
+        goto end;
     }
 
     vlog("==================================\n");
@@ -1011,8 +1551,8 @@ static int ventoy_api_clean(struct mg_connection *conn, VTOY_JSON *json)
     if (ventoy_is_disk_mounted(disk->disk_path))
     {
         vlog("%s is mounted and can't umount!\n", disk->disk_path);
-        ventoy_json_result(conn, VTOY_JSON_FAILED_RET);
-        return 0;
+        result = VTOY_JSON_FAILED_RET;
+        goto end;
     }
     else
     {
@@ -1023,40 +1563,38 @@ static int ventoy_api_clean(struct mg_connection *conn, VTOY_JSON *json)
     if (fd < 0)
     {
         vlog("failed to open %s fd:%d err:%d\n", disk->disk_path, fd, errno);
-        ventoy_json_result(conn, VTOY_JSON_FAILED_RET);
-        return 0;
+        result = VTOY_JSON_FAILED_RET;
+        goto end;
     }
 
     vdebug("start clean %s ...\n", disk->disk_model);
-    ventoy_clean_disk(fd, disk->size_in_byte);    
+    ventoy_clean_disk(fd, disk->size_in_byte);
 
     vtoy_safe_close_fd(fd);
-    
-    ventoy_json_result(conn, VTOY_JSON_SUCCESS_RET);
-    return 0;    
+
+end:
+    ventoy_disk_cache_invalidate(diskname);
+    ventoy_job_release(job);
+    ventoy_json_result(conn, result);
+    return 0;
 }
 
 static int ventoy_api_install(struct mg_connection *conn, VTOY_JSON *json)
 {
-    int i = 0;
     int ret = 0;
     int fd = 0;
     uint32_t align4kb = 0;
     uint32_t style = 0;
     uint32_t secure_boot = 0;
     uint64_t reserveBytes = 0;
+    ventoy_job *job = NULL;
     ventoy_disk *disk = NULL;
     const char *diskname = NULL;
     const char *reserve_space = NULL;
+    const char *result = VTOY_JSON_FAILED_RET;
     ventoy_thread_data *thread = NULL;
     char path[128];
-    
-    if (g_current_progress != PT_FINISH)
-    {
-        ventoy_json_result(conn, VTOY_JSON_BUSY_RET);
-        return 0;  
-    }
-    
+
     diskname = vtoy_json_get_string_ex(json, "disk");
     reserve_space = vtoy_json_get_string_ex(json, "reserve_space");
     ret += vtoy_json_get_uint(json, "partstyle", &style);
@@ -1071,42 +1609,41 @@ static int ventoy_api_install(struct mg_connection *conn, VTOY_JSON *json)
 
     reserveBytes = (uint64_t)strtoull(reserve_space, NULL, 10);
 
-    for (i = 0; i < g_disk_num; i++)
+    job = ventoy_job_alloc("install", diskname);
+    if (job == NULL)
     {
-        if (strcmp(g_disk_list[i].disk_name, diskname) == 0)
-        {
-            disk = g_disk_list + i;
-            break;
-        }
+        ventoy_json_result(conn, VTOY_JSON_BUSY_RET);
+        return 0;
     }
+    disk = &job->disk;
 
-    if (disk == NULL)
+    if (ventoy_find_disk(diskname, disk))
     {
         vlog("disk %s not found\n", diskname);
-        ventoy_json_result(conn, VTOY_JSON_NOTFOUND_RET);
-        return 0;
+        result = VTOY_JSON_NOTFOUND_RET;
+        goto err;
     }
 
     scnprintf(path, "/sys/block/%s", diskname);
     if (access(path, F_OK) < 0)
     {
         vlog("File %s not exist anymore\n", path);
-        ventoy_json_result(conn, VTOY_JSON_NOTFOUND_RET);
-        return 0;
+        result = VTOY_JSON_NOTFOUND_RET;
+        goto err;
     }
 
     if (disk->size_in_byte > 2199023255552ULL && style == 0)
     {
         vlog("disk %s is more than 2TB and GPT is needed\n", path);
-        ventoy_json_result(conn, VTOY_JSON_MBR_2TB_RET);
-        return 0;
+        result = VTOY_JSON_MBR_2TB_RET;
+        goto err;
     }
 
     if ((reserveBytes + VTOYEFI_PART_BYTES * 2) > disk->size_in_byte)
     {
         vlog("reserve space %llu is too big for disk %s %llu\n", (_ull)reserveBytes, path, (_ull)disk->size_in_byte);
-        ventoy_json_result(conn, VTOY_JSON_INVALID_RSV_RET);
-        return 0;
+        result = VTOY_JSON_INVALID_RSV_RET;
+        goto err;
     }
 
     vlog("==================================================================================\n");
@@ -1123,8 +1660,7 @@ static int ventoy_api_install(struct mg_connection *conn, VTOY_JSON *json)
     if (ventoy_is_disk_mounted(disk->disk_path))
     {
         vlog("%s is mounted and can't umount!\n", disk->disk_path);
-        ventoy_json_result(conn, VTOY_JSON_FAILED_RET);
-        return 0;
+        goto err;
     }
     else
     {
@@ -1135,8 +1671,7 @@ static int ventoy_api_install(struct mg_connection *conn, VTOY_JSON *json)
     if (fd < 0)
     {
         vlog("failed to open %s fd:%d err:%d\n", disk->disk_path, fd, errno);
-        ventoy_json_result(conn, VTOY_JSON_FAILED_RET);
-        return 0;
+        goto err;
     }
 
     vdebug("start install thread %s ...\n", disk->disk_model);
@@ -1145,45 +1680,41 @@ static int ventoy_api_install(struct mg_connection *conn, VTOY_JSON *json)
     {
         vtoy_safe_close_fd(fd);
         vlog("failed to alloc thread data err:%d\n", errno);
-        ventoy_json_result(conn, VTOY_JSON_FAILED_RET);
-        return 0;
+        goto err;
     }
-    
-    g_current_progress = PT_START;
-    g_cur_process_result = 0;
-    scnprintf(g_cur_process_type, "%s", "install");
-    scnprintf(g_cur_process_diskname, "%s", disk->disk_name);
 
+    thread->job = job;
     thread->disk = disk;
     thread->diskfd = fd;
     thread->align4kb = align4kb;
     thread->partstyle = style;
     thread->secure_boot = secure_boot;
     thread->reserveBytes = reserveBytes;
-    
+
+    ventoy_job_start(job);
     mg_start_thread(ventoy_install_thread, thread);
-    
+
     ventoy_json_result(conn, VTOY_JSON_SUCCESS_RET);
-    return 0;    
+    return 0;
+
+err:
+    ventoy_job_release(job);
+    ventoy_json_result(conn, result);
+    return 0;
 }
 
 static int ventoy_api_update(struct mg_connection *conn, VTOY_JSON *json)
 {
-    int i = 0;
     int ret = 0;
     int fd = 0;
     uint32_t secure_boot = 0;
+    ventoy_job *job = NULL;
     ventoy_disk *disk = NULL;
     const char *diskname = NULL;
+    const char *result = VTOY_JSON_FAILED_RET;
     ventoy_thread_data *thread = NULL;
     char path[128];
-    
-    if (g_current_progress != PT_FINISH)
-    {
-        ventoy_json_result(conn, VTOY_JSON_BUSY_RET);
-        return 0;  
-    }
-    
+
     diskname = vtoy_json_get_string_ex(json, "disk");
     ret += vtoy_json_get_uint(json, "secure_boot", &secure_boot);
     if (diskname == NULL || ret != JSON_SUCCESS)
@@ -1192,43 +1723,41 @@ static int ventoy_api_update(struct mg_connection *conn, VTOY_JSON *json)
         return 0;
     }
 
-    for (i = 0; i < g_disk_num; i++)
+    job = ventoy_job_alloc("update", diskname);
+    if (job == NULL)
     {
-        if (strcmp(g_disk_list[i].disk_name, diskname) == 0)
-        {
-            disk = g_disk_list + i;
-            break;
-        }
+        ventoy_json_result(conn, VTOY_JSON_BUSY_RET);
+        return 0;
     }
+    disk = &job->disk;
 
-    if (disk == NULL)
+    if (ventoy_find_disk(diskname, disk))
     {
         vlog("disk %s not found\n", diskname);
-        ventoy_json_result(conn, VTOY_JSON_NOTFOUND_RET);
-        return 0;
+        result = VTOY_JSON_NOTFOUND_RET;
+        goto err;
     }
 
     if (disk->vtoydata.ventoy_valid == 0)
     {
         vlog("disk %s is not ventoy disk\n", diskname);
-        ventoy_json_result(conn, VTOY_JSON_FAILED_RET);
-        return 0;
+        goto err;
     }
 
     scnprintf(path, "/sys/block/%s", diskname);
     if (access(path, F_OK) < 0)
     {
         vlog("File %s not exist anymore\n", path);
-        ventoy_json_result(conn, VTOY_JSON_NOTFOUND_RET);
-        return 0;
+        result = VTOY_JSON_NOTFOUND_RET;
+        goto err;
     }
 
     vlog("==========================================================\n");
     vlog("===== ventoy update %s new_secureboot:%u =========\n", disk->disk_path, secure_boot);
     vlog("==========================================================\n");
 
-    vlog("%s version:%s partstyle:%u oldsecureboot:%u reserve:%llu\n", 
-        disk->disk_path, disk->vtoydata.ventoy_ver, 
+    vlog("%s version:%s partstyle:%u oldsecureboot:%u reserve:%llu\n",
+        disk->disk_path, disk->vtoydata.ventoy_ver,
         disk->vtoydata.partition_style,
         disk->vtoydata.secure_boot_flag,
         (_ull)(disk->vtoydata.preserved_space)
@@ -1243,8 +1772,7 @@ static int ventoy_api_update(struct mg_connection *conn, VTOY_JSON *json)
     if (ventoy_is_disk_mounted(disk->disk_path))
     {
         vlog("%s is mounted and can't umount!\n", disk->disk_path);
-        ventoy_json_result(conn, VTOY_JSON_FAILED_RET);
-        return 0;
+        goto err;
     }
     else
     {
@@ -1255,8 +1783,7 @@ static int ventoy_api_update(struct mg_connection *conn, VTOY_JSON *json)
     if (fd < 0)
     {
         vlog("failed to open %s fd:%d err:%d\n", disk->disk_path, fd, errno);
-        ventoy_json_result(conn, VTOY_JSON_FAILED_RET);
-        return 0;
+        goto err;
     }
 
     vdebug("start update thread %s ...\n", disk->disk_model);
@@ -1265,34 +1792,49 @@ static int ventoy_api_update(struct mg_connection *conn, VTOY_JSON *json)
     {
         vtoy_safe_close_fd(fd);
         vlog("failed to alloc thread data err:%d\n", errno);
-        ventoy_json_result(conn, VTOY_JSON_FAILED_RET);
-        return 0;
+        goto err;
     }
-    
-    g_current_progress = PT_START;
-    g_cur_process_result = 0;
-    scnprintf(g_cur_process_type, "%s", "update");
-    scnprintf(g_cur_process_diskname, "%s", disk->disk_name);
 
+    thread->job = job;
     thread->disk = disk;
     thread->diskfd = fd;
     thread->secure_boot = secure_boot;
-    
+
+    ventoy_job_start(job);
     mg_start_thread(ventoy_update_thread, thread);
-    
+
     ventoy_json_result(conn, VTOY_JSON_SUCCESS_RET);
-    return 0;    
+    return 0;
+
+err:
+    ventoy_job_release(job);
+    ventoy_json_result(conn, result);
+    return 0;
 }
 
 
 static int ventoy_api_refresh_device(struct mg_connection *conn, VTOY_JSON *json)
 {
-    (void)json;
+    int rc = 0;
+    uint32_t async = 0;
+
+    rc = vtoy_json_get_uint(json, "async", &async);
+    if (JSON_SUCCESS != rc)
+    {
+        async = 0;
+    }
 
-    if (g_current_progress == PT_FINISH)
+    /* the disk list is enumerated into a temp list, running jobs have their own copy */
+    if (async)
     {
-        g_disk_num = 0;
-        ventoy_disk_enumerate_all();
+        if (g_disk_refreshing == 0)
+        {
+            mg_start_thread(ventoy_refresh_thread, NULL);
+        }
+    }
+    else
+    {
+        ventoy_refresh_disk_list();
     }
 
     ventoy_json_result(conn, VTOY_JSON_SUCCESS_RET);
@@ -1315,16 +1857,20 @@ static int ventoy_api_get_dev_list(struct mg_connection *conn, VTOY_JSON *json)
         alldev = 0;
     }
 
+    pthread_mutex_lock(&g_disk_mutex);
+
     buflen = g_disk_num * 1024;
     buf = (char *)malloc(buflen + 1024);
     if (!buf)
     {
+        pthread_mutex_unlock(&g_disk_mutex);
         ventoy_json_result(conn, VTOY_JSON_FAILED_RET);
         return 0;
     }
 
     VTOY_JSON_FMT_BEGIN(pos, buf, buflen);
     VTOY_JSON_FMT_OBJ_BEGIN();
+    VTOY_JSON_FMT_BOOL("refreshing", g_disk_refreshing);
     VTOY_JSON_FMT_KEY("list");
     VTOY_JSON_FMT_ARY_BEGIN();
 
@@ -1352,7 +1898,10 @@ static int ventoy_api_get_dev_list(struct mg_connection *conn, VTOY_JSON *json)
     VTOY_JSON_FMT_OBJ_END();
     VTOY_JSON_FMT_END(pos);
 
+    pthread_mutex_unlock(&g_disk_mutex);
+
     ventoy_json_buffer(conn, buf, pos);
+    free(buf);
     return 0;
 }
 
@@ -1367,6 +1916,8 @@ static JSON_CB g_ventoy_json_cb[] =
     { "update",         ventoy_api_update         },
     { "clean",          ventoy_api_clean          },
     { "get_percent",    ventoy_api_get_percent    },
+    { "get_job_list",   ventoy_api_get_job_list   },
+    { "cancel",         ventoy_api_cancel         },
 };
 
 static int ventoy_json_handler(struct mg_connection *conn, VTOY_JSON *json)
@@ -1416,8 +1967,6 @@ int ventoy_func_handler(const char *jsonstr, char *jsonbuf, int buflen)
     json = vtoy_json_create();
     if (JSON_SUCCESS == vtoy_json_parse(json, jsonstr))
     {
-        pthread_mutex_lock(&g_api_mutex);
-
         method = vtoy_json_get_string_ex(json->pstChild, "method");
         for (i = 0; i < (int)(sizeof(g_ventoy_json_cb) / sizeof(g_ventoy_json_cb[0])); i++)
         {
@@ -1427,8 +1976,6 @@ int ventoy_func_handler(const char *jsonstr, char *jsonbuf, int buflen)
                 break;
             }
         }
-
-        pthread_mutex_unlock(&g_api_mutex);
     }
     else
     {
@@ -1469,9 +2016,8 @@ static int ventoy_request_handler(struct mg_connection *conn)
         json = vtoy_json_create();
         if (JSON_SUCCESS == vtoy_json_parse(json, post_data_buf))
         {
-            pthread_mutex_lock(&g_api_mutex);
+            /* no global lock here, install/update jobs on different disks run concurrently */
             ventoy_json_handler(conn, json->pstChild);
-            pthread_mutex_unlock(&g_api_mutex);
         }
         else
         {
@@ -1535,6 +2081,17 @@ int ventoy_http_stop(void)
 int ventoy_http_init(void)
 {
     pthread_mutex_init(&g_api_mutex, NULL);
+    pthread_mutex_init(&g_job_mutex, NULL);
+    pthread_mutex_init(&g_disk_mutex, NULL);
+    pthread_mutex_init(&g_refresh_mutex, NULL);
+    pthread_mutex_init(&g_stg1_mutex, NULL);
+    pthread_mutex_init(&g_mkexfat_mutex, NULL);
+
+    g_job_list = zalloc(sizeof(ventoy_job) * VTOY_MAX_JOB_NUM);
+    if (!g_job_list)
+    {
+        return 1;
+    }
 
     ventoy_http_load_cfg();
 
@@ -1546,9 +2103,16 @@ int ventoy_http_init(void)
 void ventoy_http_exit(void)
 {
     pthread_mutex_destroy(&g_api_mutex);
-
-    check_free(g_efi_part_raw_img);
-    g_efi_part_raw_img = NULL;    
+    pthread_mutex_destroy(&g_job_mutex);
+    pthread_mutex_destroy(&g_disk_mutex);
+    pthread_mutex_destroy(&g_refresh_mutex);
+    pthread_mutex_destroy(&g_stg1_mutex);
+    pthread_mutex_destroy(&g_mkexfat_mutex);
+
+    check_free(g_job_list);
+    g_job_list = NULL;
+    check_free(g_grub_stg1_raw_img);
+    g_grub_stg1_raw_img = NULL;
 }
 
 
@@ -1597,28 +2161,37 @@ void ventoy_code_set_cur_language(const char *lang)
     pthread_mutex_unlock(&g_api_mutex);
 }
 
-void ventoy_code_refresh_device(void)
+int ventoy_code_is_busy(void)
 {
-    if (g_current_progress == PT_FINISH)
-    {
-        g_disk_num = 0;
-        ventoy_disk_enumerate_all();
-    }
+    int busy;
+
+    pthread_mutex_lock(&g_job_mutex);
+    busy = ventoy_any_job_running();
+    pthread_mutex_unlock(&g_job_mutex);
+
+    return busy;
 }
 
-int ventoy_code_is_busy(void)
+void ventoy_code_refresh_device(void)
 {
-    return (g_current_progress == PT_FINISH) ? 0 : 1;
+    if (ventoy_code_is_busy() == 0)
+    {
+        ventoy_refresh_disk_list();
+    }
 }
 
 int ventoy_code_get_percent(void)
 {
-    return g_current_progress * 100 / PT_FINISH;
+    ventoy_job *job = ventoy_last_job();
+
+    return (job ? job->progress : PT_FINISH) * 100 / PT_FINISH;
 }
 
 int ventoy_code_get_result(void)
 {
-    return g_cur_process_result;
+    ventoy_job *job = ventoy_last_job();
+
+    return (job && job->result != VTOY_JOB_RESULT_SUCCESS) ? 1 : 0;
 }
 
 void ventoy_code_save_cfg(void)
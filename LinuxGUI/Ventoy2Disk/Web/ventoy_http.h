@@ -52,6 +52,16 @@ typedef enum PROGRESS_POINT
     PT_FINISH
 }PROGRESS_POINT;
 
+/* write-back sector cache used by fat_io_lib when editing part2 in place */
+#define VTOY_FAT_CACHE_NUM  128
+typedef struct ventoy_fat_cache
+{
+    uint32_t sector;
+    int valid;
+    int dirty;
+    uint8_t data[512];
+}ventoy_fat_cache;
+
 typedef int (*ventoy_json_callback)(struct mg_connection *conn, VTOY_JSON *json);
 typedef struct JSON_CB
 {
@@ -59,6 +69,29 @@ typedef struct JSON_CB
     ventoy_json_callback callback;
 }JSON_CB;
 
+#define VTOY_MAX_JOB_NUM  64
+
+#define VTOY_JOB_RESULT_SUCCESS   0
+#define VTOY_JOB_RESULT_FAILED    1
+#define VTOY_JOB_RESULT_CANCELED  2
+
+/* 
+ * One install/update process, each job runs in its own worker thread
+ * with a private copy of the disk info, so several disks can be
+ * processed at the same time.
+ */
+typedef struct ventoy_job
+{
+    int used;
+    volatile int running;
+    volatile int cancel;
+    volatile int result;
+    volatile PROGRESS_POINT progress;
+    char type[64];
+    char diskname[64];
+    ventoy_disk disk;
+}ventoy_job;
+
 typedef struct ventoy_thread_data
 {
     int diskfd;
@@ -67,6 +100,7 @@ typedef struct ventoy_thread_data
     uint32_t secure_boot;
     uint64_t reserveBytes;
     ventoy_disk *disk;
+    ventoy_job *job;
 }ventoy_thread_data;
 
 extern int g_vtoy_exfat_disk_fd;
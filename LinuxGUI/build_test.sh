@@ -0,0 +1,26 @@
+#!/bin/bash
+
+# Host test for the disk info cache (fake sysfs tree, no root needed)
+
+XXFLAG='-std=gnu99 -D_FILE_OFFSET_BITS=64'
+
+gcc $XXFLAG -O2 -Wall -Wno-unused-function -Wno-unused-result -DSTATIC=static -DINIT= \
+    -I./Ventoy2Disk \
+    -I./Ventoy2Disk/Core \
+    -I./Ventoy2Disk/Include \
+    -I./Ventoy2Disk/Lib/fat_io_lib/include \
+    -I ./Ventoy2Disk/Lib/fat_io_lib \
+    -Wl,--wrap=open,--wrap=open64,--wrap=socket,--wrap=bind \
+    Ventoy2Disk/Test/ventoy_disk_test.c \
+    Ventoy2Disk/Core/ventoy_disk.c \
+    Ventoy2Disk/Core/ventoy_util.c \
+    Ventoy2Disk/Core/ventoy_log.c \
+    Ventoy2Disk/Core/ventoy_crc32.c \
+    Ventoy2Disk/Lib/fat_io_lib/*.c \
+    -l pthread \
+    -o vtoy_disk_test || exit 1
+
+./vtoy_disk_test
+rc=$?
+rm -f vtoy_disk_test
+exit $rc
@@ -0,0 +1,351 @@
+/******************************************************************************
+ * vtoydm_test.c  ---- host test for the vtoydm table build and manifest extract
+ *
+ * Copyright (c) 2021, longpanda <admin@ventoy.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * vtoydm.c is included so that its static functions can be called. The disk
+ * is a plain file with random data, the image map is built by the test with
+ * fragments shuffled on the disk, so the expected content of every image
+ * sector is known. Disk reads are counted (-Wl,--wrap=pread,--wrap=pread64).
+ * Build and run with VtoyTool/build_test.sh
+ */
+#include "../vtoydm.c"
+
+#define TEST_DISK_SECS   (32 * 2048)   /* 32MB disk in 512 */
+#define TEST_IMG_SECS    6000          /* image in 2048 */
+#define TEST_FILE_NUM    400           /* more than VTOYDM_EXTRACT_MAX_OPEN */
+
+static char g_test_dir[256];
+static char g_disk_file[300];
+static char g_map_file[300];
+static int g_disk_reads = 0;
+static int g_fail = 0;
+
+static unsigned char *g_disk = NULL;
+static ventoy_img_chunk g_test_chunk[TEST_IMG_SECS];
+static int g_test_chunk_num = 0;
+
+ssize_t __real_pread(int fd, void *buf, size_t count, off_t offset);
+ssize_t __wrap_pread(int fd, void *buf, size_t count, off_t offset);
+ssize_t __real_pread64(int fd, void *buf, size_t count, off_t offset);
+ssize_t __wrap_pread64(int fd, void *buf, size_t count, off_t offset);
+
+/* with _FILE_OFFSET_BITS=64 glibc redirects pread to pread64 */
+ssize_t __wrap_pread(int fd, void *buf, size_t count, off_t offset)
+{
+    g_disk_reads++;
+    return __real_pread(fd, buf, count, offset);
+}
+
+ssize_t __wrap_pread64(int fd, void *buf, size_t count, off_t offset)
+{
+    g_disk_reads++;
+    return __real_pread64(fd, buf, count, offset);
+}
+
+#define CHECK(cond, fmt, args...) \
+    if (!(cond)) { printf("FAIL %s:%d " fmt "\n", __func__, __LINE__, ##args); g_fail++; }
+
+static int write_whole_file(const char *path, const void *data, size_t len)
+{
+    FILE *fp = fopen(path, "wb");
+
+    if (!fp)
+    {
+        printf("failed to create %s %d\n", path, errno);
+        return 1;
+    }
+    fwrite(data, 1, len, fp);
+    fclose(fp);
+    return 0;
+}
+
+/* the disk sector (512) of the image sector (2048) in g_test_chunk */
+static uint64_t test_map_sector(uint32_t sector)
+{
+    int i;
+
+    for (i = 0; i < g_test_chunk_num; i++)
+    {
+        if (sector >= g_test_chunk[i].img_start_sector && sector <= g_test_chunk[i].img_end_sector)
+        {
+            return g_test_chunk[i].disk_start_sector + ((uint64_t)(sector - g_test_chunk[i].img_start_sector) << 2);
+        }
+    }
+    return 0;
+}
+
+/*
+ * Split the image into fragments of 1-300 sectors and put them on the disk in a shuffled
+ * order. Some fragments are followed on the disk by the next fragment of the image, so
+ * the extract can merge reads across them.
+ */
+static void make_image_map(void)
+{
+    int i;
+    int j;
+    int tmp;
+    int num = 0;
+    int order[TEST_IMG_SECS];
+    uint32_t len[TEST_IMG_SECS];
+    uint32_t start[TEST_IMG_SECS];
+    uint64_t disk = 2048;
+
+    for (i = 0; i < TEST_IMG_SECS; i += len[num++])
+    {
+        start[num] = i;
+        len[num] = 1 + rand() % 300;
+        if (i + len[num] > TEST_IMG_SECS)
+        {
+            len[num] = TEST_IMG_SECS - i;
+        }
+    }
+
+    for (i = 0; i < num; i++)
+    {
+        order[i] = i;
+    }
+
+    /* shuffle, but keep about one third of the pairs in the image order */
+    for (i = num - 1; i > 0; i--)
+    {
+        j = rand() % (i + 1);
+        if (rand() % 3)
+        {
+            tmp = order[i];
+            order[i] = order[j];
+            order[j] = tmp;
+        }
+    }
+
+    for (i = 0; i < num; i++)
+    {
+        j = order[i];
+        g_test_chunk[j].img_start_sector = start[j];
+        g_test_chunk[j].img_end_sector = start[j] + len[j] - 1;
+        g_test_chunk[j].disk_start_sector = disk;
+        g_test_chunk[j].disk_end_sector = disk + len[j] * 4 - 1;
+        disk += len[j] * 4 + ((rand() % 2) ? 4 : 0);
+    }
+
+    g_test_chunk_num = num;
+}
+
+static void test_linear_table(void)
+{
+    int count = 0;
+    vtoydm_linear *table = NULL;
+    ventoy_img_chunk chunk[3] =
+    {
+        { 0,  9,  2048, 2087 },
+        { 10, 19, 2088, 2127 },   /* contiguous on disk with chunk 0 */
+        { 20, 24, 8192, 8211 },
+    };
+
+    table = vtoydm_build_linear_table(chunk, 3, 25 * 2048 - 100, &count);
+    CHECK(table && count == 2, "merge count %d", count);
+    if (table && count == 2)
+    {
+        CHECK(table[0].start == 0 && table[0].len == 80 && table[0].offset == 0, "target 0");
+        CHECK(table[1].start == 80 && table[1].len == 20 && table[1].offset == 8192 - 2048, "target 1");
+    }
+    free(table);
+
+    table = vtoydm_build_linear_table(chunk, 3, 0, &count);
+    CHECK(table != NULL, "no file size check");
+    free(table);
+
+    CHECK(vtoydm_build_linear_table(chunk, 3, 25 * 2048 + 1, &count) == NULL, "file larger than the table");
+    CHECK(vtoydm_build_linear_table(chunk, 3, 24 * 2048, &count) == NULL, "file smaller than the table");
+    CHECK(vtoydm_build_linear_table(chunk + 1, 2, 0, &count) == NULL, "first chunk not at 0");
+    CHECK(vtoydm_build_linear_table(chunk, 0, 0, &count) == NULL, "empty map");
+
+    chunk[2].img_start_sector = 21;
+    CHECK(vtoydm_build_linear_table(chunk, 3, 0, &count) == NULL, "gap in the image");
+    chunk[2].img_start_sector = 20;
+
+    chunk[1].disk_start_sector = 1000;
+    CHECK(vtoydm_build_linear_table(chunk, 3, 0, &count) == NULL, "chunk before partition 1");
+    chunk[1].disk_start_sector = 2200;
+    chunk[1].disk_end_sector = 2100;
+    CHECK(vtoydm_build_linear_table(chunk, 3, 0, &count) == NULL, "reversed chunk");
+
+    /* unallocated blocks of a dynamic vdisk, zero targets never merge with linear ones */
+    chunk[1].disk_start_sector = VTOY_ZERO_CHUNK_SECTOR + 10 * 4;
+    chunk[1].disk_end_sector = chunk[1].disk_start_sector + 10 * 4 - 1;
+    chunk[2].disk_start_sector = VTOY_ZERO_CHUNK_SECTOR + 20 * 4;
+    chunk[2].disk_end_sector = chunk[2].disk_start_sector + 5 * 4 - 1;
+    table = vtoydm_build_linear_table(chunk, 3, 0, &count);
+    CHECK(table && count == 2, "zero count %d", count);
+    if (table && count == 2)
+    {
+        CHECK(!table[0].zero && table[0].start == 0 && table[0].len == 40 && table[0].offset == 0, "zero target 0");
+        CHECK(table[1].zero && table[1].start == 40 && table[1].len == 60, "zero target 1");
+    }
+    free(table);
+
+    printf("OK   linear table\n");
+}
+
+/* extract files through a manifest and compare them with the image data */
+static void test_manifest(const char *name, uint32_t *first, uint32_t *size, int num, int maxreads)
+{
+    int i;
+    int rc;
+    uint32_t pos;
+    uint32_t len;
+    char path[400];
+    unsigned char *buf = NULL;
+    unsigned char sec[2048];
+    FILE *fp = NULL;
+
+    snprintf(path, sizeof(path), "%s/manifest", g_test_dir);
+    fp = fopen(path, "w");
+    fprintf(fp, "# comment line\n");
+    for (i = 0; i < num; i++)
+    {
+        fprintf(fp, "%u %u %s/f%d\n", first[i], size[i], g_test_dir, i);
+    }
+    fclose(fp);
+
+    g_disk_reads = 0;
+    rc = vtoydm_extract_manifest(g_map_file, g_disk_file, path);
+    CHECK(rc == 0, "%s extract rc %d", name, rc);
+    CHECK(maxreads == 0 || g_disk_reads <= maxreads, "%s %d reads, expect at most %d", name, g_disk_reads, maxreads);
+
+    for (i = 0; i < num; i++)
+    {
+        snprintf(path, sizeof(path), "%s/f%d", g_test_dir, i);
+        fp = fopen(path, "rb");
+        if (!fp)
+        {
+            CHECK(0, "%s file %d not created", name, i);
+            continue;
+        }
+
+        buf = realloc(buf, size[i] + 1);
+        len = (uint32_t)fread(buf, 1, size[i] + 1, fp);
+        fclose(fp);
+        unlink(path);
+        if (len != size[i])
+        {
+            CHECK(0, "%s file %d size %u expect %u", name, i, len, size[i]);
+            continue;
+        }
+
+        for (pos = 0; pos < size[i]; pos += 2048)
+        {
+            memcpy(sec, g_disk + test_map_sector(first[i] + pos / 2048) * 512, 2048);
+            len = (size[i] - pos > 2048) ? 2048 : size[i] - pos;
+            if (memcmp(buf + pos, sec, len))
+            {
+                CHECK(0, "%s file %d differs at %u", name, i, pos);
+                break;
+            }
+        }
+    }
+
+    free(buf);
+    printf("%s %-24s files:%d reads:%d\n", g_fail ? "FAIL" : "OK  ", name, num, g_disk_reads);
+}
+
+int main(void)
+{
+    int i;
+    int fd;
+    uint32_t sector;
+    uint32_t first[TEST_FILE_NUM];
+    uint32_t size[TEST_FILE_NUM];
+    char cmd[300];
+
+    srand(7);
+    snprintf(g_test_dir, sizeof(g_test_dir), "/tmp/vtoydm_test.XXXXXX");
+    if (!mkdtemp(g_test_dir))
+    {
+        printf("mkdtemp failed %d\n", errno);
+        return 1;
+    }
+    snprintf(g_disk_file, sizeof(g_disk_file), "%s/disk", g_test_dir);
+    snprintf(g_map_file, sizeof(g_map_file), "%s/map", g_test_dir);
+
+    test_linear_table();
+
+    g_disk = malloc((size_t)TEST_DISK_SECS * 512);
+    for (i = 0; i < TEST_DISK_SECS * 512; i++)
+    {
+        g_disk[i] = (unsigned char)rand();
+    }
+    write_whole_file(g_disk_file, g_disk, (size_t)TEST_DISK_SECS * 512);
+
+    make_image_map();
+    write_whole_file(g_map_file, g_test_chunk, g_test_chunk_num * sizeof(ventoy_img_chunk));
+
+    /* files packed one after another, with odd sizes, empty files and files larger than the read buffer */
+    for (i = 0, sector = 3; i < TEST_FILE_NUM; i++)
+    {
+        size[i] = (i % 50 == 7) ? 0 : ((i % 97 == 5) ? 1536 * 1024 + 77 : 1 + rand() % 20000);
+        if (sector + (size[i] + 2047) / 2048 > TEST_IMG_SECS)
+        {
+            sector = 0;
+        }
+        first[i] = sector;
+        sector += (size[i] + 2047) / 2048;
+    }
+    test_manifest("packed files", first, size, TEST_FILE_NUM, 0);
+
+    /*
+     * 8 files of one sector in a single fragment, adjacent on disk,
+     * they must be read with one pread even though they are different files
+     */
+    for (i = 0; i < g_test_chunk_num && g_test_chunk[i].img_end_sector - g_test_chunk[i].img_start_sector < 8; i++)
+    {
+        ;
+    }
+    for (sector = 0; sector < 8; sector++)
+    {
+        first[sector] = g_test_chunk[i].img_start_sector + 7 - sector;
+        size[sector] = (sector == 7) ? 1000 : 2048;
+    }
+    test_manifest("adjacent files", first, size, 8, 1);
+
+    /* one file across two fragments that are contiguous on disk, and one across a disk jump */
+    fd = 0;
+    for (i = 0; i + 1 < g_test_chunk_num; i++)
+    {
+        if (g_test_chunk[i].disk_end_sector + 1 == g_test_chunk[i + 1].disk_start_sector && fd == 0)
+        {
+            first[fd] = g_test_chunk[i].img_end_sector;
+            size[fd++] = 3 * 2048;
+        }
+        else if (g_test_chunk[i].disk_end_sector + 1 != g_test_chunk[i + 1].disk_start_sector && fd == 1)
+        {
+            first[fd] = g_test_chunk[i].img_end_sector;
+            size[fd++] = 2 * 2048 + 1;
+        }
+    }
+    CHECK(fd == 2, "image map has no contiguous or no split fragments");
+    test_manifest("cross fragments", first, size, fd, 0);
+
+    free(g_disk);
+    snprintf(cmd, sizeof(cmd), "rm -rf '%s'", g_test_dir);
+    system(cmd);
+
+    printf("%s\n", g_fail ? "vtoydm test FAILED" : "vtoydm test passed");
+    return g_fail ? 1 : 0;
+}
@@ -0,0 +1,16 @@
+#!/bin/bash
+
+# Host test for vtoydm (image map to dm table and manifest extract, no root needed)
+
+cd $(dirname $0)
+
+gcc -D_FILE_OFFSET_BITS=64 -O2 -Wall -Wno-unused-function -Wno-unused-result -DBUILD_VTOY_TOOL \
+    -IBabyISO \
+    -Wl,--wrap=pread,--wrap=pread64 \
+    Test/vtoydm_test.c BabyISO/*.c \
+    -o vtoydm_test || exit 1
+
+./vtoydm_test
+rc=$?
+rm -f vtoydm_test
+exit $rc
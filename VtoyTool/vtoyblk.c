@@ -0,0 +1,1218 @@
+/******************************************************************************
+ * vtoyblk.c  ---- expose the ventoy image as a userspace block device
+ *
+ * Copyright (c) 2020, longpanda <admin@ventoy.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Where dm-linear is not available, the image used to be exported through
+ * vblade over the loopback interface, which encapsulates every sector in AoE.
+ * This tool serves the same ventoy_image_map directly to the kernel:
+ *
+ *   ublk: /dev/ublkbN, one io_uring per hardware queue, one thread per queue.
+ *   nbd : /dev/nbdN, requests are read from a unix socketpair (for kernels without ublk).
+ *
+ * The device is always read only.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <arpa/inet.h>
+#include <linux/fs.h>
+#include <linux/nbd.h>
+
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>) && __has_include(<linux/ublk_cmd.h>)
+#include <linux/io_uring.h>
+#include <linux/ublk_cmd.h>
+#if defined(__NR_io_uring_setup) && defined(IORING_SETUP_SQE128)
+#define VTOY_UBLK_SUPPORT 1
+#endif
+#endif
+#endif
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+#pragma pack(4)
+typedef struct ventoy_img_chunk
+{
+    uint32_t img_start_sector; // sector size: 2KB
+    uint32_t img_end_sector;   // included
+
+    uint64_t disk_start_sector; // in disk_sector_size
+    uint64_t disk_end_sector;   // included
+}ventoy_img_chunk;
+#pragma pack()
+
+/* same as makedev() in glibc, some of our libc don't have sys/sysmacros.h */
+#define VTOY_MKDEV(ma, mi)  ((((ma) & 0xfff) << 8) | ((mi) & 0xff) | (((mi) & 0xfff00) << 12))
+
+#define VTOYBLK_MODE_AUTO   0
+#define VTOYBLK_MODE_UBLK   1
+#define VTOYBLK_MODE_NBD    2
+
+#define VTOYBLK_MAX_QUEUE   4
+#define VTOYBLK_IO_BUF_SIZE (128 * 1024)
+
+static int verbose = 0;
+#define debug(fmt, ...) if(verbose) printf(fmt, ##__VA_ARGS__)
+
+static int g_disk_fd = -1;
+static int g_img_chunk_num = 0;
+static ventoy_img_chunk *g_img_chunk = NULL;
+static uint64_t g_img_size = 0;
+static volatile int g_stop = 0;
+
+ventoy_img_chunk * vtoydm_get_img_map_data(const char *img_map_file, int *plen);
+
+static void vtoyblk_sig_handler(int sig)
+{
+    (void)sig;
+    g_stop = 1;
+}
+
+/* create /dev/name from /sys/class/<class>/name/dev if it doesn't exist */
+static int vtoyblk_make_node(const char *class, const char *name, int blk)
+{
+    int fd;
+    int len;
+    char *pos = NULL;
+    unsigned int major, minor;
+    char path[256] = {0};
+    char buf[64] = {0};
+
+    snprintf(path, sizeof(path) - 1, "/dev/%s", name);
+    if (access(path, F_OK) >= 0)
+    {
+        return 0;
+    }
+
+    snprintf(path, sizeof(path) - 1, "/sys/class/%s/%s/dev", class, name);
+    fd = open(path, O_RDONLY | O_BINARY);
+    if (fd < 0)
+    {
+        return 1;
+    }
+
+    len = (int)read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+
+    pos = strchr(buf, ':');
+    if (len <= 0 || pos == NULL)
+    {
+        return 1;
+    }
+
+    major = (unsigned int)strtoul(buf, NULL, 10);
+    minor = (unsigned int)strtoul(pos + 1, NULL, 10);
+
+    snprintf(path, sizeof(path) - 1, "/dev/%s", name);
+    if (mknod(path, (blk ? S_IFBLK : S_IFCHR) | 0660, VTOY_MKDEV(major, minor)) < 0 && errno != EEXIST)
+    {
+        debug("failed to mknod %s %u:%u %d\n", path, major, minor, errno);
+        return 1;
+    }
+
+    return 0;
+}
+
+static int vtoyblk_load_map(const char *img_map_file, const char *diskname)
+{
+    int i;
+    int len = 0;
+
+    g_img_chunk = vtoydm_get_img_map_data(img_map_file, &len);
+    if (NULL == g_img_chunk)
+    {
+        return 1;
+    }
+
+    g_img_chunk_num = len / sizeof(ventoy_img_chunk);
+    if (g_img_chunk_num <= 0)
+    {
+        fprintf(stderr, "image map file %s is empty\n", img_map_file);
+        return 1;
+    }
+
+    /* the binary search below requires the chunks to be in image order */
+    for (i = 1; i < g_img_chunk_num; i++)
+    {
+        if (g_img_chunk[i].img_start_sector <= g_img_chunk[i - 1].img_end_sector)
+        {
+            fprintf(stderr, "image map chunk %d is out of order\n", i);
+            return 1;
+        }
+    }
+
+    g_img_size = ((uint64_t)g_img_chunk[g_img_chunk_num - 1].img_end_sector + 1) * 2048;
+
+    g_disk_fd = open(diskname, O_RDONLY | O_BINARY);
+    if (g_disk_fd < 0)
+    {
+        fprintf(stderr, "Failed to open %s err:%d\n", diskname, errno);
+        return 1;
+    }
+
+    debug("image map %d chunks, image size %llu\n", g_img_chunk_num, (unsigned long long)g_img_size);
+    return 0;
+}
+
+/* index of the first chunk whose end sector is not before sector */
+static int vtoyblk_find_chunk(uint64_t sector)
+{
+    int lo = 0;
+    int hi = g_img_chunk_num;
+    int mid;
+
+    while (lo < hi)
+    {
+        mid = (lo + hi) / 2;
+        if (g_img_chunk[mid].img_end_sector < sector)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+
+    return lo;
+}
+
+/* read image data [offset, offset + len), the holes between chunks are read as zero */
+static int vtoyblk_read_image(void *buf, uint64_t offset, uint32_t len)
+{
+    int i;
+    ssize_t rc;
+    uint32_t cur;
+    uint64_t start, end;
+    uint64_t diskoff;
+    char *pos = (char *)buf;
+
+    if (offset >= g_img_size)
+    {
+        memset(buf, 0, len);
+        return 0;
+    }
+
+    i = vtoyblk_find_chunk(offset / 2048);
+    while (len > 0)
+    {
+        if (i >= g_img_chunk_num)
+        {
+            memset(pos, 0, len);
+            break;
+        }
+
+        start = (uint64_t)g_img_chunk[i].img_start_sector * 2048;
+        end = ((uint64_t)g_img_chunk[i].img_end_sector + 1) * 2048;
+
+        if (offset < start)
+        {
+            cur = (start - offset > len) ? len : (uint32_t)(start - offset);
+            memset(pos, 0, cur);
+        }
+        else
+        {
+            cur = (end - offset > len) ? len : (uint32_t)(end - offset);
+            diskoff = g_img_chunk[i].disk_start_sector * 512 + (offset - start);
+
+            rc = pread(g_disk_fd, pos, cur, (off_t)diskoff);
+            if (rc != (ssize_t)cur)
+            {
+                debug("failed to read disk offset %llu len %u rc %d err %d\n",
+                      (unsigned long long)diskoff, cur, (int)rc, errno);
+                return -EIO;
+            }
+            i++;
+        }
+
+        pos += cur;
+        offset += cur;
+        len -= cur;
+    }
+
+    return 0;
+}
+
+#ifdef VTOY_UBLK_SUPPORT
+
+typedef struct vtoy_uring
+{
+    int fd;
+    unsigned int entries;
+    unsigned int sq_tail;
+    unsigned int *sq_khead;
+    unsigned int *sq_ktail;
+    unsigned int *sq_kmask;
+    unsigned int *sq_array;
+    unsigned int *cq_khead;
+    unsigned int *cq_ktail;
+    unsigned int *cq_kmask;
+    struct io_uring_cqe *cqes;
+    char *sqes;
+    void *ring_ptr;
+    size_t ring_len;
+    size_t sqes_len;
+}vtoy_uring;
+
+typedef struct vtoy_ublk_queue
+{
+    int q_id;
+    int depth;
+    int cdev_fd;
+    pthread_t thread;
+    vtoy_uring ring;
+    struct ublksrv_io_desc *iod;
+    size_t iod_len;
+    char *buf;
+}vtoy_ublk_queue;
+
+typedef struct vtoy_ublk
+{
+    int ctrl_fd;
+    int cdev_fd;
+    vtoy_uring ring;
+    struct ublksrv_ctrl_dev_info info;
+    int queue_num;
+    vtoy_ublk_queue queue[VTOYBLK_MAX_QUEUE];
+}vtoy_ublk;
+
+#ifdef UBLK_U_CMD_ADD_DEV
+#define VTOY_UBLK_ADD_DEV       UBLK_U_CMD_ADD_DEV
+#define VTOY_UBLK_DEL_DEV       UBLK_U_CMD_DEL_DEV
+#define VTOY_UBLK_START_DEV     UBLK_U_CMD_START_DEV
+#define VTOY_UBLK_STOP_DEV      UBLK_U_CMD_STOP_DEV
+#define VTOY_UBLK_SET_PARAMS    UBLK_U_CMD_SET_PARAMS
+#define VTOY_UBLK_FETCH_REQ     UBLK_U_IO_FETCH_REQ
+#define VTOY_UBLK_COMMIT_REQ    UBLK_U_IO_COMMIT_AND_FETCH_REQ
+#else
+#define VTOY_UBLK_ADD_DEV       UBLK_CMD_ADD_DEV
+#define VTOY_UBLK_DEL_DEV       UBLK_CMD_DEL_DEV
+#define VTOY_UBLK_START_DEV     UBLK_CMD_START_DEV
+#define VTOY_UBLK_STOP_DEV      UBLK_CMD_STOP_DEV
+#define VTOY_UBLK_SET_PARAMS    UBLK_CMD_SET_PARAMS
+#define VTOY_UBLK_FETCH_REQ     UBLK_IO_FETCH_REQ
+#define VTOY_UBLK_COMMIT_REQ    UBLK_IO_COMMIT_AND_FETCH_REQ
+#endif
+
+/* the uring commands of ublk need 128 bytes SQE, so SQE128 is always used here */
+#define VTOY_SQE_SIZE  128
+
+static int vtoy_uring_init(vtoy_uring *ring, unsigned int entries)
+{
+    size_t sq_len, cq_len;
+    struct io_uring_params p;
+
+    memset(ring, 0, sizeof(vtoy_uring));
+    memset(&p, 0, sizeof(p));
+    p.flags = IORING_SETUP_SQE128;
+
+    ring->fd = (int)syscall(__NR_io_uring_setup, entries, &p);
+    if (ring->fd < 0)
+    {
+        debug("io_uring_setup failed %d\n", errno);
+        return 1;
+    }
+
+    if (!(p.features & IORING_FEAT_SINGLE_MMAP))
+    {
+        debug("io_uring without single mmap is not supported\n");
+        close(ring->fd);
+        return 1;
+    }
+
+    sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned int);
+    cq_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    ring->ring_len = (sq_len > cq_len) ? sq_len : cq_len;
+
+    ring->ring_ptr = mmap(NULL, ring->ring_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    if (ring->ring_ptr == MAP_FAILED)
+    {
+        close(ring->fd);
+        return 1;
+    }
+
+    ring->sqes_len = p.sq_entries * VTOY_SQE_SIZE;
+    ring->sqes = mmap(NULL, ring->sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED)
+    {
+        munmap(ring->ring_ptr, ring->ring_len);
+        close(ring->fd);
+        return 1;
+    }
+
+    ring->entries  = p.sq_entries;
+    ring->sq_khead = (unsigned int *)((char *)ring->ring_ptr + p.sq_off.head);
+    ring->sq_ktail = (unsigned int *)((char *)ring->ring_ptr + p.sq_off.tail);
+    ring->sq_kmask = (unsigned int *)((char *)ring->ring_ptr + p.sq_off.ring_mask);
+    ring->sq_array = (unsigned int *)((char *)ring->ring_ptr + p.sq_off.array);
+    ring->cq_khead = (unsigned int *)((char *)ring->ring_ptr + p.cq_off.head);
+    ring->cq_ktail = (unsigned int *)((char *)ring->ring_ptr + p.cq_off.tail);
+    ring->cq_kmask = (unsigned int *)((char *)ring->ring_ptr + p.cq_off.ring_mask);
+    ring->cqes     = (struct io_uring_cqe *)((char *)ring->ring_ptr + p.cq_off.cqes);
+    ring->sq_tail  = *ring->sq_ktail;
+
+    return 0;
+}
+
+static void vtoy_uring_exit(vtoy_uring *ring)
+{
+    if (ring->fd >= 0)
+    {
+        munmap(ring->sqes, ring->sqes_len);
+        munmap(ring->ring_ptr, ring->ring_len);
+        close(ring->fd);
+        ring->fd = -1;
+    }
+}
+
+static struct io_uring_sqe * vtoy_uring_get_sqe(vtoy_uring *ring)
+{
+    unsigned int head;
+    unsigned int idx;
+    struct io_uring_sqe *sqe = NULL;
+
+    head = __atomic_load_n(ring->sq_khead, __ATOMIC_ACQUIRE);
+    if (ring->sq_tail - head >= ring->entries)
+    {
+        return NULL;
+    }
+
+    idx = ring->sq_tail & (*ring->sq_kmask);
+    sqe = (struct io_uring_sqe *)(ring->sqes + idx * VTOY_SQE_SIZE);
+    memset(sqe, 0, VTOY_SQE_SIZE);
+
+    ring->sq_array[idx] = idx;
+    ring->sq_tail++;
+    return sqe;
+}
+
+/* submit all the queued SQEs and wait for at least min_complete CQEs */
+static int vtoy_uring_submit(vtoy_uring *ring, unsigned int min_complete)
+{
+    int rc;
+    unsigned int submit;
+
+    submit = ring->sq_tail - *ring->sq_ktail;
+    __atomic_store_n(ring->sq_ktail, ring->sq_tail, __ATOMIC_RELEASE);
+
+    do {
+        rc = (int)syscall(__NR_io_uring_enter, ring->fd, submit, min_complete,
+                          min_complete ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+    } while (rc < 0 && errno == EINTR && !g_stop);
+
+    return rc;
+}
+
+static struct io_uring_cqe * vtoy_uring_peek_cqe(vtoy_uring *ring)
+{
+    unsigned int head = *ring->cq_khead;
+
+    if (head == __atomic_load_n(ring->cq_ktail, __ATOMIC_ACQUIRE))
+    {
+        return NULL;
+    }
+
+    return ring->cqes + (head & (*ring->cq_kmask));
+}
+
+static void vtoy_uring_cqe_seen(vtoy_uring *ring)
+{
+    __atomic_store_n(ring->cq_khead, *ring->cq_khead + 1, __ATOMIC_RELEASE);
+}
+
+static int vtoy_ublk_ctrl_cmd(vtoy_ublk *dev, unsigned int op, void *addr, unsigned int len, uint64_t data)
+{
+    int rc;
+    struct io_uring_sqe *sqe = NULL;
+    struct io_uring_cqe *cqe = NULL;
+    struct ublksrv_ctrl_cmd *cmd = NULL;
+
+    sqe = vtoy_uring_get_sqe(&dev->ring);
+    if (!sqe)
+    {
+        return -EBUSY;
+    }
+
+    sqe->opcode = IORING_OP_URING_CMD;
+    sqe->fd = dev->ctrl_fd;
+    sqe->cmd_op = op;
+
+    cmd = (struct ublksrv_ctrl_cmd *)sqe->cmd;
+    cmd->dev_id = dev->info.dev_id;
+    cmd->queue_id = (__u16)-1;
+    cmd->addr = (__u64)(unsigned long)addr;
+    cmd->len = (__u16)len;
+    cmd->data[0] = data;
+
+    if (vtoy_uring_submit(&dev->ring, 1) < 0)
+    {
+        return -errno;
+    }
+
+    cqe = vtoy_uring_peek_cqe(&dev->ring);
+    if (!cqe)
+    {
+        return -EIO;
+    }
+
+    rc = cqe->res;
+    vtoy_uring_cqe_seen(&dev->ring);
+
+    debug("ublk ctrl cmd 0x%x dev %u rc %d\n", op, dev->info.dev_id, rc);
+    return rc;
+}
+
+static int vtoy_ublk_queue_io_cmd(vtoy_ublk_queue *q, unsigned int op, int tag, int result)
+{
+    struct io_uring_sqe *sqe = NULL;
+    struct ublksrv_io_cmd *cmd = NULL;
+
+    sqe = vtoy_uring_get_sqe(&q->ring);
+    if (!sqe)
+    {
+        return 1;
+    }
+
+    sqe->opcode = IORING_OP_URING_CMD;
+    sqe->fd = q->cdev_fd;
+    sqe->cmd_op = op;
+    sqe->user_data = (__u64)tag;
+
+    cmd = (struct ublksrv_io_cmd *)sqe->cmd;
+    cmd->q_id = (__u16)q->q_id;
+    cmd->tag = (__u16)tag;
+    cmd->result = result;
+    cmd->addr = (__u64)(unsigned long)(q->buf + (size_t)tag * VTOYBLK_IO_BUF_SIZE);
+
+    return 0;
+}
+
+static int vtoy_ublk_handle_io(vtoy_ublk_queue *q, int tag)
+{
+    int rc;
+    uint32_t len;
+    const struct ublksrv_io_desc *iod = q->iod + tag;
+
+    len = iod->nr_sectors << 9;
+
+    switch (ublksrv_get_op(iod))
+    {
+        case UBLK_IO_OP_READ:
+        {
+            if (len > VTOYBLK_IO_BUF_SIZE)
+            {
+                return -EINVAL;
+            }
+
+            rc = vtoyblk_read_image(q->buf + (size_t)tag * VTOYBLK_IO_BUF_SIZE, iod->start_sector << 9, len);
+            return rc ? rc : (int)len;
+        }
+        case UBLK_IO_OP_FLUSH:
+        {
+            return 0;
+        }
+        default:
+        {
+            return -EROFS;
+        }
+    }
+}
+
+static void * vtoy_ublk_queue_thread(void *data)
+{
+    int i;
+    int tag;
+    int res;
+    int active = 0;
+    vtoy_ublk_queue *q = (vtoy_ublk_queue *)data;
+    struct io_uring_cqe *cqe = NULL;
+
+    for (i = 0; i < q->depth; i++)
+    {
+        vtoy_ublk_queue_io_cmd(q, VTOY_UBLK_FETCH_REQ, i, -1);
+    }
+    active = q->depth;
+
+    vtoy_uring_submit(&q->ring, 0);
+
+    while (active > 0)
+    {
+        if (vtoy_uring_submit(&q->ring, 1) < 0)
+        {
+            debug("queue %d io_uring_enter failed %d\n", q->q_id, errno);
+            break;
+        }
+
+        while ((cqe = vtoy_uring_peek_cqe(&q->ring)) != NULL)
+        {
+            tag = (int)cqe->user_data;
+            res = cqe->res;
+            vtoy_uring_cqe_seen(&q->ring);
+
+            if (res == UBLK_IO_RES_OK)
+            {
+                vtoy_ublk_queue_io_cmd(q, VTOY_UBLK_COMMIT_REQ, tag, vtoy_ublk_handle_io(q, tag));
+            }
+            else
+            {
+                /* UBLK_IO_RES_ABORT: the device is being stopped, no more fetch for this tag */
+                debug("queue %d tag %d res %d\n", q->q_id, tag, res);
+                active--;
+            }
+        }
+    }
+
+    debug("queue %d thread exit\n", q->q_id);
+    return NULL;
+}
+
+static int vtoy_ublk_queue_init(vtoy_ublk *dev, int q_id)
+{
+    long pagesz;
+    size_t max_len;
+    vtoy_ublk_queue *q = dev->queue + q_id;
+
+    pagesz = sysconf(_SC_PAGESIZE);
+
+    q->q_id = q_id;
+    q->depth = dev->info.queue_depth;
+    q->cdev_fd = dev->cdev_fd;
+
+    max_len = (UBLK_MAX_QUEUE_DEPTH * sizeof(struct ublksrv_io_desc) + pagesz - 1) & ~(pagesz - 1);
+    q->iod_len = (q->depth * sizeof(struct ublksrv_io_desc) + pagesz - 1) & ~(pagesz - 1);
+    q->iod = mmap(NULL, q->iod_len, PROT_READ, MAP_SHARED | MAP_POPULATE, dev->cdev_fd,
+                  UBLKSRV_CMD_BUF_OFFSET + q_id * max_len);
+    if (q->iod == MAP_FAILED)
+    {
+        debug("failed to mmap io desc for queue %d err %d\n", q_id, errno);
+        q->iod = NULL;
+        return 1;
+    }
+
+    q->buf = malloc((size_t)q->depth * VTOYBLK_IO_BUF_SIZE);
+    if (!q->buf)
+    {
+        return 1;
+    }
+
+    if (vtoy_uring_init(&q->ring, q->depth))
+    {
+        return 1;
+    }
+
+    return 0;
+}
+
+static void vtoy_ublk_queue_exit(vtoy_ublk_queue *q)
+{
+    vtoy_uring_exit(&q->ring);
+
+    if (q->iod)
+    {
+        munmap(q->iod, q->iod_len);
+        q->iod = NULL;
+    }
+
+    if (q->buf)
+    {
+        free(q->buf);
+        q->buf = NULL;
+    }
+}
+
+static int vtoyblk_run_ublk(int queue_num, int depth, int notify_fd)
+{
+    int i;
+    int rc = 1;
+    int started = 0;
+    int threads = 0;
+    char name[64];
+    struct ublk_params params;
+    sigset_t sigset, oldset;
+    vtoy_ublk *dev = NULL;
+
+    dev = malloc(sizeof(vtoy_ublk));
+    if (!dev)
+    {
+        return 1;
+    }
+    memset(dev, 0, sizeof(vtoy_ublk));
+    dev->cdev_fd = -1;
+    dev->ring.fd = -1;
+
+    for (i = 0; i < VTOYBLK_MAX_QUEUE; i++)
+    {
+        dev->queue[i].ring.fd = -1;
+    }
+
+    vtoyblk_make_node("misc", "ublk-control", 0);
+    dev->ctrl_fd = open("/dev/ublk-control", O_RDWR);
+    if (dev->ctrl_fd < 0)
+    {
+        debug("failed to open /dev/ublk-control %d\n", errno);
+        free(dev);
+        return 1;
+    }
+
+    if (vtoy_uring_init(&dev->ring, 4))
+    {
+        goto end;
+    }
+
+    dev->info.nr_hw_queues = (__u16)queue_num;
+    dev->info.queue_depth = (__u16)depth;
+    dev->info.max_io_buf_bytes = VTOYBLK_IO_BUF_SIZE;
+    dev->info.dev_id = (__u32)-1;
+    dev->info.ublksrv_pid = getpid();
+
+    if (vtoy_ublk_ctrl_cmd(dev, VTOY_UBLK_ADD_DEV, &dev->info, sizeof(dev->info), 0) < 0)
+    {
+        dev->info.dev_id = (__u32)-1;
+        goto end;
+    }
+
+    memset(&params, 0, sizeof(params));
+    params.len = sizeof(params);
+    params.types = UBLK_PARAM_TYPE_BASIC;
+    params.basic.attrs = UBLK_ATTR_READ_ONLY;
+    params.basic.logical_bs_shift = 9;
+    params.basic.physical_bs_shift = 11;
+    params.basic.io_opt_shift = 11;
+    params.basic.io_min_shift = 9;
+    params.basic.max_sectors = VTOYBLK_IO_BUF_SIZE >> 9;
+    params.basic.dev_sectors = g_img_size >> 9;
+
+    if (vtoy_ublk_ctrl_cmd(dev, VTOY_UBLK_SET_PARAMS, &params, sizeof(params), 0) < 0)
+    {
+        goto end;
+    }
+
+    snprintf(name, sizeof(name), "ublkc%u", dev->info.dev_id);
+    for (i = 0; i < 50 && dev->cdev_fd < 0; i++)
+    {
+        vtoyblk_make_node("ublk-char", name, 0);
+        snprintf(name, sizeof(name), "/dev/ublkc%u", dev->info.dev_id);
+        dev->cdev_fd = open(name, O_RDWR);
+        snprintf(name, sizeof(name), "ublkc%u", dev->info.dev_id);
+        if (dev->cdev_fd < 0)
+        {
+            usleep(100 * 1000);
+        }
+    }
+
+    if (dev->cdev_fd < 0)
+    {
+        debug("failed to open /dev/%s %d\n", name, errno);
+        goto end;
+    }
+
+    dev->queue_num = dev->info.nr_hw_queues;
+    for (i = 0; i < dev->queue_num; i++)
+    {
+        if (vtoy_ublk_queue_init(dev, i))
+        {
+            goto end;
+        }
+    }
+
+    /* signals are handled by the main thread, the queue threads only exit after STOP_DEV */
+    sigemptyset(&sigset);
+    sigaddset(&sigset, SIGTERM);
+    sigaddset(&sigset, SIGINT);
+    pthread_sigmask(SIG_BLOCK, &sigset, &oldset);
+
+    for (threads = 0; threads < dev->queue_num; threads++)
+    {
+        if (pthread_create(&dev->queue[threads].thread, NULL, vtoy_ublk_queue_thread, dev->queue + threads))
+        {
+            break;
+        }
+    }
+
+    pthread_sigmask(SIG_SETMASK, &oldset, NULL);
+    if (threads < dev->queue_num)
+    {
+        goto end;
+    }
+
+    /* START_DEV returns after all the queues have fetched their requests */
+    if (vtoy_ublk_ctrl_cmd(dev, VTOY_UBLK_START_DEV, NULL, 0, (uint64_t)getpid()) < 0)
+    {
+        goto end;
+    }
+    started = 1;
+
+    snprintf(name, sizeof(name), "ublkb%u", dev->info.dev_id);
+    for (i = 0; i < 50 && vtoyblk_make_node("block", name, 1); i++)
+    {
+        usleep(100 * 1000);
+    }
+
+    snprintf(name, sizeof(name), "/dev/ublkb%u\n", dev->info.dev_id);
+    write(notify_fd, name, strlen(name));
+    close(notify_fd);
+
+    while (!g_stop)
+    {
+        pause();
+    }
+    rc = 0;
+
+end:
+    if (dev->info.dev_id != (__u32)-1)
+    {
+        /* STOP_DEV aborts all the pending fetches, so the queue threads exit */
+        if (started || threads > 0)
+        {
+            vtoy_ublk_ctrl_cmd(dev, VTOY_UBLK_STOP_DEV, NULL, 0, 0);
+        }
+
+        for (i = 0; i < threads; i++)
+        {
+            pthread_join(dev->queue[i].thread, NULL);
+        }
+    }
+
+    for (i = 0; i < dev->queue_num; i++)
+    {
+        vtoy_ublk_queue_exit(dev->queue + i);
+    }
+
+    if (dev->cdev_fd >= 0)
+    {
+        close(dev->cdev_fd);
+    }
+
+    /* DEL_DEV waits for /dev/ublkcN to be released, so it must be the last one */
+    if (dev->info.dev_id != (__u32)-1)
+    {
+        vtoy_ublk_ctrl_cmd(dev, VTOY_UBLK_DEL_DEV, NULL, 0, 0);
+    }
+
+    vtoy_uring_exit(&dev->ring);
+    close(dev->ctrl_fd);
+    free(dev);
+    return rc;
+}
+
+#else
+
+static int vtoyblk_run_ublk(int queue_num, int depth, int notify_fd)
+{
+    (void)queue_num;
+    (void)depth;
+    (void)notify_fd;
+
+    debug("ublk is not supported in this build\n");
+    return 1;
+}
+
+#endif /* VTOY_UBLK_SUPPORT */
+
+static int vtoyblk_full_io(int fd, void *buf, size_t len, int wr)
+{
+    ssize_t rc;
+    char *pos = (char *)buf;
+
+    while (len > 0)
+    {
+        rc = wr ? write(fd, pos, len) : read(fd, pos, len);
+        if (rc <= 0)
+        {
+            if (rc < 0 && errno == EINTR && !g_stop)
+            {
+                continue;
+            }
+            return 1;
+        }
+
+        pos += rc;
+        len -= (size_t)rc;
+    }
+
+    return 0;
+}
+
+static uint64_t vtoyblk_ntohll(uint64_t v)
+{
+    return ((uint64_t)ntohl((uint32_t)(v & 0xFFFFFFFF)) << 32) | ntohl((uint32_t)(v >> 32));
+}
+
+/* serve the nbd requests from the kernel until NBD_CMD_DISC */
+static int vtoyblk_nbd_serve(int sock)
+{
+    int rc;
+    uint32_t len;
+    uint32_t type;
+    uint64_t from;
+    char *buf = NULL;
+    struct nbd_request req;
+    struct nbd_reply reply;
+
+    buf = malloc(VTOYBLK_IO_BUF_SIZE);
+    if (!buf)
+    {
+        return 1;
+    }
+
+    while (!g_stop)
+    {
+        if (vtoyblk_full_io(sock, &req, sizeof(req), 0))
+        {
+            break;
+        }
+
+        if (ntohl(req.magic) != NBD_REQUEST_MAGIC)
+        {
+            debug("invalid nbd request magic 0x%x\n", ntohl(req.magic));
+            break;
+        }
+
+        type = ntohl(req.type) & 0xFFFF;
+        len = ntohl(req.len);
+        from = vtoyblk_ntohll(req.from);
+
+        if (type == NBD_CMD_DISC)
+        {
+            debug("nbd disconnect\n");
+            break;
+        }
+
+        memset(&reply, 0, sizeof(reply));
+        reply.magic = htonl(NBD_REPLY_MAGIC);
+        memcpy(reply.handle, req.handle, sizeof(reply.handle));
+
+        if (type == NBD_CMD_READ)
+        {
+            /* the kernel never sends a request bigger than max_sectors, but be careful here */
+            rc = (len <= VTOYBLK_IO_BUF_SIZE) ? vtoyblk_read_image(buf, from, len) : -EINVAL;
+            reply.error = htonl(rc ? (uint32_t)(-rc) : 0);
+
+            if (vtoyblk_full_io(sock, &reply, sizeof(reply), 1))
+            {
+                break;
+            }
+
+            if (rc == 0 && vtoyblk_full_io(sock, buf, len, 1))
+            {
+                break;
+            }
+        }
+        else
+        {
+            if (type == NBD_CMD_WRITE)
+            {
+                /* drop the payload, the device is read only */
+                while (len > 0)
+                {
+                    from = (len > VTOYBLK_IO_BUF_SIZE) ? VTOYBLK_IO_BUF_SIZE : len;
+                    if (vtoyblk_full_io(sock, buf, (size_t)from, 0))
+                    {
+                        break;
+                    }
+                    len -= (uint32_t)from;
+                }
+            }
+
+            reply.error = htonl((type == NBD_CMD_FLUSH) ? 0 : EROFS);
+            if (vtoyblk_full_io(sock, &reply, sizeof(reply), 1))
+            {
+                break;
+            }
+        }
+    }
+
+    free(buf);
+    return 0;
+}
+
+static int vtoyblk_run_nbd(int notify_fd)
+{
+    int i;
+    int fd = -1;
+    int rc = 1;
+    int ro = 1;
+    pid_t pid;
+    int sv[2];
+    char name[64];
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0)
+    {
+        debug("failed to create socketpair %d\n", errno);
+        return 1;
+    }
+
+    for (i = 0; i < 16; i++)
+    {
+        snprintf(name, sizeof(name), "nbd%d", i);
+        vtoyblk_make_node("block", name, 1);
+
+        snprintf(name, sizeof(name), "/dev/nbd%d", i);
+        fd = open(name, O_RDWR);
+        if (fd < 0)
+        {
+            continue;
+        }
+
+        if (ioctl(fd, NBD_SET_SOCK, sv[0]) == 0)
+        {
+            break;
+        }
+
+        debug("%s is busy %d\n", name, errno);
+        close(fd);
+        fd = -1;
+    }
+
+    if (fd < 0)
+    {
+        debug("no free nbd device\n");
+        goto end;
+    }
+
+    ioctl(fd, NBD_SET_BLKSIZE, 2048UL);
+    ioctl(fd, NBD_SET_SIZE_BLOCKS, (unsigned long)(g_img_size / 2048));
+    ioctl(fd, NBD_SET_FLAGS, (unsigned long)(NBD_FLAG_HAS_FLAGS | NBD_FLAG_READ_ONLY));
+    ioctl(fd, BLKROSET, &ro);
+
+    pid = fork();
+    if (pid < 0)
+    {
+        ioctl(fd, NBD_CLEAR_SOCK);
+        goto end;
+    }
+    else if (pid == 0)
+    {
+        /* NBD_DO_IT blocks until the connection is closed */
+        close(sv[1]);
+        ioctl(fd, NBD_DO_IT);
+        ioctl(fd, NBD_CLEAR_QUE);
+        ioctl(fd, NBD_CLEAR_SOCK);
+        _exit(0);
+    }
+
+    close(sv[0]);
+    sv[0] = -1;
+
+    strcat(name, "\n");
+    write(notify_fd, name, strlen(name));
+    close(notify_fd);
+
+    rc = vtoyblk_nbd_serve(sv[1]);
+
+    ioctl(fd, NBD_DISCONNECT);
+    close(sv[1]);
+    sv[1] = -1;
+    waitpid(pid, NULL, 0);
+
+end:
+    if (sv[0] >= 0)
+    {
+        close(sv[0]);
+    }
+    if (sv[1] >= 0)
+    {
+        close(sv[1]);
+    }
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+    return rc;
+}
+
+static int vtoyblk_print_help(FILE *fp)
+{
+    fprintf(fp, "Usage: \n");
+    fprintf(fp, "  vtoyblk [ -u | -n ] [ -q queues ] [ -d depth ] [ -D ] [ -v ] img_map_file /dev/sdX\n");
+    fprintf(fp, "     -u  use ublk only\n");
+    fprintf(fp, "     -n  use nbd only\n");
+    fprintf(fp, "     -D  run in background, print the device path after it's ready\n");
+    return 0;
+}
+
+int vtoyblk_main(int argc, char **argv)
+{
+    int ch;
+    int rc = 1;
+    int len;
+    int bg = 0;
+    int mode = VTOYBLK_MODE_AUTO;
+    int queue_num = 0;
+    int depth = 64;
+    int pfd[2];
+    int notify_fd;
+    int nullfd;
+    pid_t pid;
+    char devpath[64] = {0};
+
+    while ((ch = getopt(argc, argv, "unq:d:Dv")) != -1)
+    {
+        if (ch == 'u')
+        {
+            mode = VTOYBLK_MODE_UBLK;
+        }
+        else if (ch == 'n')
+        {
+            mode = VTOYBLK_MODE_NBD;
+        }
+        else if (ch == 'q')
+        {
+            queue_num = (int)strtol(optarg, NULL, 10);
+        }
+        else if (ch == 'd')
+        {
+            depth = (int)strtol(optarg, NULL, 10);
+        }
+        else if (ch == 'D')
+        {
+            bg = 1;
+        }
+        else if (ch == 'v')
+        {
+            verbose = 1;
+        }
+        else
+        {
+            return vtoyblk_print_help(stdout);
+        }
+    }
+
+    if (optind + 2 != argc)
+    {
+        return vtoyblk_print_help(stdout);
+    }
+
+    if (queue_num <= 0)
+    {
+        queue_num = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    queue_num = (queue_num <= 0) ? 1 : ((queue_num > VTOYBLK_MAX_QUEUE) ? VTOYBLK_MAX_QUEUE : queue_num);
+
+    if (depth <= 0 || depth > 256)
+    {
+        depth = 64;
+    }
+
+    if (vtoyblk_load_map(argv[optind], argv[optind + 1]))
+    {
+        return 1;
+    }
+
+    signal(SIGTERM, vtoyblk_sig_handler);
+    signal(SIGINT, vtoyblk_sig_handler);
+    signal(SIGPIPE, SIG_IGN);
+
+    /* In background mode the device path is sent back through the pipe when the device is ready */
+    if (bg == 0)
+    {
+        fflush(stdout);
+        notify_fd = dup(STDOUT_FILENO);
+    }
+    else
+    {
+        if (pipe(pfd) < 0)
+        {
+            return 1;
+        }
+
+        pid = fork();
+        if (pid < 0)
+        {
+            return 1;
+        }
+        else if (pid > 0)
+        {
+            close(pfd[1]);
+            len = (int)read(pfd[0], devpath, sizeof(devpath) - 1);
+            close(pfd[0]);
+
+            if (len > 0)
+            {
+                printf("%s", devpath);
+                return 0;
+            }
+
+            fprintf(stderr, "Failed to create block device for %s\n", argv[optind + 1]);
+            return 1;
+        }
+
+        close(pfd[0]);
+        notify_fd = pfd[1];
+        setsid();
+
+        /*
+         * The caller reads our stdout through $(...) and waits for EOF,
+         * so the daemon must not keep the inherited stdin/stdout/stderr.
+         * The result is only reported through the pipe.
+         */
+        nullfd = open("/dev/null", O_RDWR);
+        if (nullfd >= 0)
+        {
+            dup2(nullfd, STDIN_FILENO);
+            dup2(nullfd, STDOUT_FILENO);
+            dup2(nullfd, STDERR_FILENO);
+            if (nullfd > STDERR_FILENO)
+            {
+                close(nullfd);
+            }
+        }
+    }
+
+    if (mode != VTOYBLK_MODE_NBD)
+    {
+        rc = vtoyblk_run_ublk(queue_num, depth, notify_fd);
+        debug("ublk rc=%d\n", rc);
+    }
+
+    if (rc && mode != VTOYBLK_MODE_UBLK && !g_stop)
+    {
+        rc = vtoyblk_run_nbd(notify_fd);
+        debug("nbd rc=%d\n", rc);
+    }
+
+    close(g_disk_fd);
+    free(g_img_chunk);
+    return rc;
+}
+
+// wrapper main
+#ifndef BUILD_VTOY_TOOL
+int main(int argc, char **argv)
+{
+    return vtoyblk_main(argc, argv);
+}
+#endif
@@ -0,0 +1,550 @@
+/******************************************************************************
+ * vtoydefrag.c  ---- ventoy image defragment tool
+ *
+ * Copyright (c) 2020, longpanda <admin@ventoy.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/types.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <linux/fs.h>
+#include <linux/fiemap.h>
+
+#ifndef FS_IOC_FIEMAP
+#define FS_IOC_FIEMAP _IOWR('f', 11, struct fiemap)
+#endif
+
+#define VTOYDEFRAG_EXTENT_BATCH   256
+#define VTOYDEFRAG_COPY_BUF_SIZE  (1024 * 1024)
+#define VTOYDEFRAG_TMP_SUFFIX     ".vtdefrag"
+
+static int verbose = 0;
+#define debug(fmt, ...) if(verbose) printf(fmt, ##__VA_ARGS__)
+
+typedef struct vtoydefrag_stat
+{
+    unsigned long scan_num;
+    unsigned long frag_num;
+    unsigned long rewrite_num;
+    unsigned long fail_num;
+    unsigned long long chunk_before;
+    unsigned long long chunk_after;
+}vtoydefrag_stat;
+
+static int g_report_only = 0;
+static unsigned long g_max_chunk = 1;
+static vtoydefrag_stat g_stat;
+static char *g_copy_buf = NULL;
+
+static const char *g_img_suffix[] =
+{
+    ".iso", ".wim", ".img", ".vhd", ".vhdx", ".vtoy", ".efi", NULL
+};
+
+static int vtoydefrag_is_img_file(const char *name)
+{
+    int i;
+    int len;
+    int slen;
+
+    len = (int)strlen(name);
+    for (i = 0; g_img_suffix[i]; i++)
+    {
+        slen = (int)strlen(g_img_suffix[i]);
+        if (len > slen && strcasecmp(name + len - slen, g_img_suffix[i]) == 0)
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Physically adjacent extents are merged into one chunk, the same as
+ * grub_fat_get_file_chunk/grub_ext_get_file_chunk do when the chain data
+ * is built, so the number here is the chunk count ventoy will see at boot.
+ */
+static int vtoydefrag_fiemap_chunk_num(int fd, unsigned long *chunknum)
+{
+    int i;
+    int last = 0;
+    unsigned long num = 0;
+    unsigned long long start = 0;
+    unsigned long long phyend = 0;
+    struct fiemap *map = NULL;
+    struct fiemap_extent *extent = NULL;
+
+    map = malloc(sizeof(struct fiemap) + VTOYDEFRAG_EXTENT_BATCH * sizeof(struct fiemap_extent));
+    if (!map)
+    {
+        return 1;
+    }
+
+    while (!last)
+    {
+        memset(map, 0, sizeof(struct fiemap));
+        map->fm_start = start;
+        map->fm_length = ~0ULL;
+        map->fm_flags = FIEMAP_FLAG_SYNC;
+        map->fm_extent_count = VTOYDEFRAG_EXTENT_BATCH;
+
+        if (ioctl(fd, FS_IOC_FIEMAP, map) < 0)
+        {
+            debug("FIEMAP failed err:%d\n", errno);
+            free(map);
+            return 1;
+        }
+
+        if (map->fm_mapped_extents == 0)
+        {
+            break;
+        }
+
+        for (i = 0; i < (int)map->fm_mapped_extents; i++)
+        {
+            extent = map->fm_extents + i;
+            if (num == 0 || extent->fe_physical != phyend)
+            {
+                num++;
+            }
+
+            phyend = extent->fe_physical + extent->fe_length;
+            start = extent->fe_logical + extent->fe_length;
+
+            if (extent->fe_flags & FIEMAP_EXTENT_LAST)
+            {
+                last = 1;
+            }
+        }
+    }
+
+    free(map);
+    *chunknum = num;
+    return 0;
+}
+
+/* fallback for filesystems without FIEMAP support (e.g. ntfs-3g fuseblk) */
+static int vtoydefrag_fibmap_chunk_num(int fd, unsigned long long size, unsigned long *chunknum)
+{
+    int blksize = 0;
+    unsigned int blk;
+    unsigned int lastblk = 0;
+    unsigned long num = 0;
+    unsigned long long i;
+    unsigned long long count;
+
+    if (ioctl(fd, FIGETBSZ, &blksize) < 0 || blksize <= 0)
+    {
+        debug("FIGETBSZ failed err:%d\n", errno);
+        return 1;
+    }
+
+    count = (size + blksize - 1) / blksize;
+    for (i = 0; i < count; i++)
+    {
+        blk = (unsigned int)i;
+        if (ioctl(fd, FIBMAP, &blk) < 0)
+        {
+            debug("FIBMAP failed err:%d\n", errno);
+            return 1;
+        }
+
+        if (i == 0 || blk != lastblk + 1)
+        {
+            num++;
+        }
+        lastblk = blk;
+    }
+
+    *chunknum = num;
+    return 0;
+}
+
+static int vtoydefrag_get_chunk_num(int fd, unsigned long long size, unsigned long *chunknum)
+{
+    if (vtoydefrag_fiemap_chunk_num(fd, chunknum) == 0)
+    {
+        return 0;
+    }
+
+    return vtoydefrag_fibmap_chunk_num(fd, size, chunknum);
+}
+
+static int vtoydefrag_prealloc(int fd, unsigned long long size)
+{
+#ifndef USE_DIET_C
+    if (fallocate(fd, 0, 0, (off_t)size) == 0)
+    {
+        return 0;
+    }
+    debug("fallocate failed err:%d, fallback to ftruncate\n", errno);
+#endif
+
+    return ftruncate(fd, (off_t)size);
+}
+
+static int vtoydefrag_copy_data(int srcfd, int dstfd, unsigned long long size)
+{
+    ssize_t rlen;
+    ssize_t wlen;
+    unsigned long long left = size;
+
+    lseek(srcfd, 0, SEEK_SET);
+    lseek(dstfd, 0, SEEK_SET);
+
+    while (left > 0)
+    {
+        rlen = read(srcfd, g_copy_buf, (left > VTOYDEFRAG_COPY_BUF_SIZE) ? VTOYDEFRAG_COPY_BUF_SIZE : (size_t)left);
+        if (rlen <= 0)
+        {
+            fprintf(stderr, "read failed err:%d\n", errno);
+            return 1;
+        }
+
+        wlen = write(dstfd, g_copy_buf, rlen);
+        if (wlen != rlen)
+        {
+            fprintf(stderr, "write failed err:%d\n", errno);
+            return 1;
+        }
+
+        left -= rlen;
+    }
+
+    return fsync(dstfd);
+}
+
+static int vtoydefrag_rewrite(const char *path, int srcfd, struct stat *st, unsigned long oldnum, unsigned long *newnum)
+{
+    int rc = 1;
+    int dstfd = -1;
+    int dirfd = -1;
+    char *pos = NULL;
+    char tmppath[4352];
+    char dirpath[4096];
+    struct statvfs vfs;
+
+    if (fstatvfs(srcfd, &vfs) == 0)
+    {
+        if ((unsigned long long)vfs.f_bavail * vfs.f_frsize < (unsigned long long)st->st_size)
+        {
+            fprintf(stderr, "Not enough free space to rewrite %s\n", path);
+            return 1;
+        }
+    }
+
+    snprintf(dirpath, sizeof(dirpath), "%s", path);
+    pos = strrchr(dirpath, '/');
+    if (pos)
+    {
+        *pos = 0;
+        snprintf(tmppath, sizeof(tmppath), "%s/.%s%s", dirpath, pos + 1, VTOYDEFRAG_TMP_SUFFIX);
+    }
+    else
+    {
+        snprintf(dirpath, sizeof(dirpath), ".");
+        snprintf(tmppath, sizeof(tmppath), ".%s%s", path, VTOYDEFRAG_TMP_SUFFIX);
+    }
+
+    dstfd = open(tmppath, O_CREAT | O_EXCL | O_RDWR, st->st_mode & 0777);
+    if (dstfd < 0)
+    {
+        fprintf(stderr, "Failed to create %s err:%d\n", tmppath, errno);
+        return 1;
+    }
+
+    if (vtoydefrag_prealloc(dstfd, st->st_size))
+    {
+        fprintf(stderr, "Failed to preallocate %s err:%d\n", tmppath, errno);
+        goto end;
+    }
+
+    /*
+     * Check the preallocated space first, so that we don't waste time
+     * copying the data when the filesystem can't give us a better layout.
+     */
+    if (vtoydefrag_get_chunk_num(dstfd, st->st_size, newnum) == 0 && *newnum >= oldnum)
+    {
+        printf("  no contiguous free space (%lu chunks), skip\n", *newnum);
+        *newnum = oldnum;
+        rc = 0;
+        goto end;
+    }
+
+    if (vtoydefrag_copy_data(srcfd, dstfd, st->st_size))
+    {
+        goto end;
+    }
+
+    if (vtoydefrag_get_chunk_num(dstfd, st->st_size, newnum))
+    {
+        goto end;
+    }
+
+    (void)fchown(dstfd, st->st_uid, st->st_gid);
+    close(dstfd);
+    dstfd = -1;
+
+    if (rename(tmppath, path))
+    {
+        fprintf(stderr, "Failed to rename %s to %s err:%d\n", tmppath, path, errno);
+        goto end;
+    }
+    tmppath[0] = 0;
+
+    dirfd = open(dirpath, O_RDONLY);
+    if (dirfd >= 0)
+    {
+        fsync(dirfd);
+        close(dirfd);
+    }
+
+    g_stat.rewrite_num++;
+    rc = 0;
+
+end:
+    if (dstfd >= 0)
+    {
+        close(dstfd);
+    }
+
+    if (tmppath[0])
+    {
+        unlink(tmppath);
+    }
+
+    return rc;
+}
+
+static int vtoydefrag_proc_file(const char *path)
+{
+    int fd;
+    int rc = 0;
+    unsigned long oldnum = 0;
+    unsigned long newnum = 0;
+    struct stat st;
+
+    fd = open(path, g_report_only ? O_RDONLY : O_RDWR);
+    if (fd < 0)
+    {
+        fprintf(stderr, "Failed to open %s err:%d\n", path, errno);
+        g_stat.fail_num++;
+        return 1;
+    }
+
+    if (fstat(fd, &st) || st.st_size == 0)
+    {
+        close(fd);
+        return 0;
+    }
+
+    g_stat.scan_num++;
+
+    if (vtoydefrag_get_chunk_num(fd, st.st_size, &oldnum))
+    {
+        fprintf(stderr, "Failed to get block list of %s\n", path);
+        g_stat.fail_num++;
+        close(fd);
+        return 1;
+    }
+
+    newnum = oldnum;
+    if (oldnum > g_max_chunk)
+    {
+        g_stat.frag_num++;
+        printf("%8lu chunks  %s\n", oldnum, path);
+
+        if (!g_report_only)
+        {
+            if (vtoydefrag_rewrite(path, fd, &st, oldnum, &newnum))
+            {
+                g_stat.fail_num++;
+                newnum = oldnum;
+                rc = 1;
+            }
+            else
+            {
+                printf("  %lu --> %lu chunks\n", oldnum, newnum);
+            }
+        }
+    }
+    else
+    {
+        debug("%8lu chunks  %s\n", oldnum, path);
+    }
+
+    g_stat.chunk_before += oldnum;
+    g_stat.chunk_after += newnum;
+
+    close(fd);
+    return rc;
+}
+
+static int vtoydefrag_proc_dir(const char *dir)
+{
+    char path[4096];
+    DIR *dp = NULL;
+    struct dirent *ent = NULL;
+    struct stat st;
+
+    dp = opendir(dir);
+    if (!dp)
+    {
+        fprintf(stderr, "Failed to open dir %s err:%d\n", dir, errno);
+        return 1;
+    }
+
+    while ((ent = readdir(dp)) != NULL)
+    {
+        /* skip ., .. and hidden files (including our own temp files) */
+        if (ent->d_name[0] == '.')
+        {
+            continue;
+        }
+
+        snprintf(path, sizeof(path), "%s/%s", dir, ent->d_name);
+        if (lstat(path, &st))
+        {
+            continue;
+        }
+
+        if (S_ISDIR(st.st_mode))
+        {
+            vtoydefrag_proc_dir(path);
+        }
+        else if (S_ISREG(st.st_mode) && vtoydefrag_is_img_file(ent->d_name))
+        {
+            vtoydefrag_proc_file(path);
+        }
+    }
+
+    closedir(dp);
+    return 0;
+}
+
+static int vtoydefrag_print_help(FILE *fp)
+{
+    fprintf(fp, "Usage: vtoydefrag [ -n -v -m maxchunk ] path ...\n");
+    fprintf(fp, "  path     mounted ventoy partition directory or image file\n");
+    fprintf(fp, "  -n       only report the fragment status, do not rewrite\n");
+    fprintf(fp, "  -m num   rewrite image files with more than num chunks (default 1)\n");
+    fprintf(fp, "  -v       verbose, also print the unfragmented files\n");
+    return 0;
+}
+
+int vtoydefrag_main(int argc, char **argv)
+{
+    int i;
+    int ch;
+    struct stat st;
+
+    while ((ch = getopt(argc, argv, "m:nvh")) != -1)
+    {
+        if (ch == 'n')
+        {
+            g_report_only = 1;
+        }
+        else if (ch == 'm')
+        {
+            g_max_chunk = strtoul(optarg, NULL, 10);
+        }
+        else if (ch == 'v')
+        {
+            verbose = 1;
+        }
+        else if (ch == 'h')
+        {
+            return vtoydefrag_print_help(stdout);
+        }
+        else
+        {
+            vtoydefrag_print_help(stderr);
+            return 1;
+        }
+    }
+
+    if (optind >= argc)
+    {
+        vtoydefrag_print_help(stderr);
+        return 1;
+    }
+
+    if (!g_report_only)
+    {
+        g_copy_buf = malloc(VTOYDEFRAG_COPY_BUF_SIZE);
+        if (!g_copy_buf)
+        {
+            fprintf(stderr, "Failed to malloc copy buffer\n");
+            return 1;
+        }
+    }
+
+    memset(&g_stat, 0, sizeof(g_stat));
+
+    for (i = optind; i < argc; i++)
+    {
+        if (stat(argv[i], &st))
+        {
+            fprintf(stderr, "Failed to stat %s err:%d\n", argv[i], errno);
+            g_stat.fail_num++;
+            continue;
+        }
+
+        if (S_ISDIR(st.st_mode))
+        {
+            vtoydefrag_proc_dir(argv[i]);
+        }
+        else
+        {
+            vtoydefrag_proc_file(argv[i]);
+        }
+    }
+
+    printf("\n============== fragment report ==============\n");
+    printf("image files:      %lu\n", g_stat.scan_num);
+    printf("fragmented:       %lu\n", g_stat.frag_num);
+    printf("rewritten:        %lu\n", g_stat.rewrite_num);
+    printf("failed:           %lu\n", g_stat.fail_num);
+    printf("chunks before:    %llu\n", g_stat.chunk_before);
+    printf("chunks after:     %llu\n", g_report_only ? g_stat.chunk_before : g_stat.chunk_after);
+
+    if (g_copy_buf)
+    {
+        free(g_copy_buf);
+    }
+
+    return g_stat.fail_num ? 1 : 0;
+}
+
+// wrapper main
+#ifndef BUILD_VTOY_TOOL
+int main(int argc, char **argv)
+{
+    return vtoydefrag_main(argc, argv);
+}
+#endif
+
@@ -30,6 +30,7 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <linux/fs.h>
+#include <linux/dm-ioctl.h>
 #include "biso.h"
 #include "biso_list.h"
 #include "biso_util.h"
@@ -58,6 +59,13 @@ typedef struct ventoy_img_chunk
 }ventoy_img_chunk;
 #pragma pack()
 
+/*
+ * A chunk whose disk sectors start from VTOY_ZERO_CHUNK_SECTOR has no storage
+ * (unallocated block of a dynamic vdisk). It reads as zero and can't be written.
+ */
+#define VTOY_ZERO_CHUNK_SECTOR    0x8000000000000000ULL
+#define VTOY_IS_ZERO_CHUNK(chunk) ((chunk)->disk_start_sector >= VTOY_ZERO_CHUNK_SECTOR)
+
 static int verbose = 0;
 #define debug(fmt, ...) if(verbose) printf(fmt, ##__VA_ARGS__)
 
@@ -66,6 +74,43 @@ static int verbose = 0;
 #define CMD_DUMP_ISO_INFO     3
 #define CMD_EXTRACT_ISO_FILE  4
 #define CMD_PRINT_EXTRACT_ISO_FILE  5
+#define CMD_EXTRACT_MANIFEST  6
+
+#define VTOYDM_EXTRACT_BUF_SIZE  (1024 * 1024)
+#define VTOYDM_EXTRACT_MAX_OPEN  256
+
+/* same as makedev() in glibc, some of our libc don't have sys/sysmacros.h */
+#define VTOY_MKDEV(ma, mi)  ((((ma) & 0xfff) << 8) | ((mi) & 0xff) | (((mi) & 0xfff00) << 12))
+
+/* one file to extract, sector is the first iso sector (2048) of the file */
+typedef struct vtoydm_extract_item
+{
+    uint64_t disk_sector;
+    unsigned long sector;
+    unsigned long long size;
+    char *outfile;
+    int fd;
+    int fail;
+}vtoydm_extract_item;
+
+/* one piece of an item that is contiguous on disk, at most VTOYDM_EXTRACT_BUF_SIZE */
+typedef struct vtoydm_extract_extent
+{
+    uint64_t disk_sector;   /* in 512 */
+    uint64_t offset;        /* offset in the output file */
+    uint32_t len;           /* bytes to write */
+    uint32_t secs;          /* in 2048, len rounded up */
+    int item;               /* index in the batch */
+}vtoydm_extract_extent;
+
+/* one dm linear target (or zero target for a zero chunk), all in 512 bytes sector */
+typedef struct vtoydm_linear
+{
+    uint64_t start;
+    uint64_t len;
+    uint64_t offset;
+    int zero;
+}vtoydm_linear;
 
 static uint64_t g_iso_file_size;
 static char g_disk_name[128];
@@ -212,6 +257,12 @@ int vtoydm_read_iso_sector(UINT64 sector, void *buf)
         }
     }
 
+    if (i < g_img_chunk_num && VTOY_IS_ZERO_CHUNK(g_img_chunk + i))
+    {
+        memset(buf, 0, 2048);
+        return 0;
+    }
+
     fd = open(g_disk_name, O_RDONLY | O_BINARY);
     if (fd < 0)
     {
@@ -348,17 +399,267 @@ int vtoydm_dump_iso(const char *img_map_file, const char *diskname)
     return 0;
 }
 
-static int vtoydm_extract_iso
+/* index of the chunk which contains the iso sector, -1 if not found */
+static int vtoydm_find_chunk(uint64_t sector)
+{
+    int lo = 0;
+    int hi = g_img_chunk_num - 1;
+    int mid;
+
+    while (lo <= hi)
+    {
+        mid = (lo + hi) / 2;
+        if (sector < g_img_chunk[mid].img_start_sector)
+        {
+            hi = mid - 1;
+        }
+        else if (sector > g_img_chunk[mid].img_end_sector)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            return mid;
+        }
+    }
+
+    return -1;
+}
+
+/* 
+ * Split one item into disk contiguous extents.
+ * Sectors not in the image map (should not happen) are left as holes, so they read as zero.
+ */
+static int vtoydm_add_extents
+(
+    vtoydm_extract_item *item, 
+    int itemidx,
+    vtoydm_extract_extent **extents, 
+    int *num, 
+    int *max
+)
+{
+    int idx;
+    uint32_t count;
+    uint32_t maxsec = VTOYDM_EXTRACT_BUF_SIZE / 2048;
+    uint64_t sector = item->sector;
+    uint64_t offset = 0;
+    vtoydm_extract_extent *ext = NULL;
+    vtoydm_extract_extent *newext = NULL;
+
+    while (offset < item->size)
+    {
+        count = (uint32_t)((item->size - offset + 2047) / 2048);
+        if (count > maxsec)
+        {
+            count = maxsec;
+        }
+
+        idx = vtoydm_find_chunk(sector);
+        if (idx < 0)
+        {
+            sector++;
+            offset += 2048;
+            continue;
+        }
+
+        if (sector + count - 1 > g_img_chunk[idx].img_end_sector)
+        {
+            count = (uint32_t)(g_img_chunk[idx].img_end_sector + 1 - sector);
+        }
+
+        if (*num >= *max)
+        {
+            newext = realloc(*extents, sizeof(vtoydm_extract_extent) * (*max + 1024));
+            if (NULL == newext)
+            {
+                fprintf(stderr, "Failed to realloc memory err:%d\n", errno);
+                return 1;
+            }
+            *extents = newext;
+            *max += 1024;
+        }
+
+        ext = *extents + *num;
+        ext->disk_sector = ((sector - g_img_chunk[idx].img_start_sector) << 2) + g_img_chunk[idx].disk_start_sector;
+        ext->offset = offset;
+        ext->secs = count;
+        ext->len = (item->size - offset > (uint64_t)count * 2048) ? count * 2048 : (uint32_t)(item->size - offset);
+        ext->item = itemidx;
+        (*num)++;
+
+        sector += count;
+        offset += (uint64_t)count * 2048;
+    }
+
+    return 0;
+}
+
+static int vtoydm_extent_cmp(const void *a, const void *b)
+{
+    const vtoydm_extract_extent *ext1 = (const vtoydm_extract_extent *)a;
+    const vtoydm_extract_extent *ext2 = (const vtoydm_extract_extent *)b;
+
+    if (ext1->disk_sector < ext2->disk_sector)
+    {
+        return -1;
+    }
+    else if (ext1->disk_sector > ext2->disk_sector)
+    {
+        return 1;
+    }
+    return 0;
+}
+
+/* 
+ * Extract a batch of items with the opened disk, return the failed item count.
+ * The extents of all the items are sorted by disk sector, extents contiguous on disk
+ * are read together with buf (VTOYDM_EXTRACT_BUF_SIZE) even if they belong to different files.
+ */
+static int vtoydm_extract_batch(int diskfd, vtoydm_extract_item *items, int num, char *buf)
+{
+    int i;
+    int j;
+    int k;
+    int fail = 0;
+    int reads = 0;
+    int extnum = 0;
+    int extmax = 0;
+    uint32_t pos;
+    uint32_t runsecs;
+    uint32_t maxsec = VTOYDM_EXTRACT_BUF_SIZE / 2048;
+    vtoydm_extract_item *item = NULL;
+    vtoydm_extract_extent *extents = NULL;
+
+    for (i = 0; i < num; i++)
+    {
+        items[i].fail = 0;
+        items[i].fd = open(items[i].outfile, O_CREAT | O_TRUNC | O_WRONLY | O_BINARY, 0644);
+        if (items[i].fd < 0)
+        {
+            fprintf(stderr, "Failed to create file %s err:%d\n", items[i].outfile, errno);
+            items[i].fail = 1;
+            continue;
+        }
+
+        if (ftruncate(items[i].fd, (off_t)items[i].size) < 0)
+        {
+            fprintf(stderr, "Failed to set file size %s err:%d\n", items[i].outfile, errno);
+            items[i].fail = 1;
+            continue;
+        }
+
+        if (vtoydm_add_extents(items + i, i, &extents, &extnum, &extmax))
+        {
+            items[i].fail = 1;
+        }
+    }
+
+    if (extnum > 1)
+    {
+        qsort(extents, extnum, sizeof(vtoydm_extract_extent), vtoydm_extent_cmp);
+    }
+
+    for (i = 0; i < extnum; i = j)
+    {
+        runsecs = extents[i].secs;
+        for (j = i + 1; j < extnum; j++)
+        {
+            if (extents[j].disk_sector != extents[i].disk_sector + ((uint64_t)runsecs << 2) ||
+                runsecs + extents[j].secs > maxsec)
+            {
+                break;
+            }
+            runsecs += extents[j].secs;
+        }
+
+        reads++;
+        if (pread(diskfd, buf, (size_t)runsecs * 2048, (off_t)(extents[i].disk_sector * 512)) != (ssize_t)runsecs * 2048)
+        {
+            fprintf(stderr, "Failed to read disk sector %llu count %u err:%d\n", 
+                    (unsigned long long)extents[i].disk_sector, runsecs, errno);
+            for (k = i; k < j; k++)
+            {
+                items[extents[k].item].fail = 1;
+            }
+            continue;
+        }
+
+        for (pos = 0, k = i; k < j; k++)
+        {
+            item = items + extents[k].item;
+            if (item->fail == 0 && 
+                pwrite(item->fd, buf + pos, extents[k].len, (off_t)extents[k].offset) != (ssize_t)extents[k].len)
+            {
+                fprintf(stderr, "Failed to write file %s err:%d\n", item->outfile, errno);
+                item->fail = 1;
+            }
+            pos += extents[k].secs * 2048;
+        }
+    }
+
+    debug("batch of %d files, %d extents, %d reads\n", num, extnum, reads);
+
+    for (i = 0; i < num; i++)
+    {
+        if (items[i].fd >= 0)
+        {
+            close(items[i].fd);
+            items[i].fd = -1;
+        }
+
+        if (items[i].fail)
+        {
+            fail++;
+            unlink(items[i].outfile);
+        }
+    }
+
+    if (extents)
+    {
+        free(extents);
+    }
+
+    return fail;
+}
+
+static int vtoydm_item_cmp(const void *a, const void *b)
+{
+    const vtoydm_extract_item *item1 = (const vtoydm_extract_item *)a;
+    const vtoydm_extract_item *item2 = (const vtoydm_extract_item *)b;
+
+    if (item1->disk_sector < item2->disk_sector)
+    {
+        return -1;
+    }
+    else if (item1->disk_sector > item2->disk_sector)
+    {
+        return 1;
+    }
+    return 0;
+}
+
+/* 
+ * Extract all the items with the disk opened only once, in disk order.
+ * Items are processed in batches to limit the number of output files opened at the same time.
+ */
+static int vtoydm_extract_items
 (
     const char *img_map_file, 
     const char *diskname,
-    unsigned long first_sector,
-    unsigned long long file_size,
-    const char *outfile
+    vtoydm_extract_item *items,
+    int num
 )
 {
+    int i;
+    int idx;
     int len;
-    FILE *fp = NULL;
+    int cnt;
+    int fd = -1;
+    int fail = 0;
+    char *buf = NULL;
+    unsigned long long total = 0;
+    unsigned long long done = 0;
 
     g_img_chunk = vtoydm_get_img_map_data(img_map_file, &len);
     if (NULL == g_img_chunk)
@@ -369,32 +670,173 @@ static int vtoydm_extract_iso
     strncpy(g_disk_name, diskname, sizeof(g_disk_name) - 1);
     g_img_chunk_num = len / sizeof(ventoy_img_chunk);
 
-    fp = fopen(outfile, "wb");
-    if (fp == NULL)
+    fd = open(diskname, O_RDONLY | O_BINARY);
+    if (fd < 0)
     {
-        fprintf(stderr, "Failed to create file %s err:%d\n", outfile, errno);
-        free(g_img_chunk);
-        return 1;
+        fprintf(stderr, "Failed to open %s err:%d\n", diskname, errno);
+        goto end;
     }
 
-    while (file_size > 0)
+    buf = malloc(VTOYDM_EXTRACT_BUF_SIZE);
+    if (NULL == buf)
     {
-        vtoydm_read_iso_sector(first_sector++, g_iso_sector_buf);
-        if (file_size > 2048)
+        fprintf(stderr, "Failed to malloc memory len:%d err:%d\n", VTOYDM_EXTRACT_BUF_SIZE, errno);
+        goto end;
+    }
+
+    for (i = 0; i < num; i++)
+    {
+        idx = vtoydm_find_chunk(items[i].sector);
+        if (idx >= 0)
         {
-            fwrite(g_iso_sector_buf, 2048, 1, fp);
-            file_size -= 2048;
+            items[i].disk_sector = ((items[i].sector - g_img_chunk[idx].img_start_sector) << 2) + g_img_chunk[idx].disk_start_sector;
         }
-        else
+        total += items[i].size;
+    }
+
+    if (num > 1)
+    {
+        qsort(items, num, sizeof(vtoydm_extract_item), vtoydm_item_cmp);
+    }
+
+    for (i = 0; i < num; i += cnt)
+    {
+        cnt = (num - i > VTOYDM_EXTRACT_MAX_OPEN) ? VTOYDM_EXTRACT_MAX_OPEN : (num - i);
+        fail += vtoydm_extract_batch(fd, items + i, cnt, buf);
+
+        for (idx = i; idx < i + cnt; idx++)
         {
-            fwrite(g_iso_sector_buf, 1, file_size, fp);
-            file_size = 0;
+            done += items[idx].size;
         }
+        debug("[%d/%d] %llu/%llu KB\n", i + cnt, num, done >> 10, total >> 10);
+    }
+
+end:
+    if (buf)
+    {
+        free(buf);
+    }
+
+    if (fd >= 0)
+    {
+        close(fd);
     }
     
-    fclose(fp);
     free(g_img_chunk);
-    return 0;
+    g_img_chunk = NULL;
+
+    if (fd < 0 || buf == NULL)
+    {
+        return 1;
+    }
+    return fail ? 1 : 0;
+}
+
+static int vtoydm_extract_iso
+(
+    const char *img_map_file, 
+    const char *diskname,
+    unsigned long first_sector,
+    unsigned long long file_size,
+    const char *outfile
+)
+{
+    vtoydm_extract_item item;
+
+    memset(&item, 0, sizeof(item));
+    item.sector = first_sector;
+    item.size = file_size;
+    item.outfile = (char *)outfile;
+
+    return vtoydm_extract_items(img_map_file, diskname, &item, 1);
+}
+
+/*
+ * Manifest file (or - for stdin), one file per line:
+ *     first_sector  file_size  outfile
+ * the same as the last two fields of vtoydm -i output, plus the output file path.
+ */
+static int vtoydm_extract_manifest
+(
+    const char *img_map_file, 
+    const char *diskname,
+    const char *manifest
+)
+{
+    int i;
+    int rc;
+    int num = 0;
+    int max = 0;
+    unsigned long sector;
+    unsigned long long size;
+    char line[512];
+    char path[400];
+    FILE *fp = NULL;
+    vtoydm_extract_item *items = NULL;
+    vtoydm_extract_item *newitems = NULL;
+
+    if (strcmp(manifest, "-") == 0)
+    {
+        fp = stdin;
+    }
+    else
+    {
+        fp = fopen(manifest, "r");
+        if (NULL == fp)
+        {
+            fprintf(stderr, "Failed to open file %s err:%d\n", manifest, errno);
+            return 1;
+        }
+    }
+
+    while (fgets(line, sizeof(line), fp))
+    {
+        if (line[0] == '#' || sscanf(line, "%lu %llu %399s", &sector, &size, path) != 3)
+        {
+            continue;
+        }
+
+        if (num >= max)
+        {
+            max = max ? max * 2 : 64;
+            newitems = realloc(items, max * sizeof(vtoydm_extract_item));
+            if (NULL == newitems)
+            {
+                fprintf(stderr, "Failed to realloc memory err:%d\n", errno);
+                rc = 1;
+                goto end;
+            }
+            items = newitems;
+        }
+
+        memset(items + num, 0, sizeof(vtoydm_extract_item));
+        items[num].sector = sector;
+        items[num].size = size;
+        items[num].outfile = strdup(path);
+        if (NULL == items[num].outfile)
+        {
+            rc = 1;
+            goto end;
+        }
+        num++;
+    }
+
+    debug("%d files in manifest %s\n", num, manifest);
+
+    rc = (num > 0) ? vtoydm_extract_items(img_map_file, diskname, items, num) : 0;
+
+end:
+    if (fp != stdin)
+    {
+        fclose(fp);
+    }
+
+    for (i = 0; i < num; i++)
+    {
+        free(items[i].outfile);
+    }
+    free(items);
+    return rc;
 }
 
 
@@ -484,57 +926,339 @@ static int vtoydm_print_extract_iso
 
 
 
-static int vtoydm_print_linear_table(const char *img_map_file, const char *diskname)
+static void vtoydm_get_part1_name(const char *diskname, char *part, int len)
+{
+    if (strstr(diskname, "nvme") || strstr(diskname, "mmc") || strstr(diskname, "nbd"))
+    {
+        snprintf(part, len, "%sp1", diskname);
+    }
+    else
+    {
+        snprintf(part, len, "%s1", diskname);
+    }
+}
+
+/*
+ * Convert the image chunks to dm linear targets.
+ * The image sector is 2048 bytes and the disk sector is 512 bytes, so all of them are converted to 512 here.
+ * Chunks that are contiguous both in the image and on the disk are merged into one target.
+ * Zero chunks (unallocated blocks of a dynamic vdisk) become dm zero targets.
+ * The targets must cover the image without any gap or overlap, and if file_size is not 0 they must cover
+ * the whole image file, otherwise the table is refused (dm would refuse it or return wrong data anyway).
+ */
+static vtoydm_linear * vtoydm_build_linear_table(ventoy_img_chunk *chunk, int num, uint64_t file_size, int *count)
 {
     int i;
-    int len;
-    uint32_t disk_sector_num;
-    uint32_t sector_start;
+    int n = 0;
+    int zero;
+    uint64_t start, len, offset;
+    vtoydm_linear *table = NULL;
+
+    table = malloc(sizeof(vtoydm_linear) * (num > 0 ? num : 1));
+    if (NULL == table)
+    {
+        fprintf(stderr, "Failed to malloc memory err:%d\n", errno);
+        return NULL;
+    }
+
+    for (i = 0; i < num; i++)
+    {
+        start = (uint64_t)chunk[i].img_start_sector << 2;
+        len = chunk[i].disk_end_sector + 1 - chunk[i].disk_start_sector;
+
+        zero = VTOY_IS_ZERO_CHUNK(chunk + i);
+
+        /* the ventoy partition 1 always start at sector 2048 */
+        if (chunk[i].disk_end_sector < chunk[i].disk_start_sector || chunk[i].disk_start_sector < 2048)
+        {
+            fprintf(stderr, "Invalid chunk %d disk sector %llu-%llu\n", i,
+                    (unsigned long long)chunk[i].disk_start_sector, (unsigned long long)chunk[i].disk_end_sector);
+            goto fail;
+        }
+        offset = zero ? 0 : chunk[i].disk_start_sector - 2048;
+
+        if (n > 0)
+        {
+            if (start != table[n - 1].start + table[n - 1].len)
+            {
+                fprintf(stderr, "Chunk %d start %llu is not continuous with previous end %llu\n", i,
+                        (unsigned long long)start, (unsigned long long)(table[n - 1].start + table[n - 1].len));
+                goto fail;
+            }
+
+            if (zero && table[n - 1].zero)
+            {
+                table[n - 1].len += len;
+                continue;
+            }
+
+            if (!zero && !table[n - 1].zero && offset == table[n - 1].offset + table[n - 1].len)
+            {
+                table[n - 1].len += len;
+                continue;
+            }
+        }
+        else if (start != 0)
+        {
+            fprintf(stderr, "The first chunk start %llu is not 0\n", (unsigned long long)start);
+            goto fail;
+        }
+
+        table[n].start = start;
+        table[n].len = len;
+        table[n].offset = offset;
+        table[n].zero = zero;
+        n++;
+    }
+
+    if (n == 0)
+    {
+        fprintf(stderr, "No chunk in the image map\n");
+        goto fail;
+    }
+
+    /* the last sector may be partly used */
+    len = table[n - 1].start + table[n - 1].len;
+    if (file_size > 0 && (len * 512 < file_size || len * 512 >= file_size + 2048))
+    {
+        fprintf(stderr, "Table size %llu sectors does not match file size %llu\n",
+                (unsigned long long)len, (unsigned long long)file_size);
+        goto fail;
+    }
+
+    debug("%d chunks merged to %d targets, total %llu sectors\n", num, n, (unsigned long long)len);
+
+    *count = n;
+    return table;
+
+fail:
+    free(table);
+    return NULL;
+}
+
+static vtoydm_linear * vtoydm_get_linear_table(const char *img_map_file, uint64_t file_size, int *count)
+{
+    int len = 0;
     ventoy_img_chunk *chunk = NULL;
-    
+    vtoydm_linear *table = NULL;
+
     chunk = vtoydm_get_img_map_data(img_map_file, &len);
     if (NULL == chunk)
+    {
+        return NULL;
+    }
+
+    table = vtoydm_build_linear_table(chunk, len / sizeof(ventoy_img_chunk), file_size, count);
+    free(chunk);
+    return table;
+}
+
+static int vtoydm_print_linear_table(const char *img_map_file, const char *diskname, uint64_t file_size)
+{
+    int i;
+    int count = 0;
+    char part[160];
+    vtoydm_linear *table = NULL;
+
+    table = vtoydm_get_linear_table(img_map_file, file_size, &count);
+    if (NULL == table)
     {
         return 1;
     }
 
-    for (i = 0; i < len / sizeof(ventoy_img_chunk); i++)
+    vtoydm_get_part1_name(diskname, part, sizeof(part));
+
+    for (i = 0; i < count; i++)
+    {
+        if (table[i].zero)
+        {
+            printf("%llu %llu zero\n", (unsigned long long)table[i].start, (unsigned long long)table[i].len);
+            continue;
+        }
+
+        printf("%llu %llu linear %s %llu\n", 
+               (unsigned long long)table[i].start, (unsigned long long)table[i].len, 
+               part, (unsigned long long)table[i].offset);
+    }
+
+    free(table);
+    return 0;
+}
+
+static void vtoydm_ioctl_init(struct dm_ioctl *io, size_t size, const char *name)
+{
+    memset(io, 0, sizeof(struct dm_ioctl));
+    io->version[0] = DM_VERSION_MAJOR;
+    io->version[1] = 0;
+    io->version[2] = 0;
+    io->data_size = (uint32_t)size;
+    io->data_start = sizeof(struct dm_ioctl);
+    strncpy(io->name, name, sizeof(io->name) - 1);
+}
+
+static int vtoydm_open_control(void)
+{
+    int fd;
+    unsigned int major, minor;
+    FILE *fp = NULL;
+
+    fd = open("/dev/mapper/control", O_RDWR);
+    if (fd >= 0)
+    {
+        return fd;
+    }
+
+    /* no udev/devtmpfs, create the control node by ourself like dmsetup mknodes */
+    fp = fopen("/sys/class/misc/device-mapper/dev", "r");
+    if (fp)
+    {
+        if (fscanf(fp, "%u:%u", &major, &minor) == 2)
+        {
+            mkdir("/dev/mapper", 0755);
+            mknod("/dev/mapper/control", S_IFCHR | 0600, VTOY_MKDEV(major, minor));
+        }
+        fclose(fp);
+    }
+
+    return open("/dev/mapper/control", O_RDWR);
+}
+
+/* create the dm device through the dm ioctl directly, same as "dmsetup create name table" */
+static int vtoydm_create_dm(const char *img_map_file, const char *diskname, const char *name, uint64_t file_size, int readonly)
+{
+    int i;
+    int fd = -1;
+    int rc = 1;
+    int count = 0;
+    int created = 0;
+    size_t size;
+    size_t speclen;
+    char *pos = NULL;
+    char *buf = NULL;
+    char part[160];
+    char devpath[300];
+    struct dm_ioctl io;
+    struct dm_ioctl *head = NULL;
+    struct dm_target_spec *spec = NULL;
+    vtoydm_linear *table = NULL;
+
+    table = vtoydm_get_linear_table(img_map_file, file_size, &count);
+    if (NULL == table)
+    {
+        return 1;
+    }
+
+    vtoydm_get_part1_name(diskname, part, sizeof(part));
+
+    /* each target is followed by its parameter string, aligned by 8 */
+    speclen = (sizeof(struct dm_target_spec) + strlen(part) + 32 + 7) & ~((size_t)7);
+    size = sizeof(struct dm_ioctl) + speclen * count;
+
+    buf = malloc(size);
+    if (NULL == buf)
+    {
+        fprintf(stderr, "Failed to malloc memory len:%lu err:%d\n", (unsigned long)size, errno);
+        goto end;
+    }
+    memset(buf, 0, size);
+
+    fd = vtoydm_open_control();
+    if (fd < 0)
+    {
+        fprintf(stderr, "Failed to open /dev/mapper/control err:%d\n", errno);
+        goto end;
+    }
+
+    vtoydm_ioctl_init(&io, sizeof(io), name);
+    if (ioctl(fd, DM_DEV_CREATE, &io) < 0)
+    {
+        fprintf(stderr, "Failed to create dm %s err:%d\n", name, errno);
+        goto end;
+    }
+    created = 1;
+
+    head = (struct dm_ioctl *)buf;
+    vtoydm_ioctl_init(head, size, name);
+    head->target_count = (uint32_t)count;
+    if (readonly)
     {
-        sector_start = chunk[i].img_start_sector;
-        disk_sector_num = (uint32_t)(chunk[i].disk_end_sector + 1 - chunk[i].disk_start_sector);
+        head->flags |= DM_READONLY_FLAG;
+    }
 
-        /* TBD: to be more flexible */
-        #if 0
-        printf("%u %u linear %s %llu\n", 
-               (sector_start << 2), disk_sector_num, 
-               diskname, (unsigned long long)chunk[i].disk_start_sector);
-        #else
-        if (strstr(diskname, "nvme") || strstr(diskname, "mmc") || strstr(diskname, "nbd"))
+    pos = buf + sizeof(struct dm_ioctl);
+    for (i = 0; i < count; i++)
+    {
+        spec = (struct dm_target_spec *)pos;
+        spec->sector_start = table[i].start;
+        spec->length = table[i].len;
+        spec->status = 0;
+        spec->next = (uint32_t)speclen;
+        if (table[i].zero)
         {
-            printf("%u %u linear %sp1 %llu\n", 
-               (sector_start << 2), disk_sector_num, 
-               diskname, (unsigned long long)chunk[i].disk_start_sector - 2048);
+            /* zero target has no parameter, the string is already zeroed */
+            strcpy(spec->target_type, "zero");
         }
         else
         {
-            printf("%u %u linear %s1 %llu\n", 
-               (sector_start << 2), disk_sector_num, 
-               diskname, (unsigned long long)chunk[i].disk_start_sector - 2048);
+            strcpy(spec->target_type, "linear");
+            sprintf(pos + sizeof(struct dm_target_spec), "%s %llu", part, (unsigned long long)table[i].offset);
         }
-        #endif
+        pos += speclen;
     }
 
-    free(chunk);
-    return 0;
+    if (ioctl(fd, DM_TABLE_LOAD, head) < 0)
+    {
+        fprintf(stderr, "Failed to load dm table for %s err:%d\n", name, errno);
+        goto end;
+    }
+
+    /* resume makes the new table live */
+    vtoydm_ioctl_init(&io, sizeof(io), name);
+    if (ioctl(fd, DM_DEV_SUSPEND, &io) < 0)
+    {
+        fprintf(stderr, "Failed to resume dm %s err:%d\n", name, errno);
+        goto end;
+    }
+
+    snprintf(devpath, sizeof(devpath), "/dev/mapper/%s", name);
+    if (access(devpath, F_OK) < 0)
+    {
+        mkdir("/dev/mapper", 0755);
+        mknod(devpath, S_IFBLK | 0600, (dev_t)io.dev);
+    }
+
+    debug("dm %s created with %d targets dev 0x%llx\n", name, count, (unsigned long long)io.dev);
+    rc = 0;
+
+end:
+    if (rc && created)
+    {
+        vtoydm_ioctl_init(&io, sizeof(io), name);
+        ioctl(fd, DM_DEV_REMOVE, &io);
+    }
+
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+
+    if (buf)
+    {
+        free(buf);
+    }
+
+    free(table);
+    return rc;
 }
 
 static int vtoydm_print_help(FILE *fp)
 {
     fprintf(fp, "Usage: \n"
-            "   vtoydm -p -f img_map_file -d diskname [ -v ] \n"
-            "   vtoydm -c -f img_map_file -d diskname [ -v ] \n"
+            "   vtoydm -p -f img_map_file -d diskname [ -l image_size ] [ -v ] \n"
+            "   vtoydm -c -f img_map_file -d diskname [ -n dmname ] [ -r ] [ -l image_size ] [ -v ] \n"
             "   vtoydm -i -f img_map_file -d diskname [ -v ] \n"
             "   vtoydm -e -f img_map_file -d diskname -s sector -l len -o file [ -v ] \n"
+            "   vtoydm -m manifest -f img_map_file -d diskname [ -v ] \n"
             );
     return 0;        
 }
@@ -543,13 +1267,16 @@ int vtoydm_main(int argc, char **argv)
 {
     int ch;
     int cmd = 0;
+    int readonly = 0;
     unsigned long first_sector = 0;
     unsigned long long file_size = 0;
     char diskname[128] = {0};
     char filepath[300] = {0};
     char outfile[300] = {0};
+    char dmname[128] = "ventoy";
+    char manifest[300] = {0};
 
-    while ((ch = getopt(argc, argv, "s:l:o:d:f:v::i::p::c::h::e::E::")) != -1)
+    while ((ch = getopt(argc, argv, "s:l:o:d:f:n:m:v::i::p::c::h::e::E::r::")) != -1)
     {
         if (ch == 'd')
         {
@@ -591,6 +1318,19 @@ int vtoydm_main(int argc, char **argv)
         {
             strncpy(outfile, optarg, sizeof(outfile) - 1);
         }
+        else if (ch == 'm')
+        {
+            cmd = CMD_EXTRACT_MANIFEST;
+            strncpy(manifest, optarg, sizeof(manifest) - 1);
+        }
+        else if (ch == 'n')
+        {
+            strncpy(dmname, optarg, sizeof(dmname) - 1);
+        }
+        else if (ch == 'r')
+        {
+            readonly = 1;
+        }
         else if (ch == 'v')
         {
             verbose = 1;
@@ -619,11 +1359,11 @@ int vtoydm_main(int argc, char **argv)
     {
         case CMD_PRINT_TABLE:
         {
-            return vtoydm_print_linear_table(filepath, diskname);
+            return vtoydm_print_linear_table(filepath, diskname, file_size);
         }
         case CMD_CREATE_DM:
         {
-            break;
+            return vtoydm_create_dm(filepath, diskname, dmname, file_size, readonly);
         }
         case CMD_DUMP_ISO_INFO:
         {
@@ -633,6 +1373,10 @@ int vtoydm_main(int argc, char **argv)
         {
             return vtoydm_extract_iso(filepath, diskname, first_sector, file_size, outfile);
         }
+        case CMD_EXTRACT_MANIFEST:
+        {
+            return vtoydm_extract_manifest(filepath, diskname, manifest);
+        }
         case CMD_PRINT_EXTRACT_ISO_FILE:
         {
             return vtoydm_print_extract_iso(filepath, diskname, first_sector, file_size, outfile);
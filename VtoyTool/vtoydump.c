@@ -29,11 +29,18 @@
 #include <sys/ioctl.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/socket.h>
 #include <linux/fs.h>
+#include <linux/netlink.h>
 #include <dirent.h>
+#include <poll.h>
+#include <time.h>
 
 #define IS_DIGIT(x) ((x) >= '0' && (x) <= '9')
 
+/* same as makedev() in glibc, some of our libc don't have sys/sysmacros.h */
+#define VTOY_MKDEV(ma, mi)  ((((ma) & 0xfff) << 8) | ((mi) & 0xff) | (((mi) & 0xfff00) << 12))
+
 #ifndef USE_DIET_C
 #ifndef __mips__
 typedef unsigned long long uint64_t;
@@ -480,15 +487,10 @@ static int vtoy_check_device(ventoy_os_param *param, const char *device)
     }
 }
 
-static int vtoy_print_os_param(ventoy_os_param *param, char *diskname)
+static int vtoy_find_ventoy_disk(ventoy_os_param *param, char *diskname)
 {
-    int fd, size;
     int cnt = 0;
-    char *path = param->vtoy_img_path;
-    const char *fs;
-    char diskpath[256] = {0};
-    char sizebuf[64] = {0};
-    
+
     cnt = vtoy_find_disk_by_size(param->vtoy_disk_size, diskname);
     debug("find disk by size %llu, cnt=%d...\n", (unsigned long long)param->vtoy_disk_size, cnt);
     if (1 == cnt)
@@ -503,6 +505,63 @@ static int vtoy_print_os_param(ventoy_os_param *param, char *diskname)
         cnt = vtoy_find_disk_by_guid(param, diskname);
         debug("find disk by guid cnt=%d...\n", cnt);
     }
+
+    return cnt;
+}
+
+static void vtoy_get_part2_name(const char *diskname, char *partname, int len)
+{
+    if (strstr(diskname, "nvme") || strstr(diskname, "mmc") || strstr(diskname, "nbd"))
+    {
+        snprintf(partname, len - 1, "%sp2", diskname);
+    }
+    else
+    {
+        snprintf(partname, len - 1, "%s2", diskname);
+    }
+}
+
+/* 0: part2 size ok or unknown    1: part2 exist but it's not the VTOYEFI partition */
+static int vtoy_check_part2_size(const char *partname)
+{
+    int fd, size;
+    char diskpath[256] = {0};
+    char sizebuf[64] = {0};
+
+    snprintf(diskpath, sizeof(diskpath) - 1, "/sys/class/block/%s/size", partname);
+    if (access(diskpath, F_OK) >= 0)
+    {
+        debug("get part size from sysfs for %s\n", diskpath);
+
+        fd = open(diskpath, O_RDONLY | O_BINARY);
+        if (fd >= 0)
+        {
+            read(fd, sizebuf, sizeof(sizebuf));
+            size = (int)strtoull(sizebuf, NULL, 10);
+            close(fd);
+            if ((size != (64 * 1024)) && (size != (8 * 1024)))
+            {
+                debug("sizebuf=<%s> size=%d\n", sizebuf, size);
+                return 1;
+            }
+        }
+    }
+    else
+    {
+        debug("%s not exist \n", diskpath);
+    }
+
+    return 0;
+}
+
+static int vtoy_print_os_param(ventoy_os_param *param, char *diskname)
+{
+    int cnt = 0;
+    char *path = param->vtoy_img_path;
+    const char *fs;
+    char partname[256] = {0};
+
+    cnt = vtoy_find_ventoy_disk(param, diskname);
     
     if (param->vtoy_disk_part_type < ventoy_fs_max)
     {
@@ -515,44 +574,259 @@ static int vtoy_print_os_param(ventoy_os_param *param, char *diskname)
 
     if (1 == cnt)
     {
-        if (strstr(diskname, "nvme") || strstr(diskname, "mmc") || strstr(diskname, "nbd"))
+        vtoy_get_part2_name(diskname, partname, sizeof(partname));
+        if (vtoy_check_part2_size(partname))
         {
-            snprintf(diskpath, sizeof(diskpath) - 1, "/sys/class/block/%sp2/size", diskname);
+            return 1;
         }
-        else
+
+        printf("/dev/%s#%s#%s\n", diskname, fs, path);
+        return 0;
+    }
+    else
+    {
+        return 1;
+    }
+}
+
+/* 
+ * Create /dev/xxx from /sys/class/block/xxx/dev if it doesn't exist.
+ * Some distros only populate /dev when mdev -s is called, we don't want to wait for that.
+ */
+static int vtoy_make_dev_node(const char *name)
+{
+    int fd;
+    int len;
+    char *pos = NULL;
+    unsigned int major, minor;
+    char devpath[256] = {0};
+    char buf[64] = {0};
+
+    snprintf(devpath, sizeof(devpath) - 1, "/dev/%s", name);
+    if (access(devpath, F_OK) >= 0)
+    {
+        return 0;
+    }
+
+    snprintf(devpath, sizeof(devpath) - 1, "/sys/class/block/%s/dev", name);
+    fd = open(devpath, O_RDONLY | O_BINARY);
+    if (fd < 0)
+    {
+        debug("failed to open %s %d\n", devpath, errno);
+        return 1;
+    }
+
+    len = (int)read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+
+    pos = strchr(buf, ':');
+    if (len <= 0 || pos == NULL)
+    {
+        return 1;
+    }
+
+    major = (unsigned int)strtoul(buf, NULL, 10);
+    minor = (unsigned int)strtoul(pos + 1, NULL, 10);
+
+    snprintf(devpath, sizeof(devpath) - 1, "/dev/%s", name);
+    if (mknod(devpath, S_IFBLK | 0660, VTOY_MKDEV(major, minor)) < 0 && errno != EEXIST)
+    {
+        debug("failed to mknod %s %u:%u %d\n", devpath, major, minor, errno);
+        return 1;
+    }
+
+    debug("mknod %s %u:%u\n", devpath, major, minor);
+    return 0;
+}
+
+static void vtoy_make_all_dev_node(void)
+{
+    DIR* dir = NULL;
+    struct dirent* p = NULL;
+
+    dir = opendir("/sys/block");
+    if (!dir)
+    {
+        return;
+    }
+
+    while ((p = readdir(dir)) != NULL)
+    {
+        if (vtoy_is_possible_blkdev(p->d_name))
         {
-            snprintf(diskpath, sizeof(diskpath) - 1, "/sys/class/block/%s2/size", diskname);
+            vtoy_make_dev_node(p->d_name);
         }
+    }
+    closedir(dir);
+}
+
+/* 0: ventoy disk and its partition 2 are both ready */
+static int vtoy_check_disk_ready(ventoy_os_param *param, char *diskname, char *partname, int len)
+{
+    char partpath[300] = {0};
+
+    /* the disk guid is read from /dev/xxx, so the disk node must exist first */
+    vtoy_make_all_dev_node();
+
+    if (vtoy_find_ventoy_disk(param, diskname) != 1)
+    {
+        return 1;
+    }
+
+    vtoy_get_part2_name(diskname, partname, len);
+
+    snprintf(partpath, sizeof(partpath) - 1, "/sys/class/block/%s", partname);
+    if (access(partpath, F_OK) < 0)
+    {
+        debug("%s not exist yet\n", partpath);
+        return 1;
+    }
+
+    if (vtoy_check_part2_size(partname))
+    {
+        return 1;
+    }
 
-        if (access(diskpath, F_OK) >= 0)
+    return vtoy_make_dev_node(partname);
+}
+
+static int vtoy_uevent_open(void)
+{
+    int fd;
+    int size = 1024 * 1024;
+    struct sockaddr_nl addr;
+
+    fd = socket(AF_NETLINK, SOCK_DGRAM, NETLINK_KOBJECT_UEVENT);
+    if (fd < 0)
+    {
+        debug("failed to create uevent socket %d\n", errno);
+        return -1;
+    }
+
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+
+    /* group 1: kernel events    group 2: events sent by udev after the device node is created */
+    memset(&addr, 0, sizeof(addr));
+    addr.nl_family = AF_NETLINK;
+    addr.nl_pid = 0;
+    addr.nl_groups = 1 | 2;
+
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+    {
+        addr.nl_groups = 1;
+        if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
         {
-            debug("get part size from sysfs for %s\n", diskpath);
+            debug("failed to bind uevent socket %d\n", errno);
+            close(fd);
+            return -1;
+        }
+    }
+
+    return fd;
+}
 
-            fd = open(diskpath, O_RDONLY | O_BINARY);
-            if (fd >= 0)
+/* drain all the pending uevents, return 1 if any of them is about a block device */
+static int vtoy_uevent_drain(int fd)
+{
+    int i;
+    int len;
+    int block = 0;
+    char buf[4096];
+
+    while ((len = (int)recv(fd, buf, sizeof(buf) - 1, MSG_DONTWAIT)) > 0)
+    {
+        buf[len] = 0;
+        for (i = 0; i < len; i += (int)strlen(buf + i) + 1)
+        {
+            if (strcmp(buf + i, "SUBSYSTEM=block") == 0)
             {
-                read(fd, sizebuf, sizeof(sizebuf));
-                size = (int)strtoull(sizebuf, NULL, 10);
-                close(fd);
-                if ((size != (64 * 1024)) && (size != (8 * 1024)))
-                {
-                    debug("sizebuf=<%s> size=%d\n", sizebuf, size);
-                    return 1;
-                }
+                block = 1;
+                break;
             }
         }
-        else
+        debug("uevent <%s> block:%d\n", buf, block);
+    }
+
+    if (len < 0 && errno == ENOBUFS)
+    {
+        /* some events were lost, just check again */
+        block = 1;
+    }
+
+    return block;
+}
+
+/*
+ * Wait until the ventoy disk and its partition 2 appear, then print "/dev/sdX /dev/sdX2".
+ * The uevent socket is opened before the first check, so a disk attached in between is not missed.
+ * If netlink is not available, fall back to check once per second.
+ * timeout 0 means wait forever.
+ */
+static int vtoy_wait_os_disk(ventoy_os_param *param, char *diskname, int timeout)
+{
+    int fd;
+    int ret;
+    int wait;
+    int loop = 0;
+    time_t start, now;
+    struct pollfd pfd;
+    char partname[256] = {0};
+
+    fd = vtoy_uevent_open();
+    start = time(NULL);
+
+    while (1)
+    {
+        loop++;
+        if (vtoy_check_disk_ready(param, diskname, partname, sizeof(partname)) == 0)
         {
-            debug("%s not exist \n", diskpath);
+            debug("ventoy disk ready after %d checks %d seconds\n", loop, (int)(time(NULL) - start));
+            printf("/dev/%s /dev/%s\n", diskname, partname);
+            ret = 0;
+            break;
         }
 
-        printf("/dev/%s#%s#%s\n", diskname, fs, path);
-        return 0;
+        now = time(NULL);
+        if (timeout > 0 && now - start >= timeout)
+        {
+            fprintf(stderr, "wait for ventoy disk timeout %d seconds\n", timeout);
+            ret = 1;
+            break;
+        }
+
+        /* 
+         * Even with uevent, we still wake up every second. 
+         * Because the node may be created by mdev/udev without any uevent for us.
+         */
+        wait = 1000;
+        if (timeout > 0 && (timeout - (now - start)) * 1000 < wait)
+        {
+            wait = (int)(timeout - (now - start)) * 1000;
+        }
+
+        if (fd >= 0)
+        {
+            /* skip the events about other subsystems, no need to scan the disks for them */
+            pfd.fd = fd;
+            pfd.events = POLLIN;
+            pfd.revents = 0;
+            while (poll(&pfd, 1, wait) > 0 && vtoy_uevent_drain(fd) == 0 && time(NULL) <= now)
+            {
+                ;
+            }
+        }
+        else
+        {
+            usleep(wait * 1000);
+        }
     }
-    else
+
+    if (fd >= 0)
     {
-        return 1;
+        close(fd);
     }
+
+    return ret;
 }
 
 /*
@@ -563,6 +837,7 @@ static int vtoy_print_os_param(ventoy_os_param *param, char *diskname)
  *  -c /dev/xxx     check ventoy disk
  *  -v              be verbose
  *  -l              also print image disk location 
+ *  -w timeout      wait for the ventoy disk (0 means forever) and print "/dev/sdX /dev/sdX2"
  */
 int vtoydump_main(int argc, char **argv)
 {
@@ -570,12 +845,14 @@ int vtoydump_main(int argc, char **argv)
     int ch;
     int print_path = 0;
     int print_fs = 0;
+    int wait_disk = 0;
+    int timeout = 0;
     char filename[256] = {0};
     char diskname[256] = {0};
     char device[64] = {0};
     ventoy_os_param *param = NULL;
 
-    while ((ch = getopt(argc, argv, "c:f:p:s:v::")) != -1)
+    while ((ch = getopt(argc, argv, "c:f:p:s:w:v::")) != -1)
     {
         if (ch == 'f')
         {
@@ -599,16 +876,21 @@ int vtoydump_main(int argc, char **argv)
             print_fs = 1;
             strncpy(filename, optarg, sizeof(filename) - 1);
         }
+        else if (ch == 'w')
+        {
+            wait_disk = 1;
+            timeout = (int)strtol(optarg, NULL, 10);
+        }
         else
         {
-            fprintf(stderr, "Usage: %s -f datafile [ -v ] \n", argv[0]);
+            fprintf(stderr, "Usage: %s -f datafile [ -w timeout ] [ -v ] \n", argv[0]);
             return 1;
         }
     }
 
     if (filename[0] == 0)
     {
-        fprintf(stderr, "Usage: %s -f datafile [ -v ] \n", argv[0]);
+        fprintf(stderr, "Usage: %s -f datafile [ -w timeout ] [ -v ] \n", argv[0]);
         return 1;
     }
 
@@ -659,6 +941,10 @@ int vtoydump_main(int argc, char **argv)
     {
         rc = vtoy_check_device(param, device);
     }
+    else if (wait_disk)
+    {
+        rc = vtoy_wait_os_disk(param, diskname, timeout);
+    }
     else
     {
         // print os param, you can change the output format in the function
@@ -36,6 +36,8 @@ int vtoydm_main(int argc, char **argv);
 int vtoytool_install(int argc, char **argv);
 int vtoyloader_main(int argc, char **argv);
 int vtoyvine_main(int argc, char **argv);
+int vtoydefrag_main(int argc, char **argv);
+int vtoyblk_main(int argc, char **argv);
 
 static char *g_vtoytool_name = NULL;
 static cmd_def g_cmd_list[] = 
@@ -44,6 +46,8 @@ static cmd_def g_cmd_list[] =
     { "vtoydump",    vtoydump_main    },
     { "vtoydm",      vtoydm_main      },
     { "loader",      vtoyloader_main  },
+    { "vtoydefrag",  vtoydefrag_main  },
+    { "vtoyblk",     vtoyblk_main     },
     { "--install",   vtoytool_install },
 };
 